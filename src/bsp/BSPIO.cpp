@@ -67,6 +67,93 @@ void FastBSPDataChecksum( DATA& data )
 	data.checksum = FastChecksum( data.data, data.count * sizeof( typename DATA::Type_t ) );
 }
 
+CBSPView::~CBSPView()
+{
+	if( m_pMapped )
+		g_pFileSystem->UnmapFile( m_pMapped );
+}
+
+std::unique_ptr<CBSPView> OpenBSPFile( const char* const pszFileName, const bool bAllowMapping )
+{
+	assert( pszFileName );
+
+	CFile file( pszFileName, "rb" );
+
+	if( !file.IsOpen() )
+	{
+		printf( "Couldn't open BSP file \"%s\"\n", pszFileName );
+		return nullptr;
+	}
+
+	std::unique_ptr<CBSPView> view( new CBSPView() );
+
+	if( bAllowMapping )
+	{
+		uint64_t uiSize = 0;
+
+		view->m_pMapped = g_pFileSystem->MapFile( file.GetFileHandle(), uiSize );
+
+		if( view->m_pMapped )
+		{
+			view->m_pBase = reinterpret_cast<const uint8_t*>( view->m_pMapped );
+			view->m_uiSize = static_cast<size_t>( uiSize );
+		}
+	}
+
+	//Mapping disabled or not possible, read it into the heap instead.
+	if( !view->m_pMapped )
+	{
+		const auto size = file.Size();
+
+		view->m_Buffer.reset( new uint8_t[ size ] );
+
+		const auto readCount = file.Read( view->m_Buffer.get(), size );
+
+		if( readCount < 0 || static_cast<uint64_t>( readCount ) != size )
+		{
+			printf( "Error reading BSP file \"%s\": expected %u bytes, read %d\n", pszFileName, size, readCount );
+			return nullptr;
+		}
+
+		view->m_pBase = view->m_Buffer.get();
+		view->m_uiSize = size;
+	}
+
+	if( view->m_uiSize < sizeof( dheader_t ) )
+	{
+		printf( "BSP file \"%s\" is too small to be a BSP file\n", pszFileName );
+		return nullptr;
+	}
+
+	//The header is the only thing that's always converted; the file contents themselves are never modified.
+	memcpy( &view->m_Header, view->m_pBase, sizeof( dheader_t ) );
+
+	for( size_t uiIndex = 0; uiIndex < sizeof( dheader_t ) / 4; ++uiIndex )
+	{
+		reinterpret_cast<int*>( &view->m_Header )[ uiIndex ] = LittleValue( reinterpret_cast<int*>( &view->m_Header )[ uiIndex ] );
+	}
+
+	if( view->m_Header.version != BSPVERSION )
+	{
+		printf( "BSP file \"%s\" is version %d, not %d\n", pszFileName, view->m_Header.version, BSPVERSION );
+		return nullptr;
+	}
+
+	for( int iLump = LUMP_FIRST; iLump <= LUMP_LAST; ++iLump )
+	{
+		const lump_t& lump = view->m_Header.lumps[ iLump ];
+
+		if( lump.fileofs < 0 || lump.filelen < 0 ||
+			static_cast<uint64_t>( lump.fileofs ) + static_cast<uint64_t>( lump.filelen ) > static_cast<uint64_t>( view->m_uiSize ) )
+		{
+			printf( "BSP file \"%s\" has an invalid lump %d (offset %d, length %d)\n", pszFileName, iLump, lump.fileofs, lump.filelen );
+			return nullptr;
+		}
+	}
+
+	return view;
+}
+
 std::unique_ptr<dheader_t> LoadBSPFile( const char* const pszFileName )
 {
 	assert( pszFileName );
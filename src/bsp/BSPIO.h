@@ -10,11 +10,94 @@
 #ifndef BSP_BSPIO_H
 #define BSP_BSPIO_H
 
+#include <cstdint>
 #include <memory>
 
 #include "BSPConstants.h"
 #include "BSPFile.h"
 
+/**
+*	Read-only view of the contents of a BSP file.
+*	The contents are either memory mapped through the filesystem, or read into the heap if mapping is disabled or not possible.
+*	Lump data is accessed in place; loaders should only copy data that has to be converted.
+*	@see OpenBSPFile
+*/
+class CBSPView final
+{
+public:
+	CBSPView() = default;
+	~CBSPView();
+
+	/**
+	*	@return Whether the file is memory mapped (true) or stored in the heap (false).
+	*/
+	bool IsMapped() const { return m_pMapped != nullptr; }
+
+	/**
+	*	@return Pointer to the start of the file.
+	*/
+	const uint8_t* GetBase() const { return m_pBase; }
+
+	/**
+	*	@return Size of the file, in bytes.
+	*/
+	size_t GetSize() const { return m_uiSize; }
+
+	/**
+	*	@return The file header, converted to native byte order.
+	*/
+	const dheader_t& GetHeader() const { return m_Header; }
+
+	/**
+	*	@return The given lump's header, converted to native byte order.
+	*/
+	const lump_t& GetLump( const BSPLump lump ) const { return m_Header.lumps[ lump ]; }
+
+	/**
+	*	@return Pointer to the given lump's data.
+	*/
+	const uint8_t* GetLumpData( const BSPLump lump ) const { return m_pBase + m_Header.lumps[ lump ].fileofs; }
+
+	/**
+	*	@return Whether the given pointer points into this file's data.
+	*/
+	bool Contains( const void* pData ) const
+	{
+		return reinterpret_cast<const uint8_t*>( pData ) >= m_pBase && reinterpret_cast<const uint8_t*>( pData ) < m_pBase + m_uiSize;
+	}
+
+private:
+	friend std::unique_ptr<CBSPView> OpenBSPFile( const char* const pszFileName, const bool bAllowMapping );
+
+	dheader_t m_Header = {};
+
+	const uint8_t* m_pBase = nullptr;
+	size_t m_uiSize = 0;
+
+	/**
+	*	Mapping returned by the filesystem, if the file is mapped.
+	*/
+	const void* m_pMapped = nullptr;
+
+	/**
+	*	Heap copy of the file, if the file is not mapped.
+	*/
+	std::unique_ptr<uint8_t[]> m_Buffer;
+
+private:
+	CBSPView( const CBSPView& ) = delete;
+	CBSPView& operator=( const CBSPView& ) = delete;
+};
+
+/**
+*	Opens a BSP file for read-only access.
+*	The header is validated: the version must match and all lumps must lie within the file.
+*	@param pszFileName Name of the file to open.
+*	@param bAllowMapping Whether the file may be memory mapped. If false, or if mapping fails, the file is read into the heap.
+*	@return The file view, or null if the file couldn't be opened or is invalid.
+*/
+std::unique_ptr<CBSPView> OpenBSPFile( const char* const pszFileName, const bool bAllowMapping = true );
+
 std::unique_ptr<dheader_t> LoadBSPFile( const char* const pszFileName );
 
 bool LoadBSPFile( const char* const pszFileName, CBSPFile& file );
@@ -28,6 +28,7 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #include "BSPFile.h"
 
 struct msurface_t;
+class CMemoryArena;
 
 /**
 *	in memory representation
@@ -146,6 +147,9 @@ struct texture_t
 #define SURF_DRAWBACKGROUND	0x40
 #define SURF_UNDERWATER		0x80
 
+/**
+*	Largest surface lightmap that can be built, in texels.
+*/
 #define	BLOCK_WIDTH		128
 #define	BLOCK_HEIGHT	128
 
@@ -220,16 +224,6 @@ struct glpoly_t
 	*/
 	int flags;
 
-	/**
-	*	Experimental. The OpenGL VBO ID.
-	*/
-	GLuint VBO;
-
-	/**
-	*	Experimental. The OpenGL VAO ID.
-	*/
-	GLuint VAO;
-
 	/**
 	*	List of vertex commands.
 	*	variable sized (xyz s1t1 s2t2)
@@ -324,6 +318,11 @@ struct msurface_t
 	*/
 	GLuint lightmaptexturenum;
 
+	/**
+	*	Index of the lightmap page that contains this surface's lightmap.
+	*/
+	int lightmappage;
+
 	/**
 	*	Light style indices.
 	*/
@@ -339,11 +338,16 @@ struct msurface_t
 	*/
 	bool cached_dlight;
 
+	/**
+	*	Lightmap update in which this surface's lightmap was last rebuilt.
+	*/
+	int lightmapframe;
+
 	/**
 	*	Lighting data.
 	*	[numstyles*surfsize]
 	*/
-	uint8_t* samples;
+	const uint8_t* samples;
 };
 
 struct mnode_t
@@ -441,7 +445,7 @@ struct mleaf_t
 	/**
 	*	Compressed vis data.
 	*/
-	uint8_t* compressed_vis;
+	const uint8_t* compressed_vis;
 
 	/**
 	*	Fragment info?
@@ -480,7 +484,7 @@ struct hull_t
 	/**
 	*	Clipnodes in this hull.
 	*/
-	dclipnode_t* clipnodes;
+	const dclipnode_t* clipnodes;
 
 	/**
 	*	Planes in this hull.
@@ -557,19 +561,24 @@ struct bmodel_t
 	msurface_t	*surfaces;
 
 	int			numsurfedges;
-	int			*surfedges;
+	const int	*surfedges;
 
 	int			numclipnodes;
-	dclipnode_t	*clipnodes;
+	const dclipnode_t	*clipnodes;
 
 	int			nummarksurfaces;
 	msurface_t	**marksurfaces;
 
 	hull_t		hulls[ MAX_MAP_HULLS ];
 
-	byte		*visdata;
-	byte		*lightdata;
+	const byte	*visdata;
+	const byte	*lightdata;
 	char		*entities;
+
+	/**
+	*	Arena that all of this model's data is allocated from. Owned by the world model; submodels share it.
+	*/
+	CMemoryArena* arena;
 };
 
 #endif //BSP_BSPRENDERDEFS_H
\ No newline at end of file
@@ -0,0 +1,104 @@
+#include <algorithm>
+#include <cassert>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "Logging.h"
+
+#include "CMemoryArena.h"
+
+CMemoryArena::~CMemoryArena()
+{
+	Clear();
+}
+
+bool CMemoryArena::Reserve( const size_t uiSize )
+{
+	if( m_pHead && ( m_pHead->uiSize - m_pHead->uiUsed ) >= uiSize )
+		return true;
+
+	return AllocateBlock( uiSize ) != nullptr;
+}
+
+void* CMemoryArena::Allocate( const size_t uiSize, const size_t uiAlignment )
+{
+	assert( uiAlignment > 0 && ( uiAlignment & ( uiAlignment - 1 ) ) == 0 );
+
+	if( uiSize == 0 )
+		return nullptr;
+
+	for( int iAttempt = 0; iAttempt < 2; ++iAttempt )
+	{
+		if( m_pHead )
+		{
+			const uintptr_t start = reinterpret_cast<uintptr_t>( m_pHead->GetData() + m_pHead->uiUsed );
+			const uintptr_t aligned = ( start + ( uiAlignment - 1 ) ) & ~static_cast<uintptr_t>( uiAlignment - 1 );
+			const size_t uiPadding = aligned - start;
+
+			if( m_pHead->uiUsed + uiPadding + uiSize <= m_pHead->uiSize )
+			{
+				m_pHead->uiUsed += uiPadding + uiSize;
+				m_uiAllocatedBytes += uiSize;
+
+				void* pMemory = reinterpret_cast<void*>( aligned );
+
+				memset( pMemory, 0, uiSize );
+
+				return pMemory;
+			}
+		}
+
+		//Out of reserved memory, start a new block.
+		//Callers write to the memory right away, so there is no way to recover if this fails.
+		if( !AllocateBlock( std::max( EstimateSize( uiSize, uiAlignment ), MIN_OVERFLOW_BLOCK_SIZE ) ) )
+		{
+			char szMessage[ 256 ];
+
+			snprintf( szMessage, sizeof( szMessage ), "CMemoryArena::Allocate: Out of memory allocating %u bytes\n", static_cast<unsigned int>( uiSize ) );
+
+			Warning( "%s", szMessage );
+
+			UTIL_ShowMessageBox( szMessage, "Fatal Error", LogType::ERROR );
+
+			abort();
+		}
+	}
+
+	return nullptr;
+}
+
+void CMemoryArena::Clear()
+{
+	for( Block_t* pBlock = m_pHead, *pNext; pBlock; pBlock = pNext )
+	{
+		pNext = pBlock->pNext;
+
+		free( pBlock );
+	}
+
+	m_pHead = nullptr;
+
+	m_uiAllocatedBytes = 0;
+	m_uiReservedBytes = 0;
+	m_uiBlockCount = 0;
+}
+
+CMemoryArena::Block_t* CMemoryArena::AllocateBlock( const size_t uiSize )
+{
+	auto pBlock = reinterpret_cast<Block_t*>( malloc( sizeof( Block_t ) + uiSize ) );
+
+	if( !pBlock )
+		return nullptr;
+
+	pBlock->pNext = m_pHead;
+	pBlock->uiSize = uiSize;
+	pBlock->uiUsed = 0;
+
+	m_pHead = pBlock;
+
+	m_uiReservedBytes += uiSize;
+	++m_uiBlockCount;
+
+	return pBlock;
+}
@@ -0,0 +1,127 @@
+#ifndef COMMON_CMEMORYARENA_H
+#define COMMON_CMEMORYARENA_H
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <type_traits>
+
+/**
+*	Linear memory arena.
+*	Allocations are carved out of large blocks and are never freed individually; all memory is released at once.
+*	If the reserved size turns out to be too small, additional blocks are allocated as needed.
+*	Only suitable for trivially destructible types, since destructors are never called.
+*/
+class CMemoryArena final
+{
+public:
+	/**
+	*	Default alignment of allocations.
+	*/
+	static const size_t DEFAULT_ALIGNMENT = alignof( std::max_align_t );
+
+	/**
+	*	Minimum size of blocks allocated when the reserved memory runs out.
+	*/
+	static const size_t MIN_OVERFLOW_BLOCK_SIZE = 64 * 1024;
+
+public:
+	CMemoryArena() = default;
+	~CMemoryArena();
+
+	/**
+	*	@return Total number of bytes allocated from this arena, not counting padding.
+	*/
+	size_t GetAllocatedBytes() const { return m_uiAllocatedBytes; }
+
+	/**
+	*	@return Total number of bytes reserved in blocks.
+	*/
+	size_t GetReservedBytes() const { return m_uiReservedBytes; }
+
+	/**
+	*	@return Number of blocks allocated by this arena.
+	*/
+	size_t GetBlockCount() const { return m_uiBlockCount; }
+
+	/**
+	*	Reserves a block that can hold at least the given number of bytes.
+	*	Should be called before any allocations are made, with an estimate of the total size.
+	*	@param uiSize Number of bytes to reserve.
+	*	@return Whether the memory could be reserved.
+	*/
+	bool Reserve( const size_t uiSize );
+
+	/**
+	*	Allocates zero initialized memory.
+	*	@param uiSize Number of bytes to allocate.
+	*	@param uiAlignment Alignment of the memory. Must be a power of 2.
+	*	Aborts with a fatal error if the memory couldn't be allocated.
+	*	@return Pointer to the memory, or null if uiSize is 0.
+	*/
+	void* Allocate( const size_t uiSize, const size_t uiAlignment = DEFAULT_ALIGNMENT );
+
+	/**
+	*	Allocates a zero initialized array of the given type.
+	*	@param uiCount Number of elements.
+	*	Aborts with a fatal error if the memory couldn't be allocated.
+	*	@return Pointer to the array, or null if uiCount is 0.
+	*/
+	template<typename T>
+	T* Allocate( const size_t uiCount )
+	{
+		static_assert( std::is_trivially_destructible<T>::value, "Arena allocated types must be trivially destructible" );
+
+		return reinterpret_cast<T*>( Allocate( sizeof( T ) * uiCount, alignof( T ) ) );
+	}
+
+	/**
+	*	Frees all memory in this arena. Any pointers returned by it are invalidated.
+	*/
+	void Clear();
+
+	/**
+	*	Estimates how many bytes an allocation of the given size takes up, including worst case padding.
+	*/
+	static size_t EstimateSize( const size_t uiSize, const size_t uiAlignment = DEFAULT_ALIGNMENT )
+	{
+		return uiSize + uiAlignment - 1;
+	}
+
+	/**
+	*	@copydoc EstimateSize( const size_t, const size_t )
+	*/
+	template<typename T>
+	static size_t EstimateSize( const size_t uiCount )
+	{
+		return EstimateSize( sizeof( T ) * uiCount, alignof( T ) );
+	}
+
+private:
+	struct Block_t
+	{
+		Block_t* pNext;
+		size_t uiSize;
+		size_t uiUsed;
+
+		uint8_t* GetData() { return reinterpret_cast<uint8_t*>( this + 1 ); }
+	};
+
+	Block_t* AllocateBlock( const size_t uiSize );
+
+private:
+	/**
+	*	Block currently being allocated from. Older blocks are linked after it.
+	*/
+	Block_t* m_pHead = nullptr;
+
+	size_t m_uiAllocatedBytes = 0;
+	size_t m_uiReservedBytes = 0;
+	size_t m_uiBlockCount = 0;
+
+private:
+	CMemoryArena( const CMemoryArena& ) = delete;
+	CMemoryArena& operator=( const CMemoryArena& ) = delete;
+};
+
+#endif //COMMON_CMEMORYARENA_H
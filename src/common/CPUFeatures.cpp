@@ -0,0 +1,107 @@
+#if defined( _MSC_VER ) && ( defined( _M_IX86 ) || defined( _M_X64 ) )
+#include <intrin.h>
+#endif
+
+#include "Platform.h"
+
+#include "CPUFeatures.h"
+
+namespace
+{
+bool CPUSupports( const SIMDLevel level )
+{
+#if CPU_X86
+#ifdef _MSC_VER
+	int info[ 4 ];
+
+	__cpuid( info, 0 );
+
+	const int iMaxLeaf = info[ 0 ];
+
+	__cpuid( info, 1 );
+
+	switch( level )
+	{
+	case SIMDLevel::SSE2: return ( info[ 3 ] & ( 1 << 26 ) ) != 0;
+
+	case SIMDLevel::AVX2:
+		{
+			//The OS must save the YMM registers as well.
+			const bool bOSXSave = ( info[ 2 ] & ( 1 << 27 ) ) != 0;
+			const bool bAVX = ( info[ 2 ] & ( 1 << 28 ) ) != 0;
+
+			if( !bOSXSave || !bAVX || iMaxLeaf < 7 )
+				return false;
+
+			if( ( _xgetbv( 0 ) & 6 ) != 6 )
+				return false;
+
+			__cpuidex( info, 7, 0 );
+
+			return ( info[ 1 ] & ( 1 << 5 ) ) != 0;
+		}
+
+	default: return false;
+	}
+#else
+	__builtin_cpu_init();
+
+	switch( level )
+	{
+	case SIMDLevel::SSE2: return __builtin_cpu_supports( "sse2" ) != 0;
+	case SIMDLevel::AVX2: return __builtin_cpu_supports( "avx2" ) != 0;
+	default: return false;
+	}
+#endif
+#else
+	return false;
+#endif
+}
+}
+
+const char* SIMDLevelToString( const SIMDLevel level )
+{
+	switch( level )
+	{
+	case SIMDLevel::NONE:	return "none";
+	case SIMDLevel::SSE2:	return "sse2";
+	case SIMDLevel::AVX2:	return "avx2";
+	default:				return "unknown";
+	}
+}
+
+bool SIMDLevelFromString( const char* pszName, SIMDLevel& level )
+{
+	for( int iLevel = 0; iLevel < static_cast<int>( SIMDLevel::COUNT ); ++iLevel )
+	{
+		if( !stricmp( pszName, SIMDLevelToString( static_cast<SIMDLevel>( iLevel ) ) ) )
+		{
+			level = static_cast<SIMDLevel>( iLevel );
+			return true;
+		}
+	}
+
+	return false;
+}
+
+bool IsSIMDLevelSupported( const SIMDLevel level )
+{
+	if( level == SIMDLevel::NONE )
+		return true;
+
+	if( level < SIMDLevel::NONE || level >= SIMDLevel::COUNT )
+		return false;
+
+	return CPUSupports( level );
+}
+
+SIMDLevel GetBestSIMDLevel()
+{
+	for( int iLevel = static_cast<int>( SIMDLevel::COUNT ) - 1; iLevel > static_cast<int>( SIMDLevel::NONE ); --iLevel )
+	{
+		if( IsSIMDLevelSupported( static_cast<SIMDLevel>( iLevel ) ) )
+			return static_cast<SIMDLevel>( iLevel );
+	}
+
+	return SIMDLevel::NONE;
+}
@@ -0,0 +1,63 @@
+#ifndef COMMON_CPUFEATURES_H
+#define COMMON_CPUFEATURES_H
+
+/**
+*	@file Runtime detection of the instruction sets that SIMD kernels can use.
+*/
+
+#if defined( __i386__ ) || defined( __x86_64__ ) || defined( _M_IX86 ) || defined( _M_X64 )
+#define CPU_X86 1
+#else
+#define CPU_X86 0
+#endif
+
+#if CPU_X86
+#include <immintrin.h>
+#endif
+
+/**
+*	MSVC allows intrinsics for any instruction set, GCC and Clang need the function to be compiled for it.
+*	Put this in front of functions that use intrinsics for an instruction set that may not be available, e.g. CPU_TARGET( "avx2" ).
+*/
+#if CPU_X86 && !defined( _MSC_VER )
+#define CPU_TARGET( isa ) __attribute__( ( target( isa ) ) )
+#else
+#define CPU_TARGET( isa )
+#endif
+
+/**
+*	Instruction sets that SIMD kernels can use, in order of preference.
+*/
+enum class SIMDLevel
+{
+	NONE = 0,
+	SSE2,
+	AVX2,
+
+	COUNT
+};
+
+/**
+*	@return Name of the given instruction set.
+*/
+const char* SIMDLevelToString( const SIMDLevel level );
+
+/**
+*	Finds an instruction set by name. Case insensitive.
+*	@param pszName Name to look up.
+*	@param[ out ] level Instruction set with that name.
+*	@return Whether the name is known.
+*/
+bool SIMDLevelFromString( const char* pszName, SIMDLevel& level );
+
+/**
+*	@return Whether the CPU, and the OS for instruction sets with extra registers, supports the given instruction set.
+*/
+bool IsSIMDLevelSupported( const SIMDLevel level );
+
+/**
+*	@return The best instruction set supported by this CPU.
+*/
+SIMDLevel GetBestSIMDLevel();
+
+#endif //COMMON_CPUFEATURES_H
@@ -23,6 +23,103 @@ enum FileSystemFindFlag : FileSystemFindFlags_t
 };
 }
 
+/**
+*	Results of the last level load, measured between LogLevelLoadStarted and LogLevelLoadFinished.
+*/
+struct LevelLoadInfo_t
+{
+	/**
+	*	Time between the two calls, in microseconds.
+	*/
+	uint64_t uiMicroseconds;
+
+	/**
+	*	Number of files that were opened during the load and recorded in its trace.
+	*/
+	uint32_t uiTracedFiles;
+
+	/**
+	*	Number of files from the previous trace of the level that were queued for preloading or prefetched. 0 if there was no trace, or replay is disabled.
+	*/
+	uint32_t uiReplayedFiles;
+
+	/**
+	*	Number of bytes that were queued for preloading or prefetched.
+	*/
+	uint64_t uiReplayedBytes;
+};
+
+/**
+*	Filesystem lookup statistics.
+*/
+struct FileSystemStats_t
+{
+	/**
+	*	Number of path lookups made by Open, FileExists, IsDirectory and GetLocalPath.
+	*/
+	uint64_t uiLookups;
+
+	/**
+	*	Number of lookups that were answered by the path index.
+	*/
+	uint64_t uiIndexedLookups;
+
+	/**
+	*	Number of times the disk was queried to answer lookups: file status checks, opens and directory listings.
+	*/
+	uint64_t uiDiskQueries;
+
+	/**
+	*	Number of paths currently in the path index.
+	*/
+	uint64_t uiIndexedPaths;
+
+	/**
+	*	Number of bytes used by the directories of mounted pack files.
+	*/
+	uint64_t uiPackDirectoryBytes;
+
+	/**
+	*	Number of opens that were served from the preload cache.
+	*/
+	uint64_t uiPreloadHits;
+
+	/**
+	*	Number of files in the preload cache.
+	*/
+	uint64_t uiPreloadedFiles;
+
+	/**
+	*	Number of bytes used by queued and cached preloaded files.
+	*/
+	uint64_t uiPreloadedBytes;
+
+	/**
+	*	Number of block reads that were served from the block cache.
+	*/
+	uint64_t uiBlockCacheHits;
+
+	/**
+	*	Number of block reads that had to read from disk.
+	*/
+	uint64_t uiBlockCacheMisses;
+
+	/**
+	*	Number of blocks that were evicted from the block cache to stay within its budget.
+	*/
+	uint64_t uiBlockCacheEvictions;
+
+	/**
+	*	Number of blocks in the block cache.
+	*/
+	uint64_t uiBlockCacheBlocks;
+
+	/**
+	*	Number of bytes used by the block cache.
+	*/
+	uint64_t uiBlockCacheBytes;
+};
+
 /**
 *	PowerSource filesystem interface. Provides extended functionality to the filesystem used by GoldSource.
 */
@@ -91,6 +188,74 @@ public:
 	*	@see FullPathToRelativePath
 	*/
 	virtual bool			FullPathToRelativePathEx( const char *pFullpath, char *pRelative, size_t uiSizeInChars ) = 0;
+
+	/**
+	*	Maps the contents of an open file into memory for read-only access.
+	*	Files inside of pack files only map the pages that hold the file. Mappings of the same file are shared with read buffers.
+	*	The mapping remains valid after the file has been closed, until it is released with UnmapFile.
+	*	@param file Handle to the file.
+	*	@param[ out ] uiSize Size of the file's contents, in bytes.
+	*	@return Pointer to the file's contents, or null if the file could not be mapped.
+	*	@see UnmapFile
+	*/
+	virtual const void*		MapFile( FileHandle_t file, uint64_t& uiSize ) = 0;
+
+	/**
+	*	Releases a mapping that was created by MapFile.
+	*	@param pData Pointer that was returned by MapFile.
+	*/
+	virtual void			UnmapFile( const void* pData ) = 0;
+
+	/**
+	*	Enables or disables the path index. When disabled, every lookup probes each search path on disk.
+	*	The index is enabled by default.
+	*/
+	virtual void			SetPathIndexEnabled( bool bEnabled ) = 0;
+
+	/**
+	*	@return Whether the path index is enabled.
+	*/
+	virtual bool			IsPathIndexEnabled() = 0;
+
+	/**
+	*	Enables or disables reading through the block cache in Open. Small files are cached whole, larger files in blocks.
+	*	OpenFromCacheForRead always reads through the cache. The cache is enabled by default.
+	*/
+	virtual void			SetBlockCacheEnabled( bool bEnabled ) = 0;
+
+	/**
+	*	@return Whether Open reads through the block cache.
+	*/
+	virtual bool			IsBlockCacheEnabled() = 0;
+
+	/**
+	*	Gets the lookup statistics gathered since the last call to ResetStats.
+	*	@param[ out ] stats Statistics.
+	*/
+	virtual void			GetStats( FileSystemStats_t& stats ) = 0;
+
+	/**
+	*	Resets the lookup statistics.
+	*/
+	virtual void			ResetStats() = 0;
+
+	/**
+	*	Enables or disables replaying level load traces. When enabled, LogLevelLoadStarted preloads the files that the previous load of the level opened,
+	*	and prefetches the files that it mapped or only read in part. Files that are still open or mapped are skipped.
+	*	Traces are recorded either way. Replay is enabled by default.
+	*/
+	virtual void			SetLevelLoadReplayEnabled( bool bEnabled ) = 0;
+
+	/**
+	*	@return Whether level load traces are replayed.
+	*/
+	virtual bool			IsLevelLoadReplayEnabled() = 0;
+
+	/**
+	*	Gets the results of the last level load that was finished with LogLevelLoadFinished.
+	*	@param[ out ] info Results. Zeroed if no level load has finished.
+	*/
+	virtual void			GetLastLevelLoad( LevelLoadInfo_t& info ) = 0;
 };
 
 /**
@@ -19,6 +19,7 @@
 #include "Common.h"
 #include "Engine.h"
 #include "FilePaths.h"
+#include "FileSystemCommands.h"
 #include "IMetaLoader.h"
 #include "interface.h"
 #include "Logging.h"
@@ -34,6 +35,12 @@
 #include "ui/vgui1/vgui_SchemeManager.h"
 
 #include "gl/CShaderManager.h"
+#include "gl/ImageProcessing.h"
+
+#include "bsp/BSPCollision.h"
+#include "bsp/LightmapCompose.h"
+
+#include "wad/CWadManager.h"
 
 #include "CEngine.h"
 
@@ -206,6 +213,8 @@ void CEngine::Shutdown()
 {
 	g_MapManager.FreeMap();
 
+	g_WadManager.Shutdown();
+
 	if( m_pSchemeManager )
 	{
 		delete m_pSchemeManager;
@@ -253,6 +262,14 @@ bool CEngine::HostInit()
 	if( !g_CommandBuffer.Initialize( &g_CVar ) )
 		return false;
 
+	InitFileSystemCommands();
+
+	BSP::InitCollision();
+	BSP::InitLightmapCompose();
+	InitImageProcessing();
+
+	g_MapManager.Initialize();
+
 	auto pApp = vgui::App::getInstance();
 
 	pApp->reset();
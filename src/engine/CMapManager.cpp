@@ -5,11 +5,15 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
+#include "ByteSwap.h"
 #include "Common.h"
+#include "cvardef.h"
 #include "Logging.h"
 
+#include "bsp/BSPCollision.h"
 #include "bsp/BSPIO.h"
 #include "bsp/BSPRenderIO.h"
+#include "bsp/CLightmapAtlas.h"
 #include "entity/EntityIO.h"
 #include "entity/CEntityList.h"
 #include "entity/CBaseEntity.h"
@@ -17,14 +21,444 @@
 #include "gl/GLUtil.h"
 #include "gl/CShaderManager.h"
 #include "gl/CShaderInstance.h"
+#include "gl/CTextureDecoder.h"
+#include "gl/CTextureManager.h"
+
+#include "wad/CWadFile.h"
+#include "wad/CWadManager.h"
 
 #include "Engine.h"
+#include "FileSystem2.h"
 
 #include "CMapManager.h"
 
 const float CMapManager::ROTATE_SPEED = 120.0f;
 const float CMapManager::MOVE_SPEED = 100.0f;
 
+CMapManager::CMapManager() = default;
+
+CMapManager::~CMapManager() = default;
+
+namespace
+{
+void Cmd_LightStyle_f()
+{
+	if( g_CVar.GetArgC() < 2 )
+	{
+		Msg( "Usage: lightstyle <style> [pattern]\n" );
+		return;
+	}
+
+	auto& lightStyles = g_MapManager.GetLightStyles();
+
+	const int iStyle = atoi( g_CVar.GetArgV( 1 ) );
+
+	if( iStyle < 0 || static_cast<size_t>( iStyle ) >= CLightStyles::MAX_LIGHTSTYLES )
+	{
+		Msg( "Style must be between 0 and %u\n", static_cast<unsigned int>( CLightStyles::MAX_LIGHTSTYLES - 1 ) );
+		return;
+	}
+
+	if( g_CVar.GetArgC() < 3 )
+	{
+		Msg( "Style %d: \"%s\"\n", iStyle, lightStyles.GetPattern( iStyle ) );
+		return;
+	}
+
+	if( !lightStyles.SetPattern( iStyle, g_CVar.GetArgV( 2 ) ) )
+		Msg( "Invalid pattern \"%s\"; patterns are up to %u letters 'a' through 'z'\n", g_CVar.GetArgV( 2 ), static_cast<unsigned int>( CLightStyles::MAX_PATTERN - 1 ) );
+}
+
+void Cmd_LightmapStats_f()
+{
+	const auto& stats = g_MapManager.GetLightmapStats();
+
+	Msg( "Last frame: %u texels rebuilt for lightstyles, %u surfaces touched by %u dynamic lights, %u texels rebuilt, %u surfaces over budget\n",
+		 static_cast<unsigned int>( stats.uiStyleTexels ), static_cast<unsigned int>( stats.uiDlightSurfaces ),
+		 static_cast<unsigned int>( g_MapManager.GetDynamicLights().GetNumActiveLights() ),
+		 static_cast<unsigned int>( stats.uiDlightTexels ), static_cast<unsigned int>( stats.uiDlightSkipped ) );
+}
+
+void Cmd_LightmapAtlas_f()
+{
+	if( !g_MapManager.IsMapLoaded() )
+	{
+		Msg( "No map loaded\n" );
+		return;
+	}
+
+	const auto& atlas = BSP::GetLightmapAtlas();
+
+	for( size_t uiPage = 0; uiPage < atlas.GetNumPages(); ++uiPage )
+	{
+		const auto& page = atlas.GetPage( uiPage );
+
+		Msg( "Page %u: %dx%d\n", static_cast<unsigned int>( uiPage ), page.iWidth, page.iHeight );
+	}
+
+	Msg( "%u pages, %u of %u texels used (%.1f%%)\n", 
+		 static_cast<unsigned int>( atlas.GetNumPages() ), static_cast<unsigned int>( atlas.GetUsedTexels() ),
+		 static_cast<unsigned int>( atlas.GetTotalTexels() ), atlas.GetOccupancy() * 100.0f );
+
+	if( BSP::VerifyLightmaps( &BSP::mod_known[ 0 ] ) )
+		Msg( "No lightmaps overlap\n" );
+	else
+		Warning( "Lightmaps overlap or lie outside their page\n" );
+}
+
+void Cmd_DLight_f()
+{
+	if( !g_MapManager.IsMapLoaded() )
+	{
+		Msg( "No map loaded\n" );
+		return;
+	}
+
+	const float flRadius = g_CVar.GetArgC() > 1 ? static_cast<float>( atof( g_CVar.GetArgV( 1 ) ) ) : 200.0f;
+	const float flDuration = g_CVar.GetArgC() > 2 ? static_cast<float>( atof( g_CVar.GetArgV( 2 ) ) ) : 1.0f;
+
+	const float flTime = g_MapManager.GetTime();
+
+	dlight_t* pLight = g_MapManager.GetDynamicLights().Alloc( 0, flTime );
+
+	pLight->origin = g_MapManager.GetCameraPosition();
+	pLight->radius = flRadius;
+	pLight->color[ 0 ] = pLight->color[ 1 ] = pLight->color[ 2 ] = 255;
+	pLight->die = flTime + flDuration;
+	pLight->decay = flDuration > 0 ? flRadius / flDuration : 0;
+}
+
+void Cmd_GeometryVerify_f()
+{
+	if( VerifyBrushGeometryBuilder() )
+		Msg( "Brush geometry grouping and welding output matches\n" );
+}
+
+/**
+*	Checks the last frame's visible leafs and surfaces against the camera leaf's PVS.
+*/
+void Cmd_VisVerify_f()
+{
+	if( !g_MapManager.IsMapLoaded() )
+	{
+		Msg( "No map loaded\n" );
+		return;
+	}
+
+	if( g_MapManager.GetVisibility().Verify( g_MapManager.GetVisibleSurfaces() ) )
+		Msg( "Visibility is valid\n" );
+	else
+		Warning( "Visibility is invalid\n" );
+}
+
+/**
+*	Checks that player boxes stand on the floor below the given point, or below the camera.
+*/
+void Cmd_TraceVerify_f()
+{
+	if( !g_MapManager.IsMapLoaded() )
+	{
+		Msg( "No map loaded\n" );
+		return;
+	}
+
+	Vector origin = g_MapManager.GetCameraPosition();
+
+	if( g_CVar.GetArgC() >= 4 )
+	{
+		for( int i = 0; i < 3; ++i )
+			origin[ i ] = static_cast<float>( atof( g_CVar.GetArgV( i + 1 ) ) );
+	}
+	else if( g_CVar.GetArgC() > 1 )
+	{
+		Msg( "Usage: trace_verify [x y z]\n" );
+		return;
+	}
+
+	if( BSP::VerifyPlayerHulls( g_MapManager.GetModel(), origin ) )
+		Msg( "Player hulls are valid\n" );
+	else
+		Warning( "Player hulls are invalid\n" );
+}
+
+/**
+*	Resolves every texture name of the loaded map a number of times, once through the wad manager's index
+*	and once by searching each wad in order the way lookups used to work, and compares the results and timings.
+*/
+void Cmd_WadLookupBenchmark_f()
+{
+	if( !g_MapManager.IsMapLoaded() )
+	{
+		Msg( "No map loaded\n" );
+		return;
+	}
+
+	const int iIterations = g_CVar.GetArgC() > 1 ? atoi( g_CVar.GetArgV( 1 ) ) : 100;
+
+	if( iIterations <= 0 )
+	{
+		Msg( "Usage: wad_lookup_benchmark [iterations]\n" );
+		return;
+	}
+
+	const auto& file = *g_MapManager.GetBSPFile();
+
+	const auto& lump = file.GetLump( LUMP_TEXTURES );
+
+	std::vector<std::string> textureNames;
+
+	if( lump.filelen > 0 )
+	{
+		const auto pMiptexLump = reinterpret_cast<const dmiptexlump_t*>( file.GetLumpData( LUMP_TEXTURES ) );
+
+		const int iNumMiptex = LittleValue( pMiptexLump->nummiptex );
+
+		for( int iMiptex = 0; iMiptex < iNumMiptex; ++iMiptex )
+		{
+			const int iDataOffset = LittleValue( pMiptexLump->dataofs[ iMiptex ] );
+
+			if( iDataOffset == -1 )
+				continue;
+
+			const auto pMiptex = reinterpret_cast<const miptex_t*>( reinterpret_cast<const uint8_t*>( pMiptexLump ) + iDataOffset );
+
+			textureNames.emplace_back( pMiptex->name, strnlen( pMiptex->name, sizeof( pMiptex->name ) ) );
+		}
+	}
+
+	if( textureNames.empty() )
+	{
+		Msg( "The map has no textures\n" );
+		return;
+	}
+
+	//Wads are only loaded while the map's textures are; load them again for the duration of the benchmark.
+	const bool bAddWads = g_WadManager.GetNumWads() == 0;
+
+	if( bAddWads )
+	{
+		std::vector<std::string> wadNames;
+
+		BSP::GetWadNames( g_MapManager.GetModel(), wadNames );
+
+		for( const auto& szWad : wadNames )
+			g_WadManager.AddWad( szWad.c_str() );
+	}
+
+	std::vector<const miptex_t*> indexed( textureNames.size() );
+	std::vector<const miptex_t*> linear( textureNames.size() );
+
+	const auto indexStart = std::chrono::high_resolution_clock::now();
+
+	for( int iIteration = 0; iIteration < iIterations; ++iIteration )
+	{
+		for( size_t uiIndex = 0; uiIndex < textureNames.size(); ++uiIndex )
+			indexed[ uiIndex ] = g_WadManager.FindTextureByName( textureNames[ uiIndex ].c_str() );
+	}
+
+	const auto indexEnd = std::chrono::high_resolution_clock::now();
+
+	for( int iIteration = 0; iIteration < iIterations; ++iIteration )
+	{
+		for( size_t uiIndex = 0; uiIndex < textureNames.size(); ++uiIndex )
+		{
+			const miptex_t* pTexture = nullptr;
+
+			for( size_t uiWad = 0; uiWad < g_WadManager.GetNumWads() && !pTexture; ++uiWad )
+			{
+				const auto pWad = g_WadManager.GetWad( uiWad );
+
+				if( auto pLump = pWad->GetLumpByName( textureNames[ uiIndex ].c_str(), TYP_LUMPY + TYP_LUMPY_MIPTEX ) )
+					pTexture = reinterpret_cast<const miptex_t*>( pWad->GetLumpData( pLump ) );
+			}
+
+			linear[ uiIndex ] = pTexture;
+		}
+	}
+
+	const auto linearEnd = std::chrono::high_resolution_clock::now();
+
+	size_t uiFound = 0;
+	size_t uiMismatches = 0;
+
+	for( size_t uiIndex = 0; uiIndex < textureNames.size(); ++uiIndex )
+	{
+		if( indexed[ uiIndex ] )
+			++uiFound;
+
+		if( indexed[ uiIndex ] != linear[ uiIndex ] )
+		{
+			Warning( "Texture \"%s\" resolves differently\n", textureNames[ uiIndex ].c_str() );
+			++uiMismatches;
+		}
+	}
+
+	const auto uiLookups = static_cast<double>( textureNames.size() ) * iIterations;
+
+	const double flIndexed = std::chrono::duration<double, std::micro>( indexEnd - indexStart ).count();
+	const double flLinear = std::chrono::duration<double, std::micro>( linearEnd - indexEnd ).count();
+
+	Msg( "%u textures (%u in wads) in %u wads, %d iterations\n",
+		 static_cast<unsigned int>( textureNames.size() ), static_cast<unsigned int>( uiFound ),
+		 static_cast<unsigned int>( g_WadManager.GetNumWads() ), iIterations );
+	Msg( "Indexed: %.3f ms (%.3f us per lookup)\n", flIndexed / 1000.0, flIndexed / uiLookups );
+	Msg( "Linear: %.3f ms (%.3f us per lookup)\n", flLinear / 1000.0, flLinear / uiLookups );
+	Msg( "%u mismatches\n", static_cast<unsigned int>( uiMismatches ) );
+
+	if( bAddWads )
+		g_WadManager.Clear();
+}
+
+/**
+*	Converts the loaded map's textures without uploading them, first on this thread and then on increasing numbers of worker threads,
+*	and compares the images and timings. Does not touch GL state.
+*/
+void Cmd_TextureDecodeBenchmark_f()
+{
+	if( !g_MapManager.IsMapLoaded() )
+	{
+		Msg( "No map loaded\n" );
+		return;
+	}
+
+	const int iMaxThreads = g_CVar.GetArgC() > 1 ? atoi( g_CVar.GetArgV( 1 ) ) : static_cast<int>( CTextureDecoder::GetDefaultNumWorkers() );
+
+	if( iMaxThreads <= 0 )
+	{
+		Msg( "Usage: r_texture_decode_benchmark [max threads]\n" );
+		return;
+	}
+
+	std::vector<const miptex_t*> lumpMiptex;
+	std::vector<std::unique_ptr<uint8_t[]>> swapped;
+
+	if( !BSP::GetTextureLumpMiptex( *g_MapManager.GetBSPFile(), lumpMiptex, swapped ) )
+		return;
+
+	//Wads are only loaded while the map's textures are; load them again for the duration of the benchmark.
+	const bool bAddWads = g_WadManager.GetNumWads() == 0;
+
+	if( bAddWads )
+	{
+		std::vector<std::string> wadNames;
+
+		BSP::GetWadNames( g_MapManager.GetModel(), wadNames );
+
+		for( const auto& szWad : wadNames )
+			g_WadManager.AddWad( szWad.c_str() );
+	}
+
+	std::vector<const miptex_t*> sources;
+
+	for( auto pMiptex : lumpMiptex )
+	{
+		if( auto pSource = g_TextureManager.FindMiptex( pMiptex->name, pMiptex->offsets[ 0 ] > 0 ? pMiptex : nullptr ) )
+			sources.emplace_back( pSource );
+	}
+
+	if( sources.empty() )
+	{
+		Msg( "The map has no textures\n" );
+	}
+	else
+	{
+		std::vector<MiptexImage_t> reference( sources.size() );
+
+		size_t uiTexels = 0;
+
+		CTextureDecoder decoder;
+
+		double flReference = 0;
+
+		//0 threads converts on this thread; that is the reference all others are compared against.
+		for( int iThreads = 0; iThreads <= iMaxThreads; iThreads = iThreads ? iThreads * 2 : 1 )
+		{
+			const auto start = std::chrono::high_resolution_clock::now();
+
+			decoder.Start( std::vector<const miptex_t*>( sources ), iThreads );
+
+			size_t uiMismatches = 0;
+
+			MiptexImage_t image;
+
+			for( size_t uiIndex = 0; uiIndex < sources.size(); ++uiIndex )
+			{
+				const bool bSuccess = decoder.TakeImage( uiIndex, image );
+
+				if( iThreads == 0 )
+				{
+					if( bSuccess )
+						uiTexels += image.GetLevelWidth( 0 ) * image.GetLevelHeight( 0 );
+
+					reference[ uiIndex ] = std::move( image );
+					continue;
+				}
+
+				const auto& ref = reference[ uiIndex ];
+
+				if( bSuccess != ( ref.data != nullptr ) ||
+					( bSuccess && ( image.iWidth != ref.iWidth || image.iHeight != ref.iHeight || image.iNumLevels != ref.iNumLevels ||
+						memcmp( image.data.get(), ref.data.get(), ref.levelOffsets[ ref.iNumLevels - 1 ] + ref.GetLevelWidth( ref.iNumLevels - 1 ) * ref.GetLevelHeight( ref.iNumLevels - 1 ) * 4 ) ) ) )
+				{
+					Warning( "Texture \"%s\" converts differently on %d threads\n", sources[ uiIndex ]->name, iThreads );
+					++uiMismatches;
+				}
+			}
+
+			decoder.Finish();
+
+			const double flTime = std::chrono::duration<double, std::milli>( std::chrono::high_resolution_clock::now() - start ).count();
+
+			if( iThreads == 0 )
+			{
+				flReference = flTime;
+
+				Msg( "%u textures, %u texels at level 0\n", static_cast<unsigned int>( sources.size() ), static_cast<unsigned int>( uiTexels ) );
+				Msg( "Calling thread: %.3f ms\n", flTime );
+			}
+			else
+			{
+				Msg( "%d threads: %.3f ms (%.2fx), %u mismatches\n", iThreads, flTime, flTime > 0 ? flReference / flTime : 0.0, static_cast<unsigned int>( uiMismatches ) );
+			}
+		}
+	}
+
+	if( bAddWads )
+		g_WadManager.Clear();
+}
+}
+
+namespace
+{
+//Default values must be writable; AddCVar replaces them with a copy.
+char g_szDlightBudget[] = "65536";
+char g_szLightmapPageSize[] = "2048";
+char g_szTextureThreads[] = "-1";
+}
+
+static cvar_t r_dlight_budget = { "r_dlight_budget", g_szDlightBudget, 0, 0, nullptr };
+static cvar_t r_lightmap_page_size = { "r_lightmap_page_size", g_szLightmapPageSize, 0, 0, nullptr };
+static cvar_t r_texture_threads = { "r_texture_threads", g_szTextureThreads, 0, 0, nullptr };
+
+void CMapManager::Initialize()
+{
+	g_CVar.AddCommand( "lightstyle", &Cmd_LightStyle_f );
+	g_CVar.AddCommand( "r_lightmap_stats", &Cmd_LightmapStats_f );
+	g_CVar.AddCommand( "dlight", &Cmd_DLight_f );
+	g_CVar.AddCommand( "trace_verify", &Cmd_TraceVerify_f );
+	g_CVar.AddCommand( "r_lightmap_atlas", &Cmd_LightmapAtlas_f );
+	g_CVar.AddCommand( "r_vis_verify", &Cmd_VisVerify_f );
+	g_CVar.AddCommand( "r_geometry_verify", &Cmd_GeometryVerify_f );
+	g_CVar.AddCommand( "wad_lookup_benchmark", &Cmd_WadLookupBenchmark_f );
+	g_CVar.AddCommand( "r_texture_decode_benchmark", &Cmd_TextureDecodeBenchmark_f );
+
+	g_CVar.AddCVar( &r_dlight_budget );
+	g_CVar.AddCVar( &r_lightmap_page_size );
+	g_CVar.AddCVar( &r_texture_threads );
+
+	g_WadManager.SetMappingEnabled( !GetCommandLine()->HasArgument( "-nomapwad" ) );
+}
+
 bool CMapManager::LoadMap( const char* const pszMapName )
 {
 	ASSERT( pszMapName );
@@ -33,11 +467,38 @@ bool CMapManager::LoadMap( const char* const pszMapName )
 
 	snprintf( szMapName, sizeof( szMapName ), "maps/%s.bsp", pszMapName );
 
-	auto header = LoadBSPFile( szMapName );
+	//Records the files this load opens, and preloads the ones the previous load of this map opened.
+	g_pFileSystem->LogLevelLoadStarted( pszMapName );
+
+	const bool bSuccess = LoadMapFiles( szMapName );
 
-	if( !header )
+	g_pFileSystem->LogLevelLoadFinished( pszMapName );
+
+	LevelLoadInfo_t info;
+
+	g_pFileSystem->GetLastLevelLoad( info );
+
+	if( info.uiReplayedFiles > 0 )
+	{
+		Msg( "Map load took %.3f msec, read ahead %u files (%llu bytes) from the previous load\n",
+			 info.uiMicroseconds / 1000.0, info.uiReplayedFiles, static_cast<unsigned long long>( info.uiReplayedBytes ) );
+	}
+	else
 	{
-		Msg( "Couldn't load map \"%s\"\n", szMapName );
+		Msg( "Map load took %.3f msec, without preloading\n", info.uiMicroseconds / 1000.0 );
+	}
+
+	return bSuccess;
+}
+
+bool CMapManager::LoadMapFiles( const char* const pszMapName )
+{
+	//The file is memory mapped unless told otherwise; the model references its contents directly.
+	m_BSPFile = OpenBSPFile( pszMapName, !GetCommandLine()->HasArgument( "-nomapbsp" ) );
+
+	if( !m_BSPFile )
+	{
+		Msg( "Couldn't load map \"%s\"\n", pszMapName );
 		return false;
 	}
 
@@ -46,12 +507,18 @@ bool CMapManager::LoadMap( const char* const pszMapName )
 	m_pModel = &BSP::mod_known[ 0 ];
 	BSP::mod_numknown = 1;
 
-	strcpy( m_pModel->name, szMapName );
+	strcpy( m_pModel->name, pszMapName );
+
+	m_flTime = 0;
+	m_LightmapStats = {};
+	m_DynamicLights.Clear();
 
-	bool bSuccess = BSP::LoadBrushModel( m_pModel, header.get() );
+	bool bSuccess = BSP::LoadBrushModel( m_pModel, *m_BSPFile, static_cast<int>( r_lightmap_page_size.value ), static_cast<int>( r_texture_threads.value ) ) && BuildGeometry();
 
 	if( bSuccess )
 	{
+		m_Visibility.Initialize( m_pModel );
+
 		Msg( "Loaded BSP\n" );
 
 		if( ED_LoadFromFile( m_pModel->entities ) )
@@ -83,10 +550,135 @@ void CMapManager::FreeMap()
 	{
 		g_EntList.Clear();
 
+		m_Visibility.Shutdown();
+
+		FreeGeometry();
+
 		BSP::FreeModel( m_pModel );
 
 		m_pModel = nullptr;
 	}
+
+	//Must be released after the model, since the model references it.
+	m_BSPFile.reset();
+}
+
+bool CMapManager::BuildGeometry()
+{
+	static_assert( CBrushGeometryBuilder::VERTEX_SIZE == VERTEXSIZE, "Geometry builder vertex size must match glpoly_t vertex size" );
+
+	m_Geometry.Clear();
+
+	const msurface_t* pFirstSurface = m_pModel->surfaces;
+
+	for( int iModel = 0; iModel < BSP::mod_numknown; ++iModel )
+	{
+		const bmodel_t& model = BSP::mod_known[ iModel ];
+
+		const msurface_t* pSurface = model.surfaces + model.firstmodelsurface;
+
+		for( int iIndex = 0; iIndex < model.nummodelsurfaces; ++iIndex, ++pSurface )
+		{
+			//Sky, origin, aaatrigger, etc. Don't draw these.
+			//TODO: add option to draw them.
+			if( pSurface->texinfo->flags & TEX_SPECIAL )
+				continue;
+
+			const BrushBatchKey_t key{ iModel, pSurface->texinfo->texture->pShader, pSurface->texinfo->texture, pSurface->lightmaptexturenum };
+
+			for( const glpoly_t* pPoly = pSurface->polys; pPoly; pPoly = pPoly->next )
+			{
+				m_Geometry.AddPolygon( key, pSurface - pFirstSurface, &pPoly->verts[ 0 ][ 0 ], pPoly->numverts );
+			}
+		}
+	}
+
+	m_Geometry.Build();
+
+	glGenBuffers( 1, &m_GeometryVBO );
+	glBindBuffer( GL_ARRAY_BUFFER, m_GeometryVBO );
+	glBufferData( GL_ARRAY_BUFFER, m_Geometry.GetVertices().size() * sizeof( GLfloat ), m_Geometry.GetVertices().data(), GL_STATIC_DRAW );
+
+	glGenBuffers( 1, &m_GeometryIBO );
+	glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, m_GeometryIBO );
+	glBufferData( GL_ELEMENT_ARRAY_BUFFER, m_Geometry.GetIndices().size() * sizeof( GLuint ), m_Geometry.GetIndices().data(), GL_STATIC_DRAW );
+
+	glGenBuffers( 1, &m_WorldIBO );
+
+	check_gl_error();
+
+	Msg( "Built map geometry: %u vertices (%u welded), %u indices, %u draw ranges\n", 
+		 static_cast<unsigned int>( m_Geometry.GetNumVertices() ), static_cast<unsigned int>( m_Geometry.GetNumWeldedVertices() ), 
+		 static_cast<unsigned int>( m_Geometry.GetIndices().size() ), static_cast<unsigned int>( m_Geometry.GetRanges().size() ) );
+
+	return true;
+}
+
+void CMapManager::FreeGeometry()
+{
+	if( m_WorldIBO )
+	{
+		glDeleteBuffers( 1, &m_WorldIBO );
+		m_WorldIBO = 0;
+	}
+
+	if( m_GeometryIBO )
+	{
+		glDeleteBuffers( 1, &m_GeometryIBO );
+		m_GeometryIBO = 0;
+	}
+
+	if( m_GeometryVBO )
+	{
+		glDeleteBuffers( 1, &m_GeometryVBO );
+		m_GeometryVBO = 0;
+	}
+
+	m_Geometry.Clear();
+}
+
+void CMapManager::UpdateWorldVisibility( const glm::mat4x4& viewProjection )
+{
+	const Vector& vecOrigin = m_Camera.GetPosition();
+
+	//Only changes when the camera moves to another leaf.
+	m_Visibility.MarkLeaves( m_Visibility.PointInLeaf( vecOrigin ) );
+
+	CFrustum frustum;
+
+	frustum.Setup( viewProjection );
+
+	m_Visibility.CollectSurfaces( frustum, vecOrigin, m_VisibleSurfaces );
+
+	m_WorldDrawList.Begin( m_Geometry );
+
+	for( const auto uiSurface : m_VisibleSurfaces )
+		m_WorldDrawList.AddSurface( uiSurface );
+
+	m_WorldDrawList.End();
+
+	const auto& indices = m_WorldDrawList.GetIndices();
+
+	glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, m_WorldIBO );
+	//Orphan the old data so the driver doesn't have to wait for the previous frame's draws.
+	glBufferData( GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof( GLuint ), nullptr, GL_STREAM_DRAW );
+	glBufferSubData( GL_ELEMENT_ARRAY_BUFFER, 0, indices.size() * sizeof( GLuint ), indices.data() );
+
+	check_gl_error();
+}
+
+void CMapManager::UpdateLightmaps()
+{
+	m_flTime += m_flDeltaTime;
+
+	m_LightStyles.Animate( m_flTime );
+	m_DynamicLights.Decay( m_flTime, m_flDeltaTime );
+
+	const size_t uiBudget = r_dlight_budget.value > 0 ? static_cast<size_t>( r_dlight_budget.value ) : 0;
+
+	BSP::UpdateLightmaps( m_pModel, m_LightStyles.GetValues(), m_DynamicLights.GetLights(), uiBudget, m_LightmapStats );
+
+	check_gl_error();
 }
 
 void CMapManager::RenderMap( long long uiDeltaTime )
@@ -153,6 +745,10 @@ void CMapManager::RenderMap( long long uiDeltaTime )
 
 	double flTotal = 0;
 
+	UpdateLightmaps();
+
+	UpdateWorldVisibility( projection * view );
+
 	for( CBaseEntity* pEntity = g_EntList.GetFirstEntity(); pEntity; pEntity = g_EntList.GetNextEntity( pEntity ) )
 	{
 		if( auto pModel = pEntity->GetBrushModel() )
@@ -199,19 +795,43 @@ void CMapManager::HandleSDLEvent( SDL_Event& event )
 void CMapManager::RenderModel( const glm::mat4x4& projection, const glm::mat4x4& view, const glm::mat4x4& model, 
 							   const CBaseEntity* pEntity, bmodel_t& brushModel, size_t& uiCount, size_t& uiTriangles, double& flTotal )
 {
-	msurface_t* pSurface = brushModel.surfaces + brushModel.firstmodelsurface;
+	const BrushDrawRange_t* pRanges;
+	size_t uiNumRanges;
+	GLuint IBO;
+
+	if( &brushModel == m_pModel )
+	{
+		//The world only draws potentially visible surfaces.
+		pRanges = m_WorldDrawList.GetRanges().data();
+		uiNumRanges = m_WorldDrawList.GetRanges().size();
+		IBO = m_WorldIBO;
+	}
+	else
+	{
+		size_t uiFirstRange;
 
-	CShaderInstance* pShader;
+		m_Geometry.GetGroupRanges( &brushModel - BSP::mod_known, uiFirstRange, uiNumRanges );
+
+		pRanges = m_Geometry.GetRanges().data() + uiFirstRange;
+		IBO = m_GeometryIBO;
+	}
+
+	if( !uiNumRanges )
+		return;
+
+	glBindBuffer( GL_ARRAY_BUFFER, m_GeometryVBO );
+	glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, IBO );
+
+	check_gl_error();
 
 	//TODO: need to sort transparent surfaces - Solokiller
-	for( int iIndex = 0; iIndex < brushModel.nummodelsurfaces; ++iIndex, ++pSurface )
+	for( size_t uiRange = 0; uiRange < uiNumRanges; ++uiRange )
 	{
-		//Sky, origin, aaatrigger, etc. Don't draw these.
-		//TODO: add option to draw them.
-		if( pSurface->texinfo->flags & TEX_SPECIAL )
-			continue;
+		const BrushDrawRange_t& range = pRanges[ uiRange ];
+
+		std::chrono::milliseconds start = std::chrono::duration_cast<std::chrono::milliseconds>( std::chrono::high_resolution_clock::now().time_since_epoch() );
 
-		pShader = pSurface->texinfo->texture->pShader;
+		CShaderInstance* pShader = range.key.pShader;
 
 		g_ShaderManager.ActivateShader( pShader, projection, view, model, pEntity );
 
@@ -220,7 +840,7 @@ void CMapManager::RenderModel( const glm::mat4x4& projection, const glm::mat4x4&
 		check_gl_error();
 
 		//Skies will have no texture here.
-		glBindTexture( GL_TEXTURE_2D, pSurface->lightmaptexturenum );
+		glBindTexture( GL_TEXTURE_2D, range.key.uiLightmap );
 
 		check_gl_error();
 
@@ -228,38 +848,23 @@ void CMapManager::RenderModel( const glm::mat4x4& projection, const glm::mat4x4&
 
 		check_gl_error();
 
-		for( glpoly_t* pPoly = pSurface->polys; pPoly; pPoly = pPoly->chain )
-		{
-			if( pSurface->texinfo->texture )
-				glBindTexture( GL_TEXTURE_2D, pSurface->texinfo->texture->gl_texturenum );
-			else
-				glBindTexture( GL_TEXTURE_2D, 0 );
+		glBindTexture( GL_TEXTURE_2D, range.key.pTexture ? range.key.pTexture->gl_texturenum : 0 );
 
-			check_gl_error();
-
-			for( glpoly_t* pPoly2 = pPoly; pPoly2; pPoly2 = pPoly2->next )
-			{
-				std::chrono::milliseconds start = std::chrono::duration_cast<std::chrono::milliseconds>( std::chrono::high_resolution_clock::now().time_since_epoch() );
-
-				glBindBuffer( GL_ARRAY_BUFFER, pPoly2->VBO );
-
-				check_gl_error();
+		check_gl_error();
 
-				pShader->SetupVertexAttribs();
+		pShader->SetupVertexAttribs();
 
-				check_gl_error();
+		check_gl_error();
 
-				pShader->Draw( pPoly2->numverts );
+		pShader->DrawElements( range.uiNumIndices, range.uiFirstIndex );
 
-				++uiCount;
+		++uiCount;
 
-				uiTriangles += pPoly2->numverts - 2;
+		uiTriangles += range.uiNumIndices / 3;
 
-				std::chrono::milliseconds end = std::chrono::duration_cast<std::chrono::milliseconds>( std::chrono::high_resolution_clock::now().time_since_epoch() );
+		std::chrono::milliseconds end = std::chrono::duration_cast<std::chrono::milliseconds>( std::chrono::high_resolution_clock::now().time_since_epoch() );
 
-				flTotal += ( end - start ).count();
-			}
-		}
+		flTotal += ( end - start ).count();
 	}
 }
 
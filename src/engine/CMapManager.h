@@ -1,12 +1,26 @@
 #ifndef ENGINE_CMAPMANAGER_H
 #define ENGINE_CMAPMANAGER_H
 
+#include <memory>
+#include <vector>
+
 #include <SDL2/SDL.h>
 
+#include <gl/glew.h>
+
+#include "bsp/BSPRenderIO.h"
+#include "bsp/CBSPVisibility.h"
+#include "bsp/CBrushDrawList.h"
+#include "bsp/CBrushGeometryBuilder.h"
+#include "bsp/CDynamicLights.h"
+#include "bsp/CFrustum.h"
+#include "bsp/CLightStyles.h"
+
 #include "CCamera.h"
 
 struct bmodel_t;
 class CBaseEntity;
+class CBSPView;
 
 class CMapManager final
 {
@@ -15,8 +29,13 @@ private:
 	static const float MOVE_SPEED;
 
 public:
-	CMapManager() = default;
-	~CMapManager() = default;
+	CMapManager();
+	~CMapManager();
+
+	/**
+	*	Registers map related console commands.
+	*/
+	void Initialize();
 
 	bool LoadMap( const char* const pszMapName );
 
@@ -24,11 +43,73 @@ public:
 
 	bool IsMapLoaded() const { return m_pModel != nullptr; }
 
+	/**
+	*	@return The world model of the loaded map, or null if no map is loaded.
+	*/
+	const bmodel_t* GetModel() const { return m_pModel; }
+
+	/**
+	*	@return The BSP file of the loaded map, or null if no map is loaded.
+	*/
+	const CBSPView* GetBSPFile() const { return m_BSPFile.get(); }
+
 	void RenderMap( long long uiDeltaTime );
 
+	/**
+	*	@return World visibility, as of the last rendered frame.
+	*/
+	const CBSPVisibility& GetVisibility() const { return m_Visibility; }
+
+	/**
+	*	@return World surfaces that were visible in the last rendered frame.
+	*/
+	const std::vector<uint32_t>& GetVisibleSurfaces() const { return m_VisibleSurfaces; }
+
+	CLightStyles& GetLightStyles() { return m_LightStyles; }
+
+	CDynamicLights& GetDynamicLights() { return m_DynamicLights; }
+
+	/**
+	*	@return Time since the map was loaded, in seconds.
+	*/
+	float GetTime() const { return m_flTime; }
+
+	const Vector& GetCameraPosition() const { return m_Camera.GetPosition(); }
+
+	/**
+	*	@return Lightmap work done in the last frame.
+	*/
+	const BSP::LightmapUpdateStats_t& GetLightmapStats() const { return m_LightmapStats; }
+
 	void HandleSDLEvent( SDL_Event& event );
 
 private:
+	/**
+	*	Loads the BSP file, its textures and its entities.
+	*	@param pszMapName Path of the BSP file.
+	*/
+	bool LoadMapFiles( const char* const pszMapName );
+
+	/**
+	*	Builds the static geometry of all brush models in the map and uploads it.
+	*/
+	bool BuildGeometry();
+
+	/**
+	*	Frees the static geometry.
+	*/
+	void FreeGeometry();
+
+	/**
+	*	Rebuilds the world draw list from the surfaces that are potentially visible from the camera and inside the view frustum.
+	*/
+	void UpdateWorldVisibility( const glm::mat4x4& viewProjection );
+
+	/**
+	*	Advances lightstyle animation and dynamic lights, and updates the lightmaps of affected surfaces.
+	*/
+	void UpdateLightmaps();
+
 	void RenderModel( const glm::mat4x4& projection, const glm::mat4x4& view, const glm::mat4x4& model, 
 					  const CBaseEntity* pEntity, bmodel_t& brushModel, size_t& uiCount, size_t& uiTriangles, double& flTotal );
 
@@ -43,6 +124,44 @@ private:
 private:
 	bmodel_t* m_pModel = nullptr;
 
+	/**
+	*	The loaded map's BSP file. Kept open for as long as the map is loaded.
+	*/
+	std::unique_ptr<CBSPView> m_BSPFile;
+
+	/**
+	*	Static geometry of all brush models. Groups are indices into BSP::mod_known, surfaces are indices into the world's surfaces.
+	*/
+	CBrushGeometryBuilder m_Geometry;
+
+	GLuint m_GeometryVBO = 0;
+	GLuint m_GeometryIBO = 0;
+
+	CBSPVisibility m_Visibility;
+
+	/**
+	*	Potentially visible world surfaces. Uses its own index buffer.
+	*/
+	CBrushDrawList m_WorldDrawList;
+
+	GLuint m_WorldIBO = 0;
+
+	/**
+	*	Visible world surfaces, front to back.
+	*/
+	std::vector<uint32_t> m_VisibleSurfaces;
+
+	CLightStyles m_LightStyles;
+
+	CDynamicLights m_DynamicLights;
+
+	/**
+	*	Time since the map was loaded, in seconds. Drives lightstyle animation.
+	*/
+	float m_flTime = 0;
+
+	BSP::LightmapUpdateStats_t m_LightmapStats = {};
+
 	CCamera m_Camera;
 
 	float m_flDeltaTime = 0;
@@ -0,0 +1,46 @@
+#include "Logging.h"
+
+#include "Engine.h"
+
+#include "CSIMDDispatch.h"
+
+bool CSIMDSelection::SetLevel( const SIMDLevel level )
+{
+	if( !IsSIMDLevelSupported( level ) )
+		return false;
+
+	m_Level = level;
+
+	return true;
+}
+
+void CSIMDSelection::SelectBest()
+{
+	SetLevel( GetCommandLine()->HasArgument( "-nosimd" ) ? SIMDLevel::NONE : GetBestSIMDLevel() );
+
+	Msg( "%s uses %s\n", m_pszDescription, SIMDLevelToString( m_Level ) );
+}
+
+void CSIMDSelection::Command()
+{
+	if( g_CVar.GetArgC() < 2 )
+	{
+		Msg( "%s uses %s\n", m_pszDescription, SIMDLevelToString( m_Level ) );
+		return;
+	}
+
+	const char* pszName = g_CVar.GetArgV( 1 );
+
+	SIMDLevel level;
+
+	if( !SIMDLevelFromString( pszName, level ) )
+	{
+		Msg( "Unknown instruction set \"%s\"\n", pszName );
+		return;
+	}
+
+	if( SetLevel( level ) )
+		Msg( "%s now uses %s\n", m_pszDescription, SIMDLevelToString( level ) );
+	else
+		Msg( "%s is not supported by this CPU\n", SIMDLevelToString( level ) );
+}
@@ -0,0 +1,89 @@
+#ifndef ENGINE_CSIMDDISPATCH_H
+#define ENGINE_CSIMDDISPATCH_H
+
+#include <cstddef>
+
+#include "CPUFeatures.h"
+
+/**
+*	Keeps track of the instruction set that a group of SIMD kernels uses.
+*	Selects the best supported instruction set on startup, and handles the console command that overrides it.
+*/
+class CSIMDSelection
+{
+public:
+	/**
+	*	@param pszDescription Description of what the kernels do, used in messages. Must stay valid.
+	*/
+	explicit CSIMDSelection( const char* pszDescription )
+		: m_pszDescription( pszDescription )
+	{
+	}
+
+	const char* GetDescription() const { return m_pszDescription; }
+
+	/**
+	*	@return The instruction set currently in use.
+	*/
+	SIMDLevel GetLevel() const { return m_Level; }
+
+	/**
+	*	Selects the instruction set to use.
+	*	@return Whether the instruction set is supported. If not, the current selection is unchanged.
+	*/
+	bool SetLevel( const SIMDLevel level );
+
+	/**
+	*	Selects the best supported instruction set, or none if -nosimd was passed on the command line.
+	*/
+	void SelectBest();
+
+	/**
+	*	Handles the console command to show the instruction set in use, or to select another one by name.
+	*/
+	void Command();
+
+private:
+	const char* const m_pszDescription;
+
+	SIMDLevel m_Level = SIMDLevel::NONE;
+
+private:
+	CSIMDSelection( const CSIMDSelection& ) = delete;
+	CSIMDSelection& operator=( const CSIMDSelection& ) = delete;
+};
+
+/**
+*	Selection over a table of kernels, with one entry for each instruction set.
+*	Entries for instruction sets that can't be compiled for on this platform are never selected.
+*/
+template<typename KERNELS>
+class CSIMDDispatch final : public CSIMDSelection
+{
+public:
+	typedef KERNELS Kernels_t;
+
+	static const size_t NUM_LEVELS = static_cast<size_t>( SIMDLevel::COUNT );
+
+public:
+	CSIMDDispatch( const char* pszDescription, const Kernels_t ( &kernels )[ NUM_LEVELS ] )
+		: CSIMDSelection( pszDescription )
+		, m_pKernels( kernels )
+	{
+	}
+
+	/**
+	*	@return Kernels for the instruction set currently in use.
+	*/
+	const Kernels_t& GetKernels() const { return m_pKernels[ static_cast<size_t>( GetLevel() ) ]; }
+
+	/**
+	*	@return Kernels for the given instruction set. Only valid if the instruction set is supported.
+	*/
+	const Kernels_t& GetKernels( const SIMDLevel level ) const { return m_pKernels[ static_cast<size_t>( level ) ]; }
+
+private:
+	const Kernels_t* const m_pKernels;
+};
+
+#endif //ENGINE_CSIMDDISPATCH_H
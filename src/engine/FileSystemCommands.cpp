@@ -0,0 +1,461 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "Platform.h"
+
+#include "Engine.h"
+#include "Logging.h"
+
+#include "FileSystem2.h"
+
+#include "filesystem/PackFile.h"
+
+#include "FileSystemCommands.h"
+
+namespace
+{
+/**
+*	Paths looked up by fs_lookup_benchmark. A mix of files that a map load looks for, some of which don't usually exist.
+*/
+const char* const g_pszBenchmarkPaths[] =
+{
+	"liblist.gam",
+	"gfx.wad",
+	"decals.wad",
+	"halflife.wad",
+	"maps/c1a0.bsp",
+	"maps/c1a0.res",
+	"maps/c1a0.lit",
+	"maps/c1a0.txt",
+	"models/player.mdl",
+	"models/v_crowbar.mdl",
+	"models/not_a_model.mdl",
+	"sound/sentences.txt",
+	"sound/materials.txt",
+	"sprites/hud.txt",
+	"sprites/not_a_sprite.spr",
+	"gfx/env/desertup.tga",
+	"resource/GameMenu.res",
+	"titles.txt"
+};
+
+void PrintStats( const char* pszLabel, const FileSystemStats_t& stats )
+{
+	Msg( "%s: %llu lookups (%llu indexed), %llu disk queries, %llu indexed paths, %llu bytes of pack directories\n",
+		 pszLabel,
+		 static_cast<unsigned long long>( stats.uiLookups ),
+		 static_cast<unsigned long long>( stats.uiIndexedLookups ),
+		 static_cast<unsigned long long>( stats.uiDiskQueries ),
+		 static_cast<unsigned long long>( stats.uiIndexedPaths ),
+		 static_cast<unsigned long long>( stats.uiPackDirectoryBytes ) );
+
+	Msg( "%s: %llu preloaded files using %llu bytes, %llu opens served from preloaded files\n",
+		 pszLabel,
+		 static_cast<unsigned long long>( stats.uiPreloadedFiles ),
+		 static_cast<unsigned long long>( stats.uiPreloadedBytes ),
+		 static_cast<unsigned long long>( stats.uiPreloadHits ) );
+
+	Msg( "%s: block cache has %llu blocks using %llu bytes, %llu hits, %llu misses, %llu evictions\n",
+		 pszLabel,
+		 static_cast<unsigned long long>( stats.uiBlockCacheBlocks ),
+		 static_cast<unsigned long long>( stats.uiBlockCacheBytes ),
+		 static_cast<unsigned long long>( stats.uiBlockCacheHits ),
+		 static_cast<unsigned long long>( stats.uiBlockCacheMisses ),
+		 static_cast<unsigned long long>( stats.uiBlockCacheEvictions ) );
+}
+
+void Cmd_FileSystemStats_f()
+{
+	FileSystemStats_t stats;
+
+	g_pFileSystem->GetStats( stats );
+
+	PrintStats( "Filesystem", stats );
+
+	if( g_CVar.GetArgC() > 1 && !strcmp( g_CVar.GetArgV( 1 ), "reset" ) )
+		g_pFileSystem->ResetStats();
+}
+
+void Cmd_FileSystemLoadTraceReplay_f()
+{
+	if( g_CVar.GetArgC() > 1 )
+		g_pFileSystem->SetLevelLoadReplayEnabled( atoi( g_CVar.GetArgV( 1 ) ) != 0 );
+
+	Msg( "Level load trace replay is %s\n", g_pFileSystem->IsLevelLoadReplayEnabled() ? "enabled" : "disabled" );
+}
+
+void Cmd_FileSystemBlockCache_f()
+{
+	if( g_CVar.GetArgC() > 1 )
+		g_pFileSystem->SetBlockCacheEnabled( atoi( g_CVar.GetArgV( 1 ) ) != 0 );
+
+	Msg( "Block cache is %s\n", g_pFileSystem->IsBlockCacheEnabled() ? "enabled" : "disabled" );
+}
+
+void Cmd_FileSystemPathIndex_f()
+{
+	if( g_CVar.GetArgC() > 1 )
+		g_pFileSystem->SetPathIndexEnabled( atoi( g_CVar.GetArgV( 1 ) ) != 0 );
+
+	Msg( "Path index is %s\n", g_pFileSystem->IsPathIndexEnabled() ? "enabled" : "disabled" );
+}
+
+/**
+*	Looks up every benchmark path once with FileExists and once with Open.
+*	@return Number of paths that were found.
+*/
+size_t LookupBenchmarkPaths()
+{
+	size_t uiFound = 0;
+
+	for( auto pszPath : g_pszBenchmarkPaths )
+	{
+		if( g_pFileSystem->FileExists( pszPath ) )
+			++uiFound;
+
+		auto hFile = g_pFileSystem->Open( pszPath, "rb" );
+
+		if( hFile != FILESYSTEM_INVALID_HANDLE )
+			g_pFileSystem->Close( hFile );
+	}
+
+	return uiFound;
+}
+
+void Cmd_FileSystemLookupBenchmark_f()
+{
+	size_t uiIterations = 1000;
+
+	if( g_CVar.GetArgC() > 1 )
+		uiIterations = std::max( 1, atoi( g_CVar.GetArgV( 1 ) ) );
+
+	const bool bWasEnabled = g_pFileSystem->IsPathIndexEnabled();
+
+	for( const bool bUseIndex : { false, true } )
+	{
+		g_pFileSystem->SetPathIndexEnabled( bUseIndex );
+
+		//Warm up so the index lists the directories and the OS caches are filled before timing.
+		const size_t uiFound = LookupBenchmarkPaths();
+
+		g_pFileSystem->ResetStats();
+
+		const auto start = std::chrono::high_resolution_clock::now();
+
+		for( size_t uiIteration = 0; uiIteration < uiIterations; ++uiIteration )
+			LookupBenchmarkPaths();
+
+		const auto end = std::chrono::high_resolution_clock::now();
+
+		FileSystemStats_t stats;
+
+		g_pFileSystem->GetStats( stats );
+
+		const double flSeconds = std::chrono::duration<double>( end - start ).count();
+
+		const double flLookups = static_cast<double>( std::max( stats.uiLookups, static_cast<uint64_t>( 1 ) ) );
+
+		Msg( "%s: %u of %u paths found, %.3f usec and %.2f disk queries per lookup\n",
+			 bUseIndex ? "Path index" : "Search path probing",
+			 static_cast<unsigned int>( uiFound ), static_cast<unsigned int>( ARRAYSIZE( g_pszBenchmarkPaths ) ),
+			 ( flSeconds * 1000000.0 ) / flLookups, stats.uiDiskQueries / flLookups );
+	}
+
+	g_pFileSystem->SetPathIndexEnabled( bWasEnabled );
+}
+
+/**
+*	Writes a 64 bit pack file with the given number of empty files.
+*/
+bool WriteBenchmarkPackFile( const char* pszFileName, const std::vector<std::string>& fileNames )
+{
+	typedef pack::Pack64_t Pack_t;
+
+	Pack_t::Header_t header;
+
+	memcpy( header.identifier, "PK64", sizeof( header.identifier ) );
+	header.dirofs = sizeof( header );
+	header.dirlen = static_cast<Pack_t::size_type>( fileNames.size() * sizeof( Pack_t::Entry_t ) );
+
+	std::vector<Pack_t::Entry_t> entries( fileNames.size() );
+
+	for( size_t uiIndex = 0; uiIndex < fileNames.size(); ++uiIndex )
+	{
+		auto& entry = entries[ uiIndex ];
+
+		memset( &entry, 0, sizeof( entry ) );
+
+		strncpy( entry.szFileName, fileNames[ uiIndex ].c_str(), sizeof( entry.szFileName ) - 1 );
+		entry.filepos = sizeof( header );
+		entry.filelen = 0;
+	}
+
+	auto hFile = g_pFileSystem->Open( pszFileName, "wb" );
+
+	if( hFile == FILESYSTEM_INVALID_HANDLE )
+		return false;
+
+	bool bSuccess = g_pFileSystem->Write( &header, sizeof( header ), hFile ) == sizeof( header );
+
+	if( bSuccess && !entries.empty() )
+	{
+		const int iSize = static_cast<int>( entries.size() * sizeof( Pack_t::Entry_t ) );
+
+		bSuccess = g_pFileSystem->Write( entries.data(), iSize, hFile ) == iSize;
+	}
+
+	g_pFileSystem->Close( hFile );
+
+	return bSuccess;
+}
+
+void Cmd_FileSystemPackBenchmark_f()
+{
+	const char* const pszPackFileName = "fs_pack_benchmark.pak";
+
+	//Path IDs are stored by pointer, so this has to outlive the search path.
+	static const char* const pszPathID = "PACKBENCHMARK";
+
+	size_t uiNumFiles = pack::Pack64_t::MAX_FILES;
+
+	if( g_CVar.GetArgC() > 1 )
+		uiNumFiles = std::min( static_cast<size_t>( std::max( 1, atoi( g_CVar.GetArgV( 1 ) ) ) ), pack::Pack64_t::MAX_FILES );
+
+	std::vector<std::string> fileNames( uiNumFiles );
+
+	char szName[ MAX_PATH ];
+
+	for( size_t uiIndex = 0; uiIndex < uiNumFiles; ++uiIndex )
+	{
+		snprintf( szName, sizeof( szName ), "benchmark/dir%03u/file%05u.dat", static_cast<unsigned int>( uiIndex / 256 ), static_cast<unsigned int>( uiIndex ) );
+		fileNames[ uiIndex ] = szName;
+	}
+
+	if( !WriteBenchmarkPackFile( pszPackFileName, fileNames ) )
+	{
+		Msg( "Couldn't write \"%s\"\n", pszPackFileName );
+		return;
+	}
+
+	char szFullPath[ MAX_PATH ];
+
+	if( !g_pFileSystem->GetLocalPath( pszPackFileName, szFullPath, sizeof( szFullPath ) ) )
+	{
+		Msg( "Couldn't find \"%s\" after writing it\n", pszPackFileName );
+		g_pFileSystem->RemoveFile( pszPackFileName, nullptr );
+		return;
+	}
+
+	FileSystemStats_t before;
+
+	g_pFileSystem->GetStats( before );
+
+	auto start = std::chrono::high_resolution_clock::now();
+
+	const bool bMounted = g_pFileSystem->AddPackFile( szFullPath, pszPathID );
+
+	auto end = std::chrono::high_resolution_clock::now();
+
+	if( !bMounted )
+	{
+		Msg( "Couldn't mount \"%s\"\n", szFullPath );
+		g_pFileSystem->RemoveFile( pszPackFileName, nullptr );
+		return;
+	}
+
+	FileSystemStats_t after;
+
+	g_pFileSystem->GetStats( after );
+
+	const uint64_t uiDirectoryBytes = after.uiPackDirectoryBytes - before.uiPackDirectoryBytes;
+
+	Msg( "Mounted %u entries in %.3f msec, directory uses %llu bytes (%.1f bytes per entry)\n",
+		 static_cast<unsigned int>( uiNumFiles ), std::chrono::duration<double>( end - start ).count() * 1000.0,
+		 static_cast<unsigned long long>( uiDirectoryBytes ), static_cast<double>( uiDirectoryBytes ) / uiNumFiles );
+
+	//Look up in random order so the results don't depend on the order of the entries.
+	std::vector<size_t> order( uiNumFiles );
+
+	for( size_t uiIndex = 0; uiIndex < uiNumFiles; ++uiIndex )
+		order[ uiIndex ] = uiIndex;
+
+	std::shuffle( order.begin(), order.end(), std::mt19937( 0 ) );
+
+	const bool bWasEnabled = g_pFileSystem->IsPathIndexEnabled();
+
+	for( const bool bUseIndex : { false, true } )
+	{
+		g_pFileSystem->SetPathIndexEnabled( bUseIndex );
+
+		size_t uiFound = 0;
+
+		start = std::chrono::high_resolution_clock::now();
+
+		for( const auto uiIndex : order )
+		{
+			auto hFile = g_pFileSystem->Open( fileNames[ uiIndex ].c_str(), "rb", pszPathID );
+
+			if( hFile != FILESYSTEM_INVALID_HANDLE )
+			{
+				++uiFound;
+				g_pFileSystem->Close( hFile );
+			}
+		}
+
+		end = std::chrono::high_resolution_clock::now();
+
+		Msg( "%s: opened %u of %u entries, %.3f usec per open\n",
+			 bUseIndex ? "Path index" : "Pack directory",
+			 static_cast<unsigned int>( uiFound ), static_cast<unsigned int>( uiNumFiles ),
+			 ( std::chrono::duration<double>( end - start ).count() * 1000000.0 ) / uiNumFiles );
+	}
+
+	g_pFileSystem->SetPathIndexEnabled( bWasEnabled );
+
+	g_pFileSystem->RemoveSearchPath( szFullPath );
+	g_pFileSystem->RemoveFile( pszPackFileName, nullptr );
+}
+
+void Cmd_FileSystemHandleBenchmark_f()
+{
+	const char* const pszPackFileName = "fs_handle_benchmark.pak";
+	const char* const pszEntryName = "benchmark/handle.dat";
+
+	//Path IDs are stored by pointer, so this has to outlive the search path.
+	static const char* const pszPathID = "HANDLEBENCHMARK";
+
+	size_t uiNumHandles = 10000;
+
+	if( g_CVar.GetArgC() > 1 )
+		uiNumHandles = static_cast<size_t>( std::max( 1, atoi( g_CVar.GetArgV( 1 ) ) ) );
+
+	//Pack entries don't open files of their own. Each one reads from the pack's descriptor at its own offset with positional reads,
+	//so any number of them can be open without running out of file descriptors, and they never move a shared file position.
+	if( !WriteBenchmarkPackFile( pszPackFileName, { pszEntryName } ) )
+	{
+		Msg( "Couldn't write \"%s\"\n", pszPackFileName );
+		return;
+	}
+
+	char szFullPath[ MAX_PATH ];
+
+	if( !g_pFileSystem->GetLocalPath( pszPackFileName, szFullPath, sizeof( szFullPath ) ) ||
+		!g_pFileSystem->AddPackFile( szFullPath, pszPathID ) )
+	{
+		Msg( "Couldn't mount \"%s\"\n", pszPackFileName );
+		g_pFileSystem->RemoveFile( pszPackFileName, nullptr );
+		return;
+	}
+
+	std::vector<FileHandle_t> handles;
+
+	handles.reserve( uiNumHandles );
+
+	auto start = std::chrono::high_resolution_clock::now();
+
+	for( size_t uiIndex = 0; uiIndex < uiNumHandles; ++uiIndex )
+	{
+		auto hFile = g_pFileSystem->Open( pszEntryName, "rb", pszPathID );
+
+		if( hFile == FILESYSTEM_INVALID_HANDLE )
+			break;
+
+		handles.push_back( hFile );
+	}
+
+	auto end = std::chrono::high_resolution_clock::now();
+
+	const double flOpenSeconds = std::chrono::duration<double>( end - start ).count();
+
+	const size_t uiOpened = handles.size();
+
+	//Close in random order so slots are freed from the middle of the table, not just the end.
+	std::shuffle( handles.begin(), handles.end(), std::mt19937( 0 ) );
+
+	start = std::chrono::high_resolution_clock::now();
+
+	for( auto hFile : handles )
+		g_pFileSystem->Close( hFile );
+
+	end = std::chrono::high_resolution_clock::now();
+
+	const double flCloseSeconds = std::chrono::duration<double>( end - start ).count();
+
+	Msg( "Opened %u of %u handles, %.3f usec per open, %.3f usec per close\n",
+		 static_cast<unsigned int>( uiOpened ), static_cast<unsigned int>( uiNumHandles ),
+		 uiOpened ? ( flOpenSeconds * 1000000.0 ) / uiOpened : 0.0,
+		 uiOpened ? ( flCloseSeconds * 1000000.0 ) / uiOpened : 0.0 );
+
+	g_pFileSystem->RemoveSearchPath( szFullPath );
+	g_pFileSystem->RemoveFile( pszPackFileName, nullptr );
+}
+
+/**
+*	Checks that the buffer returned by GetReadBuffer contains the same bytes as Read returns.
+*	Works for loose files and files inside of pack files.
+*/
+void Cmd_FileSystemReadBufferTest_f()
+{
+	if( g_CVar.GetArgC() < 2 )
+	{
+		Msg( "Usage: fs_readbuffer_test <file> [file...]\n" );
+		return;
+	}
+
+	for( int iArg = 1; iArg < g_CVar.GetArgC(); ++iArg )
+	{
+		const char* pszFileName = g_CVar.GetArgV( iArg );
+
+		auto hFile = g_pFileSystem->Open( pszFileName, "rb" );
+
+		if( hFile == FILESYSTEM_INVALID_HANDLE )
+		{
+			Msg( "%s: couldn't open file\n", pszFileName );
+			continue;
+		}
+
+		const unsigned int uiSize = g_pFileSystem->Size( hFile );
+
+		std::vector<uint8_t> contents( uiSize );
+
+		const int iRead = g_pFileSystem->Read( contents.data(), static_cast<int>( uiSize ), hFile );
+
+		int iBufferSize = 0;
+
+		const auto pBuffer = g_pFileSystem->GetReadBuffer( hFile, &iBufferSize, false );
+
+		//The buffer has to stay valid after the file is closed.
+		g_pFileSystem->Close( hFile );
+
+		if( !pBuffer )
+		{
+			Msg( "%s: no read buffer\n", pszFileName );
+			continue;
+		}
+
+		const bool bMatches = iRead == iBufferSize && static_cast<unsigned int>( iBufferSize ) == uiSize && !memcmp( pBuffer, contents.data(), uiSize );
+
+		Msg( "%s: %s (%u bytes)\n", pszFileName, bMatches ? "matches" : "MISMATCH", uiSize );
+
+		g_pFileSystem->ReleaseReadBuffer( FILESYSTEM_INVALID_HANDLE, pBuffer );
+	}
+}
+}
+
+void InitFileSystemCommands()
+{
+	g_CVar.AddCommand( "fs_stats", &Cmd_FileSystemStats_f );
+	g_CVar.AddCommand( "fs_pathindex", &Cmd_FileSystemPathIndex_f );
+	g_CVar.AddCommand( "fs_blockcache", &Cmd_FileSystemBlockCache_f );
+	g_CVar.AddCommand( "fs_loadtrace_replay", &Cmd_FileSystemLoadTraceReplay_f );
+	g_CVar.AddCommand( "fs_lookup_benchmark", &Cmd_FileSystemLookupBenchmark_f );
+	g_CVar.AddCommand( "fs_pack_benchmark", &Cmd_FileSystemPackBenchmark_f );
+	g_CVar.AddCommand( "fs_handle_benchmark", &Cmd_FileSystemHandleBenchmark_f );
+	g_CVar.AddCommand( "fs_readbuffer_test", &Cmd_FileSystemReadBufferTest_f );
+}
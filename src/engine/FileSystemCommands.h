@@ -0,0 +1,9 @@
+#ifndef ENGINE_FILESYSTEMCOMMANDS_H
+#define ENGINE_FILESYSTEMCOMMANDS_H
+
+/**
+*	Registers console commands used to inspect and benchmark the filesystem.
+*/
+void InitFileSystemCommands();
+
+#endif //ENGINE_FILESYSTEMCOMMANDS_H
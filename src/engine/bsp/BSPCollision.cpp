@@ -0,0 +1,474 @@
+/*
+Copyright (C) 1996-1997 Id Software, Inc.
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <random>
+
+#include "Logging.h"
+
+#include "Engine.h"
+
+#include "BSPRenderIO.h"
+
+#include "BSPCollision.h"
+
+namespace BSP
+{
+namespace
+{
+/**
+*	Transform from world space into a model's hull space.
+*/
+struct ModelTransform_t
+{
+	Vector origin;
+
+	bool bRotated;
+
+	Vector forward, right, up;
+};
+
+void AngleVectors( const Vector& angles, Vector& forward, Vector& right, Vector& up )
+{
+	const float sy = sin( glm::radians( angles[ 1 ] ) );
+	const float cy = cos( glm::radians( angles[ 1 ] ) );
+	const float sp = sin( glm::radians( angles[ 0 ] ) );
+	const float cp = cos( glm::radians( angles[ 0 ] ) );
+	const float sr = sin( glm::radians( angles[ 2 ] ) );
+	const float cr = cos( glm::radians( angles[ 2 ] ) );
+
+	forward[ 0 ] = cp * cy;
+	forward[ 1 ] = cp * sy;
+	forward[ 2 ] = -sp;
+
+	right[ 0 ] = ( -1 * sr * sp * cy + -1 * cr * -sy );
+	right[ 1 ] = ( -1 * sr * sp * sy + -1 * cr * cy );
+	right[ 2 ] = -1 * sr * cp;
+
+	up[ 0 ] = ( cr * sp * cy + -sr * -sy );
+	up[ 1 ] = ( cr * sp * sy + -sr * cy );
+	up[ 2 ] = cr * cp;
+}
+
+/**
+*	Rotates a vector into the space described by the given axes.
+*/
+Vector RotateIntoAxes( const Vector& v, const Vector& forward, const Vector& right, const Vector& up )
+{
+	return Vector( glm::dot( v, forward ), -glm::dot( v, right ), glm::dot( v, up ) );
+}
+
+void SetupTransform( const Vector& origin, const Vector& angles, ModelTransform_t& transform )
+{
+	transform.origin = origin;
+	transform.bRotated = angles[ 0 ] != 0 || angles[ 1 ] != 0 || angles[ 2 ] != 0;
+
+	if( transform.bRotated )
+		AngleVectors( angles, transform.forward, transform.right, transform.up );
+}
+
+void TraceTransformed( const bmodel_t* pModel, const ModelTransform_t& transform,
+					   const Vector& start, const Vector& mins, const Vector& maxs, const Vector& end, trace_t& trace )
+{
+	trace = trace_t{};
+
+	trace.fraction = 1;
+	trace.allsolid = true;
+	trace.endpos = end;
+
+	Vector offset;
+
+	const hull_t* pHull = HullForSize( pModel, mins, maxs, offset );
+
+	offset += transform.origin;
+
+	Vector startLocal = start - offset;
+	Vector endLocal = end - offset;
+
+	if( transform.bRotated )
+	{
+		startLocal = RotateIntoAxes( startLocal, transform.forward, transform.right, transform.up );
+		endLocal = RotateIntoAxes( endLocal, transform.forward, transform.right, transform.up );
+	}
+
+	RecursiveHullCheck( pHull, pHull->firstclipnode, 0, 1, startLocal, endLocal, trace );
+
+	if( trace.fraction != 1 )
+	{
+		if( transform.bRotated )
+		{
+			//Rotate the plane normal back into world space. Inverse rotation is the transpose.
+			const Vector normal = trace.plane.normal;
+
+			trace.plane.normal = normal[ 0 ] * transform.forward - normal[ 1 ] * transform.right + normal[ 2 ] * transform.up;
+		}
+
+		//Plane distance is relative to the model's hull space.
+		trace.plane.dist += glm::dot( trace.plane.normal, offset );
+
+		trace.endpos = start + trace.fraction * ( end - start );
+	}
+	else if( trace.allsolid || trace.startsolid )
+	{
+		trace.endpos = start;
+	}
+}
+
+void Cmd_TraceBenchmark_f()
+{
+	const bmodel_t* pWorld = &mod_known[ 0 ];
+
+	if( !pWorld->name[ 0 ] || !pWorld->nodes )
+	{
+		Msg( "No map loaded\n" );
+		return;
+	}
+
+	size_t uiCount = 100000;
+
+	if( g_CVar.GetArgC() > 1 )
+		uiCount = std::max( 1, atoi( g_CVar.GetArgV( 1 ) ) );
+
+	std::unique_ptr<TraceRequest_t[]> requests( new TraceRequest_t[ uiCount ] );
+	std::unique_ptr<trace_t[]> results( new trace_t[ uiCount ] );
+
+	//Fixed seed so results are comparable between runs.
+	std::mt19937 random( 0 );
+
+	std::uniform_real_distribution<float> dist[ 3 ] =
+	{
+		std::uniform_real_distribution<float>( pWorld->mins[ 0 ], pWorld->maxs[ 0 ] ),
+		std::uniform_real_distribution<float>( pWorld->mins[ 1 ], pWorld->maxs[ 1 ] ),
+		std::uniform_real_distribution<float>( pWorld->mins[ 2 ], pWorld->maxs[ 2 ] )
+	};
+
+	//Half point traces, half player sized box traces.
+	const Vector playerMins( -16, -16, -36 );
+	const Vector playerMaxs( 16, 16, 36 );
+
+	for( size_t uiIndex = 0; uiIndex < uiCount; ++uiIndex )
+	{
+		auto& request = requests[ uiIndex ];
+
+		for( int j = 0; j < 3; ++j )
+		{
+			request.start[ j ] = dist[ j ]( random );
+			request.end[ j ] = dist[ j ]( random );
+		}
+
+		request.mins = ( uiIndex & 1 ) ? playerMins : Vector();
+		request.maxs = ( uiIndex & 1 ) ? playerMaxs : Vector();
+	}
+
+	const auto start = std::chrono::high_resolution_clock::now();
+
+	TraceBatch( pWorld, Vector(), Vector(), requests.get(), results.get(), uiCount );
+
+	const auto end = std::chrono::high_resolution_clock::now();
+
+	size_t uiHits = 0;
+
+	for( size_t uiIndex = 0; uiIndex < uiCount; ++uiIndex )
+	{
+		if( results[ uiIndex ].fraction < 1 )
+			++uiHits;
+	}
+
+	const double flSeconds = std::chrono::duration<double>( end - start ).count();
+
+	Msg( "%u traces in %.3f msec (%.0f traces/sec), %u hit\n",
+		 static_cast<unsigned int>( uiCount ), flSeconds * 1000.0, flSeconds > 0 ? uiCount / flSeconds : 0.0, static_cast<unsigned int>( uiHits ) );
+}
+}
+
+void InitCollision()
+{
+	g_CVar.AddCommand( "trace_benchmark", &Cmd_TraceBenchmark_f );
+}
+
+int HullPointContents( const hull_t* pHull, int num, const Vector& p )
+{
+	float d;
+	const dclipnode_t* node;
+	const mplane_t* plane;
+
+	while( num >= 0 )
+	{
+		assert( num >= pHull->firstclipnode && num <= pHull->lastclipnode );
+
+		node = pHull->clipnodes + num;
+		plane = pHull->planes + node->planenum;
+
+		if( plane->type < PLANE_ANYX )
+			d = p[ plane->type ] - plane->dist;
+		else
+			d = glm::dot( plane->normal, p ) - plane->dist;
+
+		if( d < 0 )
+			num = node->children[ 1 ];
+		else
+			num = node->children[ 0 ];
+	}
+
+	return num;
+}
+
+int PointContents( const bmodel_t* pModel, const Vector& p )
+{
+	const hull_t* pHull = &pModel->hulls[ 0 ];
+
+	return HullPointContents( pHull, pHull->firstclipnode, p );
+}
+
+bool RecursiveHullCheck( const hull_t* pHull, int num, float p1f, float p2f, const Vector& p1, const Vector& p2, trace_t& trace )
+{
+	// check for empty
+	if( num < 0 )
+	{
+		if( num != CONTENTS_SOLID )
+		{
+			trace.allsolid = false;
+			if( num == CONTENTS_EMPTY )
+				trace.inopen = true;
+			else
+				trace.inwater = true;
+		}
+		else
+			trace.startsolid = true;
+		return true;		// empty
+	}
+
+	if( num < pHull->firstclipnode || num > pHull->lastclipnode )
+	{
+		printf( "BSP::RecursiveHullCheck: bad node number %d\n", num );
+		return false;
+	}
+
+	//
+	// find the point distances
+	//
+	const dclipnode_t* node = pHull->clipnodes + num;
+	const mplane_t* plane = pHull->planes + node->planenum;
+
+	float t1, t2;
+
+	if( plane->type < PLANE_ANYX )
+	{
+		t1 = p1[ plane->type ] - plane->dist;
+		t2 = p2[ plane->type ] - plane->dist;
+	}
+	else
+	{
+		t1 = glm::dot( plane->normal, p1 ) - plane->dist;
+		t2 = glm::dot( plane->normal, p2 ) - plane->dist;
+	}
+
+	if( t1 >= 0 && t2 >= 0 )
+		return RecursiveHullCheck( pHull, node->children[ 0 ], p1f, p2f, p1, p2, trace );
+	if( t1 < 0 && t2 < 0 )
+		return RecursiveHullCheck( pHull, node->children[ 1 ], p1f, p2f, p1, p2, trace );
+
+	// put the crosspoint DIST_EPSILON pixels on the near side
+	float frac;
+
+	if( t1 < 0 )
+		frac = ( t1 + DIST_EPSILON ) / ( t1 - t2 );
+	else
+		frac = ( t1 - DIST_EPSILON ) / ( t1 - t2 );
+	if( frac < 0 )
+		frac = 0;
+	if( frac > 1 )
+		frac = 1;
+
+	float midf = p1f + ( p2f - p1f ) * frac;
+	Vector mid = p1 + frac * ( p2 - p1 );
+
+	const int side = ( t1 < 0 );
+
+	// move up to the node
+	if( !RecursiveHullCheck( pHull, node->children[ side ], p1f, midf, p1, mid, trace ) )
+		return false;
+
+	if( HullPointContents( pHull, node->children[ side ^ 1 ], mid ) != CONTENTS_SOLID )
+		// go past the node
+		return RecursiveHullCheck( pHull, node->children[ side ^ 1 ], midf, p2f, mid, p2, trace );
+
+	if( trace.allsolid )
+		return false;		// never got out of the solid area
+
+	//==================
+	// the other side of the node is solid, this is the impact point
+	//==================
+	if( !side )
+	{
+		trace.plane.normal = plane->normal;
+		trace.plane.dist = plane->dist;
+	}
+	else
+	{
+		trace.plane.normal = -plane->normal;
+		trace.plane.dist = -plane->dist;
+	}
+
+	while( HullPointContents( pHull, pHull->firstclipnode, mid ) == CONTENTS_SOLID )
+	{
+		// shouldn't really happen, but does occasionally
+		frac -= 0.1f;
+		if( frac < 0 )
+		{
+			trace.fraction = midf;
+			trace.endpos = mid;
+			return false;
+		}
+		midf = p1f + ( p2f - p1f ) * frac;
+		mid = p1 + frac * ( p2 - p1 );
+	}
+
+	trace.fraction = midf;
+	trace.endpos = mid;
+
+	return false;
+}
+
+const hull_t* HullForSize( const bmodel_t* pModel, const Vector& mins, const Vector& maxs, Vector& vecOutOffset )
+{
+	const Vector size = maxs - mins;
+
+	const hull_t* pHull;
+
+	//Same rules as Half-Life: point, then standing or crouching player, then large.
+	if( size[ 0 ] <= 8 )
+		pHull = &pModel->hulls[ 0 ];
+	else if( size[ 0 ] <= 36 )
+		pHull = size[ 2 ] <= 36 ? &pModel->hulls[ 3 ] : &pModel->hulls[ 1 ];
+	else
+		pHull = &pModel->hulls[ 2 ];
+
+	// calculate an offset value to center the origin
+	vecOutOffset = pHull->clip_mins - mins;
+
+	return pHull;
+}
+
+void TraceModel( const bmodel_t* pModel, const Vector& origin, const Vector& angles,
+				 const Vector& start, const Vector& mins, const Vector& maxs, const Vector& end, trace_t& trace )
+{
+	assert( pModel );
+
+	ModelTransform_t transform;
+
+	SetupTransform( origin, angles, transform );
+
+	TraceTransformed( pModel, transform, start, mins, maxs, end, trace );
+}
+
+void TraceWorld( const bmodel_t* pWorld, const Vector& start, const Vector& mins, const Vector& maxs, const Vector& end, trace_t& trace )
+{
+	TraceModel( pWorld, Vector(), Vector(), start, mins, maxs, end, trace );
+}
+
+void TraceBatch( const bmodel_t* pModel, const Vector& origin, const Vector& angles,
+				 const TraceRequest_t* pRequests, trace_t* pResults, const size_t uiCount )
+{
+	assert( pModel );
+	assert( pRequests || !uiCount );
+	assert( pResults || !uiCount );
+
+	ModelTransform_t transform;
+
+	SetupTransform( origin, angles, transform );
+
+	for( size_t uiIndex = 0; uiIndex < uiCount; ++uiIndex )
+	{
+		const auto& request = pRequests[ uiIndex ];
+
+		TraceTransformed( pModel, transform, request.start, request.mins, request.maxs, request.end, pResults[ uiIndex ] );
+	}
+}
+
+bool VerifyPlayerHulls( const bmodel_t* pWorld, const Vector& origin )
+{
+	assert( pWorld );
+
+	trace_t trace;
+
+	//Find the floor with a point trace; that is what the boxes should land on.
+	TraceWorld( pWorld, origin, Vector(), Vector(), origin - Vector( 0, 0, 8192 ), trace );
+
+	if( trace.startsolid || trace.fraction == 1 )
+	{
+		Msg( "No floor below (%.2f %.2f %.2f)\n", origin[ 0 ], origin[ 1 ], origin[ 2 ] );
+		return false;
+	}
+
+	const float flFloor = trace.endpos[ 2 ];
+
+	struct Box_t
+	{
+		const char* pszName;
+		Vector mins;
+		Vector maxs;
+	};
+
+	const Box_t boxes[] =
+	{
+		{ "standing", Vector( -16, -16, -36 ), Vector( 16, 16, 36 ) },
+		{ "crouching", Vector( -16, -16, -18 ), Vector( 16, 16, 18 ) }
+	};
+
+	bool bSuccess = true;
+
+	for( const auto& box : boxes )
+	{
+		//Standing just above the floor.
+		const Vector start( origin[ 0 ], origin[ 1 ], flFloor - box.mins[ 2 ] + 1 );
+
+		TraceWorld( pWorld, start, box.mins, box.maxs, start, trace );
+
+		if( trace.startsolid || trace.allsolid )
+		{
+			Warning( "A %s player box standing on the floor at %.2f starts solid\n", box.pszName, flFloor );
+			bSuccess = false;
+			continue;
+		}
+
+		//Dropped onto the floor, the bottom of the box must rest on it.
+		TraceWorld( pWorld, start, box.mins, box.maxs, start - Vector( 0, 0, 64 ), trace );
+
+		const float flBottom = trace.endpos[ 2 ] + box.mins[ 2 ];
+
+		if( trace.fraction == 1 || fabs( flBottom - flFloor ) > 0.1f )
+		{
+			Warning( "A %s player box lands at %.2f instead of on the floor at %.2f\n", box.pszName, flBottom, flFloor );
+			bSuccess = false;
+			continue;
+		}
+
+		Msg( "A %s player box stands on the floor at %.2f\n", box.pszName, flFloor );
+	}
+
+	return bSuccess;
+}
+}
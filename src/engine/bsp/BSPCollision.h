@@ -0,0 +1,148 @@
+#ifndef ENGINE_BSP_BSPCOLLISION_H
+#define ENGINE_BSP_BSPCOLLISION_H
+
+/**
+*	@file Collision detection against brush model clipping hulls.
+*/
+
+#include <cstddef>
+
+#include "bsp/BSPRenderDefs.h"
+
+namespace BSP
+{
+/**
+*	Pushes impact points this far away from the plane they hit, so traces starting there don't start in solid.
+*/
+#define	DIST_EPSILON	( 0.03125f )
+
+/**
+*	Result of a trace.
+*/
+struct trace_t
+{
+	/**
+	*	If true, the trace never left solid and plane is not valid.
+	*/
+	bool allsolid;
+
+	/**
+	*	If true, the start point was in solid.
+	*/
+	bool startsolid;
+
+	/**
+	*	Whether the trace passed through empty space.
+	*/
+	bool inopen;
+
+	/**
+	*	Whether the trace passed through liquid.
+	*/
+	bool inwater;
+
+	/**
+	*	Fraction of the way that the trace got. 1.0 means nothing was hit.
+	*/
+	float fraction;
+
+	/**
+	*	Final position.
+	*/
+	Vector endpos;
+
+	/**
+	*	Plane that was hit. Only normal and dist are valid.
+	*/
+	mplane_t plane;
+};
+
+/**
+*	A single trace in a batch.
+*/
+struct TraceRequest_t
+{
+	Vector start;
+	Vector mins;
+	Vector maxs;
+	Vector end;
+};
+
+/**
+*	Registers collision related console commands.
+*/
+void InitCollision();
+
+/**
+*	Gets the contents of the given point in the given hull.
+*	@param pHull Hull to check.
+*	@param num Clipnode to start at.
+*	@param p Point to check.
+*	@return Contents. One of the CONTENTS_* values.
+*/
+int HullPointContents( const hull_t* pHull, int num, const Vector& p );
+
+/**
+*	Gets the contents of the given point in the given model, using its point sized hull.
+*/
+int PointContents( const bmodel_t* pModel, const Vector& p );
+
+/**
+*	Recursively traces a line through a hull.
+*	The trace must be initialized with allsolid set to true and fraction set to 1 before the first call.
+*	@return false if the trace hit something and no further checks are needed.
+*/
+bool RecursiveHullCheck( const hull_t* pHull, int num, float p1f, float p2f, const Vector& p1, const Vector& p2, trace_t& trace );
+
+/**
+*	Selects the hull in the given model that best matches a box of the given size.
+*	@param pModel Model to get the hull from.
+*	@param mins Box mins.
+*	@param maxs Box maxs.
+*	@param vecOutOffset Offset that must be subtracted from trace positions to trace in the hull's space.
+*	@return The hull.
+*/
+const hull_t* HullForSize( const bmodel_t* pModel, const Vector& mins, const Vector& maxs, Vector& vecOutOffset );
+
+/**
+*	Traces a box through a brush model.
+*	@param pModel Model to trace against.
+*	@param origin Position of the model.
+*	@param angles Rotation of the model, in degrees. Brush models are usually not rotated.
+*	@param start Start position.
+*	@param mins Box mins. Zero for a line trace.
+*	@param maxs Box maxs. Zero for a line trace.
+*	@param end End position.
+*	@param trace Result.
+*/
+void TraceModel( const bmodel_t* pModel, const Vector& origin, const Vector& angles,
+				 const Vector& start, const Vector& mins, const Vector& maxs, const Vector& end, trace_t& trace );
+
+/**
+*	Traces a box through the world model, which is never moved.
+*	@see TraceModel
+*/
+void TraceWorld( const bmodel_t* pWorld, const Vector& start, const Vector& mins, const Vector& maxs, const Vector& end, trace_t& trace );
+
+/**
+*	Checks that standing and crouching player boxes can stand on the floor below the given point:
+*	resting on the floor they must not start solid, and dropped onto it they must land with their bottom on it.
+*	@return Whether both boxes passed. The point must be in open space, with room for a player over the floor below it.
+*/
+bool VerifyPlayerHulls( const bmodel_t* pWorld, const Vector& origin );
+
+/**
+*	Traces a batch of boxes through a brush model.
+*	Model transform setup is done once for the entire batch.
+*	@param pModel Model to trace against.
+*	@param origin Position of the model.
+*	@param angles Rotation of the model, in degrees.
+*	@param pRequests Traces to perform.
+*	@param pResults Receives the results, one for each request.
+*	@param uiCount Number of traces.
+*/
+void TraceBatch( const bmodel_t* pModel, const Vector& origin, const Vector& angles,
+				 const TraceRequest_t* pRequests, trace_t* pResults, const size_t uiCount );
+}
+
+#endif //ENGINE_BSP_BSPCOLLISION_H
@@ -17,22 +17,39 @@ along with this program; if not, write to the Free Software
 Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
 */
+#include <algorithm>
+#include <cassert>
 #include <cmath>
 #include <cstdio>
 #include <memory>
+#include <string>
+#include <unordered_set>
+#include <vector>
 
 #include <glm/gtc/type_ptr.hpp>
 
 #include "common/ByteSwap.h"
+#include "common/CMemoryArena.h"
 #include "common/Tokenization.h"
 
+#include "bsp/BSPIO.h"
+
 #include "gl/CShaderManager.h"
 #include "gl/CBaseShader.h"
 #include "gl/CShaderInstance.h"
 
 #include "wad/CWadManager.h"
+#include "wad/WadConstants.h"
+#include "gl/CTextureDecoder.h"
 #include "gl/CTextureManager.h"
 
+#include "Engine.h"
+#include "FileSystem2.h"
+
+#include "CDynamicLights.h"
+#include "CLightmapAtlas.h"
+#include "LightmapCompose.h"
+
 #include "BSPRenderIO.h"
 
 namespace BSP
@@ -42,11 +59,11 @@ namespace BSP
 Mod_LoadVertexes
 =================
 */
-bool Mod_LoadVertexes( bmodel_t* pModel, dheader_t* pHeader, lump_t* l )
+bool Mod_LoadVertexes( bmodel_t* pModel, const CBSPView& file, const lump_t* l )
 {
-	uint8_t* mod_base = reinterpret_cast<uint8_t*>( pHeader );
+	const uint8_t* mod_base = file.GetBase();
 
-	dvertex_t* in = ( dvertex_t* ) ( mod_base + l->fileofs );
+	const dvertex_t* in = ( const dvertex_t* ) ( mod_base + l->fileofs );
 
 	if( l->filelen % sizeof( *in ) )
 	{
@@ -56,7 +73,7 @@ bool Mod_LoadVertexes( bmodel_t* pModel, dheader_t* pHeader, lump_t* l )
 
 	const size_t count = l->filelen / sizeof( *in );
 
-	mvertex_t* out = new mvertex_t[ count ];
+	mvertex_t* out = pModel->arena->Allocate<mvertex_t>( count );
 
 	pModel->vertexes = out;
 	pModel->numvertexes = count;
@@ -76,11 +93,11 @@ bool Mod_LoadVertexes( bmodel_t* pModel, dheader_t* pHeader, lump_t* l )
 Mod_LoadEdges
 =================
 */
-bool Mod_LoadEdges( bmodel_t* pModel, dheader_t* pHeader, lump_t* l )
+bool Mod_LoadEdges( bmodel_t* pModel, const CBSPView& file, const lump_t* l )
 {
-	uint8_t* mod_base = reinterpret_cast<uint8_t*>( pHeader );
+	const uint8_t* mod_base = file.GetBase();
 
-	dedge_t* in = ( dedge_t* ) ( mod_base + l->fileofs );
+	const dedge_t* in = ( const dedge_t* ) ( mod_base + l->fileofs );
 
 	if( l->filelen % sizeof( *in ) )
 	{
@@ -89,7 +106,7 @@ bool Mod_LoadEdges( bmodel_t* pModel, dheader_t* pHeader, lump_t* l )
 	}
 
 	const size_t count = l->filelen / sizeof( *in );
-	medge_t* out = new medge_t[ count ];
+	medge_t* out = pModel->arena->Allocate<medge_t>( count );
 
 	pModel->edges = out;
 	pModel->numedges = count;
@@ -108,11 +125,11 @@ bool Mod_LoadEdges( bmodel_t* pModel, dheader_t* pHeader, lump_t* l )
 Mod_LoadSurfedges
 =================
 */
-bool Mod_LoadSurfedges( bmodel_t* pModel, dheader_t* pHeader, lump_t* l )
+bool Mod_LoadSurfedges( bmodel_t* pModel, const CBSPView& file, const lump_t* l )
 {
-	uint8_t* mod_base = reinterpret_cast<uint8_t*>( pHeader );
+	const uint8_t* mod_base = file.GetBase();
 
-	int* in = ( int* ) ( mod_base + l->fileofs );
+	const int* in = ( const int* ) ( mod_base + l->fileofs );
 
 	if( l->filelen % sizeof( *in ) )
 	{
@@ -122,13 +139,77 @@ bool Mod_LoadSurfedges( bmodel_t* pModel, dheader_t* pHeader, lump_t* l )
 
 	const size_t count = l->filelen / sizeof( *in );
 
-	int* out = new int[ count ];
+#if IS_LITTLE_ENDIAN
+	//Already in the right format, use it in place.
+	pModel->surfedges = in;
+#else
+	int* out = pModel->arena->Allocate<int>( count );
+
+	for( size_t i = 0; i < count; ++i )
+		out[ i ] = LittleValue( in[ i ] );
 
 	pModel->surfedges = out;
+#endif
+
 	pModel->numsurfedges = count;
 
-	for( size_t i = 0; i < count; ++i )
-		out[ i ] = LittleValue( in[ i ] );
+	return true;
+}
+
+bool GetTextureLumpMiptex( const CBSPView& file, std::vector<const miptex_t*>& miptex, std::vector<std::unique_ptr<uint8_t[]>>& swapped )
+{
+	miptex.clear();
+	swapped.clear();
+
+	const lump_t& l = file.GetLump( LUMP_TEXTURES );
+
+	//No textures.
+	if( !l.filelen )
+		return true;
+
+	//The file data is read-only, so nothing can be swapped in place.
+	const dmiptexlump_t* m = ( const dmiptexlump_t* ) ( file.GetBase() + l.fileofs );
+
+	const int nummiptex = LittleValue( m->nummiptex );
+
+	miptex.reserve( nummiptex );
+
+	for( int i = 0; i<nummiptex; i++ )
+	{
+		const int dataofs = LittleValue( m->dataofs[ i ] );
+		if( dataofs == -1 )
+			continue;
+		const miptex_t* mt = ( const miptex_t * ) ( ( const uint8_t * ) m + dataofs );
+
+#if !IS_LITTLE_ENDIAN
+		{
+			//Texture conversion reads the header directly, so swap a copy of the texture.
+			const size_t uiSize = l.filelen - dataofs;
+
+			std::unique_ptr<uint8_t[]> copy( new uint8_t[ uiSize ] );
+			memcpy( copy.get(), mt, uiSize );
+
+			miptex_t* pSwapped = reinterpret_cast<miptex_t*>( copy.get() );
+
+			pSwapped->width = LittleValue( pSwapped->width );
+			pSwapped->height = LittleValue( pSwapped->height );
+			for( int j = 0; j<MIPLEVELS; j++ )
+				pSwapped->offsets[ j ] = LittleValue( pSwapped->offsets[ j ] );
+
+			mt = pSwapped;
+
+			swapped.emplace_back( std::move( copy ) );
+		}
+#endif
+
+		if( ( mt->width & 15 ) || ( mt->height & 15 ) )
+		{
+			printf( "Texture %s is not 16 aligned\n", mt->name );
+			return false;
+		}
+
+		miptex.emplace_back( mt );
+	}
 
 	return true;
 }
@@ -138,65 +219,74 @@ bool Mod_LoadSurfedges( bmodel_t* pModel, dheader_t* pHeader, lump_t* l )
 Mod_LoadTextures
 =================
 */
-bool Mod_LoadTextures( bmodel_t* pModel, dheader_t* pHeader, lump_t* l )
+bool Mod_LoadTextures( const CBSPView& file, const int iTextureThreads )
 {
-	int		j, pixels;
-	miptex_t	*mt;
+	std::vector<const miptex_t*> lumpMiptex;
 
-	uint8_t* mod_base = reinterpret_cast<uint8_t*>( pHeader );
+	//Swapped copies are referenced by lumpMiptex, and must outlive the decoder.
+	std::vector<std::unique_ptr<uint8_t[]>> swapped;
 
-	//No textures to load.
-	if( !l->filelen )
-	{
-		return g_TextureManager.Initialize( 0 );
-	}
+	if( !GetTextureLumpMiptex( file, lumpMiptex, swapped ) )
+		return false;
 
-	dmiptexlump_t* m = ( dmiptexlump_t* ) ( mod_base + l->fileofs );
+	if( !g_TextureManager.Initialize( lumpMiptex.size() ) )
+		return false;
 
-	m->nummiptex = LittleValue( m->nummiptex );
+	/*
+	*	Load the textures. Internal or external, doesn't matter.
+	*	The miptex index should map to the correct texture here, but for the case where something goes wrong, it shouldn't be used directly.
+	*	Use the miptex index into the miptexlump instead. - Solokiller
+	*
+	*	Textures are looked up here, converted on worker threads, and uploaded here in lump order as they're converted.
+	*	Only the first texture with a given name is loaded.
+	*/
+	std::unordered_set<const char*, RawCharHashI, RawCharEqualToI> seenNames;
 
-	if( !g_TextureManager.Initialize( m->nummiptex ) )
-		return false;
+	std::vector<const miptex_t*> sources;
+	std::vector<const char*> names;
+
+	sources.reserve( lumpMiptex.size() );
+	names.reserve( lumpMiptex.size() );
 
-	for( int i = 0; i<m->nummiptex; i++ )
+	for( auto mt : lumpMiptex )
 	{
-		m->dataofs[ i ] = LittleValue( m->dataofs[ i ] );
-		if( m->dataofs[ i ] == -1 )
+		if( !seenNames.insert( mt->name ).second )
 			continue;
-		mt = ( miptex_t * ) ( ( uint8_t * ) m + m->dataofs[ i ] );
-		mt->width = LittleValue( mt->width );
-		mt->height = LittleValue( mt->height );
-		for( j = 0; j<MIPLEVELS; j++ )
-			mt->offsets[ j ] = LittleValue( mt->offsets[ j ] );
 
-		if( ( mt->width & 15 ) || ( mt->height & 15 ) )
+		if( auto pSource = g_TextureManager.FindMiptex( mt->name, mt->offsets[ 0 ] > 0 ? mt : nullptr ) )
 		{
-			printf( "Texture %s is not 16 aligned\n", mt->name );
-			return false;
+			sources.emplace_back( pSource );
+			names.emplace_back( mt->name );
 		}
-		pixels = mt->width*mt->height / 64 * 85;
+	}
 
-		/*
-		*	Load the texture. Internal or external, doesn't matter.
-		*	The miptex index should map to the correct texture here, but for the case where something goes wrong, it shouldn't be used directly.
-		*	Use the miptex index into the miptexlump instead. - Solokiller
-		*/
-		g_TextureManager.LoadTexture( mt->name, mt->offsets[ 0 ] > 0 ? mt : nullptr );
+	{
+		CTextureDecoder decoder;
 
-		/*
-		TODO: fix this - Solokiller
-		if( !strncmp( mt->name, "sky", 3 ) )
-			R_InitSky( tx );
-		else
+		decoder.Start( std::vector<const miptex_t*>( sources ), iTextureThreads );
+
+		MiptexImage_t image;
+
+		for( size_t uiIndex = 0; uiIndex < sources.size(); ++uiIndex )
 		{
-			texture_mode = GL_LINEAR_MIPMAP_NEAREST; //_LINEAR;
-			tx->gl_texturenum = GL_LoadTexture( mt->name, tx->width, tx->height, ( byte * ) ( tx + 1 ), true, false );
-			texture_mode = GL_LINEAR;
+			if( decoder.TakeImage( uiIndex, image ) )
+				g_TextureManager.AddTexture( names[ uiIndex ], *sources[ uiIndex ], image );
+
+			/*
+			TODO: fix this - Solokiller
+			if( !strncmp( mt->name, "sky", 3 ) )
+				R_InitSky( tx );
+			else
+			{
+				texture_mode = GL_LINEAR_MIPMAP_NEAREST; //_LINEAR;
+				tx->gl_texturenum = GL_LoadTexture( mt->name, tx->width, tx->height, ( byte * ) ( tx + 1 ), true, false );
+				texture_mode = GL_LINEAR;
+			}
+			*/
 		}
-		*/
 	}
 
-	//Wads aren't needed anymore now.
+	//Wads aren't needed anymore now. The files stay open for the next map.
 	g_WadManager.Clear();
 
 	if( !g_TextureManager.SetupAnimatingTextures() )
@@ -213,7 +303,7 @@ bool Mod_LoadTextures( bmodel_t* pModel, dheader_t* pHeader, lump_t* l )
 Mod_LoadLighting
 =================
 */
-bool Mod_LoadLighting( bmodel_t* pModel, dheader_t* pHeader, lump_t* l )
+bool Mod_LoadLighting( bmodel_t* pModel, const CBSPView& file, const lump_t* l )
 {
 	//Nothing to load.
 	if( !l->filelen )
@@ -222,8 +312,8 @@ bool Mod_LoadLighting( bmodel_t* pModel, dheader_t* pHeader, lump_t* l )
 		return true;
 	}
 
-	pModel->lightdata = new uint8_t[ l->filelen ];
-	memcpy( pModel->lightdata, ( reinterpret_cast<uint8_t*>( pHeader ) ) + l->fileofs, l->filelen );
+	//Byte data, so it can always be used in place.
+	pModel->lightdata = file.GetBase() + l->fileofs;
 
 	return true;
 }
@@ -233,11 +323,11 @@ bool Mod_LoadLighting( bmodel_t* pModel, dheader_t* pHeader, lump_t* l )
 Mod_LoadPlanes
 =================
 */
-bool Mod_LoadPlanes( bmodel_t* pModel, dheader_t* pHeader, lump_t* l )
+bool Mod_LoadPlanes( bmodel_t* pModel, const CBSPView& file, const lump_t* l )
 {
-	uint8_t* mod_base = reinterpret_cast<uint8_t*>( pHeader );
+	const uint8_t* mod_base = file.GetBase();
 
-	dplane_t* in = ( dplane_t* ) ( mod_base + l->fileofs );
+	const dplane_t* in = ( const dplane_t* ) ( mod_base + l->fileofs );
 
 	if( l->filelen % sizeof( *in ) )
 	{
@@ -248,7 +338,7 @@ bool Mod_LoadPlanes( bmodel_t* pModel, dheader_t* pHeader, lump_t* l )
 	const size_t count = l->filelen / sizeof( *in );
 
 	//TODO: Why * 2? - Solokiller
-	mplane_t* out = new mplane_t[ count * 2 ];
+	mplane_t* out = pModel->arena->Allocate<mplane_t>( count * 2 );
 
 	pModel->planes = out;
 	pModel->numplanes = count;
@@ -281,14 +371,14 @@ texture_t* r_notexture_mip = nullptr;
 Mod_LoadTexinfo
 =================
 */
-bool Mod_LoadTexinfo( bmodel_t* pModel, dheader_t* pHeader, lump_t* l )
+bool Mod_LoadTexinfo( bmodel_t* pModel, const CBSPView& file, const lump_t* l )
 {
 	size_t		miptex;
 	float	len1, len2;
 
-	uint8_t* mod_base = reinterpret_cast<uint8_t*>( pHeader );
+	const uint8_t* mod_base = file.GetBase();
 
-	texinfo_t* in = ( texinfo_t* ) ( mod_base + l->fileofs );
+	const texinfo_t* in = ( const texinfo_t* ) ( mod_base + l->fileofs );
 
 	if( l->filelen % sizeof( *in ) )
 	{
@@ -298,12 +388,12 @@ bool Mod_LoadTexinfo( bmodel_t* pModel, dheader_t* pHeader, lump_t* l )
 
 	const size_t count = l->filelen / sizeof( *in );
 
-	mtexinfo_t* out = new mtexinfo_t[ count ];
+	mtexinfo_t* out = pModel->arena->Allocate<mtexinfo_t>( count );
 
 	pModel->texinfo = out;
 	pModel->numtexinfo = count;
 
-	dmiptexlump_t* m = ( dmiptexlump_t* ) ( mod_base + pHeader->lumps[ LUMP_TEXTURES ].fileofs );
+	const dmiptexlump_t* m = ( const dmiptexlump_t* ) file.GetLumpData( LUMP_TEXTURES );
 
 	for( size_t i = 0; i<count; i++, in++, out++ )
 	{
@@ -344,7 +434,7 @@ bool Mod_LoadTexinfo( bmodel_t* pModel, dheader_t* pHeader, lump_t* l )
 				return false;
 			}
 
-			miptex_t* pMiptex = reinterpret_cast<miptex_t*>( reinterpret_cast<uint8_t*>( m ) + m->dataofs[ miptex ] );
+			const miptex_t* pMiptex = reinterpret_cast<const miptex_t*>( reinterpret_cast<const uint8_t*>( m ) + LittleValue( m->dataofs[ miptex ] ) );
 
 			out->texture = g_TextureManager.FindTexture( pMiptex->name );
 
@@ -436,29 +526,7 @@ void BoundPoly( int numverts, Vector* verts, Vector& mins, Vector& maxs )
 		}
 }
 
-//static size_t g_uiPolyCount = 0;
-
-void CreatePoly( glpoly_t* pPoly )
-{
-	//glGenVertexArrays( 1, &pPoly->VAO );
-	//glBindVertexArray( pPoly->VAO );
-
-	glGenBuffers( 1, &pPoly->VBO );
-	glBindBuffer( GL_ARRAY_BUFFER, pPoly->VBO );
-
-	glBufferData( GL_ARRAY_BUFFER, pPoly->numverts * VERTEXSIZE * sizeof( GLfloat ), pPoly->verts, GL_STATIC_DRAW );
-
-	//TODO: Needed for VAO
-	//g_ShaderManager.GetShader( "LightMappedGeneric" )->SetupVertexAttribs();
-
-	/*
-	++g_uiPolyCount;
-
-	printf( "Created poly %u%s\n", g_uiPolyCount, pPoly->next ? " (duplicate)" : "" );
-	*/
-}
-
-bool SubdividePolygon( msurface_t* pSurface, int numverts, Vector* verts )
+bool SubdividePolygon( bmodel_t* pModel, msurface_t* pSurface, int numverts, Vector* verts )
 {
 	int		i, j, k;
 	Vector	mins, maxs;
@@ -525,16 +593,14 @@ bool SubdividePolygon( msurface_t* pSurface, int numverts, Vector* verts )
 			}
 		}
 
-		SubdividePolygon( pSurface, f, front );
-		SubdividePolygon( pSurface, b, back );
+		SubdividePolygon( pModel, pSurface, f, front );
+		SubdividePolygon( pModel, pSurface, b, back );
 		return true;
 	}
 
 	const size_t uiSize = sizeof( glpoly_t ) + ( numverts - 4 ) * VERTEXSIZE * sizeof( float );
 
-	poly = reinterpret_cast<glpoly_t*>( new uint8_t[ uiSize ] );
-
-	memset( poly, 0, uiSize );
+	poly = reinterpret_cast<glpoly_t*>( pModel->arena->Allocate( uiSize, alignof( glpoly_t ) ) );
 
 	poly->next = pSurface->polys;
 	pSurface->polys = poly;
@@ -548,8 +614,6 @@ bool SubdividePolygon( msurface_t* pSurface, int numverts, Vector* verts )
 		poly->verts[ i ][ 4 ] = t;
 	}
 
-	CreatePoly( poly );
-
 	return true;
 }
 
@@ -584,7 +648,7 @@ bool GL_SubdivideSurface( bmodel_t* pModel, msurface_t *fa )
 		numverts++;
 	}
 
-	return SubdividePolygon( fa, numverts, verts );
+	return SubdividePolygon( pModel, fa, numverts, verts );
 }
 
 /*
@@ -592,13 +656,13 @@ bool GL_SubdivideSurface( bmodel_t* pModel, msurface_t *fa )
 Mod_LoadFaces
 =================
 */
-bool Mod_LoadFaces( bmodel_t* pModel, dheader_t* pHeader, lump_t* l )
+bool Mod_LoadFaces( bmodel_t* pModel, const CBSPView& file, const lump_t* l )
 {
 	int			planenum, side;
 
-	uint8_t* mod_base = reinterpret_cast<uint8_t*>( pHeader );
+	const uint8_t* mod_base = file.GetBase();
 
-	dface_t* in = ( dface_t* ) ( mod_base + l->fileofs );
+	const dface_t* in = ( const dface_t* ) ( mod_base + l->fileofs );
 
 	if( l->filelen % sizeof( *in ) )
 	{
@@ -607,9 +671,7 @@ bool Mod_LoadFaces( bmodel_t* pModel, dheader_t* pHeader, lump_t* l )
 	}
 
 	const size_t count = l->filelen / sizeof( *in );
-	msurface_t* out = new msurface_t[ count ];
-
-	memset( out, 0, sizeof( msurface_t ) * count );
+	msurface_t* out = pModel->arena->Allocate<msurface_t>( count );
 
 	pModel->surfaces = out;
 	pModel->numsurfaces = count;
@@ -688,11 +750,11 @@ bool Mod_LoadFaces( bmodel_t* pModel, dheader_t* pHeader, lump_t* l )
 Mod_LoadMarksurfaces
 =================
 */
-bool Mod_LoadMarksurfaces( bmodel_t* pModel, dheader_t* pHeader, lump_t* l )
+bool Mod_LoadMarksurfaces( bmodel_t* pModel, const CBSPView& file, const lump_t* l )
 {
-	uint8_t* mod_base = reinterpret_cast<uint8_t*>( pHeader );
+	const uint8_t* mod_base = file.GetBase();
 
-	short* in = ( short* ) ( mod_base + l->fileofs );
+	const short* in = ( const short* ) ( mod_base + l->fileofs );
 
 	if( l->filelen % sizeof( *in ) )
 	{
@@ -701,7 +763,7 @@ bool Mod_LoadMarksurfaces( bmodel_t* pModel, dheader_t* pHeader, lump_t* l )
 	}
 
 	const size_t count = l->filelen / sizeof( *in );
-	msurface_t** out = new msurface_t*[ count ];
+	msurface_t** out = pModel->arena->Allocate<msurface_t*>( count );
 
 	pModel->marksurfaces = out;
 	pModel->nummarksurfaces = count;
@@ -729,17 +791,17 @@ bool Mod_LoadMarksurfaces( bmodel_t* pModel, dheader_t* pHeader, lump_t* l )
 Mod_LoadVisibility
 =================
 */
-bool Mod_LoadVisibility( bmodel_t* pModel, dheader_t* pHeader, lump_t* l )
+bool Mod_LoadVisibility( bmodel_t* pModel, const CBSPView& file, const lump_t* l )
 {
-	//Nothing to load.
+	//Nothing to load. Everything is visible.
 	if( !l->filelen )
 	{
 		pModel->visdata = nullptr;
-		return false;
+		return true;
 	}
 
-	pModel->visdata = new uint8_t[ l->filelen ];
-	memcpy( pModel->visdata, reinterpret_cast<uint8_t*>( pHeader ) + l->fileofs, l->filelen );
+	//Byte data, so it can always be used in place.
+	pModel->visdata = file.GetBase() + l->fileofs;
 
 	return true;
 }
@@ -749,11 +811,11 @@ bool Mod_LoadVisibility( bmodel_t* pModel, dheader_t* pHeader, lump_t* l )
 Mod_LoadLeafs
 =================
 */
-bool Mod_LoadLeafs( bmodel_t* pModel, dheader_t* pHeader, lump_t* l )
+bool Mod_LoadLeafs( bmodel_t* pModel, const CBSPView& file, const lump_t* l )
 {
-	uint8_t* mod_base = reinterpret_cast<uint8_t*>( pHeader );
+	const uint8_t* mod_base = file.GetBase();
 
-	dleaf_t* in = ( dleaf_t* ) ( mod_base + l->fileofs );
+	const dleaf_t* in = ( const dleaf_t* ) ( mod_base + l->fileofs );
 
 	if( l->filelen % sizeof( *in ) )
 	{
@@ -762,7 +824,7 @@ bool Mod_LoadLeafs( bmodel_t* pModel, dheader_t* pHeader, lump_t* l )
 	}
 
 	const size_t count = l->filelen / sizeof( *in );
-	mleaf_t* out = new mleaf_t[ count ];
+	mleaf_t* out = pModel->arena->Allocate<mleaf_t>( count );
 
 	pModel->leafs = out;
 	pModel->numleafs = count;
@@ -824,11 +886,11 @@ void Mod_SetParent( mnode_t *node, mnode_t *parent )
 Mod_LoadNodes
 =================
 */
-bool Mod_LoadNodes( bmodel_t* pModel, dheader_t* pHeader, lump_t* l )
+bool Mod_LoadNodes( bmodel_t* pModel, const CBSPView& file, const lump_t* l )
 {
-	uint8_t* mod_base = reinterpret_cast<uint8_t*>( pHeader );
+	const uint8_t* mod_base = file.GetBase();
 
-	dnode_t* in = ( dnode_t* ) ( mod_base + l->fileofs );
+	const dnode_t* in = ( const dnode_t* ) ( mod_base + l->fileofs );
 
 	if( l->filelen % sizeof( *in ) )
 	{
@@ -837,7 +899,7 @@ bool Mod_LoadNodes( bmodel_t* pModel, dheader_t* pHeader, lump_t* l )
 	}
 
 	const size_t count = l->filelen / sizeof( *in );
-	mnode_t* out = new mnode_t[ count ];
+	mnode_t* out = pModel->arena->Allocate<mnode_t>( count );
 
 	pModel->nodes = out;
 	pModel->numnodes = count;
@@ -878,11 +940,11 @@ bool Mod_LoadNodes( bmodel_t* pModel, dheader_t* pHeader, lump_t* l )
 Mod_LoadClipnodes
 =================
 */
-bool Mod_LoadClipnodes( bmodel_t* pModel, dheader_t* pHeader, lump_t* l )
+bool Mod_LoadClipnodes( bmodel_t* pModel, const CBSPView& file, const lump_t* l )
 {
-	uint8_t* mod_base = reinterpret_cast<uint8_t*>( pHeader );
+	const uint8_t* mod_base = file.GetBase();
 
-	dclipnode_t* in = ( dclipnode_t* ) ( mod_base + l->fileofs );
+	const dclipnode_t* in = ( const dclipnode_t* ) ( mod_base + l->fileofs );
 
 	if( l->filelen % sizeof( *in ) )
 	{
@@ -891,42 +953,50 @@ bool Mod_LoadClipnodes( bmodel_t* pModel, dheader_t* pHeader, lump_t* l )
 	}
 
 	const size_t count = l->filelen / sizeof( *in );
-	dclipnode_t* out = new dclipnode_t[ count ];
+
+#if IS_LITTLE_ENDIAN
+	//Already in the right format, use it in place.
+	const dclipnode_t* out = in;
+#else
+	dclipnode_t* out = pModel->arena->Allocate<dclipnode_t>( count );
+
+	for( size_t i = 0; i<count; i++ )
+	{
+		out[ i ].planenum = LittleValue( in[ i ].planenum );
+		out[ i ].children[ 0 ] = LittleValue( in[ i ].children[ 0 ] );
+		out[ i ].children[ 1 ] = LittleValue( in[ i ].children[ 1 ] );
+	}
+#endif
 
 	pModel->clipnodes = out;
 	pModel->numclipnodes = count;
 
-	hull_t* hull;
+	//Half-Life hull sizes: 1 is standing, 2 is large, 3 is crouching.
+	const Vector hullMins[ MAX_MAP_HULLS ] =
+	{
+		Vector( 0, 0, 0 ),
+		Vector( -16, -16, -36 ),
+		Vector( -32, -32, -32 ),
+		Vector( -16, -16, -18 )
+	};
 
-	hull = &pModel->hulls[ 1 ];
-	hull->clipnodes = out;
-	hull->firstclipnode = 0;
-	hull->lastclipnode = count - 1;
-	hull->planes = pModel->planes;
-	hull->clip_mins[ 0 ] = -16;
-	hull->clip_mins[ 1 ] = -16;
-	hull->clip_mins[ 2 ] = -24;
-	hull->clip_maxs[ 0 ] = 16;
-	hull->clip_maxs[ 1 ] = 16;
-	hull->clip_maxs[ 2 ] = 32;
-
-	hull = &pModel->hulls[ 2 ];
-	hull->clipnodes = out;
-	hull->firstclipnode = 0;
-	hull->lastclipnode = count - 1;
-	hull->planes = pModel->planes;
-	hull->clip_mins[ 0 ] = -32;
-	hull->clip_mins[ 1 ] = -32;
-	hull->clip_mins[ 2 ] = -24;
-	hull->clip_maxs[ 0 ] = 32;
-	hull->clip_maxs[ 1 ] = 32;
-	hull->clip_maxs[ 2 ] = 64;
+	const Vector hullMaxs[ MAX_MAP_HULLS ] =
+	{
+		Vector( 0, 0, 0 ),
+		Vector( 16, 16, 36 ),
+		Vector( 32, 32, 32 ),
+		Vector( 16, 16, 18 )
+	};
 
-	for( size_t i = 0; i<count; i++, out++, in++ )
+	for( size_t j = 1; j<MAX_MAP_HULLS; j++ )
 	{
-		out->planenum = LittleValue( in->planenum );
-		out->children[ 0 ] = LittleValue( in->children[ 0 ] );
-		out->children[ 1 ] = LittleValue( in->children[ 1 ] );
+		hull_t* hull = &pModel->hulls[ j ];
+		hull->clipnodes = out;
+		hull->firstclipnode = 0;
+		hull->lastclipnode = count - 1;
+		hull->planes = pModel->planes;
+		hull->clip_mins = hullMins[ j ];
+		hull->clip_maxs = hullMaxs[ j ];
 	}
 
 	return true;
@@ -937,7 +1007,7 @@ bool Mod_LoadClipnodes( bmodel_t* pModel, dheader_t* pHeader, lump_t* l )
 Mod_LoadEntities
 =================
 */
-bool Mod_LoadEntities( bmodel_t* pModel, dheader_t* pHeader, lump_t* l )
+bool Mod_LoadEntities( bmodel_t* pModel, const CBSPView& file, const lump_t* l )
 {
 	//Nothing to load.
 	if( !l->filelen )
@@ -946,8 +1016,9 @@ bool Mod_LoadEntities( bmodel_t* pModel, dheader_t* pHeader, lump_t* l )
 		return true;
 	}
 
-	pModel->entities = new char[ l->filelen ];
-	memcpy( pModel->entities, reinterpret_cast<uint8_t*>( pHeader ) + l->fileofs, l->filelen );
+	//Copied so the entity data parser can modify it.
+	pModel->entities = pModel->arena->Allocate<char>( l->filelen );
+	memcpy( pModel->entities, file.GetBase() + l->fileofs, l->filelen );
 
 	return true;
 }
@@ -957,11 +1028,11 @@ bool Mod_LoadEntities( bmodel_t* pModel, dheader_t* pHeader, lump_t* l )
 Mod_LoadSubmodels
 =================
 */
-bool Mod_LoadSubmodels( bmodel_t* pModel, dheader_t* pHeader, lump_t* l )
+bool Mod_LoadSubmodels( bmodel_t* pModel, const CBSPView& file, const lump_t* l )
 {
-	uint8_t* mod_base = reinterpret_cast<uint8_t*>( pHeader );
+	const uint8_t* mod_base = file.GetBase();
 
-	dmodel_t* in = ( dmodel_t* ) ( mod_base + l->fileofs );
+	const dmodel_t* in = ( const dmodel_t* ) ( mod_base + l->fileofs );
 
 	if( l->filelen % sizeof( *in ) )
 	{
@@ -970,7 +1041,7 @@ bool Mod_LoadSubmodels( bmodel_t* pModel, dheader_t* pHeader, lump_t* l )
 	}
 
 	const size_t count = l->filelen / sizeof( *in );
-	dmodel_t* out = new dmodel_t[ count ];
+	dmodel_t* out = pModel->arena->Allocate<dmodel_t>( count );
 
 	pModel->submodels = out;
 	pModel->numsubmodels = count;
@@ -1006,7 +1077,7 @@ void Mod_MakeHull0( bmodel_t* pModel )
 
 	mnode_t* in = pModel->nodes;
 	const size_t count = pModel->numnodes;
-	dclipnode_t* out = new dclipnode_t[ count ];
+	dclipnode_t* out = pModel->arena->Allocate<dclipnode_t>( count );
 
 	hull->clipnodes = out;
 	hull->firstclipnode = 0;
@@ -1139,6 +1210,59 @@ bool FindWadList( const bmodel_t* pModel, char*& pszWadList )
 	return false;
 }
 
+bool GetWadNames( const bmodel_t* pModel, std::vector<std::string>& wadNames )
+{
+	char* pszWadList = nullptr;
+
+	if( !FindWadList( pModel, pszWadList ) )
+		return false;
+
+	wadNames.clear();
+
+	char* pszWad = pszWadList;
+
+	while( pszWad && *pszWad )
+	{
+		char* pszNext = strchr( pszWad + 1, ';' );
+
+		if( !pszNext )
+			break;
+
+		//Null terminate so the next operations succeeds.
+		*pszNext = '\0';
+
+		//TODO: fix slashes.
+		//Strip path.
+		char* pszWadName = strrchr( pszWad, '\\' );
+
+		if( pszWadName )
+			pszWad = pszWadName + 1;
+
+		char* pszExt = strrchr( pszWad, '.' );
+
+		//Null terminate for convenience.
+		if( pszExt )
+			*pszExt = '\0';
+
+		wadNames.emplace_back( pszWad );
+
+		pszWad = pszNext + 1;
+	}
+
+	delete[] pszWadList;
+
+	return true;
+}
+
+// the lightmap texture data needs to be kept in
+// main memory so texsubimage can update properly
+CLightmapAtlas	lightmap_atlas;
+
+/**
+*	Texture for each lightmap page.
+*/
+std::vector<GLuint> lightmap_textures;
+
 /*
 ================
 BuildSurfaceDisplayList
@@ -1167,15 +1291,17 @@ void BuildSurfaceDisplayList( bmodel_t* pModel, msurface_t *fa )
 	//
 	const size_t uiSize = sizeof( glpoly_t ) + ( lnumverts - 4 ) * VERTEXSIZE * sizeof( float );
 
-	glpoly_t* poly = reinterpret_cast<glpoly_t*>( new uint8_t[ uiSize ] );
-
-	memset( poly, 0, uiSize );
+	glpoly_t* poly = reinterpret_cast<glpoly_t*>( pModel->arena->Allocate( uiSize, alignof( glpoly_t ) ) );
 
 	poly->next = fa->polys;
 	poly->flags = fa->flags;
 	fa->polys = poly;
 	poly->numverts = lnumverts;
 
+	//Surfaces without lightmaps, like sky and water, aren't in a page.
+	const int iLightmapWidth = fa->lightmaptexturenum ? lightmap_atlas.GetPage( fa->lightmappage ).iWidth : BLOCK_WIDTH;
+	const int iLightmapHeight = fa->lightmaptexturenum ? lightmap_atlas.GetPage( fa->lightmappage ).iHeight : BLOCK_HEIGHT;
+
 	for( i = 0; i<lnumverts; i++ )
 	{
 		lindex = pModel->surfedges[ fa->firstedge + i ];
@@ -1207,13 +1333,13 @@ void BuildSurfaceDisplayList( bmodel_t* pModel, msurface_t *fa )
 		s -= fa->texturemins[ 0 ];
 		s += fa->light_s * 16;
 		s += 8;
-		s /= BLOCK_WIDTH * 16; //fa->texinfo->texture->width;
+		s /= iLightmapWidth * 16; //fa->texinfo->texture->width;
 
 		t = glm::dot( *vec, *reinterpret_cast<Vector*>( &fa->texinfo->vecs[ 1 ] ) ) + fa->texinfo->vecs[ 1 ][ 3 ];
 		t -= fa->texturemins[ 1 ];
 		t += fa->light_t * 16;
 		t += 8;
-		t /= BLOCK_HEIGHT * 16; //fa->texinfo->texture->height;
+		t /= iLightmapHeight * 16; //fa->texinfo->texture->height;
 
 		poly->verts[ i ][ 5 ] = s;
 		poly->verts[ i ][ 6 ] = t;
@@ -1258,17 +1384,9 @@ void BuildSurfaceDisplayList( bmodel_t* pModel, msurface_t *fa )
 		}
 	}
 	poly->numverts = lnumverts;
-
-	CreatePoly( poly );
 }
 
-int			allocated[ MAX_LIGHTMAPS ][ BLOCK_WIDTH ];
-
-// the lightmap texture data needs to be kept in
-// main memory so texsubimage can update properly
-uint8_t		lightmaps[ 4 * MAX_LIGHTMAPS*BLOCK_WIDTH*BLOCK_HEIGHT ];
-
-int		lightmap_bytes = 4;		// 1, 2, or 4
+int		lightmap_bytes = CLightmapAtlas::BYTES_PER_TEXEL;		// 1, 2, or 4
 
 unsigned		blocklights[ BLOCK_WIDTH*BLOCK_HEIGHT * 3 ];
 
@@ -1276,58 +1394,122 @@ int		d_lightstylevalue[ 256 ];	// 8.8 fraction of base light value
 
 int		gl_lightmap_format = GL_RGBA;
 
-GLuint lightmapID[ MAX_LIGHTMAPS ];
+/**
+*	Surfaces that use each style, so only surfaces using styles that changed need to be checked.
+*	Surfaces for style N are style_surfaces[ style_surface_offsets[ N ] ] up to style_surface_offsets[ N + 1 ].
+*/
+std::vector<msurface_t*> style_surfaces;
+
+int		style_surface_offsets[ 256 + 1 ];
+
+/**
+*	Area of each lightmap page that was rebuilt since it was last uploaded.
+*/
+struct lightmaprect_t
+{
+	int left, top, right, bottom;
+};
+
+std::vector<lightmaprect_t> lightmap_dirty;
+
+/**
+*	Incremented every time lightmaps are updated. Used to tell which surfaces were marked or rebuilt during the current update.
+*	Starts at 1 so newly loaded surfaces, which have their frames zeroed, are never considered marked.
+*/
+int		r_framecount = 1;
+
+/**
+*	Lights being applied by the current update. Indexed by the bits in msurface_t::dlightbits.
+*/
+const dlight_t* cl_dlights = nullptr;
+
+/**
+*	Surfaces marked by dynamic lights during the current update.
+*/
+std::vector<msurface_t*> dlight_surfaces;
+
+/**
+*	Surfaces whose lightmap currently includes dynamic light, so they can be restored once the light is gone.
+*/
+std::vector<msurface_t*> dlit_surfaces;
 
 #define MAX_GAMMA 256
 
 int lightgammatable[ MAX_GAMMA ];
 
-// returns a texture number and the position inside it
-int AllocBlock( int w, int h, int *x, int *y )
+/*
+===============
+R_AddDynamicLights
+
+Adds the lights marked in the surface's dlightbits to blocklights
+===============
+*/
+void R_AddDynamicLights( msurface_t *surf )
 {
-	int		i, j;
-	int		best, best2;
-	int		texnum;
+	int			lnum;
+	int			sd, td;
+	float		dist, rad, minlight;
+	Vector		impact;
+	float		local[ 2 ];
+	int			s, t;
+	int			smax, tmax;
+	mtexinfo_t	*tex;
+	unsigned	*bl;
 
-	for( texnum = 0; texnum<MAX_LIGHTMAPS; texnum++ )
-	{
-		best = BLOCK_HEIGHT;
+	smax = ( surf->extents[ 0 ] >> 4 ) + 1;
+	tmax = ( surf->extents[ 1 ] >> 4 ) + 1;
+	tex = surf->texinfo;
 
-		for( i = 0; i<BLOCK_WIDTH - w; i++ )
-		{
-			best2 = 0;
+	for( lnum = 0; lnum < static_cast<int>( CDynamicLights::MAX_DLIGHTS ); lnum++ )
+	{
+		if( !( surf->dlightbits & ( 1u << lnum ) ) )
+			continue;		// not lit by this light
 
-			for( j = 0; j<w; j++ )
-			{
-				if( allocated[ texnum ][ i + j ] >= best )
-					break;
-				if( allocated[ texnum ][ i + j ] > best2 )
-					best2 = allocated[ texnum ][ i + j ];
-			}
-			if( j == w )
-			{	// this is a valid spot
-				*x = i;
-				*y = best = best2;
-			}
-		}
+		const dlight_t& light = cl_dlights[ lnum ];
 
-		if( best + h > BLOCK_HEIGHT )
+		rad = light.radius;
+		dist = glm::dot( light.origin, surf->plane->normal ) - surf->plane->dist;
+		rad -= fabs( dist );
+		minlight = light.minlight;
+		if( rad < minlight )
 			continue;
+		minlight = rad - minlight;
 
-		for( i = 0; i<w; i++ )
-			allocated[ texnum ][ *x + i ] = best + h;
+		impact = light.origin - surf->plane->normal * dist;
 
-		if( lightmapID[ texnum ] == 0 )
-		{
-			glGenTextures( 1, &lightmapID[ texnum ] );
-		}
+		local[ 0 ] = glm::dot( impact, Vector( tex->vecs[ 0 ][ 0 ], tex->vecs[ 0 ][ 1 ], tex->vecs[ 0 ][ 2 ] ) ) + tex->vecs[ 0 ][ 3 ];
+		local[ 1 ] = glm::dot( impact, Vector( tex->vecs[ 1 ][ 0 ], tex->vecs[ 1 ][ 1 ], tex->vecs[ 1 ][ 2 ] ) ) + tex->vecs[ 1 ][ 3 ];
 
-		return texnum;
-	}
+		local[ 0 ] -= surf->texturemins[ 0 ];
+		local[ 1 ] -= surf->texturemins[ 1 ];
+
+		bl = blocklights;
 
-	printf( "AllocBlock: full\n" );
+		for( t = 0; t < tmax; t++ )
+		{
+			td = static_cast<int>( local[ 1 ] - t * 16 );
+			if( td < 0 )
+				td = -td;
+			for( s = 0; s < smax; s++, bl += 3 )
+			{
+				sd = static_cast<int>( local[ 0 ] - s * 16 );
+				if( sd < 0 )
+					sd = -sd;
+				if( sd > td )
+					dist = static_cast<float>( sd + ( td >> 1 ) );
+				else
+					dist = static_cast<float>( td + ( sd >> 1 ) );
+				if( dist < minlight )
+				{
+					const unsigned amount = static_cast<unsigned>( rad - dist );
 
-	return -1;
+					bl[ 0 ] += amount * light.color[ 0 ];
+					bl[ 1 ] += amount * light.color[ 1 ];
+					bl[ 2 ] += amount * light.color[ 2 ];
+				}
+			}
+		}
+	}
 }
 
 /*
@@ -1342,12 +1524,12 @@ bool R_BuildLightMap( msurface_t *surf, uint8_t *dest, int stride )
 	int			smax, tmax;
 	int			t;
 	int			i, j, size;
-	uint8_t		*lightmap;
+	const uint8_t	*lightmap;
 	unsigned	scale;
 	int			maps;
 	unsigned	*bl;
 
-	//surf->cached_dlight = ( surf->dlightframe == r_framecount );
+	surf->cached_dlight = ( surf->dlightframe == r_framecount );
 
 	int lightscale = ( int ) floor( pow( 2.0, 1.0 / 1.8 ) * 256.0 + 0.5 );
 
@@ -1367,8 +1549,7 @@ bool R_BuildLightMap( msurface_t *surf, uint8_t *dest, int stride )
 	*/
 
 	// clear to no light
-	for( i = 0; i< size * 3; i++ )
-		blocklights[ i ] = 0;
+	memset( blocklights, 0, sizeof( *blocklights ) * size * 3 );
 
 	// add all the lightmaps
 	if( lightmap )
@@ -1377,45 +1558,20 @@ bool R_BuildLightMap( msurface_t *surf, uint8_t *dest, int stride )
 	{
 		scale = d_lightstylevalue[ surf->styles[ maps ] ];
 		surf->cached_light[ maps ] = scale;	// 8.8 fraction
-		for( i = 0; i<size * 3; i++ )
-		{
-			blocklights[ i ] += lightgammatable[ lightmap[ i ] ] * scale;
-		}
-		lightmap += size;	// skip to next lightmap
+		AccumulateLightmap( blocklights, lightmap, size * 3, lightgammatable, scale );
+		lightmap += size * 3;	// skip to next lightmap
 	}
 
 	// add all the dynamic lights
-	/*
 	if( surf->dlightframe == r_framecount )
 		R_AddDynamicLights( surf );
-		*/
 
 	// bound, invert, and shift
 store:
 	switch( gl_lightmap_format )
 	{
 	case GL_RGBA:
-		stride -= ( smax << 2 );
-		bl = blocklights;
-		for( i = 0; i<tmax; i++, dest += stride )
-		{
-			for( j = 0; j<smax; j++ )
-			{
-				for( size_t uiIndex = 0; uiIndex < 3; ++uiIndex )
-				{
-					t = *bl++;
-					t >>= 7;
-					if( t > 255 )
-						t = 255;
-					dest[ uiIndex ] = t;
-				}
-
-				dest[ 3 ] = 255;
-
-				dest += 4;
-			}
-		}
-
+		StoreLightmapRGBA( blocklights, smax, tmax, dest, stride );
 		break;
 	case GL_ALPHA:
 	case GL_LUMINANCE:
@@ -1441,6 +1597,108 @@ store:
 	return true;
 }
 
+/*
+========================
+GL_AllocateLightmaps
+
+Packs the lightmaps of all surfaces into the lightmap atlas and creates a texture for each page
+========================
+*/
+bool GL_AllocateLightmaps( bmodel_t* pModel, const int iPageSize )
+{
+	std::vector<msurface_t*> surfaces;
+	std::vector<LightmapSize_t> sizes;
+
+	surfaces.reserve( pModel->numsurfaces );
+	sizes.reserve( pModel->numsurfaces );
+
+	for( int i = 0; i < pModel->numsurfaces; ++i )
+	{
+		msurface_t* surf = pModel->surfaces + i;
+
+		if( surf->flags & ( SURF_DRAWSKY | SURF_DRAWTURB ) )
+			continue;
+
+		const int smax = ( surf->extents[ 0 ] >> 4 ) + 1;
+		const int tmax = ( surf->extents[ 1 ] >> 4 ) + 1;
+
+		if( smax > BLOCK_WIDTH || tmax > BLOCK_HEIGHT )
+		{
+			printf( "GL_AllocateLightmaps: surface lightmap of %dx%d is too large\n", smax, tmax );
+			return false;
+		}
+
+		surfaces.push_back( surf );
+		sizes.push_back( LightmapSize_t{ smax, tmax } );
+	}
+
+	std::vector<LightmapPlacement_t> placements;
+
+	GLint iMaxTextureSize = 0;
+
+	glGetIntegerv( GL_MAX_TEXTURE_SIZE, &iMaxTextureSize );
+
+	if( !lightmap_atlas.Pack( iMaxTextureSize > 0 ? std::min( iPageSize, static_cast<int>( iMaxTextureSize ) ) : iPageSize, sizes, placements ) )
+		return false;
+
+	assert( lightmap_atlas.Verify( sizes, placements ) );
+
+	lightmap_textures.resize( lightmap_atlas.GetNumPages() );
+
+	if( !lightmap_textures.empty() )
+		glGenTextures( lightmap_textures.size(), lightmap_textures.data() );
+
+	lightmap_dirty.resize( lightmap_atlas.GetNumPages() );
+
+	for( auto& rect : lightmap_dirty )
+	{
+		rect.left = rect.top = CLightmapAtlas::MAX_PAGE_SIZE;
+		rect.right = rect.bottom = 0;
+	}
+
+	for( size_t i = 0; i < surfaces.size(); ++i )
+	{
+		msurface_t* surf = surfaces[ i ];
+
+		surf->lightmappage = placements[ i ].iPage;
+		surf->light_s = placements[ i ].x;
+		surf->light_t = placements[ i ].y;
+		surf->lightmaptexturenum = lightmap_textures[ surf->lightmappage ];
+	}
+
+	printf( "Lightmaps: %u surfaces in %u pages of %d wide, %.1f%% occupied\n",
+			static_cast<unsigned int>( surfaces.size() ), static_cast<unsigned int>( lightmap_atlas.GetNumPages() ), lightmap_atlas.GetPageSize(),
+			lightmap_atlas.GetOccupancy() * 100.0f );
+
+	return true;
+}
+
+const CLightmapAtlas& GetLightmapAtlas()
+{
+	return lightmap_atlas;
+}
+
+bool VerifyLightmaps( const bmodel_t* pWorld )
+{
+	assert( pWorld );
+
+	std::vector<LightmapSize_t> sizes;
+	std::vector<LightmapPlacement_t> placements;
+
+	for( int i = 0; i < pWorld->numsurfaces; ++i )
+	{
+		const msurface_t* surf = pWorld->surfaces + i;
+
+		if( !surf->lightmaptexturenum )
+			continue;
+
+		sizes.push_back( LightmapSize_t{ ( surf->extents[ 0 ] >> 4 ) + 1, ( surf->extents[ 1 ] >> 4 ) + 1 } );
+		placements.push_back( LightmapPlacement_t{ surf->lightmappage, surf->light_s, surf->light_t } );
+	}
+
+	return lightmap_atlas.Verify( sizes, placements );
+}
+
 /*
 ========================
 GL_CreateSurfaceLightmap
@@ -1448,33 +1706,288 @@ GL_CreateSurfaceLightmap
 */
 bool GL_CreateSurfaceLightmap( msurface_t *surf )
 {
-	int		smax, tmax;
 	uint8_t	*base;
 
-	if( surf->flags & ( SURF_DRAWSKY | SURF_DRAWTURB ) )
+	if( !surf->lightmaptexturenum )
 	{
 		return true;
 	}
 
-	if( surf->lightmaptexturenum )
+	auto& page = lightmap_atlas.GetPage( surf->lightmappage );
+
+	base = page.data.data();
+	base += ( surf->light_t * page.iWidth + surf->light_s ) * lightmap_bytes;
+	return R_BuildLightMap( surf, base, page.iWidth*lightmap_bytes );
+}
+
+/*
+========================
+BuildStyleSurfaces
+
+Groups the surfaces that have lightmaps by the styles they use
+========================
+*/
+void BuildStyleSurfaces( bmodel_t* pModel )
+{
+	int counts[ 256 ] = {};
+
+	for( int i = 0; i < pModel->numsurfaces; ++i )
 	{
-		//printf( "Surface generating lightmaps multiple times\n" );
-		return true;
+		const msurface_t* surf = pModel->surfaces + i;
+
+		if( !surf->lightmaptexturenum || !surf->samples )
+			continue;
+
+		for( int maps = 0; maps < MAXLIGHTMAPS && surf->styles[ maps ] != 255; ++maps )
+			++counts[ surf->styles[ maps ] ];
 	}
 
-	smax = ( surf->extents[ 0 ] >> 4 ) + 1;
-	tmax = ( surf->extents[ 1 ] >> 4 ) + 1;
+	style_surface_offsets[ 0 ] = 0;
 
-	const int iTexture = AllocBlock( smax, tmax, &surf->light_s, &surf->light_t );
+	for( size_t i = 0; i < 256; ++i )
+		style_surface_offsets[ i + 1 ] = style_surface_offsets[ i ] + counts[ i ];
 
-	if( iTexture == -1 )
-		return false;
+	style_surfaces.resize( style_surface_offsets[ 256 ] );
+
+	//Fill in using the counts as insertion points.
+	for( size_t i = 0; i < 256; ++i )
+		counts[ i ] = style_surface_offsets[ i ];
+
+	for( int i = 0; i < pModel->numsurfaces; ++i )
+	{
+		msurface_t* surf = pModel->surfaces + i;
 
-	surf->lightmaptexturenum = lightmapID[ iTexture ];
+		if( !surf->lightmaptexturenum || !surf->samples )
+			continue;
 
-	base = lightmaps + iTexture*lightmap_bytes*BLOCK_WIDTH*BLOCK_HEIGHT;
-	base += ( surf->light_t * BLOCK_WIDTH + surf->light_s ) * lightmap_bytes;
-	return R_BuildLightMap( surf, base, BLOCK_WIDTH*lightmap_bytes );
+		for( int maps = 0; maps < MAXLIGHTMAPS && surf->styles[ maps ] != 255; ++maps )
+			style_surfaces[ counts[ surf->styles[ maps ] ]++ ] = surf;
+	}
+}
+
+/*
+========================
+R_RebuildSurfaceLightmap
+
+Rebuilds a surface's lightmap in its page and grows the page's dirty rectangle to include it
+Returns the number of texels rebuilt
+========================
+*/
+size_t R_RebuildSurfaceLightmap( msurface_t *surf )
+{
+	const int smax = ( surf->extents[ 0 ] >> 4 ) + 1;
+	const int tmax = ( surf->extents[ 1 ] >> 4 ) + 1;
+
+	auto& page = lightmap_atlas.GetPage( surf->lightmappage );
+
+	uint8_t* base = page.data.data();
+	base += ( surf->light_t * page.iWidth + surf->light_s ) * lightmap_bytes;
+
+	if( !R_BuildLightMap( surf, base, page.iWidth*lightmap_bytes ) )
+		return 0;
+
+	surf->lightmapframe = r_framecount;
+
+	lightmaprect_t& rect = lightmap_dirty[ surf->lightmappage ];
+
+	rect.left = std::min( rect.left, surf->light_s );
+	rect.top = std::min( rect.top, surf->light_t );
+	rect.right = std::max( rect.right, surf->light_s + smax );
+	rect.bottom = std::max( rect.bottom, surf->light_t + tmax );
+
+	return static_cast<size_t>( smax * tmax );
+}
+
+/*
+=============
+R_MarkLights
+
+Marks the world surfaces within the light's radius
+=============
+*/
+void R_MarkLights( bmodel_t* pWorld, const dlight_t *light, unsigned bit, mnode_t *node )
+{
+	mplane_t	*splitplane;
+	float		dist;
+	msurface_t	*surf;
+	int			i;
+
+	if( node->contents < 0 )
+		return;
+
+	splitplane = node->plane;
+	dist = glm::dot( light->origin, splitplane->normal ) - splitplane->dist;
+
+	if( dist > light->radius )
+	{
+		R_MarkLights( pWorld, light, bit, node->children[ 0 ] );
+		return;
+	}
+	if( dist < -light->radius )
+	{
+		R_MarkLights( pWorld, light, bit, node->children[ 1 ] );
+		return;
+	}
+
+	// mark the polygons
+	surf = pWorld->surfaces + node->firstsurface;
+	for( i = 0; i<node->numsurfaces; i++, surf++ )
+	{
+		if( !surf->lightmaptexturenum )
+			continue;
+
+		if( surf->dlightframe != r_framecount )
+		{
+			surf->dlightbits = 0;
+			surf->dlightframe = r_framecount;
+			dlight_surfaces.push_back( surf );
+		}
+		surf->dlightbits |= bit;
+	}
+
+	R_MarkLights( pWorld, light, bit, node->children[ 0 ] );
+	R_MarkLights( pWorld, light, bit, node->children[ 1 ] );
+}
+
+/*
+========================
+R_UploadLightmaps
+
+Uploads the dirty part of each lightmap page and clears the dirty rectangles
+========================
+*/
+void R_UploadLightmaps()
+{
+	for( size_t i = 0; i < lightmap_dirty.size(); ++i )
+	{
+		lightmaprect_t& rect = lightmap_dirty[ i ];
+
+		if( rect.right <= rect.left )
+			continue;
+
+		const auto& page = lightmap_atlas.GetPage( i );
+
+		glPixelStorei( GL_UNPACK_ROW_LENGTH, page.iWidth );
+
+		glBindTexture( GL_TEXTURE_2D, lightmap_textures[ i ] );
+
+		glTexSubImage2D( GL_TEXTURE_2D, 0, rect.left, rect.top, rect.right - rect.left, rect.bottom - rect.top,
+						 gl_lightmap_format, GL_UNSIGNED_BYTE,
+						 page.data.data() + ( rect.top * page.iWidth + rect.left ) * lightmap_bytes );
+
+		rect.left = rect.top = CLightmapAtlas::MAX_PAGE_SIZE;
+		rect.right = rect.bottom = 0;
+	}
+
+	glPixelStorei( GL_UNPACK_ROW_LENGTH, 0 );
+}
+
+void UpdateLightmaps( bmodel_t* pWorld, const int* pStyleValues, const dlight_t* pLights, const size_t uiDlightBudget, LightmapUpdateStats_t& stats )
+{
+	assert( pWorld );
+	assert( pStyleValues );
+	assert( pLights );
+
+	memset( &stats, 0, sizeof( stats ) );
+
+	++r_framecount;
+
+	cl_dlights = pLights;
+
+	//Mark dynamic lights first, so surfaces rebuilt for style changes include them.
+	dlight_surfaces.clear();
+
+	for( size_t i = 0; i < CDynamicLights::MAX_DLIGHTS; ++i )
+	{
+		if( pLights[ i ].radius <= 0 )
+			continue;
+
+		R_MarkLights( pWorld, &pLights[ i ], 1u << i, pWorld->nodes );
+	}
+
+	stats.uiDlightSurfaces = dlight_surfaces.size();
+
+	for( size_t style = 0; style < 256; ++style )
+	{
+		if( d_lightstylevalue[ style ] == pStyleValues[ style ] )
+			continue;
+
+		d_lightstylevalue[ style ] = pStyleValues[ style ];
+
+		for( int i = style_surface_offsets[ style ]; i < style_surface_offsets[ style + 1 ]; ++i )
+		{
+			msurface_t* surf = style_surfaces[ i ];
+
+			//Surfaces with several changed styles are only rebuilt once; the rebuild updates the cached values.
+			if( surf->lightmapframe == r_framecount )
+				continue;
+
+			bool bChanged = false;
+
+			for( int maps = 0; maps < MAXLIGHTMAPS && surf->styles[ maps ] != 255; ++maps )
+			{
+				if( surf->cached_light[ maps ] != d_lightstylevalue[ surf->styles[ maps ] ] )
+				{
+					bChanged = true;
+					break;
+				}
+			}
+
+			if( bChanged )
+				stats.uiStyleTexels += R_RebuildSurfaceLightmap( surf );
+		}
+	}
+
+	const size_t uiNumMarked = dlight_surfaces.size();
+
+	//Surfaces that were lit last update but weren't marked this time need their dynamic light removed.
+	for( auto surf : dlit_surfaces )
+	{
+		if( surf->dlightframe != r_framecount )
+			dlight_surfaces.push_back( surf );
+	}
+
+	dlit_surfaces.clear();
+
+	//Removals go first, so a light that went away doesn't stay in lightmaps while the budget is exceeded.
+	std::rotate( dlight_surfaces.begin(), dlight_surfaces.begin() + uiNumMarked, dlight_surfaces.end() );
+
+	//The surfaces that went the longest without a rebuild go next, so every surface gets a turn when the budget is exceeded.
+	if( uiDlightBudget )
+	{
+		std::stable_sort( dlight_surfaces.end() - uiNumMarked, dlight_surfaces.end(), []( const msurface_t* pLhs, const msurface_t* pRhs )
+		{
+			return pLhs->lightmapframe < pRhs->lightmapframe;
+		} );
+	}
+
+	size_t uiRebuilt = 0;
+
+	//Rebuild lit surfaces until the budget runs out. The rest keep their current lightmap and are retried next update.
+	//At least one surface is rebuilt, so surfaces larger than the budget are still updated.
+	for( auto surf : dlight_surfaces )
+	{
+		if( surf->lightmapframe != r_framecount )
+		{
+			const size_t uiTexels = static_cast<size_t>( ( ( surf->extents[ 0 ] >> 4 ) + 1 ) * ( ( surf->extents[ 1 ] >> 4 ) + 1 ) );
+
+			if( uiDlightBudget && uiRebuilt > 0 && stats.uiDlightTexels + uiTexels > uiDlightBudget )
+			{
+				++stats.uiDlightSkipped;
+			}
+			else
+			{
+				stats.uiDlightTexels += R_RebuildSurfaceLightmap( surf );
+				++uiRebuilt;
+			}
+		}
+
+		if( surf->cached_dlight )
+			dlit_surfaces.push_back( surf );
+	}
+
+	if( stats.uiStyleTexels || stats.uiDlightTexels )
+		R_UploadLightmaps();
 }
 
 #define bound( min, val, max ) ( ( val ) < ( min ) ? ( min ) : ( (val ) > ( max ) ? ( max ) : ( val ) ) )
@@ -1505,122 +2018,142 @@ void BuildGammaTable( float gamma, float texGamma )
 	}
 }
 
-bool LoadBrushModel( bmodel_t* pModel, dheader_t* pHeader )
+/*
+=================
+EstimateArenaSize
+
+Calculates how much memory a brush model needs from its lump sizes, so it can be allocated in one go.
+=================
+*/
+size_t EstimateArenaSize( const CBSPView& file )
+{
+	const auto count = [ & ]( const BSPLump lump, const size_t uiElementSize )
+	{
+		return static_cast<size_t>( file.GetLump( lump ).filelen ) / uiElementSize;
+	};
+
+	const size_t numvertexes = count( LUMP_VERTEXES, sizeof( dvertex_t ) );
+	const size_t numedges = count( LUMP_EDGES, sizeof( dedge_t ) );
+	const size_t numsurfedges = count( LUMP_SURFEDGES, sizeof( int ) );
+	const size_t numplanes = count( LUMP_PLANES, sizeof( dplane_t ) );
+	const size_t numtexinfo = count( LUMP_TEXINFO, sizeof( texinfo_t ) );
+	const size_t numfaces = count( LUMP_FACES, sizeof( dface_t ) );
+	const size_t nummarksurfaces = count( LUMP_MARKSURFACES, sizeof( short ) );
+	const size_t numleafs = count( LUMP_LEAFS, sizeof( dleaf_t ) );
+	const size_t numnodes = count( LUMP_NODES, sizeof( dnode_t ) );
+	const size_t numsubmodels = count( LUMP_MODELS, sizeof( dmodel_t ) );
+
+	size_t uiSize = 0;
+
+	uiSize += CMemoryArena::EstimateSize<mvertex_t>( numvertexes );
+	uiSize += CMemoryArena::EstimateSize<medge_t>( numedges );
+	uiSize += CMemoryArena::EstimateSize<mplane_t>( numplanes * 2 );
+	uiSize += CMemoryArena::EstimateSize<mtexinfo_t>( numtexinfo );
+	uiSize += CMemoryArena::EstimateSize<msurface_t>( numfaces );
+	uiSize += CMemoryArena::EstimateSize<msurface_t*>( nummarksurfaces );
+	uiSize += CMemoryArena::EstimateSize<mleaf_t>( numleafs );
+	uiSize += CMemoryArena::EstimateSize<mnode_t>( numnodes );
+	uiSize += CMemoryArena::EstimateSize<dmodel_t>( numsubmodels );
+	uiSize += CMemoryArena::EstimateSize<char>( file.GetLump( LUMP_ENTITIES ).filelen );
+
+	//Hull 0.
+	uiSize += CMemoryArena::EstimateSize<dclipnode_t>( numnodes );
+
+#if !IS_LITTLE_ENDIAN
+	//Converted copies.
+	uiSize += CMemoryArena::EstimateSize<int>( numsurfedges );
+	uiSize += CMemoryArena::EstimateSize<dclipnode_t>( count( LUMP_CLIPNODES, sizeof( dclipnode_t ) ) );
+#endif
+
+	//One polygon per face, with at most one vertex per edge.
+	uiSize += numfaces * CMemoryArena::EstimateSize( sizeof( glpoly_t ), alignof( glpoly_t ) );
+	uiSize += numsurfedges * VERTEXSIZE * sizeof( float );
+
+	return uiSize;
+}
+
+bool LoadBrushModel( bmodel_t* pModel, const CBSPView& file, const int iLightmapPageSize, const int iTextureThreads )
 {
 	assert( pModel );
-	assert( pHeader );
 
-	const int iVersion = LittleValue( pHeader->version );
+	//The header has already been swapped and validated by OpenBSPFile.
+	const dheader_t* pHeader = &file.GetHeader();
 
-	if( iVersion != BSPVERSION )
+	//All model data is allocated from a single arena that is freed in one go.
+	pModel->arena = new CMemoryArena();
+
+	if( !pModel->arena->Reserve( EstimateArenaSize( file ) ) )
 	{
-		printf( "BSP::LoadBrushmodel: %s has wrong version number (%d should be %d)\n", 
-				pModel->name, iVersion, BSPVERSION );
+		printf( "BSP::LoadBrushModel: Couldn't allocate memory for %s\n", pModel->name );
 		return false;
 	}
 
-	// swap all the lumps
-
-	for( size_t i = 0; i<sizeof( dheader_t ) / 4; ++i )
-		( ( int* ) pHeader )[ i ] = LittleValue( ( ( int* ) pHeader )[ i ] );
-
 	// load into heap
 
-	if( !Mod_LoadVertexes( pModel, pHeader, &pHeader->lumps[ LUMP_VERTEXES ] ) )
+	if( !Mod_LoadVertexes( pModel, file, &pHeader->lumps[ LUMP_VERTEXES ] ) )
 		return false;
 
-	if( !Mod_LoadEdges( pModel, pHeader, &pHeader->lumps[ LUMP_EDGES ] ) )
+	if( !Mod_LoadEdges( pModel, file, &pHeader->lumps[ LUMP_EDGES ] ) )
 		return false;
 
-	if( !Mod_LoadSurfedges( pModel, pHeader, &pHeader->lumps[ LUMP_SURFEDGES ] ) )
+	if( !Mod_LoadSurfedges( pModel, file, &pHeader->lumps[ LUMP_SURFEDGES ] ) )
 		return false;
 
 	//half-life loads entities first and looks for the wad key - Solokiller
-	if( !Mod_LoadEntities( pModel, pHeader, &pHeader->lumps[ LUMP_ENTITIES ] ) )
+	if( !Mod_LoadEntities( pModel, file, &pHeader->lumps[ LUMP_ENTITIES ] ) )
 		return false;
 
-	char* pszWadList = nullptr;
+	std::vector<std::string> wadNames;
 
-	if( !BSP::FindWadList( pModel, pszWadList ) )
+	if( !BSP::GetWadNames( pModel, wadNames ) )
 	{
 		//TODO: is this supposed to be an error? - Solokiller
 		printf( "Couldn't find wad list!\n" );
 		return false;
 	}
 
+	for( const auto& szWad : wadNames )
 	{
-		const size_t uiLength = strlen( pszWadList );
-
-		char* pszWad = pszWadList;
-
-		while( pszWad && *pszWad )
-		{
-			char* pszNext = strchr( pszWad + 1, ';' );
-
-			if( !pszNext )
-				break;
-
-			//Null terminate so the next operations succeeds.
-			*pszNext = '\0';
-
-			//TODO: fix slashes.
-			//Strip path.
-			char* pszWadName = strrchr( pszWad, '\\' );
-
-			if( pszWadName )
-				pszWad = pszWadName + 1;
+		const auto result = g_WadManager.AddWad( szWad.c_str() );
 
-			char* pszExt = strrchr( pszWad, '.' );
-
-			//Null terminate for convenience.
-			if( pszExt )
-				*pszExt = '\0';
-
-			const auto result = g_WadManager.AddWad( pszWad );
-
-			//TODO: adding wads that don't exist is not a failure condition in the engine. - Solokiller
-			if( result != CWadManager::AddResult::SUCCESS && 
-				result != CWadManager::AddResult::ALREADY_ADDED &&
-				result != CWadManager::AddResult::FILE_NOT_FOUND )
-				return false;
-
-			pszWad = pszNext + 1;
-		}
+		//TODO: adding wads that don't exist is not a failure condition in the engine. - Solokiller
+		if( result != CWadManager::AddResult::SUCCESS && 
+			result != CWadManager::AddResult::ALREADY_ADDED &&
+			result != CWadManager::AddResult::FILE_NOT_FOUND )
+			return false;
 	}
 
-	delete[] pszWadList;
-
-	if( !Mod_LoadTextures( pModel, pHeader, &pHeader->lumps[ LUMP_TEXTURES ] ) )
+	if( !Mod_LoadTextures( file, iTextureThreads ) )
 		return false;
 
-	if( !Mod_LoadLighting( pModel, pHeader, &pHeader->lumps[ LUMP_LIGHTING ] ) )
+	if( !Mod_LoadLighting( pModel, file, &pHeader->lumps[ LUMP_LIGHTING ] ) )
 		return false;
 
-	if( !Mod_LoadPlanes( pModel, pHeader, &pHeader->lumps[ LUMP_PLANES ] ) )
+	if( !Mod_LoadPlanes( pModel, file, &pHeader->lumps[ LUMP_PLANES ] ) )
 		return false;
 
-	if( !Mod_LoadTexinfo( pModel, pHeader, &pHeader->lumps[ LUMP_TEXINFO ] ) )
+	if( !Mod_LoadTexinfo( pModel, file, &pHeader->lumps[ LUMP_TEXINFO ] ) )
 		return false;
 
-	if( !Mod_LoadFaces( pModel, pHeader, &pHeader->lumps[ LUMP_FACES ] ) )
+	if( !Mod_LoadFaces( pModel, file, &pHeader->lumps[ LUMP_FACES ] ) )
 		return false;
 
-	if( !Mod_LoadMarksurfaces( pModel, pHeader, &pHeader->lumps[ LUMP_MARKSURFACES ] ) )
+	if( !Mod_LoadMarksurfaces( pModel, file, &pHeader->lumps[ LUMP_MARKSURFACES ] ) )
 		return false;
 
-	if( !Mod_LoadVisibility( pModel, pHeader, &pHeader->lumps[ LUMP_VISIBILITY ] ) )
+	if( !Mod_LoadVisibility( pModel, file, &pHeader->lumps[ LUMP_VISIBILITY ] ) )
 		return false;
 
-	if( !Mod_LoadLeafs( pModel, pHeader, &pHeader->lumps[ LUMP_LEAFS ] ) )
+	if( !Mod_LoadLeafs( pModel, file, &pHeader->lumps[ LUMP_LEAFS ] ) )
 		return false;
 
-	if( !Mod_LoadNodes( pModel, pHeader, &pHeader->lumps[ LUMP_NODES ] ) )
+	if( !Mod_LoadNodes( pModel, file, &pHeader->lumps[ LUMP_NODES ] ) )
 		return false;
 
-	if( !Mod_LoadClipnodes( pModel, pHeader, &pHeader->lumps[ LUMP_CLIPNODES ] ) )
+	if( !Mod_LoadClipnodes( pModel, file, &pHeader->lumps[ LUMP_CLIPNODES ] ) )
 		return false;
 
-	if( !Mod_LoadSubmodels( pModel, pHeader, &pHeader->lumps[ LUMP_MODELS ] ) )
+	if( !Mod_LoadSubmodels( pModel, file, &pHeader->lumps[ LUMP_MODELS ] ) )
 		return false;
 
 	Mod_MakeHull0( pModel );
@@ -1676,12 +2209,6 @@ bool LoadBrushModel( bmodel_t* pModel, dheader_t* pHeader )
 
 	pModel = pOriginal;
 
-	bmodel_t* pCurrentModel;
-
-	memset( allocated, 0, sizeof( allocated ) );
-	memset( lightmaps, 0, sizeof( lightmaps ) );
-	memset( lightmapID, 0, sizeof( lightmapID ) );
-
 	BuildGammaTable( 1.0f, 2.2f );
 
 	for( size_t uiIndex = 0; uiIndex < 256; ++uiIndex )
@@ -1689,6 +2216,9 @@ bool LoadBrushModel( bmodel_t* pModel, dheader_t* pHeader )
 		d_lightstylevalue[ uiIndex ] = 264;
 	}
 
+	if( !GL_AllocateLightmaps( pModel, iLightmapPageSize ) )
+		return false;
+
 	for( int i = 0; i<pModel->numsurfaces; i++ )
 	{
 		if( !GL_CreateSurfaceLightmap( pModel->surfaces + i ) )
@@ -1704,43 +2234,27 @@ bool LoadBrushModel( bmodel_t* pModel, dheader_t* pHeader )
 		BuildSurfaceDisplayList( pModel, pModel->surfaces + i );
 	}
 
-	for( size_t j = 1; j<MAX_MOD_KNOWN; j++ )
-	{
-		pCurrentModel = &mod_known[ j ];
-		if( !pCurrentModel->name[ 0 ] )
-			break;
-		for( int i = 0; i<pCurrentModel->numsurfaces; i++ )
-		{
-			if( !GL_CreateSurfaceLightmap( pCurrentModel->surfaces + i ) )
-				return false;
-			/*
-			if( pCurrentModel->surfaces[ i ].flags & SURF_DRAWTURB )
-				continue;
-#ifndef QUAKE2
-			if( pCurrentModel->surfaces[ i ].flags & SURF_DRAWSKY )
-				continue;
-#endif
-*/
-			BuildSurfaceDisplayList( pCurrentModel, pCurrentModel->surfaces + i );
-		}
-	}
+	//Submodels are copies of the world that share its surfaces, so the loop above has already handled their surfaces.
 
 	//
 	// upload all lightmaps that were filled
 	//
-	for( size_t i = 0; i<MAX_LIGHTMAPS; i++ )
+	for( size_t i = 0; i < lightmap_atlas.GetNumPages(); i++ )
 	{
-		if( !allocated[ i ][ 0 ] )
-			break;		// no more used
-		glBindTexture( GL_TEXTURE_2D, lightmapID[ i ] );
+		const auto& page = lightmap_atlas.GetPage( i );
+
+		glBindTexture( GL_TEXTURE_2D, lightmap_textures[ i ] );
 
 		glTexParameterf( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR );
 		glTexParameterf( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR );
 		glTexImage2D( GL_TEXTURE_2D, 0, GL_RGBA
-					  , BLOCK_WIDTH, BLOCK_HEIGHT, 0,
-					  gl_lightmap_format, GL_UNSIGNED_BYTE, lightmaps + i*BLOCK_WIDTH*BLOCK_HEIGHT*lightmap_bytes );
+					  , page.iWidth, page.iHeight, 0,
+					  gl_lightmap_format, GL_UNSIGNED_BYTE, page.data.data() );
 	}
 
+	//Submodels share the world's surfaces, so this covers every brush model.
+	BuildStyleSurfaces( pModel );
+
 	return true;
 }
 
@@ -1749,62 +2263,27 @@ void FreeModel( bmodel_t* pModel )
 	if( !pModel )
 		return;
 
-	size_t uiNumLightmapTex;
-
-	for( uiNumLightmapTex = 0; uiNumLightmapTex < MAX_LIGHTMAPS; ++uiNumLightmapTex )
+	if( !lightmap_textures.empty() )
 	{
-		if( lightmapID[ uiNumLightmapTex ] == 0 )
-			break;
-	}
-
-	if( uiNumLightmapTex )
-	{
-		glDeleteTextures( uiNumLightmapTex, lightmapID );
-		memset( lightmapID, 0, sizeof( lightmapID ) );
+		glDeleteTextures( lightmap_textures.size(), lightmap_textures.data() );
+		lightmap_textures.clear();
 	}
 
-	delete[] pModel->submodels;
-	delete[] pModel->planes;
-	delete[] pModel->leafs;
-	delete[] pModel->vertexes;
-	delete[] pModel->edges;
-	delete[] pModel->nodes;
-	delete[] pModel->texinfo;
-
-	msurface_t* pSurface = pModel->surfaces;
-	glpoly_t* pNextPoly;
-
-	for( int iIndex = 0; iIndex < pModel->numsurfaces; ++iIndex, ++pSurface )
-	{
-		for( glpoly_t* pPoly = pSurface->polys; pPoly; pPoly = pNextPoly )
-		{
-			pNextPoly = pPoly->next;
+	lightmap_atlas.Clear();
+	lightmap_dirty.clear();
 
-			delete[] pPoly;
-		}
-	}
+	style_surfaces.clear();
+	style_surfaces.shrink_to_fit();
 
-	delete[] pModel->surfaces;
-	delete[] pModel->surfedges;
-	//Don't delete, deleted later on - Solokiller
-	//delete[] pModel->clipnodes;
-	delete[] pModel->marksurfaces;
+	dlight_surfaces.clear();
+	dlit_surfaces.clear();
+	cl_dlights = nullptr;
 
 	//The textures themselves are managed by CTextureManager now, so don't delete them here. - Solokiller
 	g_TextureManager.Shutdown();
 
-	delete[] pModel->visdata;
-	delete[] pModel->lightdata;
-	delete[] pModel->entities;
-
-	//Delete the clipping hulls for the first 2 hulls only, since the 3rd is the same as the 2nd and the 4th isn't used. - Solokiller
-	for( size_t uiIndex = 0; uiIndex < 2; ++uiIndex )
-	{
-		hull_t& hull = pModel->hulls[ uiIndex ];
-
-		delete[] hull.clipnodes;
-		//hull.planes is a pointer to memory managed by bmodel_t
-	}
+	//Everything else is either in the arena or points into the BSP file.
+	delete pModel->arena;
 
 	memset( pModel, 0, sizeof( bmodel_t ) );
 }
@@ -24,25 +24,107 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 *	@file BSP Rendering data structures file IO
 */
 
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
 #include <gl/glew.h>
 
 #include "bsp/BSPConstants.h"
 #include "bsp/BSPRenderDefs.h"
 
+class CBSPView;
+class CLightmapAtlas;
+struct dlight_t;
+
 namespace BSP
 {
 #define MAX_MOD_KNOWN 512
-#define	MAX_LIGHTMAPS	256
+
+/**
+*	Default width and height of lightmap pages.
+*/
+#define DEFAULT_LIGHTMAP_PAGE_SIZE 2048
 
 extern bmodel_t mod_known[ MAX_MOD_KNOWN ];
 
 extern int mod_numknown;
 
-extern GLuint lightmapID[ MAX_LIGHTMAPS ];
-
 bool FindWadList( const bmodel_t* pModel, char*& pszWadList );
 
-bool LoadBrushModel( bmodel_t* pModel, dheader_t* pHeader );
+/**
+*	Gets the names of the wads listed by the world entity, without path and extension, in the order they're listed.
+*	@return Whether the model has a wad list.
+*/
+bool GetWadNames( const bmodel_t* pModel, std::vector<std::string>& wadNames );
+
+/**
+*	Gets the header of every texture in the texture lump, in lump order. Does not require a GL context.
+*	Textures stored in wads only have a header; their offsets are 0.
+*	@param[ out ] miptex Texture headers, in native byte order.
+*	@param[ out ] swapped On big endian platforms, holds the swapped copies that miptex points to. Must outlive miptex.
+*	@return Whether all textures are valid.
+*/
+bool GetTextureLumpMiptex( const CBSPView& file, std::vector<const miptex_t*>& miptex, std::vector<std::unique_ptr<uint8_t[]>>& swapped );
+
+/**
+*	Loads a brush model from the given BSP file.
+*	Data that doesn't need converting is referenced in place, so the file must outlive the model.
+*	@param iLightmapPageSize Width and maximum height of lightmap pages. Clamped to what the atlas and GL implementation support.
+*	@param iTextureThreads Number of threads to convert textures on. If negative, one for each core. If 0, textures are converted on the calling thread.
+*/
+bool LoadBrushModel( bmodel_t* pModel, const CBSPView& file, const int iLightmapPageSize = DEFAULT_LIGHTMAP_PAGE_SIZE, const int iTextureThreads = -1 );
+
+/**
+*	@return The atlas that holds the loaded map's lightmaps.
+*/
+const CLightmapAtlas& GetLightmapAtlas();
+
+/**
+*	Checks that every surface's lightmap lies inside its page and that no two lightmaps overlap.
+*/
+bool VerifyLightmaps( const bmodel_t* pWorld );
+
+/**
+*	Lightmap work done by a call to UpdateLightmaps.
+*/
+struct LightmapUpdateStats_t
+{
+	/**
+	*	Texels rebuilt because lightstyles changed.
+	*/
+	size_t uiStyleTexels;
+
+	/**
+	*	Surfaces touched by dynamic lights.
+	*/
+	size_t uiDlightSurfaces;
+
+	/**
+	*	Texels rebuilt to add or remove dynamic light.
+	*/
+	size_t uiDlightTexels;
+
+	/**
+	*	Surfaces that needed dynamic light changes but were skipped because the budget ran out.
+	*/
+	size_t uiDlightSkipped;
+};
+
+/**
+*	Applies new lightstyle values and dynamic lights to the loaded map's lightmaps.
+*	Only surfaces that use a style whose value changed, or that are touched by a dynamic light now or were last update, are rebuilt.
+*	Only the changed part of each lightmap page is uploaded.
+*	@param pWorld World model. Dynamic lights are marked by walking its nodes.
+*	@param pStyleValues 8.8 value for each of the 256 styles.
+*	@param pLights CDynamicLights::MAX_DLIGHTS dynamic lights. Lights with a radius of 0 are ignored.
+*	@param uiDlightBudget Maximum number of texels to rebuild for dynamic lights. 0 for no limit.
+*		At least one surface is always rebuilt. Removing light that went away comes first, then the surfaces that went the longest without a rebuild.
+*	@param stats Receives the amount of work done.
+*/
+void UpdateLightmaps( bmodel_t* pWorld, const int* pStyleValues, const dlight_t* pLights, const size_t uiDlightBudget, LightmapUpdateStats_t& stats );
 
 void FreeModel( bmodel_t* pModel );
 }
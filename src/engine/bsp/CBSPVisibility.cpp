@@ -0,0 +1,330 @@
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+#include "Logging.h"
+
+#include "CFrustum.h"
+
+#include "CBSPVisibility.h"
+
+#define BACKFACE_EPSILON 0.01f
+
+void CBSPVisibility::Initialize( bmodel_t* pWorld )
+{
+	assert( pWorld );
+
+	Shutdown();
+
+	m_pWorld = pWorld;
+
+	m_uiRowSize = ( pWorld->numleafs + 7 ) >> 3;
+
+	m_NoVis.assign( m_uiRowSize, 0xFF );
+
+	//Leaf 0 is the shared solid leaf and never has visibility data.
+	m_RowOffsets.assign( pWorld->numleafs + 1, -1 );
+}
+
+void CBSPVisibility::Shutdown()
+{
+	m_pWorld = nullptr;
+	m_uiRowSize = 0;
+
+	m_NoVis.clear();
+	m_RowOffsets.clear();
+	m_Rows.clear();
+	m_Rows.shrink_to_fit();
+
+	m_pViewLeaf = nullptr;
+	m_uiNumVisibleLeafs = 0;
+}
+
+mleaf_t* CBSPVisibility::PointInLeaf( const Vector& vecPoint ) const
+{
+	assert( m_pWorld && m_pWorld->nodes );
+
+	mnode_t* pNode = m_pWorld->nodes;
+
+	while( pNode->contents >= 0 )
+	{
+		const mplane_t* pPlane = pNode->plane;
+
+		const float flDist = glm::dot( vecPoint, pPlane->normal ) - pPlane->dist;
+
+		pNode = pNode->children[ flDist > 0 ? 0 : 1 ];
+	}
+
+	return reinterpret_cast<mleaf_t*>( pNode );
+}
+
+void CBSPVisibility::DecompressVis( const uint8_t* pIn, uint8_t* pOut ) const
+{
+	assert( pOut );
+
+	if( !pIn )
+	{
+		//No vis info, so make all visible.
+		memset( pOut, 0xFF, m_uiRowSize );
+		return;
+	}
+
+	uint8_t* const pEnd = pOut + m_uiRowSize;
+
+	while( pOut < pEnd )
+	{
+		if( *pIn )
+		{
+			*pOut++ = *pIn++;
+			continue;
+		}
+
+		//Run of zeroes; don't let bad data write past the end of the row.
+		size_t uiCount = pIn[ 1 ];
+		pIn += 2;
+
+		if( uiCount > static_cast<size_t>( pEnd - pOut ) )
+			uiCount = pEnd - pOut;
+
+		memset( pOut, 0, uiCount );
+		pOut += uiCount;
+	}
+}
+
+const uint8_t* CBSPVisibility::LeafPVS( const mleaf_t* pLeaf )
+{
+	assert( m_pWorld );
+
+	const ptrdiff_t iLeaf = pLeaf - m_pWorld->leafs;
+
+	if( iLeaf <= 0 || static_cast<size_t>( iLeaf ) >= m_RowOffsets.size() || !m_pWorld->visdata )
+		return m_NoVis.data();
+
+	int& iOffset = m_RowOffsets[ iLeaf ];
+
+	if( iOffset == -1 )
+	{
+		iOffset = static_cast<int>( m_Rows.size() );
+
+		m_Rows.resize( m_Rows.size() + m_uiRowSize );
+
+		DecompressVis( pLeaf->compressed_vis, m_Rows.data() + iOffset );
+	}
+
+	return m_Rows.data() + iOffset;
+}
+
+bool CBSPVisibility::MarkLeaves( const mleaf_t* pViewLeaf, const bool bForce )
+{
+	assert( m_pWorld );
+
+	if( m_pViewLeaf == pViewLeaf && !bForce )
+		return false;
+
+	++m_iVisFrame;
+
+	m_pViewLeaf = pViewLeaf;
+	m_uiNumVisibleLeafs = 0;
+
+	const uint8_t* pVis = LeafPVS( pViewLeaf );
+
+	for( int iLeaf = 0; iLeaf < m_pWorld->numleafs; ++iLeaf )
+	{
+		if( !( pVis[ iLeaf >> 3 ] & ( 1 << ( iLeaf & 7 ) ) ) )
+			continue;
+
+		mleaf_t* pLeaf = &m_pWorld->leafs[ iLeaf + 1 ];
+
+		++m_uiNumVisibleLeafs;
+
+		//Mark the path up to the root, stopping when it reaches a node that's already been marked.
+		mnode_t* pNode = reinterpret_cast<mnode_t*>( pLeaf );
+
+		do
+		{
+			if( pNode->visframe == m_iVisFrame )
+				break;
+
+			pNode->visframe = m_iVisFrame;
+			pNode = pNode->parent;
+		}
+		while( pNode );
+	}
+
+	return true;
+}
+
+void CBSPVisibility::CollectSurfaces( const CFrustum& frustum, const Vector& vecOrigin, std::vector<uint32_t>& surfaces )
+{
+	assert( m_pWorld );
+
+	surfaces.clear();
+
+	++m_iFrame;
+
+	RecursiveWorldNode( m_pWorld->nodes, frustum, vecOrigin, surfaces );
+}
+
+bool CBSPVisibility::Verify( const std::vector<uint32_t>& surfaces ) const
+{
+	assert( m_pWorld );
+
+	if( !m_pViewLeaf )
+	{
+		Msg( "No visibility has been marked\n" );
+		return false;
+	}
+
+	bool bSuccess = true;
+
+	const ptrdiff_t iViewLeaf = m_pViewLeaf - m_pWorld->leafs;
+
+	//Decompress the row again instead of using the cache.
+	std::vector<uint8_t> row( m_uiRowSize );
+
+	const bool bHasVis = iViewLeaf > 0 && static_cast<size_t>( iViewLeaf ) < m_RowOffsets.size() && m_pWorld->visdata;
+
+	DecompressVis( bHasVis ? m_pViewLeaf->compressed_vis : nullptr, row.data() );
+
+	if( bHasVis && ( m_RowOffsets[ iViewLeaf ] == -1 || memcmp( row.data(), m_Rows.data() + m_RowOffsets[ iViewLeaf ], m_uiRowSize ) ) )
+	{
+		Warning( "Cached PVS row of leaf %d doesn't match its visibility data\n", static_cast<int>( iViewLeaf ) );
+		bSuccess = false;
+	}
+
+	//Surfaces in leafs that are in the row.
+	std::vector<bool> surfacesInPVS( m_pWorld->numsurfaces, false );
+
+	size_t uiVisibleLeafs = 0;
+	size_t uiBadLeafs = 0;
+	size_t uiBadNodes = 0;
+
+	for( int iLeaf = 0; iLeaf < m_pWorld->numleafs; ++iLeaf )
+	{
+		const mleaf_t* pLeaf = &m_pWorld->leafs[ iLeaf + 1 ];
+
+		const bool bVisible = ( row[ iLeaf >> 3 ] & ( 1 << ( iLeaf & 7 ) ) ) != 0;
+
+		if( bVisible != ( pLeaf->visframe == m_iVisFrame ) )
+			++uiBadLeafs;
+
+		if( !bVisible )
+			continue;
+
+		++uiVisibleLeafs;
+
+		for( const mnode_t* pNode = pLeaf->parent; pNode; pNode = pNode->parent )
+		{
+			if( pNode->visframe != m_iVisFrame )
+			{
+				++uiBadNodes;
+				break;
+			}
+		}
+
+		for( int iSurface = 0; iSurface < pLeaf->nummarksurfaces; ++iSurface )
+			surfacesInPVS[ pLeaf->firstmarksurface[ iSurface ] - m_pWorld->surfaces ] = true;
+	}
+
+	if( uiVisibleLeafs != m_uiNumVisibleLeafs || uiBadLeafs )
+	{
+		Warning( "%u leafs are visible, %u were counted, %u are marked wrong\n", static_cast<unsigned int>( uiVisibleLeafs ),
+				 static_cast<unsigned int>( m_uiNumVisibleLeafs ), static_cast<unsigned int>( uiBadLeafs ) );
+		bSuccess = false;
+	}
+
+	if( uiBadNodes )
+	{
+		Warning( "%u visible leafs have unmarked parent nodes\n", static_cast<unsigned int>( uiBadNodes ) );
+		bSuccess = false;
+	}
+
+	std::vector<bool> collected( m_pWorld->numsurfaces, false );
+
+	size_t uiBadSurfaces = 0;
+
+	for( const auto uiSurface : surfaces )
+	{
+		if( uiSurface >= static_cast<uint32_t>( m_pWorld->numsurfaces ) || !surfacesInPVS[ uiSurface ] || collected[ uiSurface ] )
+		{
+			++uiBadSurfaces;
+			continue;
+		}
+
+		collected[ uiSurface ] = true;
+	}
+
+	if( uiBadSurfaces )
+	{
+		Warning( "%u collected surfaces are outside the PVS or collected more than once\n", static_cast<unsigned int>( uiBadSurfaces ) );
+		bSuccess = false;
+	}
+
+	Msg( "View leaf %d: %u of %u leafs visible, %u of %u surfaces in the PVS collected\n", static_cast<int>( iViewLeaf ),
+		 static_cast<unsigned int>( uiVisibleLeafs ), static_cast<unsigned int>( m_pWorld->numleafs ),
+		 static_cast<unsigned int>( surfaces.size() - uiBadSurfaces ), static_cast<unsigned int>( std::count( surfacesInPVS.begin(), surfacesInPVS.end(), true ) ) );
+
+	return bSuccess;
+}
+
+void CBSPVisibility::RecursiveWorldNode( mnode_t* pNode, const CFrustum& frustum, const Vector& vecOrigin, std::vector<uint32_t>& surfaces )
+{
+	if( pNode->contents == CONTENTS_SOLID )
+		return;
+
+	if( pNode->visframe != m_iVisFrame )
+		return;
+
+	if( frustum.CullBox( pNode->mins, pNode->maxs ) )
+		return;
+
+	//Leafs mark their surfaces; they are collected by the nodes that own them.
+	if( pNode->contents < 0 )
+	{
+		mleaf_t* pLeaf = reinterpret_cast<mleaf_t*>( pNode );
+
+		for( int iSurface = 0; iSurface < pLeaf->nummarksurfaces; ++iSurface )
+			pLeaf->firstmarksurface[ iSurface ]->visframe = m_iFrame;
+
+		return;
+	}
+
+	const mplane_t* pPlane = pNode->plane;
+
+	float flDot;
+
+	switch( pPlane->type )
+	{
+	case PLANE_X:
+	case PLANE_Y:
+	case PLANE_Z:
+		flDot = vecOrigin[ pPlane->type ] - pPlane->dist;
+		break;
+
+	default:
+		flDot = glm::dot( vecOrigin, pPlane->normal ) - pPlane->dist;
+		break;
+	}
+
+	const int iSide = flDot >= 0 ? 0 : 1;
+
+	//Front side first.
+	RecursiveWorldNode( pNode->children[ iSide ], frustum, vecOrigin, surfaces );
+
+	msurface_t* pSurface = m_pWorld->surfaces + pNode->firstsurface;
+
+	for( int iIndex = 0; iIndex < pNode->numsurfaces; ++iIndex, ++pSurface )
+	{
+		if( pSurface->visframe != m_iFrame )
+			continue;
+
+		//Reject surfaces facing away from the origin.
+		if( ( flDot < -BACKFACE_EPSILON && !( pSurface->flags & SURF_PLANEBACK ) ) ||
+			( flDot > BACKFACE_EPSILON && ( pSurface->flags & SURF_PLANEBACK ) ) )
+			continue;
+
+		surfaces.push_back( static_cast<uint32_t>( pSurface - m_pWorld->surfaces ) );
+	}
+
+	RecursiveWorldNode( pNode->children[ !iSide ], frustum, vecOrigin, surfaces );
+}
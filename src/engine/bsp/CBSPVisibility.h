@@ -0,0 +1,134 @@
+#ifndef ENGINE_BSP_CBSPVISIBILITY_H
+#define ENGINE_BSP_CBSPVISIBILITY_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "bsp/BSPRenderDefs.h"
+
+class CFrustum;
+
+/**
+*	Potentially visible set queries for the world model.
+*	Decompressed PVS rows are cached per leaf, so leaves that are revisited don't need to be decompressed again.
+*/
+class CBSPVisibility final
+{
+public:
+	CBSPVisibility() = default;
+	~CBSPVisibility() = default;
+
+	/**
+	*	Sets up visibility for the given world model. Clears the cache.
+	*	@param pWorld World model. Must remain valid until Shutdown is called.
+	*/
+	void Initialize( bmodel_t* pWorld );
+
+	/**
+	*	Releases the world model and clears the cache.
+	*/
+	void Shutdown();
+
+	/**
+	*	@return Number of bytes in a decompressed PVS row.
+	*/
+	size_t GetRowSize() const { return m_uiRowSize; }
+
+	/**
+	*	@return The current visibility frame. Nodes and leafs whose visframe matches this are potentially visible.
+	*/
+	int GetVisFrame() const { return m_iVisFrame; }
+
+	/**
+	*	@return The leaf that visibility was last marked from.
+	*/
+	const mleaf_t* GetViewLeaf() const { return m_pViewLeaf; }
+
+	/**
+	*	@return Number of leafs marked by the last call to MarkLeaves.
+	*/
+	size_t GetNumVisibleLeafs() const { return m_uiNumVisibleLeafs; }
+
+	/**
+	*	Finds the leaf that contains the given point.
+	*/
+	mleaf_t* PointInLeaf( const Vector& vecPoint ) const;
+
+	/**
+	*	Decompresses a run-length encoded PVS row.
+	*	@param pIn Compressed row. If null, everything is visible.
+	*	@param pOut Destination. Must be at least GetRowSize() bytes large.
+	*/
+	void DecompressVis( const uint8_t* pIn, uint8_t* pOut ) const;
+
+	/**
+	*	Gets the decompressed PVS row for the given leaf. Bit N is set if leaf N + 1 is visible.
+	*	@return Decompressed row. Valid until the next call to Initialize or Shutdown.
+	*/
+	const uint8_t* LeafPVS( const mleaf_t* pLeaf );
+
+	/**
+	*	Marks all leafs that are potentially visible from the given leaf, and their parent nodes.
+	*	Does nothing if the leaf is the same as last time, unless forced.
+	*	@param pViewLeaf Leaf that the view is in.
+	*	@param bForce Whether to mark even if the leaf hasn't changed.
+	*	@return Whether visibility was marked.
+	*/
+	bool MarkLeaves( const mleaf_t* pViewLeaf, const bool bForce = false );
+
+	/**
+	*	Walks the world front to back from the given origin, collecting surfaces in nodes marked by MarkLeaves.
+	*	Subtrees outside the frustum are skipped, and surfaces facing away from the origin are rejected.
+	*	@param frustum View frustum.
+	*	@param vecOrigin View origin.
+	*	@param surfaces Receives indices into the world's surfaces, front to back. Cleared first.
+	*/
+	void CollectSurfaces( const CFrustum& frustum, const Vector& vecOrigin, std::vector<uint32_t>& surfaces );
+
+	/**
+	*	Checks the state left by the last calls to MarkLeaves and CollectSurfaces against a brute force pass over the view leaf's PVS:
+	*	the cached row must match a fresh decompression, exactly the leafs in the row and their parent nodes must be marked,
+	*	and every collected surface must be in a marked leaf, and be collected only once. Reports counts and errors to the console.
+	*	@param surfaces Surfaces collected by CollectSurfaces.
+	*	@return Whether everything matched.
+	*/
+	bool Verify( const std::vector<uint32_t>& surfaces ) const;
+
+private:
+	void RecursiveWorldNode( mnode_t* pNode, const CFrustum& frustum, const Vector& vecOrigin, std::vector<uint32_t>& surfaces );
+
+private:
+	bmodel_t* m_pWorld = nullptr;
+
+	size_t m_uiRowSize = 0;
+
+	/**
+	*	Row that is used when the world has no visibility data, or the view is outside the world.
+	*/
+	std::vector<uint8_t> m_NoVis;
+
+	/**
+	*	Offset of each leaf's decompressed row in m_Rows, or -1 if it hasn't been decompressed yet.
+	*/
+	std::vector<int> m_RowOffsets;
+
+	std::vector<uint8_t> m_Rows;
+
+	int m_iVisFrame = 0;
+
+	/**
+	*	Incremented for every call to CollectSurfaces. Surfaces in leafs reached during the walk are marked with this.
+	*/
+	int m_iFrame = 0;
+
+	const mleaf_t* m_pViewLeaf = nullptr;
+
+	size_t m_uiNumVisibleLeafs = 0;
+
+private:
+	CBSPVisibility( const CBSPVisibility& ) = delete;
+	CBSPVisibility& operator=( const CBSPVisibility& ) = delete;
+};
+
+#endif //ENGINE_BSP_CBSPVISIBILITY_H
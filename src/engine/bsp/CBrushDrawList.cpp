@@ -0,0 +1,64 @@
+#include <cassert>
+
+#include "CBrushDrawList.h"
+
+void CBrushDrawList::Begin( const CBrushGeometryBuilder& geometry )
+{
+	m_pGeometry = &geometry;
+
+	//Keep the per-range buffers around so they don't need to be reallocated every frame.
+	m_RangeSurfaces.resize( geometry.GetRanges().size() );
+
+	for( auto& surfaces : m_RangeSurfaces )
+		surfaces.clear();
+
+	m_uiNumSurfaces = 0;
+
+	m_Indices.clear();
+	m_Ranges.clear();
+}
+
+void CBrushDrawList::AddSurface( const size_t uiSurface )
+{
+	assert( m_pGeometry );
+
+	const auto surface = m_pGeometry->GetSurfaceIndices( uiSurface );
+
+	if( surface.uiRange == CBrushGeometryBuilder::INVALID_RANGE )
+		return;
+
+	m_RangeSurfaces[ surface.uiRange ].push_back( static_cast<uint32_t>( uiSurface ) );
+
+	++m_uiNumSurfaces;
+}
+
+void CBrushDrawList::End()
+{
+	assert( m_pGeometry );
+
+	const auto& ranges = m_pGeometry->GetRanges();
+	const auto& indices = m_pGeometry->GetIndices();
+
+	for( size_t uiRange = 0; uiRange < m_RangeSurfaces.size(); ++uiRange )
+	{
+		const auto& surfaces = m_RangeSurfaces[ uiRange ];
+
+		if( surfaces.empty() )
+			continue;
+
+		BrushDrawRange_t range{ ranges[ uiRange ].key, static_cast<uint32_t>( m_Indices.size() ), 0 };
+
+		for( const auto uiSurface : surfaces )
+		{
+			const auto surface = m_pGeometry->GetSurfaceIndices( uiSurface );
+
+			m_Indices.insert( m_Indices.end(), indices.begin() + surface.uiFirstIndex, indices.begin() + surface.uiFirstIndex + surface.uiNumIndices );
+		}
+
+		range.uiNumIndices = static_cast<uint32_t>( m_Indices.size() ) - range.uiFirstIndex;
+
+		m_Ranges.push_back( range );
+	}
+
+	m_pGeometry = nullptr;
+}
@@ -0,0 +1,69 @@
+#ifndef ENGINE_BSP_CBRUSHDRAWLIST_H
+#define ENGINE_BSP_CBRUSHDRAWLIST_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "CBrushGeometryBuilder.h"
+
+/**
+*	List of surfaces to draw from static brush geometry.
+*	Surfaces are added in any order; their indices are gathered per draw range, so each range is still a single draw call.
+*	Within a range, surfaces keep the order they were added in.
+*	Does not use any graphics API.
+*/
+class CBrushDrawList final
+{
+public:
+	CBrushDrawList() = default;
+	~CBrushDrawList() = default;
+
+	/**
+	*	Starts a new list.
+	*	@param geometry Geometry that surfaces are drawn from. Must remain valid until End has been called.
+	*/
+	void Begin( const CBrushGeometryBuilder& geometry );
+
+	/**
+	*	Adds a surface to the list. Surfaces without indices are ignored.
+	*	@param uiSurface Index of the surface in the geometry.
+	*/
+	void AddSurface( const size_t uiSurface );
+
+	/**
+	*	Finishes the list, building the index data and draw ranges.
+	*/
+	void End();
+
+	/**
+	*	@return Number of surfaces that were added.
+	*/
+	size_t GetNumSurfaces() const { return m_uiNumSurfaces; }
+
+	const std::vector<uint32_t>& GetIndices() const { return m_Indices; }
+
+	/**
+	*	@return Draw ranges, in the same order as the geometry's ranges. Indices refer to this list's index data.
+	*/
+	const std::vector<BrushDrawRange_t>& GetRanges() const { return m_Ranges; }
+
+private:
+	const CBrushGeometryBuilder* m_pGeometry = nullptr;
+
+	/**
+	*	Surfaces added to each of the geometry's ranges.
+	*/
+	std::vector<std::vector<uint32_t>> m_RangeSurfaces;
+
+	size_t m_uiNumSurfaces = 0;
+
+	std::vector<uint32_t> m_Indices;
+	std::vector<BrushDrawRange_t> m_Ranges;
+
+private:
+	CBrushDrawList( const CBrushDrawList& ) = delete;
+	CBrushDrawList& operator=( const CBrushDrawList& ) = delete;
+};
+
+#endif //ENGINE_BSP_CBRUSHDRAWLIST_H
@@ -0,0 +1,354 @@
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <functional>
+
+#include "Logging.h"
+
+#include "CBrushGeometryBuilder.h"
+
+namespace
+{
+bool KeyLess( const BrushBatchKey_t& lhs, const BrushBatchKey_t& rhs )
+{
+	if( lhs.iGroup != rhs.iGroup )
+		return lhs.iGroup < rhs.iGroup;
+
+	if( lhs.pShader != rhs.pShader )
+		return std::less<CShaderInstance*>()( lhs.pShader, rhs.pShader );
+
+	if( lhs.pTexture != rhs.pTexture )
+		return std::less<texture_t*>()( lhs.pTexture, rhs.pTexture );
+
+	return lhs.uiLightmap < rhs.uiLightmap;
+}
+
+bool KeyEqual( const BrushBatchKey_t& lhs, const BrushBatchKey_t& rhs )
+{
+	return lhs.iGroup == rhs.iGroup &&
+		lhs.pShader == rhs.pShader &&
+		lhs.pTexture == rhs.pTexture &&
+		lhs.uiLightmap == rhs.uiLightmap;
+}
+
+size_t HashVertex( const float* pVertex )
+{
+	//FNV-1a over the raw bytes; welding only merges bitwise identical vertices.
+	const uint8_t* pData = reinterpret_cast<const uint8_t*>( pVertex );
+
+	size_t hash = 2166136261U;
+
+	for( size_t uiIndex = 0; uiIndex < CBrushGeometryBuilder::VERTEX_SIZE * sizeof( float ); ++uiIndex )
+	{
+		hash ^= pData[ uiIndex ];
+		hash *= 16777619U;
+	}
+
+	return hash;
+}
+}
+
+void CBrushGeometryBuilder::AddPolygon( const BrushBatchKey_t& key, const size_t uiSurface, const float* pVerts, const size_t uiNumVerts )
+{
+	assert( pVerts );
+
+	if( uiNumVerts < 3 )
+		return;
+
+	m_Pending.push_back( { key, uiSurface, m_PendingVerts.size() / VERTEX_SIZE, uiNumVerts } );
+
+	m_PendingVerts.insert( m_PendingVerts.end(), pVerts, pVerts + uiNumVerts * VERTEX_SIZE );
+}
+
+void CBrushGeometryBuilder::Build()
+{
+	m_Vertices.clear();
+	m_Indices.clear();
+	m_Ranges.clear();
+	m_Surfaces.clear();
+	m_uiNumWeldedVertices = 0;
+
+	//Stable so polygons belonging to the same surface stay together.
+	std::stable_sort( m_Pending.begin(), m_Pending.end(),
+		[]( const PendingPolygon_t& lhs, const PendingPolygon_t& rhs )
+		{
+			return KeyLess( lhs.key, rhs.key );
+		}
+	);
+
+	size_t uiMaxSurface = 0;
+
+	for( const auto& polygon : m_Pending )
+		uiMaxSurface = std::max( uiMaxSurface, polygon.uiSurface + 1 );
+
+	m_Surfaces.resize( uiMaxSurface, { INVALID_RANGE, 0, 0 } );
+
+	m_Vertices.reserve( m_PendingVerts.size() );
+
+	std::unordered_multimap<size_t, uint32_t> lookup;
+
+	lookup.reserve( m_PendingVerts.size() / VERTEX_SIZE );
+
+	uint32_t polyIndices[ 3 ];
+
+	for( const auto& polygon : m_Pending )
+	{
+		if( m_Ranges.empty() || !KeyEqual( m_Ranges.back().key, polygon.key ) )
+		{
+			m_Ranges.push_back( { polygon.key, static_cast<uint32_t>( m_Indices.size() ), 0 } );
+		}
+
+		const uint32_t uiRange = static_cast<uint32_t>( m_Ranges.size() - 1 );
+
+		auto& surface = m_Surfaces[ polygon.uiSurface ];
+
+		if( surface.uiRange == INVALID_RANGE )
+		{
+			surface.uiRange = uiRange;
+			surface.uiFirstIndex = static_cast<uint32_t>( m_Indices.size() );
+		}
+
+		assert( surface.uiRange == uiRange );
+
+		const float* pVerts = m_PendingVerts.data() + polygon.uiFirstVertex * VERTEX_SIZE;
+
+		//Triangle fan, keeps the polygon's winding order.
+		polyIndices[ 0 ] = AddVertex( pVerts, lookup );
+		polyIndices[ 1 ] = AddVertex( pVerts + VERTEX_SIZE, lookup );
+
+		for( size_t uiVert = 2; uiVert < polygon.uiNumVerts; ++uiVert )
+		{
+			polyIndices[ 2 ] = AddVertex( pVerts + uiVert * VERTEX_SIZE, lookup );
+
+			//Skip triangles that collapsed because of welding.
+			if( polyIndices[ 0 ] != polyIndices[ 1 ] && polyIndices[ 1 ] != polyIndices[ 2 ] && polyIndices[ 0 ] != polyIndices[ 2 ] )
+			{
+				m_Indices.insert( m_Indices.end(), polyIndices, polyIndices + 3 );
+			}
+
+			polyIndices[ 1 ] = polyIndices[ 2 ];
+		}
+
+		const uint32_t uiEnd = static_cast<uint32_t>( m_Indices.size() );
+
+		m_Ranges.back().uiNumIndices = uiEnd - m_Ranges.back().uiFirstIndex;
+		surface.uiNumIndices = uiEnd - surface.uiFirstIndex;
+	}
+
+	m_Pending.clear();
+	m_Pending.shrink_to_fit();
+	m_PendingVerts.clear();
+	m_PendingVerts.shrink_to_fit();
+}
+
+void CBrushGeometryBuilder::Clear()
+{
+	m_Pending.clear();
+	m_PendingVerts.clear();
+
+	m_Vertices.clear();
+	m_Indices.clear();
+	m_Ranges.clear();
+	m_Surfaces.clear();
+
+	m_uiNumWeldedVertices = 0;
+}
+
+void CBrushGeometryBuilder::GetGroupRanges( const int iGroup, size_t& uiOutFirst, size_t& uiOutCount ) const
+{
+	//Ranges are sorted by group first.
+	auto begin = std::lower_bound( m_Ranges.begin(), m_Ranges.end(), iGroup,
+		[]( const BrushDrawRange_t& range, const int iGroup )
+		{
+			return range.key.iGroup < iGroup;
+		}
+	);
+
+	auto end = std::upper_bound( begin, m_Ranges.end(), iGroup,
+		[]( const int iGroup, const BrushDrawRange_t& range )
+		{
+			return iGroup < range.key.iGroup;
+		}
+	);
+
+	uiOutFirst = begin - m_Ranges.begin();
+	uiOutCount = end - begin;
+}
+
+BrushSurfaceIndices_t CBrushGeometryBuilder::GetSurfaceIndices( const size_t uiSurface ) const
+{
+	if( uiSurface >= m_Surfaces.size() )
+		return { INVALID_RANGE, 0, 0 };
+
+	return m_Surfaces[ uiSurface ];
+}
+
+uint32_t CBrushGeometryBuilder::AddVertex( const float* pVertex, std::unordered_multimap<size_t, uint32_t>& lookup )
+{
+	const size_t hash = HashVertex( pVertex );
+
+	auto range = lookup.equal_range( hash );
+
+	for( auto it = range.first; it != range.second; ++it )
+	{
+		if( !memcmp( m_Vertices.data() + it->second * VERTEX_SIZE, pVertex, VERTEX_SIZE * sizeof( float ) ) )
+		{
+			++m_uiNumWeldedVertices;
+			return it->second;
+		}
+	}
+
+	const uint32_t uiIndex = static_cast<uint32_t>( m_Vertices.size() / VERTEX_SIZE );
+
+	m_Vertices.insert( m_Vertices.end(), pVertex, pVertex + VERTEX_SIZE );
+
+	lookup.emplace( hash, uiIndex );
+
+	return uiIndex;
+}
+
+bool VerifyBrushGeometryBuilder()
+{
+	typedef CBrushGeometryBuilder Builder;
+
+	//Position, texture coordinates, lightmap coordinates.
+	const float quad[ 4 ][ Builder::VERTEX_SIZE ] =
+	{
+		{ 0, 0, 0, 0, 0, 0, 0 },
+		{ 64, 0, 0, 1, 0, 1, 0 },
+		{ 64, 64, 0, 1, 1, 1, 1 },
+		{ 0, 64, 0, 0, 1, 0, 1 }
+	};
+
+	//Shares the edge from quad[ 1 ] to quad[ 2 ].
+	const float adjacent[ 4 ][ Builder::VERTEX_SIZE ] =
+	{
+		{ 64, 0, 0, 1, 0, 1, 0 },
+		{ 128, 0, 0, 2, 0, 2, 0 },
+		{ 128, 64, 0, 2, 1, 2, 1 },
+		{ 64, 64, 0, 1, 1, 1, 1 }
+	};
+
+	//Shares quad[ 0 ], but is drawn with another lightmap.
+	const float triangle[ 3 ][ Builder::VERTEX_SIZE ] =
+	{
+		{ 0, 0, 0, 0, 0, 0, 0 },
+		{ 0, 0, 64, 0, 1, 0, 1 },
+		{ 0, 64, 64, 1, 1, 1, 1 }
+	};
+
+	//Belongs to another group; nothing is shared.
+	const float other[ 4 ][ Builder::VERTEX_SIZE ] =
+	{
+		{ 0, 0, 128, 0, 0, 0, 0 },
+		{ 64, 0, 128, 1, 0, 1, 0 },
+		{ 64, 64, 128, 1, 1, 1, 1 },
+		{ 0, 64, 128, 0, 1, 0, 1 }
+	};
+
+	//First two vertices are identical, so its first triangle collapses.
+	const float collapsed[ 4 ][ Builder::VERTEX_SIZE ] =
+	{
+		{ 0, 0, 256, 0, 0, 0, 0 },
+		{ 0, 0, 256, 0, 0, 0, 0 },
+		{ 64, 0, 256, 1, 0, 1, 0 },
+		{ 64, 64, 256, 1, 1, 1, 1 }
+	};
+
+	const BrushBatchKey_t worldKey = { 0, nullptr, nullptr, 1 };
+	const BrushBatchKey_t worldKey2 = { 0, nullptr, nullptr, 2 };
+	const BrushBatchKey_t otherKey = { 1, nullptr, nullptr, 1 };
+
+	Builder builder;
+
+	//Added out of order; the other group must still end up last.
+	builder.AddPolygon( otherKey, 3, other[ 0 ], 4 );
+	builder.AddPolygon( worldKey, 0, quad[ 0 ], 4 );
+	builder.AddPolygon( worldKey2, 2, triangle[ 0 ], 3 );
+	builder.AddPolygon( worldKey, 1, adjacent[ 0 ], 4 );
+	//Too few vertices; ignored.
+	builder.AddPolygon( worldKey, 4, quad[ 0 ], 2 );
+	builder.AddPolygon( worldKey, 5, collapsed[ 0 ], 4 );
+
+	builder.Build();
+
+	bool bSuccess = true;
+
+	const auto check = [ & ]( const bool bCondition, const char* const pszWhat )
+	{
+		if( !bCondition )
+		{
+			Warning( "Brush geometry: %s\n", pszWhat );
+			bSuccess = false;
+		}
+	};
+
+	const auto& ranges = builder.GetRanges();
+	const auto& indices = builder.GetIndices();
+
+	//Quad: 4, adjacent: 2 new, collapsed: 3 new, triangle: 2 new, other: 4.
+	check( builder.GetNumVertices() == 15, "expected 15 vertices after welding" );
+	check( builder.GetNumWeldedVertices() == 4, "expected 4 welded vertices" );
+
+	//2 triangles for each quad, 1 for the triangle, 1 left of the collapsed quad.
+	check( indices.size() == 24, "expected 24 indices" );
+
+	check( ranges.size() == 3, "expected 3 draw ranges" );
+
+	if( ranges.size() == 3 )
+	{
+		check( ranges[ 0 ].key.iGroup == 0 && ranges[ 0 ].key.uiLightmap == 1 && ranges[ 0 ].uiNumIndices == 15, "first range should hold both world quads and the collapsed quad" );
+		check( ranges[ 1 ].key.iGroup == 0 && ranges[ 1 ].key.uiLightmap == 2 && ranges[ 1 ].uiNumIndices == 3, "second range should hold the triangle" );
+		check( ranges[ 2 ].key.iGroup == 1 && ranges[ 2 ].uiNumIndices == 6, "third range should hold the other group's quad" );
+	}
+
+	uint32_t uiExpectedFirst = 0;
+
+	for( const auto& range : ranges )
+	{
+		check( range.uiFirstIndex == uiExpectedFirst, "ranges should be contiguous" );
+		uiExpectedFirst = range.uiFirstIndex + range.uiNumIndices;
+	}
+
+	check( uiExpectedFirst == indices.size(), "ranges should cover all indices" );
+
+	check( std::all_of( indices.begin(), indices.end(), [ & ]( const uint32_t uiIndex ) { return uiIndex < builder.GetNumVertices(); } ),
+		   "indices should refer to existing vertices" );
+
+	for( size_t uiTriangle = 0; uiTriangle + 2 < indices.size(); uiTriangle += 3 )
+	{
+		const uint32_t* pTri = &indices[ uiTriangle ];
+
+		check( pTri[ 0 ] != pTri[ 1 ] && pTri[ 1 ] != pTri[ 2 ] && pTri[ 0 ] != pTri[ 2 ], "no triangle should be degenerate" );
+	}
+
+	size_t uiFirst, uiCount;
+
+	builder.GetGroupRanges( 1, uiFirst, uiCount );
+
+	check( uiFirst == 2 && uiCount == 1, "the other group should have only the last range" );
+
+	for( size_t uiSurface = 0; uiSurface <= 5; ++uiSurface )
+	{
+		const auto surface = builder.GetSurfaceIndices( uiSurface );
+
+		if( uiSurface == 4 )
+		{
+			check( surface.uiRange == Builder::INVALID_RANGE, "the ignored polygon's surface should have no indices" );
+			continue;
+		}
+
+		if( surface.uiRange >= ranges.size() )
+		{
+			check( false, "every surface should have a valid range" );
+			continue;
+		}
+
+		const auto& range = ranges[ surface.uiRange ];
+
+		check( surface.uiFirstIndex >= range.uiFirstIndex && surface.uiFirstIndex + surface.uiNumIndices <= range.uiFirstIndex + range.uiNumIndices,
+			   "surface indices should lie inside their range" );
+	}
+
+	return bSuccess;
+}
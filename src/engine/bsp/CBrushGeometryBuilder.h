@@ -0,0 +1,166 @@
+#ifndef ENGINE_BSP_CBRUSHGEOMETRYBUILDER_H
+#define ENGINE_BSP_CBRUSHGEOMETRYBUILDER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+class CShaderInstance;
+struct texture_t;
+
+/**
+*	Key that brush polygons are grouped by. Polygons with the same key are drawn with a single draw call.
+*/
+struct BrushBatchKey_t
+{
+	/**
+	*	Group that the polygon belongs to. Groups are drawn separately, e.g. one group per brush model.
+	*/
+	int iGroup;
+
+	CShaderInstance* pShader;
+	texture_t* pTexture;
+
+	/**
+	*	Lightmap texture.
+	*/
+	unsigned int uiLightmap;
+};
+
+/**
+*	Range of indices that can be drawn with a single draw call.
+*/
+struct BrushDrawRange_t
+{
+	BrushBatchKey_t key;
+
+	uint32_t uiFirstIndex;
+	uint32_t uiNumIndices;
+};
+
+/**
+*	Range of indices that belong to a single surface.
+*/
+struct BrushSurfaceIndices_t
+{
+	/**
+	*	Draw range that this surface is part of.
+	*/
+	uint32_t uiRange;
+
+	uint32_t uiFirstIndex;
+	uint32_t uiNumIndices;
+};
+
+/**
+*	Builds the static geometry of a map.
+*	Convex polygons are triangulated into a single shared vertex and index buffer, with identical vertices welded together.
+*	Indices are grouped into draw ranges by batch key, and ranges are ordered by group.
+*	Does not use any graphics API, so it can be used without a rendering context.
+*/
+class CBrushGeometryBuilder final
+{
+public:
+	/**
+	*	Number of floats per vertex: position, texture coordinates and lightmap coordinates.
+	*/
+	static const size_t VERTEX_SIZE = 7;
+
+	/**
+	*	Marks a surface that has no indices.
+	*/
+	static const uint32_t INVALID_RANGE = UINT32_MAX;
+
+public:
+	CBrushGeometryBuilder() = default;
+	~CBrushGeometryBuilder() = default;
+
+	/**
+	*	Adds a convex polygon.
+	*	@param key Key to group the polygon by.
+	*	@param uiSurface Index of the surface that the polygon belongs to. Multiple polygons can belong to the same surface.
+	*	@param pVerts Vertices, VERTEX_SIZE floats each, in drawing order.
+	*	@param uiNumVerts Number of vertices. Polygons with fewer than 3 vertices are ignored.
+	*/
+	void AddPolygon( const BrushBatchKey_t& key, const size_t uiSurface, const float* pVerts, const size_t uiNumVerts );
+
+	/**
+	*	Builds the vertex and index data, and the draw ranges, from all polygons that were added.
+	*	Pending polygons are discarded afterwards.
+	*/
+	void Build();
+
+	/**
+	*	Clears all data.
+	*/
+	void Clear();
+
+	const std::vector<float>& GetVertices() const { return m_Vertices; }
+
+	/**
+	*	@return Number of vertices in the vertex data.
+	*/
+	size_t GetNumVertices() const { return m_Vertices.size() / VERTEX_SIZE; }
+
+	const std::vector<uint32_t>& GetIndices() const { return m_Indices; }
+
+	const std::vector<BrushDrawRange_t>& GetRanges() const { return m_Ranges; }
+
+	/**
+	*	Gets the draw ranges that belong to the given group.
+	*	@param iGroup Group to get the ranges of.
+	*	@param uiOutFirst Index of the first range.
+	*	@param uiOutCount Number of ranges.
+	*/
+	void GetGroupRanges( const int iGroup, size_t& uiOutFirst, size_t& uiOutCount ) const;
+
+	/**
+	*	@return The indices of the given surface. The range is INVALID_RANGE if the surface has no indices.
+	*/
+	BrushSurfaceIndices_t GetSurfaceIndices( const size_t uiSurface ) const;
+
+	/**
+	*	@return Number of vertices that were welded to an existing vertex during the last build.
+	*/
+	size_t GetNumWeldedVertices() const { return m_uiNumWeldedVertices; }
+
+private:
+	struct PendingPolygon_t
+	{
+		BrushBatchKey_t key;
+		size_t uiSurface;
+		size_t uiFirstVertex;
+		size_t uiNumVerts;
+	};
+
+	/**
+	*	Adds a vertex to the output, or finds an identical existing one.
+	*	@return Index of the vertex.
+	*/
+	uint32_t AddVertex( const float* pVertex, std::unordered_multimap<size_t, uint32_t>& lookup );
+
+private:
+	std::vector<PendingPolygon_t> m_Pending;
+	std::vector<float> m_PendingVerts;
+
+	std::vector<float> m_Vertices;
+	std::vector<uint32_t> m_Indices;
+	std::vector<BrushDrawRange_t> m_Ranges;
+	std::vector<BrushSurfaceIndices_t> m_Surfaces;
+
+	size_t m_uiNumWeldedVertices = 0;
+
+private:
+	CBrushGeometryBuilder( const CBrushGeometryBuilder& ) = delete;
+	CBrushGeometryBuilder& operator=( const CBrushGeometryBuilder& ) = delete;
+};
+
+/**
+*	Builds a small synthetic set of polygons and checks the draw ranges, the number of vertices left after welding,
+*	and that every index and surface range is valid. Does not require a rendering context.
+*	@return Whether the output matched the expected results.
+*/
+bool VerifyBrushGeometryBuilder();
+
+#endif //ENGINE_BSP_CBRUSHGEOMETRYBUILDER_H
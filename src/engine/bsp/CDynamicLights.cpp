@@ -0,0 +1,79 @@
+#include "CDynamicLights.h"
+
+void CDynamicLights::Clear()
+{
+	for( auto& light : m_Lights )
+		light = dlight_t{};
+}
+
+dlight_t* CDynamicLights::Alloc( const int iKey, const float flTime )
+{
+	dlight_t* pLight = nullptr;
+
+	// first look for an exact key match
+	if( iKey )
+	{
+		for( auto& light : m_Lights )
+		{
+			if( light.key == iKey )
+			{
+				pLight = &light;
+				break;
+			}
+		}
+	}
+
+	// then look for anything else
+	if( !pLight )
+	{
+		for( auto& light : m_Lights )
+		{
+			if( light.die < flTime || light.radius <= 0 )
+			{
+				pLight = &light;
+				break;
+			}
+		}
+	}
+
+	if( !pLight )
+		pLight = &m_Lights[ 0 ];
+
+	*pLight = dlight_t{};
+	pLight->key = iKey;
+
+	return pLight;
+}
+
+void CDynamicLights::Decay( const float flTime, const float flDeltaTime )
+{
+	for( auto& light : m_Lights )
+	{
+		if( light.radius <= 0 )
+			continue;
+
+		if( light.die < flTime )
+		{
+			light.radius = 0;
+			continue;
+		}
+
+		light.radius -= flDeltaTime * light.decay;
+
+		if( light.radius < 0 )
+			light.radius = 0;
+	}
+}
+
+size_t CDynamicLights::GetNumActiveLights() const
+{
+	size_t uiCount = 0;
+
+	for( const auto& light : m_Lights )
+	{
+		if( light.radius > 0 )
+			++uiCount;
+	}
+
+	return uiCount;
+}
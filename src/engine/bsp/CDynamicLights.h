@@ -0,0 +1,101 @@
+#ifndef ENGINE_BSP_CDYNAMICLIGHTS_H
+#define ENGINE_BSP_CDYNAMICLIGHTS_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include "bsp/BSPRenderDefs.h"
+
+/**
+*	A dynamic point light, such as a muzzle flash or explosion.
+*/
+struct dlight_t
+{
+	Vector origin;
+
+	/**
+	*	Radius of the light. The light is inactive if this is 0.
+	*/
+	float radius;
+
+	/**
+	*	Light color, 255 is normal brightness.
+	*/
+	uint8_t color[ 3 ];
+
+	/**
+	*	Time at which the light is removed.
+	*/
+	float die;
+
+	/**
+	*	Radius lost per second.
+	*/
+	float decay;
+
+	/**
+	*	Don't add when contributing less than this.
+	*/
+	float minlight;
+
+	/**
+	*	So entities can reuse the same light.
+	*/
+	int key;
+};
+
+/**
+*	List of dynamic lights. Lights are identified by their index, which is also their bit in msurface_t::dlightbits.
+*/
+class CDynamicLights final
+{
+public:
+	/**
+	*	Maximum number of dynamic lights. Limited by the number of bits in msurface_t::dlightbits.
+	*/
+	static const size_t MAX_DLIGHTS = 32;
+
+public:
+	CDynamicLights() = default;
+	~CDynamicLights() = default;
+
+	/**
+	*	Removes all lights.
+	*/
+	void Clear();
+
+	/**
+	*	Allocates a light. If a light with the given key exists it is reused, otherwise a light that has died is used.
+	*	If all lights are in use, the first light is overwritten.
+	*	@param iKey Key to identify the light with. 0 never matches an existing light.
+	*	@param flTime Current time.
+	*	@return Cleared light with its key set.
+	*/
+	dlight_t* Alloc( const int iKey, const float flTime );
+
+	/**
+	*	Shrinks lights by their decay rate and removes lights that have died.
+	*	@param flTime Current time.
+	*	@param flDeltaTime Time since the last call.
+	*/
+	void Decay( const float flTime, const float flDeltaTime );
+
+	/**
+	*	@return All lights. Inactive lights have a radius of 0.
+	*/
+	const dlight_t* GetLights() const { return m_Lights; }
+
+	/**
+	*	@return Number of lights with a radius greater than 0.
+	*/
+	size_t GetNumActiveLights() const;
+
+private:
+	dlight_t m_Lights[ MAX_DLIGHTS ] = {};
+
+private:
+	CDynamicLights( const CDynamicLights& ) = delete;
+	CDynamicLights& operator=( const CDynamicLights& ) = delete;
+};
+
+#endif //ENGINE_BSP_CDYNAMICLIGHTS_H
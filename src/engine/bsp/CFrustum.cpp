@@ -0,0 +1,115 @@
+#include "CFrustum.h"
+
+int BoxOnPlaneSide( const Vector& mins, const Vector& maxs, const mplane_t* p )
+{
+	//Fast axial cases.
+	if( p->type < PLANE_ANYX )
+	{
+		if( p->dist <= mins[ p->type ] )
+			return 1;
+		if( p->dist >= maxs[ p->type ] )
+			return 2;
+		return 3;
+	}
+
+	//General case. dist1 is the corner furthest along the normal, dist2 the one furthest against it.
+	float dist1, dist2;
+
+	switch( p->signbits )
+	{
+	case 0:
+		dist1 = p->normal[ 0 ] * maxs[ 0 ] + p->normal[ 1 ] * maxs[ 1 ] + p->normal[ 2 ] * maxs[ 2 ];
+		dist2 = p->normal[ 0 ] * mins[ 0 ] + p->normal[ 1 ] * mins[ 1 ] + p->normal[ 2 ] * mins[ 2 ];
+		break;
+	case 1:
+		dist1 = p->normal[ 0 ] * mins[ 0 ] + p->normal[ 1 ] * maxs[ 1 ] + p->normal[ 2 ] * maxs[ 2 ];
+		dist2 = p->normal[ 0 ] * maxs[ 0 ] + p->normal[ 1 ] * mins[ 1 ] + p->normal[ 2 ] * mins[ 2 ];
+		break;
+	case 2:
+		dist1 = p->normal[ 0 ] * maxs[ 0 ] + p->normal[ 1 ] * mins[ 1 ] + p->normal[ 2 ] * maxs[ 2 ];
+		dist2 = p->normal[ 0 ] * mins[ 0 ] + p->normal[ 1 ] * maxs[ 1 ] + p->normal[ 2 ] * mins[ 2 ];
+		break;
+	case 3:
+		dist1 = p->normal[ 0 ] * mins[ 0 ] + p->normal[ 1 ] * mins[ 1 ] + p->normal[ 2 ] * maxs[ 2 ];
+		dist2 = p->normal[ 0 ] * maxs[ 0 ] + p->normal[ 1 ] * maxs[ 1 ] + p->normal[ 2 ] * mins[ 2 ];
+		break;
+	case 4:
+		dist1 = p->normal[ 0 ] * maxs[ 0 ] + p->normal[ 1 ] * maxs[ 1 ] + p->normal[ 2 ] * mins[ 2 ];
+		dist2 = p->normal[ 0 ] * mins[ 0 ] + p->normal[ 1 ] * mins[ 1 ] + p->normal[ 2 ] * maxs[ 2 ];
+		break;
+	case 5:
+		dist1 = p->normal[ 0 ] * mins[ 0 ] + p->normal[ 1 ] * maxs[ 1 ] + p->normal[ 2 ] * mins[ 2 ];
+		dist2 = p->normal[ 0 ] * maxs[ 0 ] + p->normal[ 1 ] * mins[ 1 ] + p->normal[ 2 ] * maxs[ 2 ];
+		break;
+	case 6:
+		dist1 = p->normal[ 0 ] * maxs[ 0 ] + p->normal[ 1 ] * mins[ 1 ] + p->normal[ 2 ] * mins[ 2 ];
+		dist2 = p->normal[ 0 ] * mins[ 0 ] + p->normal[ 1 ] * maxs[ 1 ] + p->normal[ 2 ] * maxs[ 2 ];
+		break;
+	default:
+	case 7:
+		dist1 = p->normal[ 0 ] * mins[ 0 ] + p->normal[ 1 ] * mins[ 1 ] + p->normal[ 2 ] * mins[ 2 ];
+		dist2 = p->normal[ 0 ] * maxs[ 0 ] + p->normal[ 1 ] * maxs[ 1 ] + p->normal[ 2 ] * maxs[ 2 ];
+		break;
+	}
+
+	int sides = 0;
+
+	if( dist1 >= p->dist )
+		sides = 1;
+	if( dist2 < p->dist )
+		sides |= 2;
+
+	return sides;
+}
+
+void CFrustum::Setup( const glm::mat4x4& viewProjection )
+{
+	//Gribb/Hartmann plane extraction. glm matrices are column major, so row N is viewProjection[ column ][ N ].
+	const auto row = [ & ]( const int iRow )
+	{
+		return glm::vec4( viewProjection[ 0 ][ iRow ], viewProjection[ 1 ][ iRow ], viewProjection[ 2 ][ iRow ], viewProjection[ 3 ][ iRow ] );
+	};
+
+	const glm::vec4 row3 = row( 3 );
+
+	const glm::vec4 planes[ NUM_PLANES ] =
+	{
+		row3 + row( 0 ),	//Left
+		row3 - row( 0 ),	//Right
+		row3 + row( 1 ),	//Bottom
+		row3 - row( 1 )		//Top
+	};
+
+	for( size_t uiIndex = 0; uiIndex < NUM_PLANES; ++uiIndex )
+	{
+		mplane_t& plane = m_Planes[ uiIndex ];
+
+		const Vector normal( planes[ uiIndex ] );
+
+		const float flLength = glm::length( normal );
+
+		plane.normal = normal / flLength;
+		//The extracted plane is normal . x + w >= 0, mplane_t uses normal . x - dist.
+		plane.dist = -planes[ uiIndex ].w / flLength;
+		plane.type = PLANE_ANYZ;
+
+		plane.signbits = 0;
+
+		for( int j = 0; j < 3; ++j )
+		{
+			if( plane.normal[ j ] < 0 )
+				plane.signbits |= 1 << j;
+		}
+	}
+}
+
+bool CFrustum::CullBox( const Vector& mins, const Vector& maxs ) const
+{
+	for( size_t uiIndex = 0; uiIndex < NUM_PLANES; ++uiIndex )
+	{
+		if( BoxOnPlaneSide( mins, maxs, &m_Planes[ uiIndex ] ) == 2 )
+			return true;
+	}
+
+	return false;
+}
@@ -0,0 +1,47 @@
+#ifndef ENGINE_BSP_CFRUSTUM_H
+#define ENGINE_BSP_CFRUSTUM_H
+
+#include <glm/mat4x4.hpp>
+
+#include "bsp/BSPRenderDefs.h"
+
+/**
+*	Determines which side of a plane a box is on.
+*	Uses the plane's type and signbits to test only the two corners that matter.
+*	@return 1 if the box is in front of the plane, 2 if it is behind, 3 if it crosses it.
+*/
+int BoxOnPlaneSide( const Vector& mins, const Vector& maxs, const mplane_t* p );
+
+/**
+*	View frustum, as a set of planes that face inward.
+*/
+class CFrustum final
+{
+public:
+	/**
+	*	Number of planes used for culling: left, right, bottom and top.
+	*	Near and far aren't used, the near plane is too close to the view origin to cull anything and the far plane is beyond the map.
+	*/
+	static const size_t NUM_PLANES = 4;
+
+public:
+	CFrustum() = default;
+
+	/**
+	*	Extracts the frustum planes from a view projection matrix.
+	*	@param viewProjection Projection matrix multiplied by the view matrix.
+	*/
+	void Setup( const glm::mat4x4& viewProjection );
+
+	const mplane_t& GetPlane( const size_t uiIndex ) const { return m_Planes[ uiIndex ]; }
+
+	/**
+	*	@return Whether the given box is entirely outside the frustum.
+	*/
+	bool CullBox( const Vector& mins, const Vector& maxs ) const;
+
+private:
+	mplane_t m_Planes[ NUM_PLANES ] = {};
+};
+
+#endif //ENGINE_BSP_CFRUSTUM_H
@@ -0,0 +1,139 @@
+#include <cassert>
+#include <cstring>
+
+#include "Platform.h"
+
+#include "CLightStyles.h"
+
+namespace
+{
+/**
+*	Patterns that game code sets up for the first styles.
+*/
+const char* const g_pszStandardPatterns[] =
+{
+	// 0 normal
+	"m",
+
+	// 1 FLICKER (first variety)
+	"mmnmmommommnonmmonqnmmo",
+
+	// 2 SLOW STRONG PULSE
+	"abcdefghijklmnopqrstuvwxyzyxwvutsrqponmlkjihgfedcba",
+
+	// 3 CANDLE (first variety)
+	"mmmmmaaaaammmmmaaaaaabcdefgabcdefg",
+
+	// 4 FAST STROBE
+	"mamamamamama",
+
+	// 5 GENTLE PULSE 1
+	"jklmnopqrstuvwxyzyxwvutsrqponmlkj",
+
+	// 6 FLICKER (second variety)
+	"nmonqnmomnmomomno",
+
+	// 7 CANDLE (second variety)
+	"mmmaaaabcdefgmmmmaaaammmaamm",
+
+	// 8 CANDLE (third variety)
+	"mmmaaammmaaammmabcdefaaaammmmabcdefmmmaaaa",
+
+	// 9 SLOW STROBE (fourth variety)
+	"aaaaaaaazzzzzzzz",
+
+	// 10 FLUORESCENT FLICKER
+	"mmamammmmammamamaaamammma",
+
+	// 11 SLOW PULSE NOT FADE TO BLACK
+	"abcdefghijklmnopqrrqponmlkjihgfedcba",
+
+	// 12 UNDERWATER LIGHT MUTATION
+	"mmnnmmnnnmmnn"
+};
+
+/**
+*	Style used for testing, always dark.
+*/
+const size_t TEST_STYLE = 63;
+}
+
+CLightStyles::CLightStyles()
+{
+	Reset();
+}
+
+void CLightStyles::Reset()
+{
+	memset( m_szPatterns, 0, sizeof( m_szPatterns ) );
+
+	for( size_t uiIndex = 0; uiIndex < ARRAYSIZE( g_pszStandardPatterns ); ++uiIndex )
+	{
+		SetPattern( uiIndex, g_pszStandardPatterns[ uiIndex ] );
+	}
+
+	SetPattern( TEST_STYLE, "a" );
+
+	for( auto& value : m_Values )
+		value = DEFAULT_VALUE;
+}
+
+const char* CLightStyles::GetPattern( const size_t uiStyle ) const
+{
+	if( uiStyle >= MAX_LIGHTSTYLES )
+		return nullptr;
+
+	return m_szPatterns[ uiStyle ];
+}
+
+bool CLightStyles::SetPattern( const size_t uiStyle, const char* const pszPattern )
+{
+	assert( pszPattern );
+
+	if( uiStyle >= MAX_LIGHTSTYLES )
+		return false;
+
+	const size_t uiLength = strlen( pszPattern );
+
+	if( uiLength >= MAX_PATTERN )
+		return false;
+
+	for( size_t uiIndex = 0; uiIndex < uiLength; ++uiIndex )
+	{
+		if( pszPattern[ uiIndex ] < 'a' || pszPattern[ uiIndex ] > 'z' )
+			return false;
+	}
+
+	strcpy( m_szPatterns[ uiStyle ], pszPattern );
+
+	return true;
+}
+
+size_t CLightStyles::Animate( const float flTime )
+{
+	const int iFrame = static_cast<int>( flTime * 10 );
+
+	size_t uiChanged = 0;
+
+	for( size_t uiStyle = 0; uiStyle < MAX_LIGHTSTYLES; ++uiStyle )
+	{
+		const char* pszPattern = m_szPatterns[ uiStyle ];
+
+		const size_t uiLength = strlen( pszPattern );
+
+		int iValue;
+
+		if( !uiLength )
+			iValue = 256;
+		else
+			iValue = ( pszPattern[ iFrame % uiLength ] - 'a' ) * 22;
+
+		if( m_Values[ uiStyle ] != iValue )
+		{
+			m_Values[ uiStyle ] = iValue;
+			++uiChanged;
+		}
+	}
+
+	return uiChanged;
+}
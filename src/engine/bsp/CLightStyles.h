@@ -0,0 +1,75 @@
+#ifndef ENGINE_BSP_CLIGHTSTYLES_H
+#define ENGINE_BSP_CLIGHTSTYLES_H
+
+#include <cstddef>
+
+/**
+*	Animated lightstyles.
+*	Each style has a pattern of letters, 'a' is dark, 'm' is normal and 'z' is double bright. Patterns advance 10 letters per second.
+*/
+class CLightStyles final
+{
+public:
+	/**
+	*	Number of styles that can be given a pattern. Styles 32 and up are used by switchable lights.
+	*/
+	static const size_t MAX_LIGHTSTYLES = 64;
+
+	/**
+	*	Maximum pattern length, including the null terminator.
+	*/
+	static const size_t MAX_PATTERN = 64;
+
+	/**
+	*	Number of values. Surfaces store styles as bytes, so every byte value has a value.
+	*/
+	static const size_t NUM_VALUES = 256;
+
+	/**
+	*	8.8 value of styles that have no pattern; 'm'.
+	*/
+	static const int DEFAULT_VALUE = 264;
+
+public:
+	CLightStyles();
+	~CLightStyles() = default;
+
+	/**
+	*	Restores the standard patterns and clears all others.
+	*/
+	void Reset();
+
+	/**
+	*	@return The pattern of the given style, or null if the style is out of range.
+	*/
+	const char* GetPattern( const size_t uiStyle ) const;
+
+	/**
+	*	Sets the pattern of the given style. Takes effect on the next call to Animate.
+	*	@return Whether the pattern was set. Fails if the style is out of range or the pattern contains characters other than 'a' through 'z'.
+	*/
+	bool SetPattern( const size_t uiStyle, const char* const pszPattern );
+
+	/**
+	*	Evaluates all patterns at the given time.
+	*	@param flTime Time in seconds.
+	*	@return Number of styles whose value changed.
+	*/
+	size_t Animate( const float flTime );
+
+	/**
+	*	@return 8.8 values for every style, as evaluated by the last call to Animate.
+	*/
+	const int* GetValues() const { return m_Values; }
+
+private:
+	char m_szPatterns[ MAX_LIGHTSTYLES ][ MAX_PATTERN ];
+
+	int m_Values[ NUM_VALUES ];
+
+private:
+	CLightStyles( const CLightStyles& ) = delete;
+	CLightStyles& operator=( const CLightStyles& ) = delete;
+};
+
+#endif //ENGINE_BSP_CLIGHTSTYLES_H
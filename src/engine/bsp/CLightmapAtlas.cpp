@@ -0,0 +1,168 @@
+#include <algorithm>
+#include <cassert>
+#include <cstdio>
+#include <numeric>
+
+#include "CLightmapAtlas.h"
+
+void CLightmapAtlas::Clear()
+{
+	m_iPageSize = 0;
+	m_Pages.clear();
+	m_Pages.shrink_to_fit();
+	m_uiUsedTexels = 0;
+}
+
+bool CLightmapAtlas::Pack( int iPageSize, const std::vector<LightmapSize_t>& sizes, std::vector<LightmapPlacement_t>& placements )
+{
+	Clear();
+
+	iPageSize = std::max( MIN_PAGE_SIZE, std::min( iPageSize, MAX_PAGE_SIZE ) );
+
+	//Round down to a power of 2.
+	while( iPageSize & ( iPageSize - 1 ) )
+		iPageSize &= iPageSize - 1;
+
+	m_iPageSize = iPageSize;
+
+	placements.resize( sizes.size() );
+
+	//Tallest first, so each shelf is as tall as the first lightmap placed on it and later ones fill it with little waste.
+	std::vector<size_t> order( sizes.size() );
+
+	std::iota( order.begin(), order.end(), 0 );
+
+	std::stable_sort( order.begin(), order.end(), [ & ]( const size_t lhs, const size_t rhs )
+	{
+		if( sizes[ lhs ].iHeight != sizes[ rhs ].iHeight )
+			return sizes[ lhs ].iHeight > sizes[ rhs ].iHeight;
+
+		return sizes[ lhs ].iWidth > sizes[ rhs ].iWidth;
+	} );
+
+	struct Shelf_t
+	{
+		int iPage;
+		int y;
+		int iHeight;
+
+		/**
+		*	First free column.
+		*/
+		int x;
+	};
+
+	std::vector<Shelf_t> shelves;
+
+	for( const auto uiIndex : order )
+	{
+		const LightmapSize_t& size = sizes[ uiIndex ];
+
+		if( size.iWidth <= 0 || size.iHeight <= 0 || size.iWidth > iPageSize || size.iHeight > iPageSize )
+		{
+			printf( "CLightmapAtlas::Pack: lightmap of %dx%d does not fit in a %dx%d page\n", size.iWidth, size.iHeight, iPageSize, iPageSize );
+			Clear();
+			return false;
+		}
+
+		Shelf_t* pShelf = nullptr;
+
+		for( auto& shelf : shelves )
+		{
+			if( shelf.iHeight >= size.iHeight && iPageSize - shelf.x >= size.iWidth )
+			{
+				pShelf = &shelf;
+				break;
+			}
+		}
+
+		if( !pShelf )
+		{
+			//Open a new shelf, on a new page if the last one is full.
+			if( m_Pages.empty() || m_Pages.back().iHeight + size.iHeight > iPageSize )
+			{
+				m_Pages.push_back( Page_t{ iPageSize, 0, {} } );
+			}
+
+			Page_t& page = m_Pages.back();
+
+			shelves.push_back( Shelf_t{ static_cast<int>( m_Pages.size() - 1 ), page.iHeight, size.iHeight, 0 } );
+
+			page.iHeight += size.iHeight;
+
+			pShelf = &shelves.back();
+		}
+
+		placements[ uiIndex ] = LightmapPlacement_t{ pShelf->iPage, pShelf->x, pShelf->y };
+
+		pShelf->x += size.iWidth;
+
+		m_uiUsedTexels += static_cast<size_t>( size.iWidth * size.iHeight );
+	}
+
+	for( auto& page : m_Pages )
+	{
+		page.data.assign( static_cast<size_t>( page.iWidth * page.iHeight * BYTES_PER_TEXEL ), 0 );
+	}
+
+	return true;
+}
+
+bool CLightmapAtlas::Verify( const std::vector<LightmapSize_t>& sizes, const std::vector<LightmapPlacement_t>& placements ) const
+{
+	if( sizes.size() != placements.size() )
+		return false;
+
+	std::vector<std::vector<bool>> coverage( m_Pages.size() );
+
+	for( size_t uiIndex = 0; uiIndex < m_Pages.size(); ++uiIndex )
+		coverage[ uiIndex ].resize( static_cast<size_t>( m_Pages[ uiIndex ].iWidth * m_Pages[ uiIndex ].iHeight ) );
+
+	for( size_t uiIndex = 0; uiIndex < sizes.size(); ++uiIndex )
+	{
+		const LightmapSize_t& size = sizes[ uiIndex ];
+		const LightmapPlacement_t& placement = placements[ uiIndex ];
+
+		if( placement.iPage < 0 || static_cast<size_t>( placement.iPage ) >= m_Pages.size() )
+			return false;
+
+		const Page_t& page = m_Pages[ placement.iPage ];
+
+		if( placement.x < 0 || placement.y < 0 || placement.x + size.iWidth > page.iWidth || placement.y + size.iHeight > page.iHeight )
+			return false;
+
+		auto& covered = coverage[ placement.iPage ];
+
+		for( int y = placement.y; y < placement.y + size.iHeight; ++y )
+		{
+			for( int x = placement.x; x < placement.x + size.iWidth; ++x )
+			{
+				const size_t uiTexel = static_cast<size_t>( y * page.iWidth + x );
+
+				if( covered[ uiTexel ] )
+					return false;
+
+				covered[ uiTexel ] = true;
+			}
+		}
+	}
+
+	return true;
+}
+
+size_t CLightmapAtlas::GetTotalTexels() const
+{
+	size_t uiTotal = 0;
+
+	for( const auto& page : m_Pages )
+		uiTotal += static_cast<size_t>( page.iWidth * page.iHeight );
+
+	return uiTotal;
+}
+
+float CLightmapAtlas::GetOccupancy() const
+{
+	const size_t uiTotal = GetTotalTexels();
+
+	return uiTotal ? static_cast<float>( m_uiUsedTexels ) / uiTotal : 0.0f;
+}
@@ -0,0 +1,106 @@
+#ifndef ENGINE_BSP_CLIGHTMAPATLAS_H
+#define ENGINE_BSP_CLIGHTMAPATLAS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+*	Size of a surface's lightmap, in texels.
+*/
+struct LightmapSize_t
+{
+	int iWidth;
+	int iHeight;
+};
+
+/**
+*	Where a surface's lightmap was placed.
+*/
+struct LightmapPlacement_t
+{
+	int iPage;
+	int x;
+	int y;
+};
+
+/**
+*	Packs surface lightmaps into square pages and stores their RGBA texels.
+*	Lightmaps are sorted by height and placed on shelves, which wastes little space when most lightmaps are small.
+*	Pages are allocated as needed, and each page is only as tall as its used area.
+*/
+class CLightmapAtlas final
+{
+public:
+	static const int BYTES_PER_TEXEL = 4;
+
+	static const int MIN_PAGE_SIZE = 128;
+	static const int MAX_PAGE_SIZE = 4096;
+
+	struct Page_t
+	{
+		int iWidth;
+		int iHeight;
+
+		std::vector<uint8_t> data;
+	};
+
+public:
+	CLightmapAtlas() = default;
+	~CLightmapAtlas() = default;
+
+	/**
+	*	Frees all pages.
+	*/
+	void Clear();
+
+	/**
+	*	Packs lightmaps of the given sizes. Any previous contents are freed.
+	*	@param iPageSize Page width and maximum page height. Rounded down to a power of 2 and clamped to [ MIN_PAGE_SIZE, MAX_PAGE_SIZE ].
+	*	@param sizes Lightmap sizes.
+	*	@param placements Receives the placement of each lightmap, in the same order as the sizes.
+	*	@return Whether all lightmaps were packed. Fails if a lightmap is larger than a page.
+	*/
+	bool Pack( int iPageSize, const std::vector<LightmapSize_t>& sizes, std::vector<LightmapPlacement_t>& placements );
+
+	/**
+	*	Checks that every placement is inside its page and that no two placements overlap.
+	*/
+	bool Verify( const std::vector<LightmapSize_t>& sizes, const std::vector<LightmapPlacement_t>& placements ) const;
+
+	int GetPageSize() const { return m_iPageSize; }
+
+	size_t GetNumPages() const { return m_Pages.size(); }
+
+	const Page_t& GetPage( const size_t uiIndex ) const { return m_Pages[ uiIndex ]; }
+
+	Page_t& GetPage( const size_t uiIndex ) { return m_Pages[ uiIndex ]; }
+
+	/**
+	*	@return Number of texels covered by lightmaps.
+	*/
+	size_t GetUsedTexels() const { return m_uiUsedTexels; }
+
+	/**
+	*	@return Number of texels in all pages.
+	*/
+	size_t GetTotalTexels() const;
+
+	/**
+	*	@return Fraction of page texels covered by lightmaps, in the range [ 0, 1 ].
+	*/
+	float GetOccupancy() const;
+
+private:
+	int m_iPageSize = 0;
+
+	std::vector<Page_t> m_Pages;
+
+	size_t m_uiUsedTexels = 0;
+
+private:
+	CLightmapAtlas( const CLightmapAtlas& ) = delete;
+	CLightmapAtlas& operator=( const CLightmapAtlas& ) = delete;
+};
+
+#endif //ENGINE_BSP_CLIGHTMAPATLAS_H
@@ -0,0 +1,330 @@
+#include <cassert>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "Common.h"
+#include "Logging.h"
+
+#include "Engine.h"
+#include "CSIMDDispatch.h"
+
+#include "LightmapCompose.h"
+
+namespace BSP
+{
+namespace
+{
+typedef void ( *AccumulateFn )( unsigned int* pBlockLights, const uint8_t* pSamples, const size_t uiCount, const int* pGammaTable, const unsigned int scale );
+typedef void ( *StoreRGBAFn )( const unsigned int* pBlockLights, const int smax, const int tmax, uint8_t* pDest, const int stride );
+
+/**
+*	Scalar versions. These define the expected output for the other versions.
+*/
+void AccumulateScalar( unsigned int* pBlockLights, const uint8_t* pSamples, const size_t uiCount, const int* pGammaTable, const unsigned int scale )
+{
+	for( size_t i = 0; i < uiCount; ++i )
+	{
+		pBlockLights[ i ] += pGammaTable[ pSamples[ i ] ] * scale;
+	}
+}
+
+inline void StoreTexelScalar( const unsigned int* bl, uint8_t* dest )
+{
+	for( size_t uiIndex = 0; uiIndex < 3; ++uiIndex )
+	{
+		unsigned int t = bl[ uiIndex ] >> 7;
+
+		if( t > 255 )
+			t = 255;
+
+		dest[ uiIndex ] = t;
+	}
+
+	dest[ 3 ] = 255;
+}
+
+void StoreRGBAScalar( const unsigned int* pBlockLights, const int smax, const int tmax, uint8_t* pDest, const int stride )
+{
+	for( int i = 0; i < tmax; ++i, pDest += stride )
+	{
+		uint8_t* dest = pDest;
+
+		for( int j = 0; j < smax; ++j, pBlockLights += 3, dest += 4 )
+		{
+			StoreTexelScalar( pBlockLights, dest );
+		}
+	}
+}
+
+#if CPU_X86
+/*
+*	After the shift by 7 block lights are below 2^25, so they are never negative as signed 32 bit integers.
+*	This makes signed saturation when packing down to 8 bits identical to the scalar clamp to 255.
+*/
+
+/**
+*	Low 32 bits of a 32 bit multiply. SSE2 only has an unsigned 32x32->64 multiply for the even lanes.
+*/
+CPU_TARGET( "sse2" ) inline __m128i MulLo32SSE2( const __m128i a, const __m128i b )
+{
+	const __m128i even = _mm_mul_epu32( a, b );
+	const __m128i odd = _mm_mul_epu32( _mm_srli_si128( a, 4 ), _mm_srli_si128( b, 4 ) );
+
+	return _mm_unpacklo_epi32( _mm_shuffle_epi32( even, _MM_SHUFFLE( 0, 0, 2, 0 ) ), _mm_shuffle_epi32( odd, _MM_SHUFFLE( 0, 0, 2, 0 ) ) );
+}
+
+CPU_TARGET( "sse2" ) void AccumulateSSE2( unsigned int* pBlockLights, const uint8_t* pSamples, const size_t uiCount, const int* pGammaTable, const unsigned int scale )
+{
+	const __m128i vecScale = _mm_set1_epi32( static_cast<int>( scale ) );
+
+	size_t i = 0;
+
+	for( ; i + 4 <= uiCount; i += 4 )
+	{
+		//No gather in SSE2; the table lookups are scalar.
+		const __m128i gamma = _mm_set_epi32(
+			pGammaTable[ pSamples[ i + 3 ] ], pGammaTable[ pSamples[ i + 2 ] ],
+			pGammaTable[ pSamples[ i + 1 ] ], pGammaTable[ pSamples[ i ] ] );
+
+		__m128i* pDest = reinterpret_cast<__m128i*>( pBlockLights + i );
+
+		_mm_storeu_si128( pDest, _mm_add_epi32( _mm_loadu_si128( pDest ), MulLo32SSE2( gamma, vecScale ) ) );
+	}
+
+	AccumulateScalar( pBlockLights + i, pSamples + i, uiCount - i, pGammaTable, scale );
+}
+
+/**
+*	Converts 4 texels worth of block lights to 12 clamped bytes, in the low 12 bytes of the result.
+*/
+CPU_TARGET( "sse2" ) inline __m128i PackTexelsSSE2( const unsigned int* bl )
+{
+	const __m128i a = _mm_srli_epi32( _mm_loadu_si128( reinterpret_cast<const __m128i*>( bl ) ), 7 );
+	const __m128i b = _mm_srli_epi32( _mm_loadu_si128( reinterpret_cast<const __m128i*>( bl + 4 ) ), 7 );
+	const __m128i c = _mm_srli_epi32( _mm_loadu_si128( reinterpret_cast<const __m128i*>( bl + 8 ) ), 7 );
+
+	return _mm_packus_epi16( _mm_packs_epi32( a, b ), _mm_packs_epi32( c, c ) );
+}
+
+CPU_TARGET( "sse2" ) void StoreRGBASSE2( const unsigned int* pBlockLights, const int smax, const int tmax, uint8_t* pDest, const int stride )
+{
+	alignas( 16 ) uint8_t rgb[ 16 ];
+
+	for( int i = 0; i < tmax; ++i, pDest += stride )
+	{
+		uint8_t* dest = pDest;
+
+		int j = 0;
+
+		for( ; j + 4 <= smax; j += 4, pBlockLights += 12, dest += 16 )
+		{
+			_mm_store_si128( reinterpret_cast<__m128i*>( rgb ), PackTexelsSSE2( pBlockLights ) );
+
+			//No byte shuffle in SSE2; insert alpha while copying out.
+			for( size_t uiTexel = 0; uiTexel < 4; ++uiTexel )
+			{
+				dest[ uiTexel * 4 ] = rgb[ uiTexel * 3 ];
+				dest[ uiTexel * 4 + 1 ] = rgb[ uiTexel * 3 + 1 ];
+				dest[ uiTexel * 4 + 2 ] = rgb[ uiTexel * 3 + 2 ];
+				dest[ uiTexel * 4 + 3 ] = 255;
+			}
+		}
+
+		for( ; j < smax; ++j, pBlockLights += 3, dest += 4 )
+		{
+			StoreTexelScalar( pBlockLights, dest );
+		}
+	}
+}
+
+CPU_TARGET( "avx2" ) void AccumulateAVX2( unsigned int* pBlockLights, const uint8_t* pSamples, const size_t uiCount, const int* pGammaTable, const unsigned int scale )
+{
+	const __m256i vecScale = _mm256_set1_epi32( static_cast<int>( scale ) );
+
+	size_t i = 0;
+
+	for( ; i + 8 <= uiCount; i += 8 )
+	{
+		const __m256i indices = _mm256_cvtepu8_epi32( _mm_loadl_epi64( reinterpret_cast<const __m128i*>( pSamples + i ) ) );
+		const __m256i gamma = _mm256_i32gather_epi32( pGammaTable, indices, 4 );
+
+		__m256i* pDest = reinterpret_cast<__m256i*>( pBlockLights + i );
+
+		_mm256_storeu_si256( pDest, _mm256_add_epi32( _mm256_loadu_si256( pDest ), _mm256_mullo_epi32( gamma, vecScale ) ) );
+	}
+
+	AccumulateScalar( pBlockLights + i, pSamples + i, uiCount - i, pGammaTable, scale );
+}
+
+CPU_TARGET( "avx2" ) void StoreRGBAAVX2( const unsigned int* pBlockLights, const int smax, const int tmax, uint8_t* pDest, const int stride )
+{
+	//Spreads 4 RGB texels out to RGBA, leaving alpha zero.
+	const __m128i shuffle = _mm_setr_epi8( 0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1 );
+	const __m128i alpha = _mm_set1_epi32( static_cast<int>( 0xFF000000 ) );
+
+	for( int i = 0; i < tmax; ++i, pDest += stride )
+	{
+		uint8_t* dest = pDest;
+
+		int j = 0;
+
+		for( ; j + 4 <= smax; j += 4, pBlockLights += 12, dest += 16 )
+		{
+			const __m128i rgba = _mm_or_si128( _mm_shuffle_epi8( PackTexelsSSE2( pBlockLights ), shuffle ), alpha );
+
+			_mm_storeu_si128( reinterpret_cast<__m128i*>( dest ), rgba );
+		}
+
+		for( ; j < smax; ++j, pBlockLights += 3, dest += 4 )
+		{
+			StoreTexelScalar( pBlockLights, dest );
+		}
+	}
+}
+#endif
+
+struct LightmapKernels_t
+{
+	AccumulateFn accumulate;
+	StoreRGBAFn storeRGBA;
+};
+
+const LightmapKernels_t g_Kernels[] =
+{
+	{ &AccumulateScalar, &StoreRGBAScalar },
+#if CPU_X86
+	{ &AccumulateSSE2, &StoreRGBASSE2 },
+	{ &AccumulateAVX2, &StoreRGBAAVX2 }
+#else
+	{ nullptr, nullptr },
+	{ nullptr, nullptr }
+#endif
+};
+
+CSIMDDispatch<LightmapKernels_t> g_Dispatch( "Lightmap composition", g_Kernels );
+
+bool CompareKernels( const LightmapKernels_t& kernels, std::mt19937& random )
+{
+	std::uniform_int_distribution<int> byteDist( 0, 255 );
+
+	int gammaTable[ 256 ];
+
+	for( auto& gamma : gammaTable )
+		gamma = byteDist( random );
+
+	const int* const pGammaTable = gammaTable;
+
+	std::uniform_int_distribution<int> sizeDist( 1, 18 );
+	std::uniform_int_distribution<int> styleDist( 1, 4 );
+	//Covers the full range of style values, 'a' through 'z' at 22 per step, as well as overbright values.
+	std::uniform_int_distribution<unsigned int> scaleDist( 0, 1024 );
+
+	std::vector<uint8_t> samples;
+	std::vector<unsigned int> expectedLights, actualLights;
+	std::vector<uint8_t> expectedTexels, actualTexels;
+
+	for( int iTest = 0; iTest < 1000; ++iTest )
+	{
+		const int smax = sizeDist( random );
+		const int tmax = sizeDist( random );
+		const int iStyles = styleDist( random );
+
+		const size_t uiCount = static_cast<size_t>( smax * tmax * 3 );
+
+		samples.resize( uiCount * iStyles );
+
+		for( auto& sample : samples )
+			sample = static_cast<uint8_t>( byteDist( random ) );
+
+		expectedLights.assign( uiCount, 0 );
+		actualLights.assign( uiCount, 0 );
+
+		for( int iStyle = 0; iStyle < iStyles; ++iStyle )
+		{
+			const unsigned int scale = scaleDist( random );
+
+			AccumulateScalar( expectedLights.data(), samples.data() + uiCount * iStyle, uiCount, pGammaTable, scale );
+			kernels.accumulate( actualLights.data(), samples.data() + uiCount * iStyle, uiCount, pGammaTable, scale );
+		}
+
+		if( expectedLights != actualLights )
+			return false;
+
+		//Store into a wider page to check that the stride is respected and nothing outside the block is written.
+		const int stride = ( smax + 3 ) * 4;
+
+		expectedTexels.assign( stride * tmax, 0xCD );
+		actualTexels.assign( stride * tmax, 0xCD );
+
+		StoreRGBAScalar( expectedLights.data(), smax, tmax, expectedTexels.data(), stride );
+		kernels.storeRGBA( actualLights.data(), smax, tmax, actualTexels.data(), stride );
+
+		if( expectedTexels != actualTexels )
+			return false;
+	}
+
+	return true;
+}
+
+void Cmd_LightmapSIMD_f()
+{
+	g_Dispatch.Command();
+}
+
+void Cmd_LightmapVerify_f()
+{
+	if( VerifyLightmapSIMD() )
+		Msg( "Lightmap composition output matches for all supported instruction sets\n" );
+}
+}
+
+void InitLightmapCompose()
+{
+	g_Dispatch.SelectBest();
+
+	g_CVar.AddCommand( "r_lightmap_simd", &Cmd_LightmapSIMD_f );
+	g_CVar.AddCommand( "r_lightmap_verify", &Cmd_LightmapVerify_f );
+}
+
+void AccumulateLightmap( unsigned int* pBlockLights, const uint8_t* pSamples, const size_t uiCount, const int* pGammaTable, const unsigned int scale )
+{
+	assert( pBlockLights );
+	assert( pSamples );
+	assert( pGammaTable );
+
+	g_Dispatch.GetKernels().accumulate( pBlockLights, pSamples, uiCount, pGammaTable, scale );
+}
+
+void StoreLightmapRGBA( const unsigned int* pBlockLights, const int smax, const int tmax, uint8_t* pDest, const int stride )
+{
+	assert( pBlockLights );
+	assert( pDest );
+
+	g_Dispatch.GetKernels().storeRGBA( pBlockLights, smax, tmax, pDest, stride );
+}
+
+bool VerifyLightmapSIMD()
+{
+	bool bSuccess = true;
+
+	for( int iLevel = static_cast<int>( SIMDLevel::NONE ) + 1; iLevel < static_cast<int>( SIMDLevel::COUNT ); ++iLevel )
+	{
+		const auto level = static_cast<SIMDLevel>( iLevel );
+
+		if( !IsSIMDLevelSupported( level ) )
+			continue;
+
+		//Same seed for each so failures are reproducible.
+		std::mt19937 random( 0 );
+
+		if( !CompareKernels( g_Dispatch.GetKernels( level ), random ) )
+		{
+			Warning( "Lightmap composition using %s does not match the scalar output\n", SIMDLevelToString( level ) );
+			bSuccess = false;
+		}
+	}
+
+	return bSuccess;
+}
+}
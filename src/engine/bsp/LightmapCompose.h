@@ -0,0 +1,48 @@
+#ifndef ENGINE_BSP_LIGHTMAPCOMPOSE_H
+#define ENGINE_BSP_LIGHTMAPCOMPOSE_H
+
+/**
+*	@file Lightmap composition kernels.
+*	Accumulates lightstyle layers into 8.8 block lights and packs them into RGBA lightmap pages.
+*	SSE2 and AVX2 versions are selected at runtime, and produce the exact same output as the scalar version.
+*/
+
+#include <cstddef>
+#include <cstdint>
+
+namespace BSP
+{
+/**
+*	Selects the best supported instruction set, unless -nosimd was passed on the command line, and registers console commands.
+*	r_lightmap_simd shows or overrides the selection.
+*/
+void InitLightmapCompose();
+
+/**
+*	Adds a lightstyle layer to the block lights: pBlockLights[ i ] += pGammaTable[ pSamples[ i ] ] * scale.
+*	@param pBlockLights Block lights to add to.
+*	@param pSamples Lightmap samples for this layer.
+*	@param uiCount Number of values. This is 3 times the number of texels.
+*	@param pGammaTable 256 entry gamma table.
+*	@param scale 8.8 lightstyle value.
+*/
+void AccumulateLightmap( unsigned int* pBlockLights, const uint8_t* pSamples, const size_t uiCount, const int* pGammaTable, const unsigned int scale );
+
+/**
+*	Shifts block lights down to 8 bits, clamps them and writes them as RGBA texels with alpha set to 255.
+*	@param pBlockLights Block lights. smax * tmax * 3 values.
+*	@param smax Width in texels.
+*	@param tmax Height in texels.
+*	@param pDest Destination texel.
+*	@param stride Number of bytes between rows in the destination.
+*/
+void StoreLightmapRGBA( const unsigned int* pBlockLights, const int smax, const int tmax, uint8_t* pDest, const int stride );
+
+/**
+*	Runs every supported instruction set on random data and compares the output against the scalar version.
+*	@return Whether all supported instruction sets produced identical output.
+*/
+bool VerifyLightmapSIMD();
+}
+
+#endif //ENGINE_BSP_LIGHTMAPCOMPOSE_H
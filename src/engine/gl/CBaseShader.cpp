@@ -11,4 +11,11 @@ CBaseShader::CBaseShader()
 {
 	m_pNext = m_pHead;
 	m_pHead = this;
+}
+
+void CBaseShader::OnDrawElements( CShaderInstance*, const size_t uiNumIndices, const size_t uiFirstIndex )
+{
+	glDrawElements( GL_TRIANGLES, uiNumIndices, GL_UNSIGNED_INT, reinterpret_cast<void*>( uiFirstIndex * sizeof( GLuint ) ) );
+
+	check_gl_error();
 }
\ No newline at end of file
@@ -242,6 +242,14 @@ public:
 
 	virtual void OnDraw( CShaderInstance* pInstance, const size_t uiNumVerts ) = 0;
 
+	/**
+	*	Draws indexed triangles from the bound element array buffer.
+	*	@param pInstance Shader instance.
+	*	@param uiNumIndices Number of indices to draw.
+	*	@param uiFirstIndex Index of the first index in the element array buffer.
+	*/
+	virtual void OnDrawElements( CShaderInstance* pInstance, const size_t uiNumIndices, const size_t uiFirstIndex );
+
 private:
 	static CBaseShader* m_pHead;
 	CBaseShader* m_pNext;
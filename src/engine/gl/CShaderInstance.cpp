@@ -271,6 +271,11 @@ void CShaderInstance::Draw( const size_t uiNumVerts )
 	m_pShader->OnDraw( this, uiNumVerts );
 }
 
+void CShaderInstance::DrawElements( const size_t uiNumIndices, const size_t uiFirstIndex )
+{
+	m_pShader->OnDrawElements( this, uiNumIndices, uiFirstIndex );
+}
+
 void CShaderInstance::OnPreLink()
 {
 	const size_t uiCount = m_pShader->GetNumOutputs();
@@ -61,6 +61,11 @@ public:
 	*/
 	void Draw( const size_t uiNumVerts );
 
+	/**
+	*	Draw indexed triangles from the bound element array buffer.
+	*/
+	void DrawElements( const size_t uiNumIndices, const size_t uiFirstIndex );
+
 	const GLint* GetAttributes() const { return m_pAttributes; }
 
 	const GLint* GetUniforms() const { return m_pUniforms; }
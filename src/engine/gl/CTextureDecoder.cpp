@@ -0,0 +1,136 @@
+#include <algorithm>
+#include <cassert>
+
+#include "CTextureDecoder.h"
+
+const size_t CTextureDecoder::MAX_WORKERS;
+const size_t CTextureDecoder::MAX_DECODED_AHEAD;
+
+size_t CTextureDecoder::GetDefaultNumWorkers()
+{
+	return std::max( static_cast<size_t>( 1 ), std::min( static_cast<size_t>( std::thread::hardware_concurrency() ), MAX_WORKERS ) );
+}
+
+CTextureDecoder::~CTextureDecoder()
+{
+	Finish();
+}
+
+void CTextureDecoder::Start( std::vector<const miptex_t*>&& miptex, const int iNumWorkers )
+{
+	Finish();
+
+	m_Jobs.resize( miptex.size() );
+
+	for( size_t uiIndex = 0; uiIndex < miptex.size(); ++uiIndex )
+		m_Jobs[ uiIndex ].pMiptex = miptex[ uiIndex ];
+
+	m_bShutdown = false;
+	m_uiNextJob = 0;
+	m_uiTaken = 0;
+
+	const size_t uiNumWorkers = std::min( iNumWorkers < 0 ? GetDefaultNumWorkers() : std::min( static_cast<size_t>( iNumWorkers ), MAX_WORKERS ), m_Jobs.size() );
+
+	for( size_t uiIndex = 0; uiIndex < uiNumWorkers; ++uiIndex )
+		m_Workers.emplace_back( &CTextureDecoder::WorkerMain, this );
+}
+
+bool CTextureDecoder::TakeImage( const size_t uiIndex, MiptexImage_t& image )
+{
+	assert( uiIndex == m_uiTaken );
+
+	if( uiIndex != m_uiTaken || uiIndex >= m_Jobs.size() )
+		return false;
+
+	auto& job = m_Jobs[ uiIndex ];
+
+	std::unique_lock<std::mutex> lock( m_Mutex );
+
+	if( m_Workers.empty() )
+	{
+		//No workers; decode it here.
+		m_uiNextJob = uiIndex + 1;
+
+		lock.unlock();
+
+		job.state = Decode( job );
+
+		lock.lock();
+	}
+	else
+	{
+		m_ImageReady.wait( lock, [ &job ]()
+		{
+			return job.state != State::PENDING;
+		} );
+	}
+
+	++m_uiTaken;
+
+	const bool bSuccess = job.state == State::DONE;
+
+	image = std::move( job.image );
+
+	lock.unlock();
+
+	//Room for another image to be decoded ahead.
+	m_WorkAvailable.notify_one();
+
+	return bSuccess;
+}
+
+void CTextureDecoder::Finish()
+{
+	{
+		std::lock_guard<std::mutex> lock( m_Mutex );
+
+		m_bShutdown = true;
+	}
+
+	m_WorkAvailable.notify_all();
+
+	for( auto& worker : m_Workers )
+		worker.join();
+
+	m_Workers.clear();
+
+	m_Jobs.clear();
+	m_Jobs.shrink_to_fit();
+}
+
+CTextureDecoder::State CTextureDecoder::Decode( Job_t& job )
+{
+	if( !job.pMiptex )
+		return State::FAILED;
+
+	return ConvertMiptex( job.pMiptex, job.image ) ? State::DONE : State::FAILED;
+}
+
+void CTextureDecoder::WorkerMain()
+{
+	std::unique_lock<std::mutex> lock( m_Mutex );
+
+	while( true )
+	{
+		m_WorkAvailable.wait( lock, [ this ]()
+		{
+			return m_bShutdown || m_uiNextJob >= m_Jobs.size() || m_uiNextJob < m_uiTaken + MAX_DECODED_AHEAD;
+		} );
+
+		if( m_bShutdown || m_uiNextJob >= m_Jobs.size() )
+			return;
+
+		auto& job = m_Jobs[ m_uiNextJob++ ];
+
+		//Nothing else touches the job until it's marked as done, so it can be decoded without holding the lock.
+		lock.unlock();
+
+		const State state = Decode( job );
+
+		lock.lock();
+
+		job.state = state;
+
+		m_ImageReady.notify_all();
+	}
+}
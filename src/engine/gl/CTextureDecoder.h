@@ -0,0 +1,122 @@
+#ifndef GL_CTEXTUREDECODER_H
+#define GL_CTEXTUREDECODER_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "GLMiptex.h"
+
+/**
+*	Converts miptex to RGBA images on a pool of worker threads, so that they can be uploaded one after the other as they become ready.
+*	Workers only run ConvertMiptex on data that was resolved by the caller, so no GL context is needed to decode images.
+*	All methods must be called from the same thread.
+*/
+class CTextureDecoder final
+{
+public:
+	/**
+	*	Maximum number of worker threads.
+	*/
+	static const size_t MAX_WORKERS = 16;
+
+	/**
+	*	Maximum number of images that can be decoded but not yet taken. Limits how much memory decoding ahead can use.
+	*/
+	static const size_t MAX_DECODED_AHEAD = 32;
+
+	/**
+	*	@return Number of workers to use by default: one for each core, up to MAX_WORKERS.
+	*/
+	static size_t GetDefaultNumWorkers();
+
+public:
+	CTextureDecoder() = default;
+	~CTextureDecoder();
+
+	/**
+	*	Starts decoding the given miptex. Any previous decode is finished first.
+	*	@param miptex Textures to decode. Null entries fail to decode. The data must stay valid until Finish is called.
+	*	@param iNumWorkers Number of worker threads. If negative, uses GetDefaultNumWorkers.
+	*		If 0, no threads are started, and each image is decoded by TakeImage.
+	*/
+	void Start( std::vector<const miptex_t*>&& miptex, const int iNumWorkers );
+
+	/**
+	*	@return Number of images that are being decoded.
+	*/
+	size_t GetNumImages() const { return m_Jobs.size(); }
+
+	/**
+	*	@return Number of worker threads that were started.
+	*/
+	size_t GetNumWorkers() const { return m_Workers.size(); }
+
+	/**
+	*	Waits for an image to be decoded and takes it. Images must be taken in order, starting at 0.
+	*	@param uiIndex Index of the image.
+	*	@param[ out ] image Decoded image.
+	*	@return Whether the miptex was decoded.
+	*/
+	bool TakeImage( const size_t uiIndex, MiptexImage_t& image );
+
+	/**
+	*	Stops all workers. Images that haven't been taken are discarded.
+	*/
+	void Finish();
+
+private:
+	enum class State
+	{
+		PENDING,
+		DONE,
+		FAILED
+	};
+
+	struct Job_t
+	{
+		const miptex_t* pMiptex = nullptr;
+
+		State state = State::PENDING;
+
+		MiptexImage_t image;
+	};
+
+	/**
+	*	Decodes a job. The job must have been handed out to the caller, so the lock need not be held.
+	*/
+	static State Decode( Job_t& job );
+
+	void WorkerMain();
+
+private:
+	std::mutex m_Mutex;
+
+	std::condition_variable m_WorkAvailable;
+
+	std::condition_variable m_ImageReady;
+
+	std::vector<std::thread> m_Workers;
+
+	bool m_bShutdown = false;
+
+	std::vector<Job_t> m_Jobs;
+
+	/**
+	*	Index of the next job to hand out to a worker.
+	*/
+	size_t m_uiNextJob = 0;
+
+	/**
+	*	Number of images that have been taken.
+	*/
+	size_t m_uiTaken = 0;
+
+private:
+	CTextureDecoder( const CTextureDecoder& ) = delete;
+	CTextureDecoder& operator=( const CTextureDecoder& ) = delete;
+};
+
+#endif //GL_CTEXTUREDECODER_H
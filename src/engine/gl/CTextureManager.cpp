@@ -76,41 +76,59 @@ texture_t* CTextureManager::FindTexture( const char* const pszName )
 	return const_cast<texture_t*>( const_cast<const CTextureManager*>( this )->FindTexture( pszName ) );
 }
 
-texture_t* CTextureManager::LoadTexture( const char* const pszName, const miptex_t* pMiptex )
+const miptex_t* CTextureManager::FindMiptex( const char* const pszName, const miptex_t* pMiptex ) const
 {
 	assert( pszName );
 
 	if( !pszName )
 		return nullptr;
 
-	if( auto pTexture = FindTexture( pszName ) )
-		return pTexture;
-
 	const size_t uiLength = strlen( pszName );
 
 	//Should never happen since all textures come from lumps.
 	if( uiLength >= WAD_MAX_LUMP_NAME_SIZE )
 	{
-		printf( "CTextureManager::LoadTexture: Texture name too long (max %u, got %u)\n", WAD_MAX_LUMP_NAME_SIZE, uiLength );
+		printf( "CTextureManager::FindMiptex: Texture name too long (max %u, got %u)\n", WAD_MAX_LUMP_NAME_SIZE, static_cast<unsigned int>( uiLength ) );
 		return nullptr;
 	}
 
-	if( m_uiTexturesInUse >= m_Textures.size() )
+	if( !pMiptex )
+		pMiptex = g_WadManager.FindTextureByName( pszName );
+
+	if( !pMiptex )
 	{
-		printf( "CTextureManager::LoadTexture: Out of texture IDs (max: %u)\n", m_Textures.size() );
+		printf( "CTextureManager::FindMiptex: Couldn't find texture \"%s\"\n", pszName );
 		return nullptr;
 	}
 
-	if( !pMiptex )
-		pMiptex = g_WadManager.FindTextureByName( pszName );
+	return pMiptex;
+}
 
-	if( !pMiptex )
+texture_t* CTextureManager::AddTexture( const char* const pszName, const miptex_t& miptex, const MiptexImage_t& image )
+{
+	assert( pszName );
+
+	if( !pszName )
+		return nullptr;
+
+	if( auto pTexture = FindTexture( pszName ) )
+		return pTexture;
+
+	const size_t uiLength = strlen( pszName );
+
+	if( uiLength >= WAD_MAX_LUMP_NAME_SIZE )
+	{
+		printf( "CTextureManager::AddTexture: Texture name too long (max %u, got %u)\n", WAD_MAX_LUMP_NAME_SIZE, static_cast<unsigned int>( uiLength ) );
+		return nullptr;
+	}
+
+	if( m_uiTexturesInUse >= m_Textures.size() )
 	{
-		printf( "CTextureManager::LoadTexture: Couldn't find texture \"%s\"\n", pszName );
+		printf( "CTextureManager::AddTexture: Out of texture IDs (max: %u)\n", static_cast<unsigned int>( m_Textures.size() ) );
 		return nullptr;
 	}
 
-	GLuint tex = UploadMiptex( pMiptex );
+	GLuint tex = UploadMiptexImage( image );
 
 	if( tex == 0 )
 		return nullptr;
@@ -122,8 +140,8 @@ texture_t* CTextureManager::LoadTexture( const char* const pszName, const miptex
 	//Length checked earlier.
 	strcpy( pTexture->name, pszName );
 
-	pTexture->width = pMiptex->width;
-	pTexture->height = pMiptex->height;
+	pTexture->width = miptex.width;
+	pTexture->height = miptex.height;
 
 	pTexture->gl_texturenum = tex;
 
@@ -147,7 +165,7 @@ texture_t* CTextureManager::LoadTexture( const char* const pszName, const miptex
 	if( !result.second )
 	{
 		//Insertion failed; remove texture.
-		printf( "CTextureManager::LoadTexture: Failed to insert texture \"%s\" into map\n", pszName );
+		printf( "CTextureManager::AddTexture: Failed to insert texture \"%s\" into map\n", pszName );
 		glDeleteTextures( 1, &pTexture->gl_texturenum );
 
 		memset( pTexture, 0, sizeof( texture_t ) );
@@ -159,6 +177,35 @@ texture_t* CTextureManager::LoadTexture( const char* const pszName, const miptex
 	return pTexture;
 }
 
+texture_t* CTextureManager::LoadTexture( const char* const pszName, const miptex_t* pMiptex )
+{
+	assert( pszName );
+
+	if( !pszName )
+		return nullptr;
+
+	if( auto pTexture = FindTexture( pszName ) )
+		return pTexture;
+
+	if( m_uiTexturesInUse >= m_Textures.size() )
+	{
+		printf( "CTextureManager::LoadTexture: Out of texture IDs (max: %u)\n", static_cast<unsigned int>( m_Textures.size() ) );
+		return nullptr;
+	}
+
+	pMiptex = FindMiptex( pszName, pMiptex );
+
+	if( !pMiptex )
+		return nullptr;
+
+	MiptexImage_t image;
+
+	if( !ConvertMiptex( pMiptex, image ) )
+		return nullptr;
+
+	return AddTexture( pszName, *pMiptex, image );
+}
+
 //TODO: define this elsewhere - Solokiller
 #define	ANIM_CYCLE	2
 
@@ -11,6 +11,7 @@
 #include "bsp/BSPRenderDefs.h"
 
 struct miptex_t;
+struct MiptexImage_t;
 
 /**
 *	Manages all textures used by the map.
@@ -76,6 +77,24 @@ public:
 	*/
 	texture_t* FindTexture( const char* const pszName );
 
+	/**
+	*	Finds the data to load a texture from. Does not require a GL context.
+	*	@param pszName Name of the texture.
+	*	@param pMiptex Optional. Texture data to use. If null, the texture is looked up in the loaded wads.
+	*	@return Texture data, or null if the texture could not be found.
+	*/
+	const miptex_t* FindMiptex( const char* const pszName, const miptex_t* pMiptex = nullptr ) const;
+
+	/**
+	*	Adds a new texture from an image that was converted from the given miptex.
+	*	@param pszName Name of the texture.
+	*	@param miptex Texture data that the image was converted from.
+	*	@param image Converted image to upload.
+	*	@return Texture, or null if the texture could not be added. If a texture with the given name already exists, that texture.
+	*	@see ConvertMiptex
+	*/
+	texture_t* AddTexture( const char* const pszName, const miptex_t& miptex, const MiptexImage_t& image );
+
 	/**
 	*	Loads a new texture. If pMiptex is not null, uses it as a source to load the texture.
 	*	@param pszName Name of the texture.
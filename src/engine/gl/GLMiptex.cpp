@@ -1,9 +1,11 @@
 #include <cassert>
 #include <cstdint>
+#include <cstdio>
 #include <cstring>
 #include <memory>
 
 #include "GLUtil.h"
+#include "ImageProcessing.h"
 
 #include "GLMiptex.h"
 
@@ -138,21 +140,11 @@ bool CalculateImageDimensions( const int iWidth, const int iHeight, int& iOutWid
 	return true;
 }
 
-GLuint UploadMiptex( const miptex_t* pMiptex )
+bool ConvertMiptex( const miptex_t* pMiptex, MiptexImage_t& image )
 {
 	assert( pMiptex );
 
-	GLuint tex;
-
-	glGenTextures( 1, &tex );
-
-	check_gl_error();
-
-	glBindTexture( GL_TEXTURE_2D, tex );
-
-	check_gl_error();
-
-	uint8_t rgba[ PALETTE_ENTRIES * 4 ];
+	uint32_t rgba[ PALETTE_ENTRIES ];
 
 	const uint8_t* pBase = reinterpret_cast<const uint8_t*>( pMiptex );
 
@@ -171,66 +163,83 @@ GLuint UploadMiptex( const miptex_t* pMiptex )
 	if( pMiptex->name[ 0 ] == '{' )
 		format = TexFormat_t::SPR_ALPHTEST;
 
-	Convert8To32Bit( pPal, rgba, format );
+	Convert8To32Bit( pPal, reinterpret_cast<uint8_t*>( rgba ), format );
 
 	// convert texture to power of 2. Otherwise it ends up having weird lines.
 	int outwidth;
 	int outheight;
 
 	if( !CalculateImageDimensions( pMiptex->width, pMiptex->height, outwidth, outheight ) )
-		return 0;
+		return false;
 
-	const size_t uiSize = outwidth * outheight * 4;
+	image.iWidth = outwidth;
+	image.iHeight = outheight;
 
-	//Needs at least one pixel (satisfies code analysis)
-	if( uiSize < 4 )
-		return 0;
+	//Stop at the last level that is at least one texel in both dimensions.
+	image.iNumLevels = 1;
+
+	while( image.iNumLevels < MIPLEVELS && ( outwidth >> image.iNumLevels ) > 0 && ( outheight >> image.iNumLevels ) > 0 )
+		++image.iNumLevels;
 
-	std::unique_ptr<uint8_t[]> image = std::make_unique<uint8_t[]>( uiSize );
+	size_t uiSize = 0;
 
-	if( !image )
+	for( int iLevel = 0; iLevel < image.iNumLevels; ++iLevel )
 	{
-		return 0;
+		image.levelOffsets[ iLevel ] = uiSize;
+		uiSize += image.GetLevelWidth( iLevel ) * image.GetLevelHeight( iLevel ) * 4;
 	}
 
-	int row1[ MAX_TEXTURE_DIMS ], row2[ MAX_TEXTURE_DIMS ], col1[ MAX_TEXTURE_DIMS ], col2[ MAX_TEXTURE_DIMS ];
+	image.data.reset( new uint8_t[ uiSize ] );
+
+	const bool bRescaled = outwidth != static_cast<int>( pMiptex->width ) || outheight != static_cast<int>( pMiptex->height );
 
-	for( int i = 0; i < outwidth; i++ )
+	if( !bRescaled )
 	{
-		col1[ i ] = ( int ) ( ( i + 0.25 ) * ( pMiptex->width / ( float ) outwidth ) );
-		col2[ i ] = ( int ) ( ( i + 0.75 ) * ( pMiptex->width / ( float ) outwidth ) );
+		//The stored mip levels can be used as is.
+		for( int iLevel = 0; iLevel < image.iNumLevels; ++iLevel )
+		{
+			ExpandPalette( pBase + pMiptex->offsets[ iLevel ], image.GetLevelWidth( iLevel ) * image.GetLevelHeight( iLevel ), rgba, image.GetLevel( iLevel ) );
+		}
+
+		return true;
 	}
 
-	for( int i = 0; i < outheight; i++ )
+	const uint8_t* pPixelData = reinterpret_cast<const uint8_t*>( pBase + pMiptex->offsets[ 0 ] );
+
+	// scale down and convert to 32bit RGBA
+	ResampleIndexed( pPixelData, pMiptex->width, pMiptex->height, rgba, image.GetLevel( 0 ), outwidth, outheight );
+
+	//The stored levels don't match the new size, so build the rest of the chain from the resampled image.
+	for( int iLevel = 1; iLevel < image.iNumLevels; ++iLevel )
 	{
-		row1[ i ] = ( int ) ( ( i + 0.25 ) * ( pMiptex->height / ( float ) outheight ) ) * pMiptex->width;
-		row2[ i ] = ( int ) ( ( i + 0.75 ) * ( pMiptex->height / ( float ) outheight ) ) * pMiptex->width;
+		DownsampleRGBA( image.GetLevel( iLevel - 1 ), image.GetLevelWidth( iLevel - 1 ), image.GetLevelHeight( iLevel - 1 ), image.GetLevel( iLevel ) );
 	}
 
-	uint8_t* out = image.get();
+	return true;
+}
+
+GLuint UploadMiptexImage( const MiptexImage_t& image )
+{
+	GLuint tex;
 
-	const uint8_t	*pix1, *pix2, *pix3, *pix4;
+	glGenTextures( 1, &tex );
 
-	const uint8_t* pPixelData = reinterpret_cast<const uint8_t*>( pBase + pMiptex->offsets[ 0 ] );
+	check_gl_error();
 
-	// scale down and convert to 32bit RGBA
-	for( int i = 0; i<outheight; i++ )
+	glBindTexture( GL_TEXTURE_2D, tex );
+
+	check_gl_error();
+
+	for( int iLevel = 0; iLevel < image.iNumLevels; ++iLevel )
 	{
-		for( int j = 0; j<outwidth; j++, out += 4 )
-		{
-			pix1 = &rgba[ pPixelData[ row1[ i ] + col1[ j ] ] * 4 ];
-			pix2 = &rgba[ pPixelData[ row1[ i ] + col2[ j ] ] * 4 ];
-			pix3 = &rgba[ pPixelData[ row2[ i ] + col1[ j ] ] * 4 ];
-			pix4 = &rgba[ pPixelData[ row2[ i ] + col2[ j ] ] * 4 ];
-
-			out[ 0 ] = ( pix1[ 0 ] + pix2[ 0 ] + pix3[ 0 ] + pix4[ 0 ] ) >> 2;
-			out[ 1 ] = ( pix1[ 1 ] + pix2[ 1 ] + pix3[ 1 ] + pix4[ 1 ] ) >> 2;
-			out[ 2 ] = ( pix1[ 2 ] + pix2[ 2 ] + pix3[ 2 ] + pix4[ 2 ] ) >> 2;
-			out[ 3 ] = ( pix1[ 3 ] + pix2[ 3 ] + pix3[ 3 ] + pix4[ 3 ] ) >> 2;
-		}
+		glTexImage2D( GL_TEXTURE_2D, iLevel, GL_RGBA, image.GetLevelWidth( iLevel ), image.GetLevelHeight( iLevel ), 0, GL_RGBA, GL_UNSIGNED_BYTE, image.GetLevel( iLevel ) );
 	}
 
-	glTexImage2D( GL_TEXTURE_2D, 0, GL_RGBA, outwidth, outheight, 0, GL_RGBA, GL_UNSIGNED_BYTE, image.get() );
+	check_gl_error();
+
+	//Only the levels that were uploaded are used, so the texture is complete without a full chain.
+	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0 );
+	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, image.iNumLevels - 1 );
 
 	check_gl_error();
 
@@ -248,9 +257,17 @@ GLuint UploadMiptex( const miptex_t* pMiptex )
 
 	check_gl_error();
 
-	glGenerateMipmap( GL_TEXTURE_2D );
+	return tex;
+}
 
-	check_gl_error();
+GLuint UploadMiptex( const miptex_t* pMiptex )
+{
+	assert( pMiptex );
 
-	return tex;
-}
\ No newline at end of file
+	MiptexImage_t image;
+
+	if( !ConvertMiptex( pMiptex, image ) )
+		return 0;
+
+	return UploadMiptexImage( image );
+}
@@ -1,10 +1,64 @@
 #ifndef GL_GLMIPTEX_H
 #define GL_GLMIPTEX_H
 
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
 #include <gl/glew.h>
 
 #include "wad/WadFile.h"
 
+/**
+*	A miptex converted to RGBA, along with its mip levels.
+*	Level 0 is a power of 2 in size, and each level after that is half the size of the one before it.
+*/
+struct MiptexImage_t
+{
+	int iWidth = 0;
+	int iHeight = 0;
+
+	int iNumLevels = 0;
+
+	/**
+	*	Offset of each level in data.
+	*/
+	size_t levelOffsets[ MIPLEVELS ] = {};
+
+	/**
+	*	All levels, one after the other.
+	*/
+	std::unique_ptr<uint8_t[]> data;
+
+	int GetLevelWidth( const int iLevel ) const { return iWidth >> iLevel; }
+
+	int GetLevelHeight( const int iLevel ) const { return iHeight >> iLevel; }
+
+	uint8_t* GetLevel( const int iLevel ) { return data.get() + levelOffsets[ iLevel ]; }
+
+	const uint8_t* GetLevel( const int iLevel ) const { return data.get() + levelOffsets[ iLevel ]; }
+};
+
+/**
+*	Converts a miptex to RGBA. Does not require a GL context.
+*	The mip levels stored in the miptex are used if the texture is not rescaled to a power of 2 size,
+*	otherwise they are built from the rescaled image.
+*	@param pMiptex Miptex to convert.
+*	@param[ out ] image Converted image.
+*	@return Whether the miptex was converted.
+*/
+bool ConvertMiptex( const miptex_t* pMiptex, MiptexImage_t& image );
+
+/**
+*	Uploads a converted miptex, including its mip levels.
+*	@return Texture name.
+*/
+GLuint UploadMiptexImage( const MiptexImage_t& image );
+
+/**
+*	Converts and uploads a miptex.
+*	@return Texture name, or 0 if the miptex couldn't be converted.
+*/
 GLuint UploadMiptex( const miptex_t* pMiptex );
 
-#endif //GL_GLMIPTEX_H
\ No newline at end of file
+#endif //GL_GLMIPTEX_H
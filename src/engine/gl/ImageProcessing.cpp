@@ -0,0 +1,504 @@
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "Common.h"
+#include "Logging.h"
+
+#include "Engine.h"
+#include "CSIMDDispatch.h"
+
+#include "ImageProcessing.h"
+
+namespace
+{
+typedef void ( *ExpandFn )( const uint8_t* pIndices, const size_t uiCount, const uint32_t* pPalette, uint8_t* pDest );
+
+/**
+*	Resamples one row. pRow1 and pRow2 are the two source rows, pCol1 and pCol2 the two source columns of each destination texel.
+*/
+typedef void ( *ResampleRowFn )( const uint8_t* pRow1, const uint8_t* pRow2, const int* pCol1, const int* pCol2,
+								 const int iOutWidth, const uint32_t* pPalette, uint8_t* pDest );
+
+/**
+*	Downsamples one row. pRow1 and pRow2 are the two source rows, uiPairOffset the offset in bytes from each source texel to its right neighbour.
+*/
+typedef void ( *DownsampleRowFn )( const uint8_t* pRow1, const uint8_t* pRow2, const size_t uiPairOffset, const int iOutWidth, uint8_t* pDest );
+
+/**
+*	Scalar versions. These define the expected output for the other versions.
+*/
+void ExpandScalar( const uint8_t* pIndices, const size_t uiCount, const uint32_t* pPalette, uint8_t* pDest )
+{
+	for( size_t i = 0; i < uiCount; ++i, pDest += 4 )
+	{
+		memcpy( pDest, &pPalette[ pIndices[ i ] ], 4 );
+	}
+}
+
+void ResampleRowScalar( const uint8_t* pRow1, const uint8_t* pRow2, const int* pCol1, const int* pCol2,
+						const int iOutWidth, const uint32_t* pPalette, uint8_t* pDest )
+{
+	for( int j = 0; j < iOutWidth; ++j, pDest += 4 )
+	{
+		const uint8_t* pix1 = reinterpret_cast<const uint8_t*>( &pPalette[ pRow1[ pCol1[ j ] ] ] );
+		const uint8_t* pix2 = reinterpret_cast<const uint8_t*>( &pPalette[ pRow1[ pCol2[ j ] ] ] );
+		const uint8_t* pix3 = reinterpret_cast<const uint8_t*>( &pPalette[ pRow2[ pCol1[ j ] ] ] );
+		const uint8_t* pix4 = reinterpret_cast<const uint8_t*>( &pPalette[ pRow2[ pCol2[ j ] ] ] );
+
+		pDest[ 0 ] = ( pix1[ 0 ] + pix2[ 0 ] + pix3[ 0 ] + pix4[ 0 ] ) >> 2;
+		pDest[ 1 ] = ( pix1[ 1 ] + pix2[ 1 ] + pix3[ 1 ] + pix4[ 1 ] ) >> 2;
+		pDest[ 2 ] = ( pix1[ 2 ] + pix2[ 2 ] + pix3[ 2 ] + pix4[ 2 ] ) >> 2;
+		pDest[ 3 ] = ( pix1[ 3 ] + pix2[ 3 ] + pix3[ 3 ] + pix4[ 3 ] ) >> 2;
+	}
+}
+
+void DownsampleRowScalar( const uint8_t* pRow1, const uint8_t* pRow2, const size_t uiPairOffset, const int iOutWidth, uint8_t* pDest )
+{
+	for( int j = 0; j < iOutWidth; ++j, pRow1 += 8, pRow2 += 8, pDest += 4 )
+	{
+		for( size_t uiChannel = 0; uiChannel < 4; ++uiChannel )
+		{
+			pDest[ uiChannel ] = ( pRow1[ uiChannel ] + pRow1[ uiPairOffset + uiChannel ] + pRow2[ uiChannel ] + pRow2[ uiPairOffset + uiChannel ] ) >> 2;
+		}
+	}
+}
+
+#if CPU_X86
+/*
+*	The sum of 4 bytes fits in 16 bits, so the averages are computed exactly by widening to 16 bits, adding, shifting and packing back down.
+*/
+
+CPU_TARGET( "sse2" ) inline __m128i Average4SSE2( const __m128i a, const __m128i b, const __m128i c, const __m128i d )
+{
+	const __m128i zero = _mm_setzero_si128();
+
+	__m128i lo = _mm_add_epi16( _mm_unpacklo_epi8( a, zero ), _mm_unpacklo_epi8( b, zero ) );
+	lo = _mm_add_epi16( lo, _mm_add_epi16( _mm_unpacklo_epi8( c, zero ), _mm_unpacklo_epi8( d, zero ) ) );
+
+	__m128i hi = _mm_add_epi16( _mm_unpackhi_epi8( a, zero ), _mm_unpackhi_epi8( b, zero ) );
+	hi = _mm_add_epi16( hi, _mm_add_epi16( _mm_unpackhi_epi8( c, zero ), _mm_unpackhi_epi8( d, zero ) ) );
+
+	return _mm_packus_epi16( _mm_srli_epi16( lo, 2 ), _mm_srli_epi16( hi, 2 ) );
+}
+
+CPU_TARGET( "sse2" ) void ExpandSSE2( const uint8_t* pIndices, const size_t uiCount, const uint32_t* pPalette, uint8_t* pDest )
+{
+	size_t i = 0;
+
+	for( ; i + 4 <= uiCount; i += 4 )
+	{
+		//No gather in SSE2; the table lookups are scalar.
+		const __m128i texels = _mm_set_epi32(
+			pPalette[ pIndices[ i + 3 ] ], pPalette[ pIndices[ i + 2 ] ],
+			pPalette[ pIndices[ i + 1 ] ], pPalette[ pIndices[ i ] ] );
+
+		_mm_storeu_si128( reinterpret_cast<__m128i*>( pDest + i * 4 ), texels );
+	}
+
+	ExpandScalar( pIndices + i, uiCount - i, pPalette, pDest + i * 4 );
+}
+
+CPU_TARGET( "sse2" ) void ResampleRowSSE2( const uint8_t* pRow1, const uint8_t* pRow2, const int* pCol1, const int* pCol2,
+											const int iOutWidth, const uint32_t* pPalette, uint8_t* pDest )
+{
+	int j = 0;
+
+	for( ; j + 4 <= iOutWidth; j += 4 )
+	{
+		const __m128i pix1 = _mm_set_epi32(
+			pPalette[ pRow1[ pCol1[ j + 3 ] ] ], pPalette[ pRow1[ pCol1[ j + 2 ] ] ],
+			pPalette[ pRow1[ pCol1[ j + 1 ] ] ], pPalette[ pRow1[ pCol1[ j ] ] ] );
+		const __m128i pix2 = _mm_set_epi32(
+			pPalette[ pRow1[ pCol2[ j + 3 ] ] ], pPalette[ pRow1[ pCol2[ j + 2 ] ] ],
+			pPalette[ pRow1[ pCol2[ j + 1 ] ] ], pPalette[ pRow1[ pCol2[ j ] ] ] );
+		const __m128i pix3 = _mm_set_epi32(
+			pPalette[ pRow2[ pCol1[ j + 3 ] ] ], pPalette[ pRow2[ pCol1[ j + 2 ] ] ],
+			pPalette[ pRow2[ pCol1[ j + 1 ] ] ], pPalette[ pRow2[ pCol1[ j ] ] ] );
+		const __m128i pix4 = _mm_set_epi32(
+			pPalette[ pRow2[ pCol2[ j + 3 ] ] ], pPalette[ pRow2[ pCol2[ j + 2 ] ] ],
+			pPalette[ pRow2[ pCol2[ j + 1 ] ] ], pPalette[ pRow2[ pCol2[ j ] ] ] );
+
+		_mm_storeu_si128( reinterpret_cast<__m128i*>( pDest + j * 4 ), Average4SSE2( pix1, pix2, pix3, pix4 ) );
+	}
+
+	ResampleRowScalar( pRow1, pRow2, pCol1 + j, pCol2 + j, iOutWidth - j, pPalette, pDest + j * 4 );
+}
+
+/**
+*	Splits 8 texels into the even and odd texels.
+*/
+CPU_TARGET( "sse2" ) inline void DeinterleaveSSE2( const uint8_t* pTexels, __m128i& even, __m128i& odd )
+{
+	const __m128 a = _mm_castsi128_ps( _mm_loadu_si128( reinterpret_cast<const __m128i*>( pTexels ) ) );
+	const __m128 b = _mm_castsi128_ps( _mm_loadu_si128( reinterpret_cast<const __m128i*>( pTexels + 16 ) ) );
+
+	even = _mm_castps_si128( _mm_shuffle_ps( a, b, _MM_SHUFFLE( 2, 0, 2, 0 ) ) );
+	odd = _mm_castps_si128( _mm_shuffle_ps( a, b, _MM_SHUFFLE( 3, 1, 3, 1 ) ) );
+}
+
+CPU_TARGET( "sse2" ) void DownsampleRowSSE2( const uint8_t* pRow1, const uint8_t* pRow2, const size_t uiPairOffset, const int iOutWidth, uint8_t* pDest )
+{
+	int j = 0;
+
+	//Single texel wide images have no pairs to split.
+	if( uiPairOffset == 4 )
+	{
+		for( ; j + 4 <= iOutWidth; j += 4 )
+		{
+			__m128i even1, odd1, even2, odd2;
+
+			DeinterleaveSSE2( pRow1 + j * 8, even1, odd1 );
+			DeinterleaveSSE2( pRow2 + j * 8, even2, odd2 );
+
+			_mm_storeu_si128( reinterpret_cast<__m128i*>( pDest + j * 4 ), Average4SSE2( even1, odd1, even2, odd2 ) );
+		}
+	}
+
+	DownsampleRowScalar( pRow1 + j * 8, pRow2 + j * 8, uiPairOffset, iOutWidth - j, pDest + j * 4 );
+}
+
+CPU_TARGET( "avx2" ) void ExpandAVX2( const uint8_t* pIndices, const size_t uiCount, const uint32_t* pPalette, uint8_t* pDest )
+{
+	const int* const pTable = reinterpret_cast<const int*>( pPalette );
+
+	size_t i = 0;
+
+	for( ; i + 8 <= uiCount; i += 8 )
+	{
+		const __m256i indices = _mm256_cvtepu8_epi32( _mm_loadl_epi64( reinterpret_cast<const __m128i*>( pIndices + i ) ) );
+
+		_mm256_storeu_si256( reinterpret_cast<__m256i*>( pDest + i * 4 ), _mm256_i32gather_epi32( pTable, indices, 4 ) );
+	}
+
+	ExpandScalar( pIndices + i, uiCount - i, pPalette, pDest + i * 4 );
+}
+
+/**
+*	Splits 16 texels into the even and odd texels.
+*/
+CPU_TARGET( "avx2" ) inline void DeinterleaveAVX2( const uint8_t* pTexels, __m256i& even, __m256i& odd )
+{
+	const __m256 a = _mm256_castsi256_ps( _mm256_loadu_si256( reinterpret_cast<const __m256i*>( pTexels ) ) );
+	const __m256 b = _mm256_castsi256_ps( _mm256_loadu_si256( reinterpret_cast<const __m256i*>( pTexels + 32 ) ) );
+
+	//Shuffles work within 128 bit lanes, so this yields texels 0, 2, 8, 10, 4, 6, 12, 14; the permute puts them back in order.
+	even = _mm256_permute4x64_epi64( _mm256_castps_si256( _mm256_shuffle_ps( a, b, _MM_SHUFFLE( 2, 0, 2, 0 ) ) ), _MM_SHUFFLE( 3, 1, 2, 0 ) );
+	odd = _mm256_permute4x64_epi64( _mm256_castps_si256( _mm256_shuffle_ps( a, b, _MM_SHUFFLE( 3, 1, 3, 1 ) ) ), _MM_SHUFFLE( 3, 1, 2, 0 ) );
+}
+
+CPU_TARGET( "avx2" ) void DownsampleRowAVX2( const uint8_t* pRow1, const uint8_t* pRow2, const size_t uiPairOffset, const int iOutWidth, uint8_t* pDest )
+{
+	const __m256i zero = _mm256_setzero_si256();
+
+	int j = 0;
+
+	//Single texel wide images have no pairs to split.
+	if( uiPairOffset == 4 )
+	{
+		for( ; j + 8 <= iOutWidth; j += 8 )
+		{
+			__m256i even1, odd1, even2, odd2;
+
+			DeinterleaveAVX2( pRow1 + j * 8, even1, odd1 );
+			DeinterleaveAVX2( pRow2 + j * 8, even2, odd2 );
+
+			//Unpacking and packing both work within 128 bit lanes, so the texels end up back in order.
+			__m256i lo = _mm256_add_epi16( _mm256_unpacklo_epi8( even1, zero ), _mm256_unpacklo_epi8( odd1, zero ) );
+			lo = _mm256_add_epi16( lo, _mm256_add_epi16( _mm256_unpacklo_epi8( even2, zero ), _mm256_unpacklo_epi8( odd2, zero ) ) );
+
+			__m256i hi = _mm256_add_epi16( _mm256_unpackhi_epi8( even1, zero ), _mm256_unpackhi_epi8( odd1, zero ) );
+			hi = _mm256_add_epi16( hi, _mm256_add_epi16( _mm256_unpackhi_epi8( even2, zero ), _mm256_unpackhi_epi8( odd2, zero ) ) );
+
+			const __m256i average = _mm256_packus_epi16( _mm256_srli_epi16( lo, 2 ), _mm256_srli_epi16( hi, 2 ) );
+
+			_mm256_storeu_si256( reinterpret_cast<__m256i*>( pDest + j * 4 ), average );
+		}
+	}
+
+	DownsampleRowSSE2( pRow1 + j * 8, pRow2 + j * 8, uiPairOffset, iOutWidth - j, pDest + j * 4 );
+}
+#endif
+
+struct ImageKernels_t
+{
+	ExpandFn expand;
+	ResampleRowFn resampleRow;
+	DownsampleRowFn downsampleRow;
+};
+
+const ImageKernels_t g_Kernels[] =
+{
+	{ &ExpandScalar, &ResampleRowScalar, &DownsampleRowScalar },
+#if CPU_X86
+	{ &ExpandSSE2, &ResampleRowSSE2, &DownsampleRowSSE2 },
+	//Gathering the palette entries of 4 taps through indices loaded one at a time is slower than the SSE2 version.
+	{ &ExpandAVX2, &ResampleRowSSE2, &DownsampleRowAVX2 }
+#else
+	{ nullptr, nullptr, nullptr },
+	{ nullptr, nullptr, nullptr }
+#endif
+};
+
+CSIMDDispatch<ImageKernels_t> g_Dispatch( "Image processing", g_Kernels );
+
+bool Resample( const ImageKernels_t& kernels, const uint8_t* pIndices, const int iWidth, const int iHeight, const uint32_t* pPalette,
+			   uint8_t* pDest, const int iOutWidth, const int iOutHeight )
+{
+	if( iWidth <= 0 || iHeight <= 0 || iOutWidth <= 0 || iOutHeight <= 0 )
+		return false;
+
+	//Every tap lands on the texel itself.
+	if( iWidth == iOutWidth && iHeight == iOutHeight )
+	{
+		kernels.expand( pIndices, static_cast<size_t>( iWidth ) * iHeight, pPalette, pDest );
+		return true;
+	}
+
+	std::vector<int> col1( iOutWidth ), col2( iOutWidth ), row1( iOutHeight ), row2( iOutHeight );
+
+	for( int i = 0; i < iOutWidth; i++ )
+	{
+		col1[ i ] = ( int ) ( ( i + 0.25 ) * ( iWidth / ( float ) iOutWidth ) );
+		col2[ i ] = ( int ) ( ( i + 0.75 ) * ( iWidth / ( float ) iOutWidth ) );
+	}
+
+	for( int i = 0; i < iOutHeight; i++ )
+	{
+		row1[ i ] = ( int ) ( ( i + 0.25 ) * ( iHeight / ( float ) iOutHeight ) ) * iWidth;
+		row2[ i ] = ( int ) ( ( i + 0.75 ) * ( iHeight / ( float ) iOutHeight ) ) * iWidth;
+	}
+
+	const size_t uiRowSize = static_cast<size_t>( iOutWidth ) * 4;
+
+	for( int i = 0; i < iOutHeight; ++i, pDest += uiRowSize )
+	{
+		kernels.resampleRow( pIndices + row1[ i ], pIndices + row2[ i ], col1.data(), col2.data(), iOutWidth, pPalette, pDest );
+	}
+
+	return true;
+}
+
+bool Downsample( const ImageKernels_t& kernels, const uint8_t* pSrc, const int iWidth, const int iHeight, uint8_t* pDest )
+{
+	if( iWidth <= 0 || iHeight <= 0 )
+		return false;
+
+	const int iOutWidth = GetDownsampledSize( iWidth );
+	const int iOutHeight = GetDownsampledSize( iHeight );
+
+	const size_t uiRowSize = static_cast<size_t>( iWidth ) * 4;
+	const size_t uiPairOffset = iWidth > 1 ? 4 : 0;
+
+	for( int i = 0; i < iOutHeight; ++i, pDest += iOutWidth * 4 )
+	{
+		const uint8_t* pRow1 = pSrc + ( iHeight > 1 ? i * 2 : 0 ) * uiRowSize;
+		const uint8_t* pRow2 = pSrc + ( iHeight > 1 ? i * 2 + 1 : 0 ) * uiRowSize;
+
+		kernels.downsampleRow( pRow1, pRow2, uiPairOffset, iOutWidth, pDest );
+	}
+
+	return true;
+}
+
+bool CompareKernels( const ImageKernels_t& kernels, std::mt19937& random )
+{
+	std::uniform_int_distribution<int> byteDist( 0, 255 );
+
+	uint32_t palette[ 256 ];
+
+	for( auto& entry : palette )
+	{
+		uint8_t rgba[ 4 ];
+
+		for( auto& channel : rgba )
+			channel = static_cast<uint8_t>( byteDist( random ) );
+
+		memcpy( &entry, rgba, sizeof( entry ) );
+	}
+
+	//Covers sizes that aren't multiples of the vector width, and both upscaling and downscaling.
+	std::uniform_int_distribution<int> sizeDist( 1, 80 );
+
+	std::vector<uint8_t> indices;
+	std::vector<uint8_t> expected, actual;
+
+	for( int iTest = 0; iTest < 1000; ++iTest )
+	{
+		const int iWidth = sizeDist( random );
+		const int iHeight = sizeDist( random );
+
+		const bool bSameSize = ( iTest % 4 ) == 0;
+
+		const int iOutWidth = bSameSize ? iWidth : sizeDist( random );
+		const int iOutHeight = bSameSize ? iHeight : sizeDist( random );
+
+		indices.resize( iWidth * iHeight );
+
+		for( auto& index : indices )
+			index = static_cast<uint8_t>( byteDist( random ) );
+
+		//Resample into a larger buffer to check that nothing past the image is written.
+		const size_t uiSize = iOutWidth * iOutHeight * 4;
+
+		expected.assign( uiSize + 64, 0xCD );
+		actual.assign( uiSize + 64, 0xCD );
+
+		Resample( g_Kernels[ 0 ], indices.data(), iWidth, iHeight, palette, expected.data(), iOutWidth, iOutHeight );
+		Resample( kernels, indices.data(), iWidth, iHeight, palette, actual.data(), iOutWidth, iOutHeight );
+
+		if( expected != actual )
+			return false;
+
+		//Downsample the resampled image, so single texel wide and high images are covered as well.
+		std::vector<uint8_t> image( expected.begin(), expected.begin() + uiSize );
+
+		const size_t uiDownsampledSize = GetDownsampledSize( iOutWidth ) * GetDownsampledSize( iOutHeight ) * 4;
+
+		expected.assign( uiDownsampledSize + 64, 0xCD );
+		actual.assign( uiDownsampledSize + 64, 0xCD );
+
+		Downsample( g_Kernels[ 0 ], image.data(), iOutWidth, iOutHeight, expected.data() );
+		Downsample( kernels, image.data(), iOutWidth, iOutHeight, actual.data() );
+
+		if( expected != actual )
+			return false;
+	}
+
+	return true;
+}
+
+void Cmd_ImageSIMD_f()
+{
+	g_Dispatch.Command();
+}
+
+void Cmd_ImageVerify_f()
+{
+	if( VerifyImageSIMD() )
+		Msg( "Image processing output matches for all supported instruction sets\n" );
+}
+
+/**
+*	Times each supported instruction set converting a texture at its own size, and resampling one to a power of 2 size.
+*/
+void Cmd_ImageBenchmark_f()
+{
+	const int iIterations = g_CVar.GetArgC() > 1 ? atoi( g_CVar.GetArgV( 1 ) ) : 100;
+
+	if( iIterations <= 0 )
+	{
+		Msg( "Usage: r_image_benchmark [iterations]\n" );
+		return;
+	}
+
+	std::mt19937 random( 0 );
+	std::uniform_int_distribution<int> byteDist( 0, 255 );
+
+	uint32_t palette[ 256 ];
+
+	for( auto& entry : palette )
+		entry = static_cast<uint32_t>( random() );
+
+	const int iWidth = 256, iHeight = 256;
+	const int iOddWidth = 320, iOddHeight = 200;
+	const int iOutWidth = 512, iOutHeight = 256;
+
+	//Used for both images.
+	std::vector<uint8_t> indices( std::max( iWidth * iHeight, iOddWidth * iOddHeight ) );
+
+	for( auto& index : indices )
+		index = static_cast<uint8_t>( byteDist( random ) );
+
+	std::vector<uint8_t> image( iOutWidth * iOutHeight * 4 );
+
+	for( int iLevel = 0; iLevel < static_cast<int>( SIMDLevel::COUNT ); ++iLevel )
+	{
+		const auto level = static_cast<SIMDLevel>( iLevel );
+
+		if( !IsSIMDLevelSupported( level ) )
+			continue;
+
+		const auto& kernels = g_Dispatch.GetKernels( level );
+
+		const auto start = std::chrono::high_resolution_clock::now();
+
+		for( int iIteration = 0; iIteration < iIterations; ++iIteration )
+			Resample( kernels, indices.data(), iWidth, iHeight, palette, image.data(), iWidth, iHeight );
+
+		const auto expanded = std::chrono::high_resolution_clock::now();
+
+		for( int iIteration = 0; iIteration < iIterations; ++iIteration )
+			Resample( kernels, indices.data(), iOddWidth, iOddHeight, palette, image.data(), iOutWidth, iOutHeight );
+
+		const auto resampled = std::chrono::high_resolution_clock::now();
+
+		Msg( "%s: expand %dx%d %.3f us, resample %dx%d to %dx%d %.3f us\n", SIMDLevelToString( level ),
+			 iWidth, iHeight, std::chrono::duration<double, std::micro>( expanded - start ).count() / iIterations,
+			 iOddWidth, iOddHeight, iOutWidth, iOutHeight, std::chrono::duration<double, std::micro>( resampled - expanded ).count() / iIterations );
+	}
+}
+}
+
+void InitImageProcessing()
+{
+	g_Dispatch.SelectBest();
+
+	g_CVar.AddCommand( "r_image_simd", &Cmd_ImageSIMD_f );
+	g_CVar.AddCommand( "r_image_verify", &Cmd_ImageVerify_f );
+	g_CVar.AddCommand( "r_image_benchmark", &Cmd_ImageBenchmark_f );
+}
+
+void ExpandPalette( const uint8_t* pIndices, const size_t uiCount, const uint32_t* pPalette, uint8_t* pDest )
+{
+	assert( pIndices );
+	assert( pPalette );
+	assert( pDest );
+
+	g_Dispatch.GetKernels().expand( pIndices, uiCount, pPalette, pDest );
+}
+
+bool ResampleIndexed( const uint8_t* pIndices, const int iWidth, const int iHeight, const uint32_t* pPalette,
+					  uint8_t* pDest, const int iOutWidth, const int iOutHeight )
+{
+	assert( pIndices );
+	assert( pPalette );
+	assert( pDest );
+
+	return Resample( g_Dispatch.GetKernels(), pIndices, iWidth, iHeight, pPalette, pDest, iOutWidth, iOutHeight );
+}
+
+bool DownsampleRGBA( const uint8_t* pSrc, const int iWidth, const int iHeight, uint8_t* pDest )
+{
+	assert( pSrc );
+	assert( pDest );
+
+	return Downsample( g_Dispatch.GetKernels(), pSrc, iWidth, iHeight, pDest );
+}
+
+bool VerifyImageSIMD()
+{
+	bool bSuccess = true;
+
+	for( int iLevel = static_cast<int>( SIMDLevel::NONE ) + 1; iLevel < static_cast<int>( SIMDLevel::COUNT ); ++iLevel )
+	{
+		const auto level = static_cast<SIMDLevel>( iLevel );
+
+		if( !IsSIMDLevelSupported( level ) )
+			continue;
+
+		//Same seed for each so failures are reproducible.
+		std::mt19937 random( 0 );
+
+		if( !CompareKernels( g_Dispatch.GetKernels( level ), random ) )
+		{
+			Warning( "Image processing using %s does not match the scalar output\n", SIMDLevelToString( level ) );
+			bSuccess = false;
+		}
+	}
+
+	return bSuccess;
+}
@@ -0,0 +1,62 @@
+#ifndef GL_IMAGEPROCESSING_H
+#define GL_IMAGEPROCESSING_H
+
+/**
+*	@file Image processing kernels used to convert 8 bit indexed textures to RGBA and build their mip levels.
+*	SSE2 and AVX2 versions are selected at runtime, and produce the exact same output as the scalar version.
+*	None of these functions require a GL context.
+*/
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+*	Selects the best supported instruction set, unless -nosimd was passed on the command line, and registers console commands.
+*/
+void InitImageProcessing();
+
+/**
+*	Converts indexed texels to RGBA: pDest[ i ] = pPalette[ pIndices[ i ] ].
+*	@param pIndices Palette indices.
+*	@param uiCount Number of texels.
+*	@param pPalette 256 entry palette. Each entry holds the R, G, B and A bytes in memory order.
+*	@param pDest Destination. uiCount * 4 bytes.
+*/
+void ExpandPalette( const uint8_t* pIndices, const size_t uiCount, const uint32_t* pPalette, uint8_t* pDest );
+
+/**
+*	Resamples an indexed image to the given size and converts it to RGBA.
+*	Each destination texel is the average of 4 source texels, at a quarter and three quarters of the way across the area it covers.
+*	If the size is unchanged, this is the same as ExpandPalette.
+*	@param pIndices Palette indices. iWidth * iHeight texels.
+*	@param pPalette 256 entry palette. Each entry holds the R, G, B and A bytes in memory order.
+*	@param pDest Destination. iOutWidth * iOutHeight * 4 bytes.
+*	@return Whether the image was resampled. Fails if either size is not positive.
+*/
+bool ResampleIndexed( const uint8_t* pIndices, const int iWidth, const int iHeight, const uint32_t* pPalette,
+					  uint8_t* pDest, const int iOutWidth, const int iOutHeight );
+
+/**
+*	Halves an RGBA image in both dimensions. Each destination texel is the average of the 2x2 source texels it covers.
+*	A dimension of 1 stays 1, and the last row or column of an odd dimension is not sampled.
+*	@param pSrc Source image. iWidth * iHeight * 4 bytes.
+*	@param pDest Destination. GetDownsampledSize( iWidth ) * GetDownsampledSize( iHeight ) * 4 bytes.
+*	@return Whether the image was downsampled. Fails if either size is not positive.
+*/
+bool DownsampleRGBA( const uint8_t* pSrc, const int iWidth, const int iHeight, uint8_t* pDest );
+
+/**
+*	@return Size of a dimension after DownsampleRGBA.
+*/
+inline int GetDownsampledSize( const int iSize )
+{
+	return iSize > 1 ? iSize / 2 : 1;
+}
+
+/**
+*	Runs every supported instruction set on random data and compares the output against the scalar version.
+*	@return Whether all supported instruction sets produced identical output.
+*/
+bool VerifyImageSIMD();
+
+#endif //GL_IMAGEPROCESSING_H
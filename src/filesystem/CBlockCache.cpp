@@ -0,0 +1,166 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <iterator>
+
+#include "CBlockCache.h"
+
+const size_t CBlockCache::BLOCK_SIZE;
+const uint64_t CBlockCache::MAX_CACHE_SIZE;
+const uint64_t CBlockCache::MAX_FILE_SIZE;
+
+std::string CBlockCache::MakeFileKey( const char* pszDiskPath, const uint64_t uiOffset, const uint64_t uiLength, const int64_t iModTime )
+{
+	char szSuffix[ 64 ];
+
+	snprintf( szSuffix, sizeof( szSuffix ), "|%llu|%llu|%lld",
+			  static_cast<unsigned long long>( uiOffset ), static_cast<unsigned long long>( uiLength ), static_cast<long long>( iModTime ) );
+
+	//The disk path comes first so GetDiskPath can recover it.
+	return std::string( pszDiskPath ) + szSuffix;
+}
+
+CBlockCache::Data_t CBlockCache::Find( const std::string& szFileKey, const uint64_t uiBlock )
+{
+	const auto szKey = MakeBlockKey( szFileKey, uiBlock );
+
+	std::lock_guard<std::mutex> lock( m_Mutex );
+
+	auto it = m_Lookup.find( szKey );
+
+	if( it == m_Lookup.end() )
+	{
+		++m_uiMisses;
+		return nullptr;
+	}
+
+	++m_uiHits;
+
+	m_Entries.splice( m_Entries.begin(), m_Entries, it->second );
+
+	return it->second->data;
+}
+
+void CBlockCache::Insert( const std::string& szFileKey, const uint64_t uiBlock, Data_t data )
+{
+	if( !data || data->size() > BLOCK_SIZE )
+		return;
+
+	auto szKey = MakeBlockKey( szFileKey, uiBlock );
+
+	std::lock_guard<std::mutex> lock( m_Mutex );
+
+	auto it = m_Lookup.find( szKey );
+
+	//Another handle read the same block at the same time.
+	if( it != m_Lookup.end() )
+		Remove( it->second );
+
+	m_uiCachedBytes += data->size();
+
+	m_Entries.emplace_front( Entry_t{ szKey, GetDiskPath( szFileKey ), std::move( data ) } );
+
+	m_Lookup.emplace( std::move( szKey ), m_Entries.begin() );
+
+	m_DiskPaths[ m_Entries.front().szDiskPath ].emplace_back( m_Entries.begin() );
+
+	while( m_uiCachedBytes > MAX_CACHE_SIZE && m_Entries.size() > 1 )
+	{
+		Remove( std::prev( m_Entries.end() ) );
+
+		++m_uiEvictions;
+	}
+}
+
+void CBlockCache::Forget( const char* pszDiskPath )
+{
+	std::lock_guard<std::mutex> lock( m_Mutex );
+
+	auto it = m_DiskPaths.find( pszDiskPath );
+
+	if( it == m_DiskPaths.end() )
+		return;
+
+	//Removing the last block removes the list as well.
+	const auto blocks = it->second;
+
+	for( auto block : blocks )
+	{
+		Remove( block );
+	}
+}
+
+void CBlockCache::Clear()
+{
+	std::lock_guard<std::mutex> lock( m_Mutex );
+
+	m_Entries.clear();
+	m_Lookup.clear();
+	m_DiskPaths.clear();
+
+	m_uiCachedBytes = 0;
+}
+
+void CBlockCache::GetStats( Stats_t& stats ) const
+{
+	std::lock_guard<std::mutex> lock( m_Mutex );
+
+	stats.uiHits = m_uiHits;
+	stats.uiMisses = m_uiMisses;
+	stats.uiEvictions = m_uiEvictions;
+	stats.uiCachedBlocks = m_Entries.size();
+	stats.uiCachedBytes = m_uiCachedBytes;
+}
+
+void CBlockCache::ResetStats()
+{
+	std::lock_guard<std::mutex> lock( m_Mutex );
+
+	m_uiHits = 0;
+	m_uiMisses = 0;
+	m_uiEvictions = 0;
+}
+
+std::string CBlockCache::MakeBlockKey( const std::string& szFileKey, const uint64_t uiBlock )
+{
+	char szSuffix[ 32 ];
+
+	snprintf( szSuffix, sizeof( szSuffix ), "#%llu", static_cast<unsigned long long>( uiBlock ) );
+
+	return szFileKey + szSuffix;
+}
+
+std::string CBlockCache::GetDiskPath( const std::string& szFileKey )
+{
+	//Strip the offset, length and modification time that MakeFileKey appended.
+	size_t uiEnd = szFileKey.size();
+
+	for( int iField = 0; iField < 3; ++iField )
+	{
+		if( uiEnd == 0 || ( uiEnd = szFileKey.rfind( '|', uiEnd - 1 ) ) == std::string::npos )
+			return szFileKey;
+	}
+
+	return szFileKey.substr( 0, uiEnd );
+}
+
+void CBlockCache::Remove( Entries_t::iterator it )
+{
+	m_uiCachedBytes -= it->data->size();
+
+	m_Lookup.erase( it->szKey );
+
+	auto diskPath = m_DiskPaths.find( it->szDiskPath );
+
+	if( diskPath != m_DiskPaths.end() )
+	{
+		auto& blocks = diskPath->second;
+
+		blocks.erase( std::find( blocks.begin(), blocks.end(), it ) );
+
+		if( blocks.empty() )
+			m_DiskPaths.erase( diskPath );
+	}
+
+	m_Entries.erase( it );
+}
@@ -0,0 +1,148 @@
+#ifndef FILESYSTEM_CBLOCKCACHE_H
+#define FILESYSTEM_CBLOCKCACHE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/**
+*	Memory budgeted least recently used cache of file contents.
+*	Files are cached in fixed size blocks, so small files are cached whole as a single block.
+*	Files are identified by where their data is stored on disk, along with their length and modification time, so changed files are never served from the cache.
+*	Handles read blocks from any thread, so all methods are thread safe.
+*/
+class CBlockCache final
+{
+public:
+	/**
+	*	Size of a block. Files up to this size are cached whole.
+	*/
+	static const size_t BLOCK_SIZE = 64 * 1024;
+
+	/**
+	*	Maximum number of bytes that cached blocks may use together.
+	*/
+	static const uint64_t MAX_CACHE_SIZE = 32 * 1024 * 1024;
+
+	/**
+	*	Files larger than this are never cached, since reading them would evict everything else.
+	*/
+	static const uint64_t MAX_FILE_SIZE = 4 * 1024 * 1024;
+
+	typedef std::shared_ptr<const std::vector<uint8_t>> Data_t;
+
+	struct Stats_t
+	{
+		/**
+		*	Number of block lookups that were served from the cache.
+		*/
+		uint64_t uiHits;
+
+		/**
+		*	Number of block lookups that had to read from disk.
+		*/
+		uint64_t uiMisses;
+
+		/**
+		*	Number of blocks that were dropped to stay within the budget.
+		*/
+		uint64_t uiEvictions;
+
+		uint64_t uiCachedBlocks;
+
+		uint64_t uiCachedBytes;
+	};
+
+public:
+	CBlockCache() = default;
+	~CBlockCache() = default;
+
+	/**
+	*	Creates the key that identifies a file's contents.
+	*	@param pszDiskPath File on disk that contains the data. For files in pack files, the pack file.
+	*	@param uiOffset Offset of the data in the file on disk.
+	*	@param uiLength Length of the file.
+	*	@param iModTime Modification time of the file on disk.
+	*/
+	static std::string MakeFileKey( const char* pszDiskPath, const uint64_t uiOffset, const uint64_t uiLength, const int64_t iModTime );
+
+	/**
+	*	@return The given block of a file, or null if it isn't cached. Marks the block as most recently used.
+	*/
+	Data_t Find( const std::string& szFileKey, const uint64_t uiBlock );
+
+	/**
+	*	Adds a block of a file, evicting the least recently used blocks if the cache is full.
+	*/
+	void Insert( const std::string& szFileKey, const uint64_t uiBlock, Data_t data );
+
+	/**
+	*	Drops all blocks of files stored in the given file on disk.
+	*/
+	void Forget( const char* pszDiskPath );
+
+	void Clear();
+
+	void GetStats( Stats_t& stats ) const;
+
+	void ResetStats();
+
+private:
+	struct Entry_t
+	{
+		std::string szKey;
+
+		/**
+		*	File on disk that the block was read from.
+		*/
+		std::string szDiskPath;
+
+		Data_t data;
+	};
+
+	typedef std::list<Entry_t> Entries_t;
+
+	static std::string MakeBlockKey( const std::string& szFileKey, const uint64_t uiBlock );
+
+	/**
+	*	@return The disk path that the given file key was made from.
+	*/
+	static std::string GetDiskPath( const std::string& szFileKey );
+
+	/**
+	*	Removes an entry. Must be called with the mutex held.
+	*/
+	void Remove( Entries_t::iterator it );
+
+private:
+	mutable std::mutex m_Mutex;
+
+	/**
+	*	Cached blocks, most recently used first.
+	*/
+	Entries_t m_Entries;
+
+	std::unordered_map<std::string, Entries_t::iterator> m_Lookup;
+
+	/**
+	*	Cached blocks of each file on disk, so Forget doesn't have to look at every block.
+	*/
+	std::unordered_map<std::string, std::vector<Entries_t::iterator>> m_DiskPaths;
+
+	uint64_t m_uiCachedBytes = 0;
+
+	uint64_t m_uiHits = 0;
+	uint64_t m_uiMisses = 0;
+	uint64_t m_uiEvictions = 0;
+
+private:
+	CBlockCache( const CBlockCache& ) = delete;
+	CBlockCache& operator=( const CBlockCache& ) = delete;
+};
+
+#endif //FILESYSTEM_CBLOCKCACHE_H
@@ -0,0 +1,310 @@
+#include <algorithm>
+#include <cstring>
+
+#include "CPackDirectory.h"
+#include "CWildcardPattern.h"
+
+#include "CDirectoryTree.h"
+
+namespace fs = std::experimental::filesystem;
+
+namespace
+{
+const char PATH_SEPARATOR = static_cast<char>( fs::path::preferred_separator );
+
+bool IsSeparator( const char c )
+{
+	return c == '/' || c == '\\';
+}
+}
+
+void CDirectoryTree::Find( const char* pszRootPath, const CPackDirectory* pPackDirectory, const CWildcardPattern& pattern, Matches_t& matches )
+{
+	if( !m_bBuilt )
+	{
+		m_Root.bIsDirectory = true;
+
+		if( pPackDirectory )
+		{
+			m_bIsPack = true;
+			BuildPackTree( *pPackDirectory );
+		}
+
+		m_bBuilt = true;
+	}
+
+	std::string szPath;
+	std::string szDiskPath = ( pszRootPath && *pszRootPath ) ? pszRootPath : ".";
+
+	Node_t* pNode = &m_Root;
+
+	Refresh( *pNode, szDiskPath );
+
+	for( const auto& szDirectory : pattern.GetDirectories() )
+	{
+		pNode = FindChild( *pNode, szDirectory );
+
+		if( !pNode || !pNode->bIsDirectory || pNode->bIsSymlink )
+			return;
+
+		if( !szPath.empty() )
+			szPath += PATH_SEPARATOR;
+
+		szPath += szDirectory;
+
+		szDiskPath += PATH_SEPARATOR;
+		szDiskPath += szDirectory;
+
+		Refresh( *pNode, szDiskPath );
+	}
+
+	const auto& szPrefix = pattern.GetNamePrefix();
+
+	auto it = std::lower_bound( pNode->children.begin(), pNode->children.end(), szPrefix, []( const std::unique_ptr<Node_t>& child, const std::string& szName )
+	{
+		return child->szName < szName;
+	} );
+
+	for( auto end = pNode->children.end(); it != end; ++it )
+	{
+		auto& child = **it;
+
+		if( child.szName.compare( 0, szPrefix.length(), szPrefix ) != 0 )
+			break;
+
+		//A literal pattern names a single entry, there is no need to look inside of it.
+		if( pattern.IsLiteral() )
+		{
+			if( child.szName.length() == szPrefix.length() && ( !child.bIsDirectory || !m_bIsPack ) )
+			{
+				const std::string szChildPath = szPath.empty() ? child.szName : szPath + PATH_SEPARATOR + child.szName;
+
+				if( pattern.Matches( szChildPath ) )
+					matches.emplace_back( Match_t{ szChildPath, child.bIsDirectory } );
+			}
+
+			break;
+		}
+
+		AddEntry( child, szPath, szDiskPath, pattern, matches );
+	}
+}
+
+void CDirectoryTree::InvalidatePath( const char* pszPath )
+{
+	if( m_bIsPack )
+		return;
+
+	m_Root.bListed = false;
+
+	Node_t* pNode = &m_Root;
+
+	const char* pszComponent = pszPath;
+
+	while( *pszComponent )
+	{
+		const char* pszEnd = pszComponent;
+
+		while( *pszEnd && !IsSeparator( *pszEnd ) )
+			++pszEnd;
+
+		if( pszEnd > pszComponent )
+		{
+			pNode = FindChild( *pNode, std::string( pszComponent, pszEnd - pszComponent ) );
+
+			if( !pNode )
+				break;
+
+			pNode->bListed = false;
+		}
+
+		pszComponent = *pszEnd ? pszEnd + 1 : pszEnd;
+	}
+}
+
+void CDirectoryTree::BuildPackTree( const CPackDirectory& packDirectory )
+{
+	std::string szComponent;
+
+	for( size_t uiIndex = 0; uiIndex < packDirectory.size(); ++uiIndex )
+	{
+		Node_t* pNode = &m_Root;
+
+		const char* pszComponent = packDirectory[ uiIndex ].GetFileName();
+
+		while( *pszComponent )
+		{
+			const char* pszEnd = pszComponent;
+
+			while( *pszEnd && !IsSeparator( *pszEnd ) )
+				++pszEnd;
+
+			if( pszEnd > pszComponent )
+			{
+				szComponent.assign( pszComponent, pszEnd - pszComponent );
+
+				//Everything but the last component is a directory.
+				pNode = &GetOrAddChild( *pNode, szComponent, *pszEnd != '\0' );
+			}
+
+			pszComponent = *pszEnd ? pszEnd + 1 : pszEnd;
+		}
+	}
+}
+
+void CDirectoryTree::Refresh( Node_t& node, const std::string& szDiskPath )
+{
+	if( m_bIsPack )
+		return;
+
+	std::error_code error;
+
+	++m_uiNumDiskQueries;
+
+	const auto modified = fs::last_write_time( szDiskPath, error );
+
+	if( error )
+	{
+		//The directory is gone.
+		node.children.clear();
+		node.bListed = false;
+		return;
+	}
+
+	if( node.bListed && modified == node.modified )
+		return;
+
+	++m_uiNumDiskQueries;
+
+	struct Entry_t
+	{
+		std::string szName;
+		bool bIsDirectory;
+		bool bIsSymlink;
+	};
+
+	std::vector<Entry_t> entries;
+
+	for( fs::directory_iterator it( szDiskPath, error ), end; !error && it != end; it.increment( error ) )
+	{
+		std::error_code statusError;
+
+		const bool bIsDirectory = fs::is_directory( it->status( statusError ) );
+		const bool bIsSymlink = fs::is_symlink( it->symlink_status( statusError ) );
+
+		entries.emplace_back( Entry_t{ it->path().filename().u8string(), bIsDirectory, bIsSymlink } );
+	}
+
+	std::sort( entries.begin(), entries.end(), []( const Entry_t& lhs, const Entry_t& rhs )
+	{
+		return lhs.szName < rhs.szName;
+	} );
+
+	//Keep the nodes of entries that still exist, so their own listings don't have to be redone.
+	std::vector<std::unique_ptr<Node_t>> children;
+
+	children.reserve( entries.size() );
+
+	auto old = node.children.begin();
+
+	for( auto& entry : entries )
+	{
+		while( old != node.children.end() && ( *old )->szName < entry.szName )
+			++old;
+
+		std::unique_ptr<Node_t> child;
+
+		if( old != node.children.end() && ( *old )->szName == entry.szName )
+		{
+			child = std::move( *old );
+			++old;
+		}
+		else
+		{
+			child = std::make_unique<Node_t>();
+			child->szName = std::move( entry.szName );
+		}
+
+		child->bIsDirectory = entry.bIsDirectory;
+		child->bIsSymlink = entry.bIsSymlink;
+
+		if( !child->bIsDirectory )
+		{
+			child->children.clear();
+			child->bListed = false;
+		}
+
+		children.emplace_back( std::move( child ) );
+	}
+
+	node.children = std::move( children );
+	node.modified = modified;
+	node.bListed = true;
+}
+
+CDirectoryTree::Node_t* CDirectoryTree::FindChild( Node_t& node, const std::string& szName )
+{
+	auto it = std::lower_bound( node.children.begin(), node.children.end(), szName, []( const std::unique_ptr<Node_t>& child, const std::string& szName )
+	{
+		return child->szName < szName;
+	} );
+
+	if( it != node.children.end() && ( *it )->szName == szName )
+		return it->get();
+
+	return nullptr;
+}
+
+CDirectoryTree::Node_t& CDirectoryTree::GetOrAddChild( Node_t& node, const std::string& szName, const bool bIsDirectory )
+{
+	auto it = std::lower_bound( node.children.begin(), node.children.end(), szName, []( const std::unique_ptr<Node_t>& child, const std::string& szName )
+	{
+		return child->szName < szName;
+	} );
+
+	if( it != node.children.end() && ( *it )->szName == szName )
+	{
+		( *it )->bIsDirectory = ( *it )->bIsDirectory || bIsDirectory;
+		return **it;
+	}
+
+	auto child = std::make_unique<Node_t>();
+
+	child->szName = szName;
+	child->bIsDirectory = bIsDirectory;
+	child->bListed = true;
+
+	return **node.children.emplace( it, std::move( child ) );
+}
+
+void CDirectoryTree::AddSubtree( Node_t& node, std::string& szPath, std::string& szDiskPath, const CWildcardPattern& pattern, Matches_t& matches )
+{
+	Refresh( node, szDiskPath );
+
+	for( auto& child : node.children )
+		AddEntry( *child, szPath, szDiskPath, pattern, matches );
+}
+
+void CDirectoryTree::AddEntry( Node_t& node, std::string& szPath, std::string& szDiskPath, const CWildcardPattern& pattern, Matches_t& matches )
+{
+	const size_t uiPathLength = szPath.length();
+	const size_t uiDiskPathLength = szDiskPath.length();
+
+	if( !szPath.empty() )
+		szPath += PATH_SEPARATOR;
+
+	szPath += node.szName;
+
+	szDiskPath += PATH_SEPARATOR;
+	szDiskPath += node.szName;
+
+	//Pack files don't store directories, so only their files are returned.
+	if( ( !node.bIsDirectory || !m_bIsPack ) && pattern.Matches( szPath ) )
+		matches.emplace_back( Match_t{ szPath, node.bIsDirectory } );
+
+	if( node.bIsDirectory && !node.bIsSymlink )
+		AddSubtree( node, szPath, szDiskPath, pattern, matches );
+
+	szPath.resize( uiPathLength );
+	szDiskPath.resize( uiDiskPathLength );
+}
@@ -0,0 +1,134 @@
+#ifndef FILESYSTEM_CDIRECTORYTREE_H
+#define FILESYSTEM_CDIRECTORYTREE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <experimental/filesystem>
+#include <memory>
+#include <string>
+#include <vector>
+
+class CPackDirectory;
+class CWildcardPattern;
+
+/**
+*	Snapshot of the directory tree of a search path, used to answer FindFirst/FindNext.
+*	Loose directories are listed the first time a search enters them, and listed again when their modification time changes.
+*	Pack file trees are built from the pack directory on the first search, and never change.
+*	Searches only enter the directories named by the pattern's literal prefix, so their cost depends on the entries under those directories, not on the size of the tree.
+*/
+class CDirectoryTree final
+{
+public:
+	/**
+	*	An entry that matched a search.
+	*/
+	struct Match_t
+	{
+		/**
+		*	Path relative to the search path, with preferred separators.
+		*/
+		std::string szPath;
+
+		bool bIsDirectory;
+	};
+
+	typedef std::vector<Match_t> Matches_t;
+
+public:
+	CDirectoryTree() = default;
+	~CDirectoryTree() = default;
+
+	CDirectoryTree( CDirectoryTree&& other ) = default;
+	CDirectoryTree& operator=( CDirectoryTree&& other ) = default;
+
+	/**
+	*	Finds all entries that match a pattern, in directory order. Directories come before their contents.
+	*	@param pszRootPath For loose search paths, the path of the search path on disk.
+	*	@param pPackDirectory For pack search paths, the pack directory. Directories inside of pack files are never returned.
+	*	@param pattern Pattern to match.
+	*	@param[ out ] matches Matching entries are appended to this list.
+	*/
+	void Find( const char* pszRootPath, const CPackDirectory* pPackDirectory, const CWildcardPattern& pattern, Matches_t& matches );
+
+	/**
+	*	Forgets the listings of the directories that contain the given path, so entries created or removed there are picked up
+	*	even if the modification time didn't change.
+	*	@param pszPath Path relative to the search path.
+	*/
+	void InvalidatePath( const char* pszPath );
+
+	/**
+	*	@return Number of directory listings and directory status checks made since the last call to ResetNumDiskQueries.
+	*/
+	uint64_t GetNumDiskQueries() const { return m_uiNumDiskQueries; }
+
+	void ResetNumDiskQueries() { m_uiNumDiskQueries = 0; }
+
+private:
+	struct Node_t
+	{
+		std::string szName;
+
+		bool bIsDirectory = false;
+
+		/**
+		*	Symbolic links to directories are returned, but not searched, so link cycles can't cause endless searches.
+		*/
+		bool bIsSymlink = false;
+
+		/**
+		*	Whether the children are up to date as of the modification time.
+		*/
+		bool bListed = false;
+
+		std::experimental::filesystem::file_time_type modified;
+
+		/**
+		*	Sorted by name.
+		*/
+		std::vector<std::unique_ptr<Node_t>> children;
+	};
+
+	void BuildPackTree( const CPackDirectory& packDirectory );
+
+	/**
+	*	Makes sure the children of a loose directory are up to date. Does nothing for pack trees.
+	*/
+	void Refresh( Node_t& node, const std::string& szDiskPath );
+
+	/**
+	*	@return The child with the given name, or null if there is none.
+	*/
+	static Node_t* FindChild( Node_t& node, const std::string& szName );
+
+	/**
+	*	@return The child with the given name, which is added if there is none.
+	*/
+	static Node_t& GetOrAddChild( Node_t& node, const std::string& szName, const bool bIsDirectory );
+
+	/**
+	*	Adds every entry below the given directory that matches the pattern.
+	*/
+	void AddSubtree( Node_t& node, std::string& szPath, std::string& szDiskPath, const CWildcardPattern& pattern, Matches_t& matches );
+
+	/**
+	*	Adds an entry if it matches, and continues into it if it's a directory.
+	*/
+	void AddEntry( Node_t& node, std::string& szPath, std::string& szDiskPath, const CWildcardPattern& pattern, Matches_t& matches );
+
+private:
+	Node_t m_Root;
+
+	bool m_bIsPack = false;
+
+	bool m_bBuilt = false;
+
+	uint64_t m_uiNumDiskQueries = 0;
+
+private:
+	CDirectoryTree( const CDirectoryTree& ) = delete;
+	CDirectoryTree& operator=( const CDirectoryTree& ) = delete;
+};
+
+#endif //FILESYSTEM_CDIRECTORYTREE_H
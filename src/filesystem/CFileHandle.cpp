@@ -1,9 +1,70 @@
+#include <algorithm>
 #include <cassert>
+#include <cerrno>
+#include <cstring>
 
+#ifdef WIN32
+#include <io.h>
+#endif
+
+#include "CBlockCache.h"
 #include "CFileSystem.h"
 
 #include "CFileHandle.h"
 
+namespace
+{
+/**
+*	Reads from a file at the given offset without using or changing its stream position.
+*	@return Number of bytes read, or -1 if an error occurred.
+*/
+int64_t ReadAt( FILE* pFile, void* pBuffer, const size_t uiSize, const uint64_t uiOffset )
+{
+#ifdef WIN32
+	HANDLE hFile = reinterpret_cast<HANDLE>( _get_osfhandle( _fileno( pFile ) ) );
+
+	if( hFile == INVALID_HANDLE_VALUE )
+		return -1;
+
+	OVERLAPPED overlapped{};
+
+	overlapped.Offset = static_cast<DWORD>( uiOffset & 0xFFFFFFFF );
+	overlapped.OffsetHigh = static_cast<DWORD>( uiOffset >> 32 );
+
+	DWORD dwRead = 0;
+
+	if( !ReadFile( hFile, pBuffer, static_cast<DWORD>( uiSize ), &dwRead, &overlapped ) )
+		return GetLastError() == ERROR_HANDLE_EOF ? 0 : -1;
+
+	return dwRead;
+#else
+	const int iDescriptor = fileno( pFile );
+
+	size_t uiTotal = 0;
+
+	while( uiTotal < uiSize )
+	{
+		const ssize_t iRead = pread64( iDescriptor, static_cast<uint8_t*>( pBuffer ) + uiTotal, uiSize - uiTotal, uiOffset + uiTotal );
+
+		if( iRead < 0 )
+		{
+			if( errno == EINTR )
+				continue;
+
+			return -1;
+		}
+
+		if( iRead == 0 )
+			break;
+
+		uiTotal += static_cast<size_t>( iRead );
+	}
+
+	return static_cast<int64_t>( uiTotal );
+#endif
+}
+}
+
 CFileHandle::CFileHandle( CFileSystem& fileSystem, const char* pszFileName, const char* pszMode, const bool bIsPackFile )
 {
 	assert( pszFileName );
@@ -43,9 +104,6 @@ CFileHandle::CFileHandle( CFileSystem& fileSystem, std::string&& szFileName, FIL
 		m_uiLength = uiLength;
 
 		m_Flags |= FileHandleFlag::IS_PACK_ENTRY;
-
-		//TODO: use 64 bit seek - Solokiller
-		fseek( m_pFile, static_cast<long>( m_uiStartOffset ), SEEK_SET );
 	}
 	else
 	{
@@ -53,6 +111,23 @@ CFileHandle::CFileHandle( CFileSystem& fileSystem, std::string&& szFileName, FIL
 	}
 }
 
+CFileHandle::CFileHandle( std::string&& szFileName, std::shared_ptr<const std::vector<uint8_t>>&& data )
+{
+	assert( data );
+
+	m_szFileName = std::move( szFileName );
+
+	m_PreloadedData = std::move( data );
+
+	m_uiLength = m_PreloadedData->size();
+
+	//The whole file is in the buffer, so reads never have to fill it.
+	m_pBufferData = m_PreloadedData->data();
+	m_uiBufferSize = m_PreloadedData->size();
+
+	m_Flags |= FileHandleFlag::IS_PRELOADED;
+}
+
 CFileHandle::CFileHandle( CFileHandle&& other )
 	: CFileHandle()
 {
@@ -75,28 +150,230 @@ void CFileHandle::Close()
 {
 	if( IsOpen() )
 	{
-		if( !IsPackEntry() )
+		if( m_pFile && !IsPackEntry() )
 		{
 			fclose( m_pFile );
 		}
 
 		m_pFile = nullptr;
 		m_szFileName.clear();
+		m_szKey.clear();
 
 		m_uiStartOffset = m_uiLength = 0;
 
 		m_Flags = FileHandleFlag::NONE;
+
+		m_uiPosition = 0;
+		m_Buffer.reset();
+		m_pBufferData = nullptr;
+		m_PreloadedData.reset();
+		m_pBlockCache = nullptr;
+		m_szBlockCacheKey.clear();
+		m_CachedBlock.reset();
+		m_uiBufferStart = 0;
+		m_uiBufferSize = 0;
+		m_bReadError = false;
 	}
 }
 
+size_t CFileHandle::ReadEntry( void* pOutput, const size_t uiSize )
+{
+	assert( IsPositional() );
+
+	if( m_uiPosition >= m_uiLength )
+		return 0;
+
+	const size_t uiToRead = static_cast<size_t>( std::min( static_cast<uint64_t>( uiSize ), m_uiLength - m_uiPosition ) );
+
+	auto pDest = static_cast<uint8_t*>( pOutput );
+
+	size_t uiRead = 0;
+
+	while( uiRead < uiToRead )
+	{
+		if( m_uiPosition >= m_uiBufferStart && m_uiPosition < m_uiBufferStart + m_uiBufferSize )
+		{
+			const size_t uiOffset = static_cast<size_t>( m_uiPosition - m_uiBufferStart );
+			const size_t uiCount = std::min( uiToRead - uiRead, m_uiBufferSize - uiOffset );
+
+			memcpy( pDest + uiRead, m_pBufferData + uiOffset, uiCount );
+
+			uiRead += uiCount;
+			m_uiPosition += uiCount;
+
+			continue;
+		}
+
+		const size_t uiRemaining = uiToRead - uiRead;
+
+		//Large reads go straight to the destination, unless they should be cached.
+		if( !m_pBlockCache && uiRemaining >= PACK_ENTRY_BUFFER_SIZE )
+		{
+			const int64_t iResult = ReadAt( m_pFile, pDest + uiRead, uiRemaining, m_uiStartOffset + m_uiPosition );
+
+			if( iResult <= 0 )
+			{
+				if( iResult < 0 )
+					m_bReadError = true;
+
+				break;
+			}
+
+			uiRead += static_cast<size_t>( iResult );
+			m_uiPosition += static_cast<uint64_t>( iResult );
+
+			continue;
+		}
+
+		if( !FillBuffer() )
+			break;
+	}
+
+	return uiRead;
+}
+
+char* CFileHandle::ReadEntryLine( char* pszOutput, const int iMaxChars )
+{
+	assert( IsPositional() );
+
+	if( iMaxChars <= 0 )
+		return nullptr;
+
+	int iCount = 0;
+
+	while( iCount < iMaxChars - 1 )
+	{
+		if( !( m_uiPosition >= m_uiBufferStart && m_uiPosition < m_uiBufferStart + m_uiBufferSize ) )
+		{
+			if( m_uiPosition >= m_uiLength || !FillBuffer() )
+				break;
+		}
+
+		const char c = static_cast<char>( m_pBufferData[ m_uiPosition - m_uiBufferStart ] );
+
+		++m_uiPosition;
+
+		pszOutput[ iCount++ ] = c;
+
+		if( c == '\n' )
+			break;
+	}
+
+	if( iCount == 0 && iMaxChars > 1 )
+		return nullptr;
+
+	pszOutput[ iCount ] = '\0';
+
+	return pszOutput;
+}
+
+void CFileHandle::SetBlockCache( CBlockCache& cache, std::string&& szFileKey )
+{
+	assert( IsOpen() && !IsPreloaded() );
+
+	m_pBlockCache = &cache;
+	m_szBlockCacheKey = std::move( szFileKey );
+
+	//Any buffered data came from the file, drop it so reads start using the cache.
+	m_uiBufferSize = 0;
+
+	m_Flags |= FileHandleFlag::IS_BLOCK_CACHED;
+}
+
+bool CFileHandle::FillBuffer()
+{
+	m_uiBufferSize = 0;
+
+	if( m_uiPosition >= m_uiLength )
+		return false;
+
+	if( m_pBlockCache )
+		return FillBufferFromCache();
+
+	if( !m_Buffer )
+	{
+		m_Buffer = std::make_unique<uint8_t[]>( PACK_ENTRY_BUFFER_SIZE );
+		m_pBufferData = m_Buffer.get();
+	}
+
+	const size_t uiCount = static_cast<size_t>( std::min( static_cast<uint64_t>( PACK_ENTRY_BUFFER_SIZE ), m_uiLength - m_uiPosition ) );
+
+	const int64_t iResult = ReadAt( m_pFile, m_Buffer.get(), uiCount, m_uiStartOffset + m_uiPosition );
+
+	if( iResult <= 0 )
+	{
+		if( iResult < 0 )
+			m_bReadError = true;
+
+		return false;
+	}
+
+	m_uiBufferStart = m_uiPosition;
+	m_uiBufferSize = static_cast<size_t>( iResult );
+
+	return true;
+}
+
+bool CFileHandle::FillBufferFromCache()
+{
+	const uint64_t uiBlock = m_uiPosition / CBlockCache::BLOCK_SIZE;
+	const uint64_t uiBlockStart = uiBlock * CBlockCache::BLOCK_SIZE;
+
+	auto data = m_pBlockCache->Find( m_szBlockCacheKey, uiBlock );
+
+	if( !data )
+	{
+		const size_t uiCount = static_cast<size_t>( std::min( static_cast<uint64_t>( CBlockCache::BLOCK_SIZE ), m_uiLength - uiBlockStart ) );
+
+		auto block = std::make_shared<std::vector<uint8_t>>( uiCount );
+
+		const int64_t iResult = ReadAt( m_pFile, block->data(), uiCount, m_uiStartOffset + uiBlockStart );
+
+		if( iResult <= 0 )
+		{
+			if( iResult < 0 )
+				m_bReadError = true;
+
+			return false;
+		}
+
+		//A short read means the file changed since it was opened, so only complete blocks are cached.
+		if( static_cast<size_t>( iResult ) == uiCount )
+			m_pBlockCache->Insert( m_szBlockCacheKey, uiBlock, block );
+		else
+			block->resize( static_cast<size_t>( iResult ) );
+
+		data = std::move( block );
+	}
+
+	m_CachedBlock = std::move( data );
+
+	m_pBufferData = m_CachedBlock->data();
+	m_uiBufferStart = uiBlockStart;
+	m_uiBufferSize = m_CachedBlock->size();
+
+	return m_uiPosition < m_uiBufferStart + m_uiBufferSize;
+}
+
 void CFileHandle::swap( CFileHandle& other )
 {
 	if( this != &other )
 	{
 		std::swap( m_pFile, other.m_pFile );
 		std::swap( m_szFileName, other.m_szFileName );
+		std::swap( m_szKey, other.m_szKey );
 		std::swap( m_uiStartOffset, other.m_uiStartOffset );
 		std::swap( m_uiLength, other.m_uiLength );
 		std::swap( m_Flags, other.m_Flags );
+		std::swap( m_uiPosition, other.m_uiPosition );
+		std::swap( m_Buffer, other.m_Buffer );
+		std::swap( m_pBufferData, other.m_pBufferData );
+		std::swap( m_PreloadedData, other.m_PreloadedData );
+		std::swap( m_pBlockCache, other.m_pBlockCache );
+		std::swap( m_szBlockCacheKey, other.m_szBlockCacheKey );
+		std::swap( m_CachedBlock, other.m_CachedBlock );
+		std::swap( m_uiBufferStart, other.m_uiBufferStart );
+		std::swap( m_uiBufferSize, other.m_uiBufferSize );
+		std::swap( m_bReadError, other.m_bReadError );
 	}
 }
@@ -3,8 +3,11 @@
 
 #include <cstdio>
 #include <cstdint>
+#include <memory>
 #include <string>
+#include <vector>
 
+class CBlockCache;
 class CFileSystem;
 
 typedef uint32_t FileHandleFlags_t;
@@ -23,14 +26,34 @@ enum : FileHandleFlags_t
 	*	This is a file in a pack file.
 	*/
 	IS_PACK_ENTRY	= 1 << 1,
+
+	/**
+	*	This file's contents were preloaded into memory, or were cached whole.
+	*/
+	IS_PRELOADED	= 1 << 2,
+
+	/**
+	*	Reads from this file go through the block cache.
+	*/
+	IS_BLOCK_CACHED	= 1 << 3,
 };
 }
 
 /**
 *	A handle to a file. Contains information about the file, such as the name.
+*	Pack entries read from the pack file with positional reads at their own position, through their own buffer.
+*	They never move the pack file's stream position, so entries from the same pack file can be read in any order, and by different threads.
+*	Preloaded files are read the same way, from memory that was taken from the preload cache or is shared with the block cache.
+*	Block cached files read whole blocks through the block cache instead of filling their own buffer.
 */
 class CFileHandle
 {
+public:
+	/**
+	*	Size of the read buffer that pack entries allocate when they are first read from.
+	*/
+	static const size_t PACK_ENTRY_BUFFER_SIZE = 4096;
+
 public:
 	/**
 	*	Constructs a handle that points to no file.
@@ -47,6 +70,11 @@ public:
 	*/
 	CFileHandle( CFileSystem& fileSystem, std::string&& szFileName, FILE* pFile, uint64_t uiStartOffset, uint64_t uiLength );
 
+	/**
+	*	Constructs a handle that reads from the given preloaded or cached contents.
+	*/
+	CFileHandle( std::string&& szFileName, std::shared_ptr<const std::vector<uint8_t>>&& data );
+
 	CFileHandle( CFileHandle&& other );
 	CFileHandle& operator=( CFileHandle&& other );
 
@@ -59,6 +87,13 @@ public:
 
 	inline const std::string& GetFileName() const { return m_szFileName; }
 
+	/**
+	*	@return Normalized path that the file was opened for reading with. Empty for files that weren't opened for reading, or whose path can't be normalized.
+	*/
+	inline const std::string& GetKey() const { return m_szKey; }
+
+	inline void SetKey( std::string&& szKey ) { m_szKey = std::move( szKey ); }
+
 	inline uint64_t GetStartOffset() const { return m_uiStartOffset; }
 
 	inline uint64_t GetLength() const { return m_uiLength; }
@@ -73,26 +108,117 @@ public:
 
 	inline bool IsPackEntry() const { return ( m_Flags & FileHandleFlag::IS_PACK_ENTRY ) != 0; }
 
+	inline bool IsPreloaded() const { return ( m_Flags & FileHandleFlag::IS_PRELOADED ) != 0; }
+
+	/**
+	*	@return For preloaded files, the contents of the whole file.
+	*/
+	inline const std::shared_ptr<const std::vector<uint8_t>>& GetPreloadedData() const { return m_PreloadedData; }
+
+	inline bool IsBlockCached() const { return ( m_Flags & FileHandleFlag::IS_BLOCK_CACHED ) != 0; }
+
+	/**
+	*	@return Whether reads use ReadEntry and the handle's own position instead of the FILE* stream. True for pack entries, preloaded and block cached files.
+	*/
+	inline bool IsPositional() const { return IsPackEntry() || IsPreloaded() || IsBlockCached(); }
+
+	/**
+	*	Makes reads go through the given block cache. The cache must outlive the handle.
+	*	@param szFileKey Key of this file's contents, created by CBlockCache::MakeFileKey.
+	*/
+	void SetBlockCache( CBlockCache& cache, std::string&& szFileKey );
+
 	bool IsOpen() const;
 
 	void Close();
 
+	/**
+	*	@return For positional handles, the read position relative to the start of the entry.
+	*/
+	inline uint64_t GetPosition() const { return m_uiPosition; }
+
+	/**
+	*	Sets the read position of a positional handle. Positions past the end are allowed; reads there return nothing.
+	*/
+	inline void SetPosition( const uint64_t uiPosition ) { m_uiPosition = uiPosition; }
+
+	/**
+	*	@return Whether reading from a positional handle failed.
+	*/
+	inline bool HasReadError() const { return m_bReadError; }
+
+	/**
+	*	Reads from a positional handle at the current position, and advances the position.
+	*	@return Number of bytes read. Less than requested at the end of the entry.
+	*/
+	size_t ReadEntry( void* pOutput, const size_t uiSize );
+
+	/**
+	*	Reads a line from a positional handle at the current position, and advances the position. Behaves like fgets.
+	*	@return pszOutput, or null if the end of the entry was reached before anything was read.
+	*/
+	char* ReadEntryLine( char* pszOutput, const int iMaxChars );
+
 	bool operator==( const CFileHandle& other ) const;
 
 	bool operator!=( const CFileHandle& other ) const { return !( *this == other ); }
 
 	void swap( CFileHandle& other );
 
+private:
+	/**
+	*	Fills the pack entry buffer starting at the current position.
+	*	@return Whether any bytes were read.
+	*/
+	bool FillBuffer();
+
+	/**
+	*	Points the buffer to the block cache's block that contains the current position, reading the block if it isn't cached.
+	*	@return Whether the buffer contains the current position.
+	*/
+	bool FillBufferFromCache();
+
 private:
 	FILE* m_pFile = nullptr;
 
 	std::string m_szFileName;
 
+	std::string m_szKey;
+
 	uint64_t m_uiStartOffset = 0;
 	uint64_t m_uiLength = 0;
 
 	FileHandleFlags_t m_Flags = FileHandleFlag::NONE;
 
+	uint64_t m_uiPosition = 0;
+
+	std::unique_ptr<uint8_t[]> m_Buffer;
+
+	/**
+	*	Buffer that reads copy from. Either m_Buffer, the preloaded contents, which cover the whole file, or the current cached block.
+	*/
+	const uint8_t* m_pBufferData = nullptr;
+
+	std::shared_ptr<const std::vector<uint8_t>> m_PreloadedData;
+
+	CBlockCache* m_pBlockCache = nullptr;
+
+	std::string m_szBlockCacheKey;
+
+	std::shared_ptr<const std::vector<uint8_t>> m_CachedBlock;
+
+	/**
+	*	Entry relative position of the first byte in the buffer.
+	*/
+	uint64_t m_uiBufferStart = 0;
+
+	/**
+	*	Number of valid bytes in the buffer.
+	*/
+	size_t m_uiBufferSize = 0;
+
+	bool m_bReadError = false;
+
 private:
 	CFileHandle( const CFileHandle& ) = delete;
 	CFileHandle& operator=( const CFileHandle& ) = delete;
@@ -110,12 +236,12 @@ inline void CFileHandle::ClearFlags( const FileHandleFlags_t flags )
 
 inline bool CFileHandle::IsOpen() const
 {
-	return m_pFile != nullptr;
+	return m_pFile != nullptr || m_PreloadedData;
 }
 
 inline bool CFileHandle::operator==( const CFileHandle& other ) const
 {
-	return m_pFile == other.m_pFile;
+	return m_pFile == other.m_pFile && m_PreloadedData == other.m_PreloadedData;
 }
 
 #endif //FILESYSTEM_CFILEHANDLE_H
@@ -0,0 +1,91 @@
+#include <cassert>
+
+#include "CFileHandleTable.h"
+
+const uint32_t CFileHandleTable::INDEX_BITS;
+const uint32_t CFileHandleTable::INDEX_MASK;
+const uint32_t CFileHandleTable::GENERATION_MASK;
+const size_t CFileHandleTable::MAX_HANDLES;
+const size_t CFileHandleTable::SLAB_SIZE;
+
+FileHandle_t CFileHandleTable::Add( CFileHandle&& file )
+{
+	uint32_t uiIndex = m_uiFirstFree;
+
+	if( uiIndex )
+	{
+		m_uiFirstFree = GetSlot( uiIndex ).uiNextFree;
+	}
+	else
+	{
+		if( m_uiNumSlots > MAX_HANDLES )
+			return FILESYSTEM_INVALID_HANDLE;
+
+		uiIndex = m_uiNumSlots++;
+
+		if( uiIndex / SLAB_SIZE >= m_Slabs.size() )
+			m_Slabs.emplace_back( new Slot_t[ SLAB_SIZE ] );
+	}
+
+	auto& slot = GetSlot( uiIndex );
+
+	slot.file = std::move( file );
+	slot.uiNextFree = 0;
+	slot.bInUse = true;
+
+	++m_uiCount;
+
+	return reinterpret_cast<FileHandle_t>( static_cast<uintptr_t>( ( slot.uiGeneration << INDEX_BITS ) | uiIndex ) );
+}
+
+CFileHandle* CFileHandleTable::Get( FileHandle_t handle ) const
+{
+	auto pSlot = Lookup( handle );
+
+	return pSlot ? &pSlot->file : nullptr;
+}
+
+bool CFileHandleTable::Remove( FileHandle_t handle )
+{
+	auto pSlot = Lookup( handle );
+
+	if( !pSlot )
+		return false;
+
+	const uint32_t uiIndex = static_cast<uint32_t>( reinterpret_cast<uintptr_t>( handle ) ) & INDEX_MASK;
+
+	pSlot->file.Close();
+
+	//Handles to this slot that are still around no longer match.
+	pSlot->uiGeneration = ( pSlot->uiGeneration + 1 ) & GENERATION_MASK;
+	pSlot->bInUse = false;
+
+	pSlot->uiNextFree = m_uiFirstFree;
+	m_uiFirstFree = uiIndex;
+
+	--m_uiCount;
+
+	return true;
+}
+
+CFileHandleTable::Slot_t* CFileHandleTable::Lookup( FileHandle_t handle ) const
+{
+	const auto uiValue = reinterpret_cast<uintptr_t>( handle );
+
+	const uint32_t uiIndex = static_cast<uint32_t>( uiValue ) & INDEX_MASK;
+	const uint32_t uiGeneration = static_cast<uint32_t>( uiValue >> INDEX_BITS );
+
+	if( uiIndex == 0 || uiIndex >= m_uiNumSlots )
+		return nullptr;
+
+	auto& slot = GetSlot( uiIndex );
+
+	if( !slot.bInUse || slot.uiGeneration != uiGeneration )
+	{
+		//A handle to a file that has since been closed. Its slot may already hold another file.
+		assert( !"CFileHandleTable: use of a closed file handle" );
+		return nullptr;
+	}
+
+	return &slot;
+}
@@ -0,0 +1,129 @@
+#ifndef FILESYSTEM_CFILEHANDLETABLE_H
+#define FILESYSTEM_CFILEHANDLETABLE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "FileSystem.h"
+
+#include "CFileHandle.h"
+
+/**
+*	Owns all open files and hands out FileHandle_t values that refer to them.
+*	Files are stored in fixed size slabs, so they never move once added, and free slots are reused through a free list.
+*	A handle encodes the slot index and the slot's generation, which changes whenever the slot is freed, so handles to closed files are detected.
+*/
+class CFileHandleTable final
+{
+public:
+	/**
+	*	Number of bits of a handle that store the slot index. The remaining bits store the generation.
+	*/
+	static const uint32_t INDEX_BITS = 20;
+
+	static const uint32_t INDEX_MASK = ( 1U << INDEX_BITS ) - 1;
+
+	static const uint32_t GENERATION_MASK = 0xFFFFFFFFU >> INDEX_BITS;
+
+	/**
+	*	Maximum number of open files. Index 0 is never used, so the invalid handle is never handed out.
+	*/
+	static const size_t MAX_HANDLES = INDEX_MASK;
+
+	/**
+	*	Number of files in a slab.
+	*/
+	static const size_t SLAB_SIZE = 256;
+
+public:
+	CFileHandleTable() = default;
+	~CFileHandleTable() = default;
+
+	/**
+	*	Takes ownership of an open file.
+	*	@return Handle to the file, or FILESYSTEM_INVALID_HANDLE if the table is full.
+	*/
+	FileHandle_t Add( CFileHandle&& file );
+
+	/**
+	*	@return The file that the handle refers to, or null if the handle is invalid or the file has been closed.
+	*/
+	CFileHandle* Get( FileHandle_t handle ) const;
+
+	/**
+	*	Closes and frees the file that the handle refers to.
+	*	@return Whether the handle referred to an open file.
+	*/
+	bool Remove( FileHandle_t handle );
+
+	/**
+	*	@return Number of open files.
+	*/
+	size_t GetCount() const { return m_uiCount; }
+
+	/**
+	*	Calls the given function for every open file.
+	*/
+	template<typename FUNC>
+	void ForEach( FUNC&& func ) const;
+
+private:
+	struct Slot_t
+	{
+		CFileHandle file;
+
+		uint32_t uiGeneration = 0;
+
+		/**
+		*	If this slot is free, index of the next free slot, or 0 if this is the last one.
+		*/
+		uint32_t uiNextFree = 0;
+
+		bool bInUse = false;
+	};
+
+	Slot_t& GetSlot( const uint32_t uiIndex ) const
+	{
+		return m_Slabs[ uiIndex / SLAB_SIZE ][ uiIndex % SLAB_SIZE ];
+	}
+
+	/**
+	*	@return The slot that the handle refers to, or null if it is stale or invalid.
+	*/
+	Slot_t* Lookup( FileHandle_t handle ) const;
+
+private:
+	std::vector<std::unique_ptr<Slot_t[]>> m_Slabs;
+
+	/**
+	*	Number of slots that have been handed out at least once, including the reserved slot 0.
+	*/
+	uint32_t m_uiNumSlots = 1;
+
+	/**
+	*	First free slot, or 0 if there are none.
+	*/
+	uint32_t m_uiFirstFree = 0;
+
+	size_t m_uiCount = 0;
+
+private:
+	CFileHandleTable( const CFileHandleTable& ) = delete;
+	CFileHandleTable& operator=( const CFileHandleTable& ) = delete;
+};
+
+template<typename FUNC>
+void CFileHandleTable::ForEach( FUNC&& func ) const
+{
+	for( uint32_t uiIndex = 1; uiIndex < m_uiNumSlots; ++uiIndex )
+	{
+		auto& slot = GetSlot( uiIndex );
+
+		if( slot.bInUse )
+			func( slot.file );
+	}
+}
+
+#endif //FILESYSTEM_CFILEHANDLETABLE_H
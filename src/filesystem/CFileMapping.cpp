@@ -0,0 +1,125 @@
+#include <cassert>
+#include <limits>
+
+#ifdef WIN32
+#include <io.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#endif
+
+#include "CFileMapping.h"
+
+namespace
+{
+/**
+*	@return The granularity that mapping offsets must be aligned to.
+*/
+uint64_t GetMappingGranularity()
+{
+#ifdef WIN32
+	SYSTEM_INFO info;
+
+	GetSystemInfo( &info );
+
+	return info.dwAllocationGranularity;
+#else
+	return static_cast<uint64_t>( sysconf( _SC_PAGESIZE ) );
+#endif
+}
+}
+
+bool CFileMapping::Map( FILE* pFile, const uint64_t uiOffset, const uint64_t uiLength )
+{
+	assert( pFile );
+
+	Unmap();
+
+	if( !pFile || uiLength == 0 )
+		return false;
+
+	static const uint64_t uiGranularity = GetMappingGranularity();
+
+	const uint64_t uiViewOffset = uiOffset - ( uiOffset % uiGranularity );
+	const uint64_t uiDelta = uiOffset - uiViewOffset;
+
+	//Can't map more than the address space can hold.
+	if( uiLength + uiDelta > std::numeric_limits<size_t>::max() )
+		return false;
+
+	const size_t uiViewSize = static_cast<size_t>( uiLength + uiDelta );
+
+#ifdef WIN32
+	HANDLE hFile = reinterpret_cast<HANDLE>( _get_osfhandle( _fileno( pFile ) ) );
+
+	if( hFile == INVALID_HANDLE_VALUE )
+		return false;
+
+	m_hMapping = CreateFileMappingA( hFile, nullptr, PAGE_READONLY, 0, 0, nullptr );
+
+	if( !m_hMapping )
+		return false;
+
+	m_pView = MapViewOfFile( m_hMapping, FILE_MAP_READ,
+							 static_cast<DWORD>( uiViewOffset >> 32 ), static_cast<DWORD>( uiViewOffset & 0xFFFFFFFF ), uiViewSize );
+
+	if( !m_pView )
+	{
+		CloseHandle( m_hMapping );
+		m_hMapping = nullptr;
+		return false;
+	}
+#else
+	void* pView = mmap64( nullptr, uiViewSize, PROT_READ, MAP_PRIVATE, fileno( pFile ), static_cast<off64_t>( uiViewOffset ) );
+
+	if( pView == MAP_FAILED )
+		return false;
+
+	//The caller is going to read the data soon, so start paging it in now.
+	posix_madvise( pView, uiViewSize, POSIX_MADV_WILLNEED );
+
+	m_pView = pView;
+#endif
+
+	m_uiViewSize = uiViewSize;
+
+	m_pData = reinterpret_cast<const uint8_t*>( m_pView ) + uiDelta;
+	m_uiSize = uiLength;
+
+	return true;
+}
+
+void CFileMapping::Unmap()
+{
+	if( !m_pView )
+		return;
+
+#ifdef WIN32
+	UnmapViewOfFile( m_pView );
+	CloseHandle( m_hMapping );
+	m_hMapping = nullptr;
+#else
+	munmap( m_pView, m_uiViewSize );
+#endif
+
+	m_pView = nullptr;
+	m_uiViewSize = 0;
+
+	m_pData = nullptr;
+	m_uiSize = 0;
+}
+
+bool CFileMapping::Prefetch( FILE* pFile, const uint64_t uiOffset, const uint64_t uiLength )
+{
+	assert( pFile );
+
+	if( !pFile || uiLength == 0 )
+		return false;
+
+#ifdef WIN32
+	//Windows can only prefetch memory that is already mapped.
+	return false;
+#else
+	return posix_fadvise64( fileno( pFile ), static_cast<off64_t>( uiOffset ), static_cast<off64_t>( uiLength ), POSIX_FADV_WILLNEED ) == 0;
+#endif
+}
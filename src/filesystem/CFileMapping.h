@@ -0,0 +1,83 @@
+#ifndef FILESYSTEM_CFILEMAPPING_H
+#define FILESYSTEM_CFILEMAPPING_H
+
+#include <cstdint>
+#include <cstdio>
+
+#include "Platform.h"
+
+/**
+*	Read-only memory mapping of a region of an open file.
+*	The region does not need to be page aligned; the mapping is expanded to the nearest page boundary internally.
+*/
+class CFileMapping final
+{
+public:
+	CFileMapping() = default;
+
+	~CFileMapping()
+	{
+		Unmap();
+	}
+
+	/**
+	*	@return Whether a region is currently mapped.
+	*/
+	bool IsMapped() const { return m_pData != nullptr; }
+
+	/**
+	*	@return Pointer to the start of the mapped region.
+	*/
+	const uint8_t* GetData() const { return m_pData; }
+
+	/**
+	*	@return Size of the mapped region, in bytes.
+	*/
+	uint64_t GetSize() const { return m_uiSize; }
+
+	/**
+	*	Maps the given region of the given file. Any previous mapping is released first.
+	*	The file may be closed once this returns; the mapping keeps its own reference to the file's contents.
+	*	@param pFile File to map. Must have been opened for reading.
+	*	@param uiOffset Offset in the file where the region starts.
+	*	@param uiLength Length of the region, in bytes. Must be larger than 0.
+	*	@return Whether the region was mapped.
+	*/
+	bool Map( FILE* pFile, const uint64_t uiOffset, const uint64_t uiLength );
+
+	/**
+	*	Releases the mapping, if any.
+	*/
+	void Unmap();
+
+	/**
+	*	Asks the OS to start reading the given region of a file into memory, so that mapping or reading it later doesn't have to wait for the disk.
+	*	Does not move the file's position.
+	*	@return Whether the OS accepted the request. Always false on platforms that can't prefetch files that aren't mapped.
+	*/
+	static bool Prefetch( FILE* pFile, const uint64_t uiOffset, const uint64_t uiLength );
+
+private:
+	/**
+	*	Page aligned start of the mapped view.
+	*/
+	void* m_pView = nullptr;
+
+	/**
+	*	Size of the mapped view, in bytes.
+	*/
+	size_t m_uiViewSize = 0;
+
+#ifdef WIN32
+	HANDLE m_hMapping = nullptr;
+#endif
+
+	const uint8_t* m_pData = nullptr;
+	uint64_t m_uiSize = 0;
+
+private:
+	CFileMapping( const CFileMapping& ) = delete;
+	CFileMapping& operator=( const CFileMapping& ) = delete;
+};
+
+#endif //FILESYSTEM_CFILEMAPPING_H
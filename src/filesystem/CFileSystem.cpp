@@ -1,5 +1,10 @@
 #include <algorithm>
 #include <cassert>
+#include <cstring>
+#include <limits>
+#include <unordered_set>
+
+#include <sys/stat.h>
 
 #include "interface.h"
 
@@ -18,6 +23,42 @@ static CCharacterSet g_BreakSet( "{}()'" );
 static CCharacterSet g_BreakSetIncludingColons( "{}()':" );
 
 static CFileSystem g_FileSystem;
+
+/**
+*	Splits a list of files separated by whitespace, commas or semicolons into path index keys.
+*	Files that can't be looked up in the path index are skipped.
+*/
+std::vector<std::string> ParseResourceList( const char* pszList )
+{
+	std::vector<std::string> keys;
+
+	if( !pszList )
+		return keys;
+
+	char szPath[ MAX_PATH ];
+	char szKey[ MAX_PATH ];
+
+	while( *pszList )
+	{
+		const size_t uiLength = strcspn( pszList, " \t\r\n,;" );
+
+		if( uiLength > 0 && uiLength < sizeof( szPath ) )
+		{
+			strncpy( szPath, pszList, uiLength );
+			szPath[ uiLength ] = '\0';
+
+			if( CPathIndex::NormalizePath( szPath, szKey, sizeof( szKey ) ) )
+				keys.emplace_back( szKey );
+		}
+
+		pszList += uiLength;
+
+		if( *pszList )
+			++pszList;
+	}
+
+	return keys;
+}
 }
 
 /*
@@ -28,7 +69,17 @@ EXPOSE_SINGLE_INTERFACE_GLOBALVAR( CFileSystem, IFileSystem2, FILESYSTEM2_INTERF
 
 void CFileSystem::RemoveAllSearchPaths()
 {
+	for( const auto& searchPath : m_SearchPaths )
+	{
+		if( searchPath->IsPackFile() )
+			DetachMappings( searchPath->packFile->GetFile() );
+	}
+
 	m_SearchPaths.clear();
+
+	m_PathIndex.Invalidate( m_SearchPaths );
+	m_Preloader.Clear();
+	m_BlockCache.Clear();
 }
 
 void CFileSystem::AddSearchPath( const char *pPath, const char *pathID )
@@ -54,12 +105,18 @@ bool CFileSystem::RemoveSearchPath( const char *pPath )
 
 	do
 	{
+		if( ( *it )->IsPackFile() )
+			DetachMappings( ( *it )->packFile->GetFile() );
+
 		m_SearchPaths.erase( it );
 
 		it = FindSearchPath( szPath );
 	}
 	while( it != m_SearchPaths.end() );
 
+	m_PathIndex.Invalidate( m_SearchPaths );
+	m_Preloader.Clear();
+
 	return true;
 }
 
@@ -89,7 +146,10 @@ void CFileSystem::RemoveFile( const char *pRelativePath, const char *pathID )
 		path = fs::path( searchPath->szPath ) / szPath;
 
 		if( fs::remove( path, error ) )
+		{
+			InvalidatePath( szPath );
 			break;
+		}
 	}
 }
 
@@ -118,6 +178,8 @@ void CFileSystem::CreateDirHierarchy( const char *path, const char *pathID )
 
 		fs::create_directories( directories, error );
 
+		InvalidatePath( szPath );
+
 		return;
 	}
 
@@ -135,6 +197,8 @@ void CFileSystem::CreateDirHierarchy( const char *path, const char *pathID )
 
 			fs::create_directories( directories, error );
 
+			InvalidatePath( szPath );
+
 			return;
 		}
 	}
@@ -151,14 +215,38 @@ bool CFileSystem::FileExists( const char *pFileName )
 
 	UTIL_FixSlashes( szPath );
 
+	++m_Stats.uiLookups;
+
+	if( m_bUsePathIndex )
+	{
+		char szKey[ MAX_PATH ];
+
+		if( CPathIndex::NormalizePath( szPath, szKey, sizeof( szKey ) ) )
+		{
+			++m_Stats.uiIndexedLookups;
+
+			return m_PathIndex.Find( szKey, nullptr ) != nullptr;
+		}
+	}
+
 	fs::path path;
 
 	std::error_code error;
 
 	for( const auto& searchPath : m_SearchPaths )
 	{
+		if( searchPath->IsPackFile() )
+		{
+			if( searchPath->packDirectory.Find( szPath ) )
+				return true;
+
+			continue;
+		}
+
 		path = fs::path( searchPath->szPath ) / szPath;
 
+		++m_Stats.uiDiskQueries;
+
 		if( fs::exists( path, error ) )
 		{
 			return true;
@@ -179,14 +267,33 @@ bool CFileSystem::IsDirectory( const char *pFileName )
 
 	UTIL_FixSlashes( szPath );
 
+	++m_Stats.uiLookups;
+
+	if( m_bUsePathIndex )
+	{
+		char szKey[ MAX_PATH ];
+
+		if( CPathIndex::NormalizePath( szPath, szKey, sizeof( szKey ) ) )
+		{
+			++m_Stats.uiIndexedLookups;
+
+			return m_PathIndex.Find( szKey, nullptr, CPathIndex::FindFlag::DIRECTORIES_ONLY ) != nullptr;
+		}
+	}
+
 	fs::path path;
 
 	std::error_code error;
 
 	for( const auto& searchPath : m_SearchPaths )
 	{
+		if( searchPath->IsPackFile() )
+			continue;
+
 		path = fs::path( searchPath->szPath ) / szPath;
 
+		++m_Stats.uiDiskQueries;
+
 		if( fs::is_directory( path, error ) )
 			return true;
 	}
@@ -230,9 +337,10 @@ FileHandle_t CFileSystem::Open( const char *pFileName, const char *pOptions, con
 
 			if( file.IsOpen() )
 			{
-				m_OpenedFiles.emplace_back( std::make_unique<CFileHandle>( std::move( file ) ) );
+				//The file may have been created.
+				InvalidatePath( szPath );
 
-				return reinterpret_cast<FileHandle_t>( m_OpenedFiles.back().get() );
+				return m_OpenedFiles.Add( std::move( file ) );
 			}
 
 			break;
@@ -241,14 +349,62 @@ FileHandle_t CFileSystem::Open( const char *pFileName, const char *pOptions, con
 		return FILESYSTEM_INVALID_HANDLE;
 	}
 
+	++m_Stats.uiLookups;
+
+	if( m_bUsePathIndex )
+	{
+		char szKey[ MAX_PATH ];
+
+		if( CPathIndex::NormalizePath( szPath, szKey, sizeof( szKey ) ) )
+		{
+			++m_Stats.uiIndexedLookups;
+
+			auto pLocation = m_PathIndex.Find( szKey, pathID, CPathIndex::FindFlag::FILES_ONLY );
+
+			if( !pLocation )
+				return FILESYSTEM_INVALID_HANDLE;
+
+			FileHandle_t hFile;
+
+			if( auto data = m_Preloader.Take( szKey, pLocation->pSearchPath ) )
+				hFile = m_OpenedFiles.Add( CFileHandle( std::string( szPath ), std::move( data ) ) );
+			else if( m_bUseBlockCache )
+			{
+				//The index remembers the status of loose files, so they aren't checked on disk every time they're opened.
+				CPathIndex::FileStatus_t status;
+
+				if( !pLocation->pPackEntry && !m_PathIndex.GetFileStatus( *pLocation, status ) )
+					return FILESYSTEM_INVALID_HANDLE;
+
+				hFile = OpenCachedFile( *pLocation->pSearchPath, pLocation->pPackEntry, pLocation->pPackEntry ? szPath : pLocation->szActualPath.c_str(), pOptions,
+										pLocation->pPackEntry ? nullptr : &status );
+			}
+			else if( pLocation->pPackEntry )
+				hFile = OpenPackEntry( *pLocation->pSearchPath, *pLocation->pPackEntry, szPath );
+			else
+				hFile = OpenLooseFile( *pLocation->pSearchPath, pLocation->szActualPath.c_str(), pOptions );
+
+			if( hFile != FILESYSTEM_INVALID_HANDLE )
+				RecordLevelLoadAccess( szPath, hFile );
+
+			return hFile;
+		}
+	}
+
 	//Reading from a file, consider all paths.
 	for( const auto& searchPath : m_SearchPaths )
 	{
 		if( pathID && ( !searchPath->pszPathID || strcmp( pathID, searchPath->pszPathID ) != 0 ) )
 			continue;
 
-		if( auto pFileHandle = FindFile( *searchPath, szPath, pOptions ) )
-			return reinterpret_cast<FileHandle_t>( pFileHandle );
+		auto hFile = FindFile( *searchPath, szPath, pOptions, m_bUseBlockCache );
+
+		if( hFile != FILESYSTEM_INVALID_HANDLE )
+		{
+			RecordLevelLoadAccess( szPath, hFile );
+
+			return hFile;
+		}
 	}
 
 	return FILESYSTEM_INVALID_HANDLE;
@@ -259,30 +415,21 @@ void CFileSystem::Close( FileHandle_t file )
 	if( file == FILESYSTEM_INVALID_HANDLE )
 		return;
 
-	auto pFile = reinterpret_cast<CFileHandle*>( file );
-
-	auto position = m_OpenedFiles.begin();
+	auto pFile = m_OpenedFiles.Get( file );
 
-	for( auto end = m_OpenedFiles.end(); position != end; ++position )
+	if( !pFile )
 	{
-		if( position->get() == pFile )
-			break;
+		Warning( FILESYSTEM_WARNING_CRITICAL, "CFileSystem::Close: Closing file that was already closed, or not opened!\n" );
+		return;
 	}
 
-	if( position == m_OpenedFiles.end() )
-		return;
+	Warning( FILESYSTEM_WARNING_REPORTALLACCESSES, "CFileSystem::Close: Closing file \"%s\"\n", pFile->GetFileName().c_str() );
 
-	if( pFile->IsOpen() )
-	{
-		Warning( FILESYSTEM_WARNING_REPORTALLACCESSES, "CFileSystem::Close: Closing file \"%s\"\n", pFile->GetFileName().c_str() );
-		pFile->Close();
-	}
-	else
-	{
-		Warning( FILESYSTEM_WARNING_CRITICAL, "CFileSystem::Close: Closing file that was already closed, or not opened!\n" );
-	}
+	//Pack entries share the pack file's FILE*, which stays open.
+	if( !pFile->IsPackEntry() )
+		DetachMappings( pFile->GetFile() );
 
-	m_OpenedFiles.erase( position );
+	m_OpenedFiles.Remove( file );
 }
 
 void CFileSystem::Seek( FileHandle_t file, int pos, FileSystemSeek_t seekType )
@@ -317,7 +464,7 @@ void CFileSystem::FileTimeToString( char* pStrip, int maxCharsIncludingTerminato
 
 bool CFileSystem::IsOk( FileHandle_t file )
 {
-	auto pFile = reinterpret_cast<CFileHandle*>( file );
+	auto pFile = m_OpenedFiles.Get( file );
 
 	if( !pFile )
 	{
@@ -331,12 +478,15 @@ bool CFileSystem::IsOk( FileHandle_t file )
 		return 0;
 	}
 
+	if( pFile->IsPositional() )
+		return !pFile->HasReadError();
+
 	return ferror( pFile->GetFile() ) == 0;
 }
 
 void CFileSystem::Flush( FileHandle_t file )
 {
-	auto pFile = reinterpret_cast<CFileHandle*>( file );
+	auto pFile = m_OpenedFiles.Get( file );
 
 	if( !pFile )
 	{
@@ -350,12 +500,16 @@ void CFileSystem::Flush( FileHandle_t file )
 		return;
 	}
 
+	//Pack entries and preloaded files are read only, and don't read through a stream.
+	if( pFile->IsPositional() )
+		return;
+
 	fflush( pFile->GetFile() );
 }
 
 bool CFileSystem::EndOfFile( FileHandle_t file )
 {
-	auto pFile = reinterpret_cast<CFileHandle*>( file );
+	auto pFile = m_OpenedFiles.Get( file );
 
 	if( !pFile )
 	{
@@ -369,11 +523,9 @@ bool CFileSystem::EndOfFile( FileHandle_t file )
 		return 0;
 	}
 
-	if( pFile->IsPackEntry() )
+	if( pFile->IsPositional() )
 	{
-		const auto position = ftell64( pFile->GetFile() );
-
-		return static_cast<uint64_t>( position ) >= pFile->GetStartOffset() + pFile->GetLength();
+		return pFile->GetPosition() >= pFile->GetLength();
 	}
 
 	return !!feof( pFile->GetFile() );
@@ -381,7 +533,7 @@ bool CFileSystem::EndOfFile( FileHandle_t file )
 
 int CFileSystem::Read( void* pOutput, int size, FileHandle_t file )
 {
-	auto pFile = reinterpret_cast<CFileHandle*>( file );
+	auto pFile = m_OpenedFiles.Get( file );
 
 	if( !pFile )
 	{
@@ -395,37 +547,31 @@ int CFileSystem::Read( void* pOutput, int size, FileHandle_t file )
 		return 0;
 	}
 
-	if( pFile->IsPackEntry() )
-	{
-		if( pFile->GetLength() == 0 )
-			return 0;
-
-		const auto position = ftell64( pFile->GetFile() );
+	const uint64_t uiStart = m_bRecordingLevelLoad ? Tell64( file ) : 0;
 
-		const auto relativePos = position - pFile->GetStartOffset();
+	int iRead;
 
-		if( relativePos >= pFile->GetLength() )
+	if( pFile->IsPositional() )
+	{
+		if( size <= 0 )
 			return 0;
 
-		auto result = fread( pOutput, 1, size, pFile->GetFile() );
-
-		if( relativePos + size >= pFile->GetLength() + 1 )
-		{
-			//Adjust the amount that was read to match the file's contents.
-			const auto maxRead = static_cast<size_t>( ( pFile->GetLength() + 1 ) - relativePos );
-
-			result = std::min( result, maxRead );
-		}
-
-		return result;
+		iRead = static_cast<int>( pFile->ReadEntry( pOutput, static_cast<size_t>( size ) ) );
+	}
+	else
+	{
+		iRead = fread( pOutput, 1, size, pFile->GetFile() );
 	}
 
-	return fread( pOutput, 1, size, pFile->GetFile() );
+	if( iRead > 0 )
+		RecordLevelLoadRead( *pFile, uiStart, static_cast<uint64_t>( iRead ) );
+
+	return iRead;
 }
 
 int CFileSystem::Write( void const* pInput, int size, FileHandle_t file )
 {
-	auto pFile = reinterpret_cast<CFileHandle*>( file );
+	auto pFile = m_OpenedFiles.Get( file );
 
 	if( !pFile )
 	{
@@ -439,12 +585,18 @@ int CFileSystem::Write( void const* pInput, int size, FileHandle_t file )
 		return 0;
 	}
 
+	if( pFile->IsPreloaded() )
+	{
+		Warning( FILESYSTEM_WARNING_CRITICAL, "CFileSystem::Write: Attempted to write to preloaded file \"%s\"!\n", pFile->GetFileName().c_str() );
+		return 0;
+	}
+
 	return fwrite( pInput, 1, size, pFile->GetFile() );
 }
 
 char *CFileSystem::ReadLine( char *pOutput, int maxChars, FileHandle_t file )
 {
-	auto pFile = reinterpret_cast<CFileHandle*>( file );
+	auto pFile = m_OpenedFiles.Get( file );
 
 	if( !pFile )
 	{
@@ -458,26 +610,23 @@ char *CFileSystem::ReadLine( char *pOutput, int maxChars, FileHandle_t file )
 		return nullptr;
 	}
 
-	if( pFile->IsPackEntry() )
-	{
-		if( pFile->GetLength() == 0 )
-			return nullptr;
-
-		const auto position = ftell64( pFile->GetFile() );
+	const uint64_t uiStart = m_bRecordingLevelLoad ? Tell64( file ) : 0;
 
-		const auto relativePos = position - pFile->GetStartOffset();
+	char* pszResult;
 
-		if( relativePos >= pFile->GetLength() )
-			return nullptr;
-
-		//The length is the number of bytes in the file, so allow that much to be read.
-		if( relativePos + maxChars >= pFile->GetLength() + 1 )
-		{
-			maxChars = static_cast<int>( ( pFile->GetLength() + 1 ) - relativePos );
-		}
+	if( pFile->IsPositional() )
+	{
+		pszResult = pFile->ReadEntryLine( pOutput, maxChars );
+	}
+	else
+	{
+		pszResult = fgets( pOutput, maxChars, pFile->GetFile() );
 	}
 
-	return fgets( pOutput, maxChars, pFile->GetFile() );
+	if( pszResult && m_bRecordingLevelLoad )
+		RecordLevelLoadRead( *pFile, uiStart, Tell64( file ) - uiStart );
+
+	return pszResult;
 }
 
 int CFileSystem::FPrintf( FileHandle_t file, const char *pFormat, ... )
@@ -493,6 +642,54 @@ int CFileSystem::FPrintf( FileHandle_t file, const char *pFormat, ... )
 	return result;
 }
 
+void *CFileSystem::GetReadBuffer( FileHandle_t file, int *outBufferSize, bool )
+{
+	//Mapped files are always available, so failIfNotInCache doesn't matter.
+	if( outBufferSize )
+		*outBufferSize = 0;
+
+	auto pFile = m_OpenedFiles.Get( file );
+
+	if( !pFile )
+	{
+		Warning( FILESYSTEM_WARNING_CRITICAL, "CFileSystem::GetReadBuffer: Attempted to get buffer of null file handle!\n" );
+		return nullptr;
+	}
+
+	if( !pFile->IsOpen() )
+	{
+		Warning( FILESYSTEM_WARNING_CRITICAL, "CFileSystem::GetReadBuffer: Attempted to get buffer of handle with null file pointer!\n" );
+		return nullptr;
+	}
+
+	//The size is reported as an int.
+	if( pFile->GetLength() == 0 || pFile->GetLength() > static_cast<uint64_t>( std::numeric_limits<int>::max() ) )
+		return nullptr;
+
+	const uint8_t* pData = AcquireMapping( *pFile, "GetReadBuffer" );
+
+	if( !pData )
+		return nullptr;
+
+	RecordLevelLoadMapping( *pFile );
+
+	if( outBufferSize )
+		*outBufferSize = static_cast<int>( pFile->GetLength() );
+
+	//Callers must not write to the buffer; the mapping is read-only.
+	return const_cast<uint8_t*>( pData );
+}
+
+void CFileSystem::ReleaseReadBuffer( FileHandle_t, void *readBuffer )
+{
+	if( !readBuffer )
+		return;
+
+	//Looked up by address, so it can be released after its file has been closed.
+	if( !ReleaseMapping( readBuffer ) )
+		Warning( FILESYSTEM_WARNING_CRITICAL, "CFileSystem::ReleaseReadBuffer: Attempted to release buffer that was not returned by GetReadBuffer!\n" );
+}
+
 const char *CFileSystem::FindFirst( const char *pWildCard, FileFindHandle_t *pHandle, const char *pathID )
 {
 	return FindFirstEx( pWildCard, pHandle, FileSystemFindFlag::NONE, pathID );
@@ -541,14 +738,17 @@ const char *CFileSystem::FindNext( FileFindHandle_t handle )
 
 				data.currentPath = path;
 
+				data.matches.clear();
+				data.uiNextMatch = 0;
+
 				if( searchPath->IsPackFile() )
 				{
-					data.pack_iterator = searchPath->packEntries.begin();
+					searchPath->directoryTree.Find( nullptr, &searchPath->packDirectory, data.filter, data.matches );
 					data.flags |= FindFileFlag::IS_PACK_FILE;
 				}
 				else
 				{
-					data.iterator = fs::recursive_directory_iterator( searchPath->szPath );
+					searchPath->directoryTree.Find( searchPath->szPath, nullptr, data.filter, data.matches );
 					data.flags &= ~FindFileFlag::IS_PACK_FILE;
 				}
 
@@ -568,41 +768,9 @@ const char *CFileSystem::FindNext( FileFindHandle_t handle )
 			return nullptr;
 		}
 
-		auto searchPath = ( *data.currentPath ).get();
-
-		if( searchPath->IsPackFile() )
-		{
-			for( auto end = searchPath->packEntries.end(); data.pack_iterator != end; )
-			{
-				data.szFileName = data.pack_iterator->second->GetFileName();
-
-				++data.pack_iterator;
-
-				//Matches the wildcard.
-				if( UTIL_TokenMatches( data.szFileName.c_str(), data.szFilter.c_str() ) )
-					return data.szFileName.c_str();
-			}
-		}
-		else
-		{
-			for( auto end = fs::recursive_directory_iterator(); data.iterator != end; )
-			{
-				data.entry = *data.iterator;
-				data.szFileName = data.entry.path().u8string();
-
-				//Trim the search path so it returns uniform paths for use in I/O.
-				if( *searchPath->szPath )
-				{
-					data.szFileName = data.szFileName.substr( strlen( searchPath->szPath ) + 1 );
-				}
-
-				++data.iterator;
-
-				//Matches the wildcard.
-				if( UTIL_TokenMatches( data.szFileName.c_str(), data.szFilter.c_str() ) )
-					return data.szFileName.c_str();
-			}
-		}
+		//Matches are relative to the search path, so they can be used for I/O directly.
+		if( !data.EndOfPath() )
+			return data.matches[ data.uiNextMatch++ ].szPath.c_str();
 
 		//The directory was completely empty or didn't have matching contents, so go to the next one.
 	}
@@ -624,7 +792,11 @@ bool CFileSystem::FindIsDirectory( FileFindHandle_t handle )
 		return false;
 	}
 
-	return fs::is_directory( data.entry.status() );
+	//Refers to the match that FindNext returned last.
+	if( data.uiNextMatch == 0 || data.uiNextMatch > data.matches.size() )
+		return false;
+
+	return data.matches[ data.uiNextMatch - 1 ].bIsDirectory;
 }
 
 void CFileSystem::FindClose( FileFindHandle_t handle )
@@ -670,14 +842,45 @@ const char *CFileSystem::GetLocalPath( const char *pFileName, char *pLocalPath,
 
 	UTIL_FixSlashes( szPath );
 
+	++m_Stats.uiLookups;
+
 	fs::path path;
 
+	if( m_bUsePathIndex )
+	{
+		char szKey[ MAX_PATH ];
+
+		if( CPathIndex::NormalizePath( szPath, szKey, sizeof( szKey ) ) )
+		{
+			++m_Stats.uiIndexedLookups;
+
+			auto pLocation = m_PathIndex.Find( szKey, nullptr, CPathIndex::FindFlag::LOOSE_ONLY );
+
+			if( !pLocation )
+				return nullptr;
+
+			path = fs::path( pLocation->pSearchPath->szPath ) / pLocation->szActualPath;
+
+			path.make_preferred();
+
+			strncpy( pLocalPath, path.u8string().c_str(), localPathBufferSize );
+			pLocalPath[ localPathBufferSize - 1 ] = '\0';
+
+			return pLocalPath;
+		}
+	}
+
 	std::error_code error;
 
 	for( const auto& searchPath : m_SearchPaths )
 	{
+		if( searchPath->IsPackFile() )
+			continue;
+
 		path = fs::path( searchPath->szPath ) / szPath;
 
+		++m_Stats.uiDiskQueries;
+
 		if( fs::exists( path, error ) )
 		{
 			path.make_preferred();
@@ -852,12 +1055,12 @@ bool CFileSystem::GetCurrentDirectory( char* pDirectory, int maxlen )
 	 
 void CFileSystem::PrintOpenedFiles()
 {
-	for( const auto& file : m_OpenedFiles )
+	m_OpenedFiles.ForEach( [ this ]( const CFileHandle& file )
 	{
-		const char* const pszName = !file->GetFileName().empty() ? file->GetFileName().c_str() : "???";
+		const char* const pszName = !file.GetFileName().empty() ? file.GetFileName().c_str() : "???";
 
 		Warning( FILESYSTEM_WARNING_REPORTUNCLOSED, "File %s was never closed\n", pszName );
-	}
+	} );
 }
 	 
 void CFileSystem::SetWarningFunc( FileSystemWarningFunc pfnWarning )
@@ -870,9 +1073,113 @@ void CFileSystem::SetWarningLevel( FileWarningLevel_t level )
 	m_WarningLevel = level;
 }
 
+void CFileSystem::LogLevelLoadStarted( const char *name )
+{
+	if( !name || !( *name ) )
+		return;
+
+	m_szLevelLoadName = name;
+
+	m_CurrentLevelLoad = {};
+
+	if( m_bReplayLevelLoads )
+		ReplayLevelLoadTrace( name );
+
+	m_LevelLoadTrace.Clear();
+
+	m_bRecordingLevelLoad = true;
+
+	m_LevelLoadStart = std::chrono::steady_clock::now();
+}
+
+void CFileSystem::LogLevelLoadFinished( const char * )
+{
+	if( !m_bRecordingLevelLoad )
+		return;
+
+	m_bRecordingLevelLoad = false;
+
+	m_CurrentLevelLoad.uiMicroseconds = static_cast<uint64_t>(
+		std::chrono::duration_cast<std::chrono::microseconds>( std::chrono::steady_clock::now() - m_LevelLoadStart ).count() );
+
+	m_CurrentLevelLoad.uiTracedFiles = static_cast<uint32_t>( m_LevelLoadTrace.GetEntries().size() );
+
+	m_LastLevelLoad = m_CurrentLevelLoad;
+
+	WriteLevelLoadTrace( m_szLevelLoadName.c_str() );
+}
+
+int CFileSystem::HintResourceNeed( const char *hintlist, int forgetEverything )
+{
+	if( forgetEverything )
+		m_Preloader.Clear();
+
+	int iQueued = 0;
+
+	for( const auto& szKey : ParseResourceList( hintlist ) )
+	{
+		if( QueuePreload( szKey.c_str() ) )
+			++iQueued;
+	}
+
+	return iQueued;
+}
+
+int CFileSystem::PauseResourcePreloading()
+{
+	return m_Preloader.SetPaused( true );
+}
+
+int CFileSystem::ResumeResourcePreloading()
+{
+	return m_Preloader.SetPaused( false );
+}
+
+bool CFileSystem::IsFileImmediatelyAvailable( const char *pFileName )
+{
+	char szKey[ MAX_PATH ];
+
+	//Files that are still being preloaded would be read twice if they were opened now.
+	if( CPathIndex::NormalizePath( pFileName, szKey, sizeof( szKey ) ) )
+		return !m_Preloader.IsPending( szKey );
+
+	return true;
+}
+
+WaitForResourcesHandle_t CFileSystem::WaitForResources( const char *resourcelist )
+{
+	const auto keys = ParseResourceList( resourcelist );
+
+	for( const auto& szKey : keys )
+		QueuePreload( szKey.c_str() );
+
+	return m_Preloader.CreateWait( keys );
+}
+
+bool CFileSystem::GetWaitForResourcesProgress( WaitForResourcesHandle_t handle, float *progress /* out */, bool *complete /* out */ )
+{
+	float flProgress;
+	bool bComplete;
+
+	const bool bResult = m_Preloader.GetWaitProgress( handle, flProgress, bComplete );
+
+	if( progress )
+		*progress = flProgress;
+
+	if( complete )
+		*complete = bComplete;
+
+	return bResult;
+}
+
+void CFileSystem::CancelWaitForResources( WaitForResourcesHandle_t handle )
+{
+	m_Preloader.CancelWait( handle );
+}
+
 int CFileSystem::SetVBuf( FileHandle_t stream, char *buffer, int mode, long size )
 {
-	auto pFile = reinterpret_cast<CFileHandle*>( stream );
+	auto pFile = m_OpenedFiles.Get( stream );
 
 	if( !pFile )
 	{
@@ -886,6 +1193,10 @@ int CFileSystem::SetVBuf( FileHandle_t stream, char *buffer, int mode, long size
 		return 0;
 	}
 
+	//Pack entries and preloaded files have their own buffer, and must not change the pack file's buffering.
+	if( pFile->IsPositional() )
+		return 0;
+
 	return setvbuf( pFile->GetFile(), buffer, mode, size );
 }
 
@@ -899,7 +1210,7 @@ void CFileSystem::GetInterfaceVersion( char *p, int maxlen )
 }
 
 template<typename PackType>
-bool ProcessPackFile( CFileSystem& fileSystem, const char* pszFileName, FILE* pFile, CSearchPath::Entries_t& entries )
+bool ProcessPackFile( CFileSystem& fileSystem, const char* pszFileName, FILE* pFile, CPackDirectory& directory )
 {
 	assert( pFile );
 
@@ -939,16 +1250,25 @@ bool ProcessPackFile( CFileSystem& fileSystem, const char* pszFileName, FILE* pF
 		return false;
 	}
 
+	//Names aren't guaranteed to be null terminated if they use the whole buffer.
+	size_t uiNameBytes = 0;
+
 	for( size_t uiIndex = 0; uiIndex < numFiles; ++uiIndex )
 	{
-		auto& packEntry = packEntries[ uiIndex ];
-
-		auto entry = std::make_unique<CPackFileEntry>( std::move( fs::path( packEntry.szFileName ).make_preferred().u8string() ), packEntry.filepos, packEntry.filelen );
-
-		entries.emplace( std::make_pair( entry->GetFileName().c_str(), std::move( entry ) ) );
+		uiNameBytes += strnlen( packEntries[ uiIndex ].szFileName, PackType::ENTRY_NAME_MAX_LENGTH );
 	}
 
-	return true;
+	directory.Reserve( numFiles, uiNameBytes );
+
+	for( size_t uiIndex = 0; uiIndex < numFiles; ++uiIndex )
+	{
+		const auto& packEntry = packEntries[ uiIndex ];
+
+		directory.Add( packEntry.szFileName, strnlen( packEntry.szFileName, PackType::ENTRY_NAME_MAX_LENGTH ),
+					   LittleValue( packEntry.filepos ), LittleValue( packEntry.filelen ) );
+	}
+
+	return true;
 }
 
 bool CFileSystem::AddPackFile( const char *fullpath, const char *pathID )
@@ -981,8 +1301,14 @@ FileHandle_t CFileSystem::OpenFromCacheForRead( const char *pFileName, const cha
 		if( pathID && ( !searchPath->pszPathID || strcmp( pathID, searchPath->pszPathID ) != 0 ) )
 			continue;
 
-		if( auto pFileHandle = FindFile( *searchPath, szPath, pOptions ) )
-			return reinterpret_cast<FileHandle_t>( pFileHandle );
+		auto hFile = FindFile( *searchPath, szPath, pOptions, true );
+
+		if( hFile != FILESYSTEM_INVALID_HANDLE )
+		{
+			RecordLevelLoadAccess( szPath, hFile );
+
+			return hFile;
+		}
 	}
 
 	return FILESYSTEM_INVALID_HANDLE;
@@ -995,7 +1321,7 @@ void CFileSystem::AddSearchPathNoWrite( const char *pPath, const char *pathID )
 
 void CFileSystem::Seek64( FileHandle_t file, int64_t pos, FileSystemSeek_t seekType )
 {
-	auto pFile = reinterpret_cast<CFileHandle*>( file );
+	auto pFile = m_OpenedFiles.Get( file );
 
 	if( !pFile )
 	{
@@ -1009,26 +1335,31 @@ void CFileSystem::Seek64( FileHandle_t file, int64_t pos, FileSystemSeek_t seekT
 		return;
 	}
 
-	int64_t position = pos;
-
-	if( pFile->IsPackEntry() )
+	if( pFile->IsPositional() )
 	{
+		int64_t position;
+
 		switch( seekType )
 		{
-		case FILESYSTEM_SEEK_HEAD:
+		case FILESYSTEM_SEEK_HEAD:		position = pos; break;
+		case FILESYSTEM_SEEK_CURRENT:	position = static_cast<int64_t>( pFile->GetPosition() ) + pos; break;
+		case FILESYSTEM_SEEK_TAIL:		position = static_cast<int64_t>( pFile->GetLength() ) + pos; break;
+		default:
 			{
-				position += pFile->GetStartOffset();
-				break;
+				Warning( FILESYSTEM_WARNING_CRITICAL, "CFileSystem::Seek: invalid seek type '%d'\n", seekType );
+				return;
 			}
+		}
 
-		case FILESYSTEM_SEEK_TAIL:
-			{
-				//Adjust end position to the file's end
-				position += pFile->GetStartOffset() + pFile->GetLength();
-				seekType = FILESYSTEM_SEEK_HEAD;
-				break;
-			}
+		if( position < 0 )
+		{
+			Warning( FILESYSTEM_WARNING_CRITICAL, "CFileSystem::Seek: Attempted to seek before the start of \"%s\"\n", pFile->GetFileName().c_str() );
+			return;
 		}
+
+		pFile->SetPosition( static_cast<uint64_t>( position ) );
+
+		return;
 	}
 
 	int origin;
@@ -1045,12 +1376,12 @@ void CFileSystem::Seek64( FileHandle_t file, int64_t pos, FileSystemSeek_t seekT
 		}
 	}
 
-	fseek64( pFile->GetFile(), position, origin );
+	fseek64( pFile->GetFile(), pos, origin );
 }
 
 uint64_t CFileSystem::Tell64( FileHandle_t file )
 {
-	auto pFile = reinterpret_cast<CFileHandle*>( file );
+	auto pFile = m_OpenedFiles.Get( file );
 
 	if( !pFile )
 	{
@@ -1064,11 +1395,9 @@ uint64_t CFileSystem::Tell64( FileHandle_t file )
 		return 0;
 	}
 
-	if( pFile->IsPackEntry() )
+	if( pFile->IsPositional() )
 	{
-		const auto position = ftell64( pFile->GetFile() );
-
-		return position - pFile->GetStartOffset();
+		return pFile->GetPosition();
 	}
 
 	return ftell64( pFile->GetFile() );
@@ -1076,7 +1405,7 @@ uint64_t CFileSystem::Tell64( FileHandle_t file )
 
 uint64_t CFileSystem::Size64( FileHandle_t file )
 {
-	auto pFile = reinterpret_cast<CFileHandle*>( file );
+	auto pFile = m_OpenedFiles.Get( file );
 
 	if( !pFile )
 	{
@@ -1125,9 +1454,7 @@ int64_t CFileSystem::GetFileTimeEx( const char *pFileName )
 	{
 		if( searchPath->IsPackFile() )
 		{
-			auto it = searchPath->packEntries.find( szPath );
-
-			if( it != searchPath->packEntries.end() )
+			if( searchPath->packDirectory.Find( szPath ) )
 			{
 				//Use the pack file's file time. - Solokiller
 				return std::chrono::duration_cast<std::chrono::seconds>( fs::last_write_time( searchPath->szPath, error ).time_since_epoch() ).count();
@@ -1160,7 +1487,7 @@ void CFileSystem::FileTimeToStringEx( char* pStrip, int maxCharsIncludingTermina
 
 int CFileSystem::VFPrintf( FileHandle_t file, const char *pFormat, va_list list )
 {
-	auto pFile = reinterpret_cast<CFileHandle*>( file );
+	auto pFile = m_OpenedFiles.Get( file );
 
 	if( !pFile )
 	{
@@ -1174,6 +1501,12 @@ int CFileSystem::VFPrintf( FileHandle_t file, const char *pFormat, va_list list
 		return 0;
 	}
 
+	if( pFile->IsPreloaded() )
+	{
+		Warning( FILESYSTEM_WARNING_CRITICAL, "CFileSystem::FPrintf: Attempted to format print to preloaded file \"%s\"!\n", pFile->GetFileName().c_str() );
+		return 0;
+	}
+
 	const auto result = vfprintf( pFile->GetFile(), pFormat, list );
 
 	return result;
@@ -1196,7 +1529,7 @@ const char *CFileSystem::FindFirstEx( const char *pWildCard, FileFindHandle_t *p
 	if( flags & FileSystemFindFlag::SKIP_IDENTICAL_PATHS )
 		data.flags |= FindFileFlag::SKIP_IDENTICAL_PATHS;
 
-	data.szFilter = std::move( fs::path( szPath ).make_preferred().u8string() );
+	data.filter = CWildcardPattern( fs::path( szPath ).make_preferred().u8string().c_str() );
 
 	if( pathID )
 	{
@@ -1267,6 +1600,130 @@ bool CFileSystem::FullPathToRelativePathEx( const char *pFullpath, char *pRelati
 	return false;
 }
 
+const void* CFileSystem::MapFile( FileHandle_t file, uint64_t& uiSize )
+{
+	uiSize = 0;
+
+	auto pFile = m_OpenedFiles.Get( file );
+
+	if( !pFile )
+	{
+		Warning( FILESYSTEM_WARNING_CRITICAL, "CFileSystem::MapFile: Attempted to map null file handle!\n" );
+		return nullptr;
+	}
+
+	if( !pFile->IsOpen() )
+	{
+		Warning( FILESYSTEM_WARNING_CRITICAL, "CFileSystem::MapFile: Attempted to map handle with null file pointer!\n" );
+		return nullptr;
+	}
+
+	//Nothing to map.
+	if( pFile->GetLength() == 0 )
+		return nullptr;
+
+	const uint8_t* pData = AcquireMapping( *pFile, "MapFile" );
+
+	if( !pData )
+		return nullptr;
+
+	RecordLevelLoadMapping( *pFile );
+
+	uiSize = pFile->GetLength();
+
+	return pData;
+}
+
+void CFileSystem::UnmapFile( const void* pData )
+{
+	if( !pData )
+		return;
+
+	if( !ReleaseMapping( pData ) )
+		Warning( FILESYSTEM_WARNING_CRITICAL, "CFileSystem::UnmapFile: Attempted to unmap data that was not mapped by the filesystem!\n" );
+}
+
+void CFileSystem::SetPathIndexEnabled( bool bEnabled )
+{
+	m_bUsePathIndex = bEnabled;
+}
+
+bool CFileSystem::IsPathIndexEnabled()
+{
+	return m_bUsePathIndex;
+}
+
+void CFileSystem::GetStats( FileSystemStats_t& stats )
+{
+	stats = m_Stats;
+
+	stats.uiDiskQueries += m_PathIndex.GetNumDiskQueries();
+	stats.uiIndexedPaths = m_PathIndex.GetNumPaths();
+
+	stats.uiPackDirectoryBytes = 0;
+
+	for( const auto& searchPath : m_SearchPaths )
+	{
+		stats.uiPackDirectoryBytes += searchPath->packDirectory.GetMemoryUsage();
+		stats.uiDiskQueries += searchPath->directoryTree.GetNumDiskQueries();
+	}
+
+	CResourcePreloader::Stats_t preloadStats;
+
+	m_Preloader.GetStats( preloadStats );
+
+	stats.uiPreloadHits = preloadStats.uiHits;
+	stats.uiPreloadedFiles = preloadStats.uiCachedFiles;
+	stats.uiPreloadedBytes = preloadStats.uiCachedBytes;
+
+	CBlockCache::Stats_t blockCacheStats;
+
+	m_BlockCache.GetStats( blockCacheStats );
+
+	stats.uiBlockCacheHits = blockCacheStats.uiHits;
+	stats.uiBlockCacheMisses = blockCacheStats.uiMisses;
+	stats.uiBlockCacheEvictions = blockCacheStats.uiEvictions;
+	stats.uiBlockCacheBlocks = blockCacheStats.uiCachedBlocks;
+	stats.uiBlockCacheBytes = blockCacheStats.uiCachedBytes;
+}
+
+void CFileSystem::ResetStats()
+{
+	m_Stats = {};
+
+	m_PathIndex.ResetNumDiskQueries();
+	m_Preloader.ResetStats();
+	m_BlockCache.ResetStats();
+
+	for( const auto& searchPath : m_SearchPaths )
+		searchPath->directoryTree.ResetNumDiskQueries();
+}
+
+void CFileSystem::SetBlockCacheEnabled( bool bEnabled )
+{
+	m_bUseBlockCache = bEnabled;
+}
+
+bool CFileSystem::IsBlockCacheEnabled()
+{
+	return m_bUseBlockCache;
+}
+
+void CFileSystem::SetLevelLoadReplayEnabled( bool bEnabled )
+{
+	m_bReplayLevelLoads = bEnabled;
+}
+
+bool CFileSystem::IsLevelLoadReplayEnabled()
+{
+	return m_bReplayLevelLoads;
+}
+
+void CFileSystem::GetLastLevelLoad( LevelLoadInfo_t& info )
+{
+	info = m_LastLevelLoad;
+}
+
 void CFileSystem::Warning( FileWarningLevel_t level, const char* pszFormat, ... )
 {
 	char szBuffer[ 4096 ];
@@ -1365,6 +1822,9 @@ bool CFileSystem::AddSearchPath( const char *pPath, const char *pathID, const bo
 
 	m_SearchPaths.emplace_back( std::move( path ) );
 
+	m_PathIndex.Invalidate( m_SearchPaths );
+	m_Preloader.Clear();
+
 	//Add any game pack files present in the path.
 	AddPackFiles( m_SearchPaths.back()->szPath );
 
@@ -1397,14 +1857,14 @@ bool CFileSystem::PreparePackFile( const char* pszFullPath, const char* pszPathI
 
 	fseek64( file.GetFile(), file.GetStartOffset() + offset, SEEK_SET );
 
-	CSearchPath::Entries_t entries;
+	CPackDirectory directory;
 
 	bool bSuccess = false;
 
 	switch( type )
 	{
-	case pack::PackType::PACK_32BIT:	bSuccess = ProcessPackFile<pack::Pack32_t>( *this, pszFullPath, file.GetFile(), entries ); break;
-	case pack::PackType::PACK_64BIT:	bSuccess = ProcessPackFile<pack::Pack64_t>( *this, pszFullPath, file.GetFile(), entries ); break;
+	case pack::PackType::PACK_32BIT:	bSuccess = ProcessPackFile<pack::Pack32_t>( *this, pszFullPath, file.GetFile(), directory ); break;
+	case pack::PackType::PACK_64BIT:	bSuccess = ProcessPackFile<pack::Pack64_t>( *this, pszFullPath, file.GetFile(), directory ); break;
 	}
 
 	if( !bSuccess )
@@ -1427,10 +1887,21 @@ bool CFileSystem::PreparePackFile( const char* pszFullPath, const char* pszPathI
 
 	path->packFile = std::make_unique<CFileHandle>( std::move( file ) );
 
-	path->packEntries = std::move( entries );
+	{
+		struct stat buffer{};
+
+		stat( pszFullPath, &buffer );
+
+		path->iPackModTime = static_cast<int64_t>( buffer.st_mtime );
+	}
+
+	path->packDirectory = std::move( directory );
 
 	m_SearchPaths.emplace_back( std::move( path ) );
 
+	m_PathIndex.Invalidate( m_SearchPaths );
+	m_Preloader.Clear();
+
 	return true;
 }
 
@@ -1490,42 +1961,591 @@ void CFileSystem::AddPackFiles( const char* pszPath )
 	}
 }
 
-CFileHandle* CFileSystem::FindFile( CSearchPath& searchPath, const char* pszFileName, const char* pszOptions )
+FileHandle_t CFileSystem::FindFile( CSearchPath& searchPath, const char* pszFileName, const char* pszOptions, const bool bUseBlockCache )
 {
-	std::unique_ptr<CFileHandle> file;
-	
 	if( searchPath.IsPackFile() )
 	{
-		auto path = fs::path( pszFileName );
+		auto pEntry = searchPath.packDirectory.Find( pszFileName );
 
-		path.make_preferred();
+		if( !pEntry )
+			return FILESYSTEM_INVALID_HANDLE;
 
-		auto szFileName = path.u8string();
+		if( bUseBlockCache )
+			return OpenCachedFile( searchPath, pEntry, pszFileName, pszOptions );
 
-		auto it = searchPath.packEntries.find( szFileName.c_str() );
+		return OpenPackEntry( searchPath, *pEntry, pszFileName );
+	}
 
-		if( it == searchPath.packEntries.end() )
-			return nullptr;
+	if( bUseBlockCache )
+		return OpenCachedFile( searchPath, nullptr, pszFileName, pszOptions );
+
+	return OpenLooseFile( searchPath, pszFileName, pszOptions );
+}
+
+FileHandle_t CFileSystem::OpenPackEntry( CSearchPath& searchPath, const CPackFileEntry& entry, const char* pszFileName )
+{
+	auto path = fs::path( pszFileName );
+
+	path.make_preferred();
+
+	CFileHandle file( *this, std::move( path.u8string() ), searchPath.packFile->GetFile(), entry.GetStartOffset(), entry.GetLength() );
+
+	if( !file.IsOpen() )
+		return FILESYSTEM_INVALID_HANDLE;
+
+	return m_OpenedFiles.Add( std::move( file ) );
+}
+
+FileHandle_t CFileSystem::OpenLooseFile( CSearchPath& searchPath, const char* pszFileName, const char* pszOptions )
+{
+	auto path = fs::path( searchPath.szPath ) / pszFileName;
+
+	path.make_preferred();
+
+	++m_Stats.uiDiskQueries;
 
-		auto& entry = *( it->second );
+	CFileHandle file( *this, path.u8string().c_str(), pszOptions );
 
-		file = std::make_unique<CFileHandle>( *this, std::move( path.u8string() ), searchPath.packFile->GetFile(), entry.GetStartOffset(), entry.GetLength() );
+	if( !file.IsOpen() )
+		return FILESYSTEM_INVALID_HANDLE;
+
+	return m_OpenedFiles.Add( std::move( file ) );
+}
+
+FileHandle_t CFileSystem::OpenCachedFile( CSearchPath& searchPath, const CPackFileEntry* pEntry, const char* pszFileName, const char* pszOptions,
+											const CPathIndex::FileStatus_t* pStatus )
+{
+	std::string szDiskPath;
+	uint64_t uiOffset;
+	uint64_t uiLength;
+	int64_t iModTime;
+
+	if( pEntry )
+	{
+		szDiskPath = searchPath.szPath;
+		uiOffset = pEntry->GetStartOffset();
+		uiLength = pEntry->GetLength();
+		iModTime = searchPath.iPackModTime;
 	}
 	else
 	{
+#ifdef WIN32
+		//Cached contents are raw bytes, text mode reads have to translate line endings.
+		if( !strchr( pszOptions, 'b' ) )
+			return OpenLooseFile( searchPath, pszFileName, pszOptions );
+#endif
+
 		auto path = fs::path( searchPath.szPath ) / pszFileName;
 
 		path.make_preferred();
 
-		file = std::make_unique<CFileHandle>( *this, path.u8string().c_str(), pszOptions );
+		szDiskPath = path.u8string();
+
+		CPathIndex::FileStatus_t status;
+
+		if( pStatus )
+		{
+			status = *pStatus;
+		}
+		else
+		{
+			++m_Stats.uiDiskQueries;
+
+			struct stat buffer{};
+
+			if( stat( szDiskPath.c_str(), &buffer ) == -1 )
+				return FILESYSTEM_INVALID_HANDLE;
+
+			status.uiLength = static_cast<uint64_t>( buffer.st_size );
+			status.iModTime = static_cast<int64_t>( buffer.st_mtime );
+			status.bIsRegularFile = ( buffer.st_mode & S_IFMT ) == S_IFREG;
+		}
+
+		//Let the normal open handle anything that isn't a regular file.
+		if( !status.bIsRegularFile )
+			return OpenLooseFile( searchPath, pszFileName, pszOptions );
+
+		uiOffset = 0;
+		uiLength = status.uiLength;
+		iModTime = status.iModTime;
 	}
 
-	if( file->IsOpen() )
+	if( uiLength > CBlockCache::MAX_FILE_SIZE )
+		return pEntry ? OpenPackEntry( searchPath, *pEntry, pszFileName ) : OpenLooseFile( searchPath, pszFileName, pszOptions );
+
+	auto szKey = CBlockCache::MakeFileKey( szDiskPath.c_str(), uiOffset, uiLength, iModTime );
+
+	if( uiLength <= CBlockCache::BLOCK_SIZE )
 	{
-		m_OpenedFiles.emplace_back( std::move( file ) );
+		std::string szHandleName;
+
+		if( pEntry )
+		{
+			auto path = fs::path( pszFileName );
+
+			path.make_preferred();
 
-		return m_OpenedFiles.back().get();
+			szHandleName = path.u8string();
+		}
+		else
+		{
+			szHandleName = szDiskPath;
+		}
+
+		//Small files are cached whole, so they can be served without opening the file.
+		auto data = m_BlockCache.Find( szKey, 0 );
+
+		if( !data )
+		{
+			CFileHandle file;
+
+			if( pEntry )
+			{
+				file = CFileHandle( *this, std::string( szHandleName ), searchPath.packFile->GetFile(), uiOffset, uiLength );
+			}
+			else
+			{
+				++m_Stats.uiDiskQueries;
+
+				file = CFileHandle( *this, szDiskPath.c_str(), pszOptions );
+			}
+
+			if( !file.IsOpen() )
+				return FILESYSTEM_INVALID_HANDLE;
+
+			auto contents = std::make_shared<std::vector<uint8_t>>( static_cast<size_t>( uiLength ) );
+
+			size_t uiRead;
+
+			if( file.IsPositional() )
+				uiRead = file.ReadEntry( contents->data(), contents->size() );
+			else
+				uiRead = fread( contents->data(), 1, contents->size(), file.GetFile() );
+
+			//The file changed after it was checked, read it normally.
+			if( uiRead != contents->size() )
+			{
+				if( pEntry )
+					return OpenPackEntry( searchPath, *pEntry, pszFileName );
+
+				fseek64( file.GetFile(), 0, SEEK_SET );
+
+				return m_OpenedFiles.Add( std::move( file ) );
+			}
+
+			m_BlockCache.Insert( szKey, 0, contents );
+
+			data = std::move( contents );
+		}
+
+		return m_OpenedFiles.Add( CFileHandle( std::move( szHandleName ), std::move( data ) ) );
 	}
 
-	return nullptr;
+	auto hFile = pEntry ? OpenPackEntry( searchPath, *pEntry, pszFileName ) : OpenLooseFile( searchPath, pszFileName, pszOptions );
+
+	if( hFile != FILESYSTEM_INVALID_HANDLE )
+		m_OpenedFiles.Get( hFile )->SetBlockCache( m_BlockCache, std::move( szKey ) );
+
+	return hFile;
+}
+
+bool CFileSystem::QueuePreload( const char* pszKey )
+{
+	//Only lookups through the path index can use preloaded files.
+	if( !m_bUsePathIndex )
+		return false;
+
+	auto pLocation = m_PathIndex.Find( pszKey, nullptr, CPathIndex::FindFlag::FILES_ONLY );
+
+	if( !pLocation )
+		return false;
+
+	CResourcePreloader::Request_t request;
+
+	request.szKey = pszKey;
+	request.pSearchPath = pLocation->pSearchPath;
+
+	if( pLocation->pPackEntry )
+	{
+		request.szDiskPath = pLocation->pSearchPath->szPath;
+		request.uiOffset = pLocation->pPackEntry->GetStartOffset();
+		request.uiLength = pLocation->pPackEntry->GetLength();
+	}
+	else
+	{
+		auto path = fs::path( pLocation->pSearchPath->szPath ) / pLocation->szActualPath;
+
+		path.make_preferred();
+
+		std::error_code error;
+
+		++m_Stats.uiDiskQueries;
+
+		const auto uiSize = fs::file_size( path, error );
+
+		if( error )
+			return false;
+
+		request.szDiskPath = path.u8string();
+		request.uiOffset = 0;
+		request.uiLength = uiSize;
+	}
+
+	return m_Preloader.Queue( std::move( request ) );
+}
+
+void CFileSystem::RecordLevelLoadAccess( const char* pszPath, FileHandle_t file )
+{
+	char szKey[ MAX_PATH ];
+
+	if( !CPathIndex::NormalizePath( pszPath, szKey, sizeof( szKey ) ) )
+		return;
+
+	auto pFile = m_OpenedFiles.Get( file );
+
+	if( m_bRecordingLevelLoad )
+		m_LevelLoadTrace.Add( szKey, pFile->GetLength() );
+
+	pFile->SetKey( szKey );
+}
+
+void CFileSystem::RecordLevelLoadRead( const CFileHandle& file, const uint64_t uiOffset, const uint64_t uiLength )
+{
+	if( m_bRecordingLevelLoad && !file.GetKey().empty() )
+		m_LevelLoadTrace.AddRange( file.GetKey().c_str(), uiOffset, uiLength );
+}
+
+void CFileSystem::RecordLevelLoadMapping( const CFileHandle& file )
+{
+	if( m_bRecordingLevelLoad && !file.GetKey().empty() )
+		m_LevelLoadTrace.SetMapped( file.GetKey().c_str() );
+}
+
+bool CFileSystem::PrefetchFile( const CLevelLoadTrace::Entry_t& entry, uint64_t& uiBytes )
+{
+	uiBytes = 0;
+
+	if( !m_bUsePathIndex )
+		return false;
+
+	auto pLocation = m_PathIndex.Find( entry.szKey.c_str(), nullptr, CPathIndex::FindFlag::FILES_ONLY );
+
+	if( !pLocation )
+		return false;
+
+	FILE* pFile;
+	uint64_t uiStart;
+	uint64_t uiLength;
+
+	if( pLocation->pPackEntry )
+	{
+		pFile = pLocation->pSearchPath->packFile->GetFile();
+		uiStart = pLocation->pPackEntry->GetStartOffset();
+		uiLength = pLocation->pPackEntry->GetLength();
+	}
+	else
+	{
+		CPathIndex::FileStatus_t status;
+
+		if( !m_PathIndex.GetFileStatus( *pLocation, status ) || !status.bIsRegularFile )
+			return false;
+
+		auto path = fs::path( pLocation->pSearchPath->szPath ) / pLocation->szActualPath;
+
+		path.make_preferred();
+
+		++m_Stats.uiDiskQueries;
+
+		pFile = fopen64( path.u8string().c_str(), "rb" );
+
+		if( !pFile )
+			return false;
+
+		uiStart = 0;
+		uiLength = status.uiLength;
+	}
+
+	//The file may have changed since the trace was recorded, so stay within its current size.
+	auto prefetch = [ & ]( const uint64_t uiOffset, const uint64_t uiSize )
+	{
+		if( uiOffset >= uiLength )
+			return;
+
+		const uint64_t uiClamped = std::min( uiSize, uiLength - uiOffset );
+
+		if( CFileMapping::Prefetch( pFile, uiStart + uiOffset, uiClamped ) )
+			uiBytes += uiClamped;
+	};
+
+	if( entry.bMapped || entry.ranges.empty() )
+	{
+		prefetch( 0, uiLength );
+	}
+	else
+	{
+		for( const auto& range : entry.ranges )
+			prefetch( range.uiOffset, range.uiLength );
+	}
+
+	//The OS keeps the prefetched pages after the file is closed.
+	if( !pLocation->pPackEntry )
+		fclose( pFile );
+
+	return uiBytes > 0;
+}
+
+void CFileSystem::GetLevelLoadTracePath( const char* pszLevelName, char* pszPath, const size_t uiSizeInChars )
+{
+	const char* const pszDirectory = "loadtraces/";
+
+	snprintf( pszPath, uiSizeInChars, "%s%s.trace", pszDirectory, pszLevelName );
+
+	//Level names may contain directories, keep them out of the path.
+	for( char* pszChar = pszPath + strlen( pszDirectory ); *pszChar; ++pszChar )
+	{
+		if( *pszChar == '/' || *pszChar == '\\' || *pszChar == ':' )
+			*pszChar = '_';
+	}
+}
+
+void CFileSystem::ReplayLevelLoadTrace( const char* pszLevelName )
+{
+	char szPath[ MAX_PATH ];
+
+	GetLevelLoadTracePath( pszLevelName, szPath, sizeof( szPath ) );
+
+	auto hFile = Open( szPath, "rb" );
+
+	if( hFile == FILESYSTEM_INVALID_HANDLE )
+		return;
+
+	std::vector<uint8_t> data( static_cast<size_t>( Size64( hFile ) ) );
+
+	const bool bRead = static_cast<size_t>( Read( data.data(), static_cast<int>( data.size() ), hFile ) ) == data.size();
+
+	Close( hFile );
+
+	CLevelLoadTrace trace;
+
+	if( !bRead || !trace.Deserialize( data.data(), data.size() ) )
+	{
+		Warning( FILESYSTEM_WARNING_REPORTUSAGE, "CFileSystem::ReplayLevelLoadTrace: Trace file \"%s\" is invalid\n", szPath );
+		return;
+	}
+
+	//Files that are still open or mapped, like WADs that the previous level used as well, don't need to be read again.
+	std::unordered_set<std::string> inUse;
+
+	m_OpenedFiles.ForEach( [ & ]( const CFileHandle& file )
+	{
+		if( !file.GetKey().empty() )
+			inUse.emplace( file.GetKey() );
+	} );
+
+	for( const auto& mapping : m_Mappings )
+	{
+		if( !mapping->szKey.empty() )
+			inUse.emplace( mapping->szKey );
+	}
+
+	//Replay in the order the files were opened last time, so the first ones needed are read first.
+	for( const auto& entry : trace.GetEntries() )
+	{
+		if( inUse.find( entry.szKey ) != inUse.end() )
+			continue;
+
+		uint64_t uiBytes = 0;
+
+		//Mapped files and files that were only read in part are prefetched into the OS cache,
+		//so they don't use preload memory and only the parts that are needed are read.
+		//Everything else is preloaded, as are files that the OS couldn't prefetch.
+		bool bReplayed = ( entry.bMapped || ( !entry.ranges.empty() && entry.GetReadLength() < entry.uiLength ) ) && PrefetchFile( entry, uiBytes );
+
+		if( !bReplayed && QueuePreload( entry.szKey.c_str() ) )
+		{
+			bReplayed = true;
+			uiBytes = entry.uiLength;
+		}
+
+		if( bReplayed )
+		{
+			++m_CurrentLevelLoad.uiReplayedFiles;
+			m_CurrentLevelLoad.uiReplayedBytes += uiBytes;
+		}
+	}
+}
+
+void CFileSystem::WriteLevelLoadTrace( const char* pszLevelName )
+{
+	if( m_LevelLoadTrace.GetEntries().empty() )
+		return;
+
+	char szPath[ MAX_PATH ];
+
+	GetLevelLoadTracePath( pszLevelName, szPath, sizeof( szPath ) );
+
+	std::vector<uint8_t> data;
+
+	m_LevelLoadTrace.Serialize( data );
+
+	CreateDirHierarchy( "loadtraces", nullptr );
+
+	auto hFile = Open( szPath, "wb" );
+
+	if( hFile == FILESYSTEM_INVALID_HANDLE )
+	{
+		Warning( FILESYSTEM_WARNING_REPORTUSAGE, "CFileSystem::WriteLevelLoadTrace: Couldn't open \"%s\" for writing\n", szPath );
+		return;
+	}
+
+	if( static_cast<size_t>( Write( data.data(), static_cast<int>( data.size() ), hFile ) ) != data.size() )
+		Warning( FILESYSTEM_WARNING_REPORTUSAGE, "CFileSystem::WriteLevelLoadTrace: Couldn't write \"%s\"\n", szPath );
+
+	Close( hFile );
+}
+
+const uint8_t* CFileSystem::AcquireMapping( CFileHandle& file, const char* pszCaller )
+{
+	//Preloaded and cached contents are already in memory, so hand out a reference to them.
+	if( file.IsPreloaded() )
+	{
+		const auto& data = file.GetPreloadedData();
+
+		auto it = std::find_if( m_Mappings.begin(), m_Mappings.end(), [ & ]( const std::unique_ptr<Mapping_t>& mapping )
+		{
+			return mapping->data == data;
+		} );
+
+		if( it == m_Mappings.end() )
+		{
+			auto mapping = std::make_unique<Mapping_t>();
+
+			mapping->data = data;
+			mapping->pSource = nullptr;
+			mapping->uiOffset = 0;
+			mapping->szKey = file.GetKey();
+			mapping->uiRefCount = 0;
+
+			m_Mappings.emplace_back( std::move( mapping ) );
+
+			it = m_Mappings.end() - 1;
+		}
+
+		++( *it )->uiRefCount;
+
+		return ( *it )->GetData();
+	}
+
+	const FILE* pSource = file.GetFile();
+
+	const uint64_t uiOffset = file.GetStartOffset();
+	const uint64_t uiLength = file.GetLength();
+
+	auto it = std::find_if( m_Mappings.begin(), m_Mappings.end(), [ = ]( const std::unique_ptr<Mapping_t>& mapping )
+	{
+		return !mapping->data && mapping->pSource == pSource && mapping->uiOffset == uiOffset && mapping->mapping.GetSize() == uiLength;
+	} );
+
+	if( it == m_Mappings.end() )
+	{
+		//Reading past the end of a mapped file crashes, so make sure the pack file wasn't truncated.
+		if( file.IsPackEntry() )
+		{
+			auto searchPath = std::find_if( m_SearchPaths.begin(), m_SearchPaths.end(), [ = ]( const std::unique_ptr<CSearchPath>& searchPath )
+			{
+				return searchPath->IsPackFile() && searchPath->packFile->GetFile() == pSource;
+			} );
+
+			if( searchPath == m_SearchPaths.end() )
+			{
+				Warning( FILESYSTEM_WARNING_CRITICAL, "CFileSystem::%s: Pack file of entry \"%s\" is no longer mounted!\n", pszCaller, file.GetFileName().c_str() );
+				return nullptr;
+			}
+
+			if( uiOffset + uiLength > ( *searchPath )->packFile->GetLength() )
+			{
+				Warning( FILESYSTEM_WARNING_CRITICAL, "CFileSystem::%s: File \"%s\" extends past the end of its pack file!\n", pszCaller, file.GetFileName().c_str() );
+				return nullptr;
+			}
+		}
+
+		auto mapping = std::make_unique<Mapping_t>();
+
+		//The mapping is expanded to page boundaries internally, so only the pages that hold the file are mapped.
+		if( !mapping->mapping.Map( file.GetFile(), uiOffset, uiLength ) )
+		{
+			Warning( FILESYSTEM_WARNING_REPORTUSAGE, "CFileSystem::%s: Couldn't map file \"%s\"\n", pszCaller, file.GetFileName().c_str() );
+			return nullptr;
+		}
+
+		mapping->pSource = pSource;
+		mapping->uiOffset = uiOffset;
+		mapping->szKey = file.GetKey();
+		mapping->uiRefCount = 0;
+
+		m_Mappings.emplace_back( std::move( mapping ) );
+
+		it = m_Mappings.end() - 1;
+	}
+
+	auto& mapping = **it;
+
+	++mapping.uiRefCount;
+
+	return mapping.mapping.GetData();
+}
+
+bool CFileSystem::ReleaseMapping( const void* pData )
+{
+	auto pBuffer = reinterpret_cast<const uint8_t*>( pData );
+
+	auto it = std::find_if( m_Mappings.begin(), m_Mappings.end(), [ = ]( const std::unique_ptr<Mapping_t>& mapping )
+	{
+		const auto pMapped = mapping->GetData();
+
+		return pBuffer >= pMapped && pBuffer < pMapped + mapping->GetSize();
+	} );
+
+	if( it == m_Mappings.end() )
+		return false;
+
+	if( --( *it )->uiRefCount == 0 )
+		m_Mappings.erase( it );
+
+	return true;
+}
+
+void CFileSystem::DetachMappings( const FILE* pFile )
+{
+	for( auto& mapping : m_Mappings )
+	{
+		if( mapping->pSource == pFile )
+			mapping->pSource = nullptr;
+	}
+}
+
+void CFileSystem::InvalidatePath( const char* pszPath )
+{
+	char szKey[ MAX_PATH ];
+
+	if( CPathIndex::NormalizePath( pszPath, szKey, sizeof( szKey ) ) )
+	{
+		m_PathIndex.InvalidatePath( szKey );
+		m_Preloader.Forget( szKey );
+	}
+
+	//Cached contents and listings are checked against modification times, but those have a coarse resolution, so drop them explicitly.
+	for( const auto& searchPath : m_SearchPaths )
+	{
+		if( searchPath->IsPackFile() )
+			continue;
+
+		searchPath->directoryTree.InvalidatePath( pszPath );
+
+		auto path = fs::path( searchPath->szPath ) / pszPath;
+
+		path.make_preferred();
+
+		m_BlockCache.Forget( path.u8string().c_str() );
+	}
 }
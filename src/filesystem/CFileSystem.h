@@ -1,17 +1,25 @@
 #ifndef FILESYSTEM_CFILESYSTEM_H
 #define FILESYSTEM_CFILESYSTEM_H
 
+#include <chrono>
 #include <cstdint>
 #include <cstdio>
-#include <experimental/filesystem>
 #include <memory>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 #include "Platform.h"
 
+#include "CBlockCache.h"
 #include "CFileHandle.h"
+#include "CFileHandleTable.h"
+#include "CFileMapping.h"
+#include "CLevelLoadTrace.h"
+#include "CPathIndex.h"
+#include "CResourcePreloader.h"
 #include "CSearchPath.h"
+#include "CWildcardPattern.h"
 
 #include "FileSystem2.h"
 
@@ -40,23 +48,15 @@ private:
 	{
 		bool EndOfPath() const
 		{
-			if( flags & FindFileFlag::IS_PACK_FILE )
-			{
-				return pack_iterator == currentPath->get()->packEntries.end();
-			}
-			else
-			{
-				return iterator == std::experimental::filesystem::recursive_directory_iterator();
-			}
+			return uiNextMatch >= matches.size();
 		}
 
-		std::experimental::filesystem::recursive_directory_iterator iterator;
-		//For pack search paths: the index of the current pack file entry.
-		CSearchPath::Entries_t::const_iterator pack_iterator;
+		//Entries of the current search path that match the filter.
+		CDirectoryTree::Matches_t matches;
+		//Index of the match that FindNext returns next.
+		size_t uiNextMatch = 0;
 
-		std::experimental::filesystem::directory_entry entry;
-		std::string szFileName;
-		std::string szFilter;
+		CWildcardPattern filter;
 
 		char szPathID[ MAX_PATH ];
 
@@ -67,9 +67,50 @@ private:
 		std::vector<const char*> searchedPaths;
 	};
 
-	typedef std::vector<std::unique_ptr<CFileHandle>> OpenedFiles_t;
 	typedef std::vector<std::unique_ptr<FindFileData>> FindFiles_t;
 
+	/**
+	*	A mapping that backs read buffers and MapFile.
+	*	Pack entries only map their own range of the pack file, so entries of pack files that don't fit in the address space can still be mapped.
+	*	Read buffers and MapFile calls for the same range of the same file share a mapping.
+	*	Files whose contents are in memory already, because they were preloaded or cached whole, point into those contents instead.
+	*/
+	struct Mapping_t
+	{
+		CFileMapping mapping;
+
+		/**
+		*	Preloaded or cached contents that are used instead of the mapping. Keeps the contents alive until nothing refers to them.
+		*/
+		std::shared_ptr<const std::vector<uint8_t>> data;
+
+		/**
+		*	The file that was mapped. Set to null once the file is closed, so a new file that reuses the FILE* gets its own mapping.
+		*/
+		const FILE* pSource;
+
+		/**
+		*	Offset of the mapped range in the file.
+		*/
+		uint64_t uiOffset;
+
+		/**
+		*	Normalized path of the file that the mapping was created for, so level load replays can skip files that are still mapped.
+		*/
+		std::string szKey;
+
+		/**
+		*	Number of read buffers and MapFile pointers that point into this mapping.
+		*/
+		size_t uiRefCount;
+
+		const uint8_t* GetData() const { return data ? data->data() : mapping.GetData(); }
+
+		uint64_t GetSize() const { return data ? data->size() : mapping.GetSize(); }
+	};
+
+	typedef std::vector<std::unique_ptr<Mapping_t>> Mappings_t;
+
 public:
 	CFileSystem() = default;
 
@@ -202,6 +243,28 @@ public:
 
 	bool			FullPathToRelativePathEx( const char *pFullpath, char *pRelative, size_t uiSizeInChars ) override;
 
+	const void*		MapFile( FileHandle_t file, uint64_t& uiSize ) override;
+
+	void			UnmapFile( const void* pData ) override;
+
+	void			SetPathIndexEnabled( bool bEnabled ) override;
+
+	bool			IsPathIndexEnabled() override;
+
+	void			SetBlockCacheEnabled( bool bEnabled ) override;
+
+	bool			IsBlockCacheEnabled() override;
+
+	void			GetStats( FileSystemStats_t& stats ) override;
+
+	void			ResetStats() override;
+
+	void			SetLevelLoadReplayEnabled( bool bEnabled ) override;
+
+	bool			IsLevelLoadReplayEnabled() override;
+
+	void			GetLastLevelLoad( LevelLoadInfo_t& info ) override;
+
 	//CFileSystem
 
 	void Warning( FileWarningLevel_t level, const char* pszFormat, ... );
@@ -218,12 +281,119 @@ private:
 
 	void AddPackFiles( const char* pszPath );
 
-	CFileHandle* FindFile( CSearchPath& searchPath, const char* pszFileName, const char* pszOptions );
+	FileHandle_t FindFile( CSearchPath& searchPath, const char* pszFileName, const char* pszOptions, const bool bUseBlockCache );
+
+	FileHandle_t OpenPackEntry( CSearchPath& searchPath, const CPackFileEntry& entry, const char* pszFileName );
+
+	FileHandle_t OpenLooseFile( CSearchPath& searchPath, const char* pszFileName, const char* pszOptions );
+
+	/**
+	*	Opens a file that reads through the block cache. Small files that are cached whole are opened without touching the file.
+	*	Files that are too large to cache are opened normally.
+	*	@param pEntry For files in pack files, the pack entry. Otherwise null.
+	*	@param pszFileName For pack entries, the name of the file. Otherwise the path relative to the search path.
+	*	@param pStatus For loose files, the status known to the path index. If null, the file's status is read from disk.
+	*/
+	FileHandle_t OpenCachedFile( CSearchPath& searchPath, const CPackFileEntry* pEntry, const char* pszFileName, const char* pszOptions,
+								 const CPathIndex::FileStatus_t* pStatus = nullptr );
+
+	/**
+	*	Queues a file for preloading, if it can be found through the path index.
+	*	@param pszKey Normalized path.
+	*	@return Whether the file is queued or already preloaded.
+	*/
+	bool QueuePreload( const char* pszKey );
+
+	/**
+	*	Remembers the normalized path of a file that was opened for reading, and adds it to the level load trace if one is being recorded.
+	*/
+	void RecordLevelLoadAccess( const char* pszPath, FileHandle_t file );
+
+	/**
+	*	Adds a read from an opened file to the level load trace, if one is being recorded.
+	*	@param uiOffset Position that the read started at, relative to the start of the file.
+	*/
+	void RecordLevelLoadRead( const CFileHandle& file, const uint64_t uiOffset, const uint64_t uiLength );
+
+	/**
+	*	Marks an opened file as mapped in the level load trace, if one is being recorded.
+	*/
+	void RecordLevelLoadMapping( const CFileHandle& file );
+
+	/**
+	*	Asks the OS to read the parts of a traced file that were used by the last load into memory, if it can be found through the path index.
+	*	Mapped files are prefetched whole.
+	*	@param[ out ] uiBytes Number of bytes that were prefetched.
+	*	@return Whether anything was prefetched.
+	*/
+	bool PrefetchFile( const CLevelLoadTrace::Entry_t& entry, uint64_t& uiBytes );
+
+	/**
+	*	Gets the path of the trace file of the given level, relative to the search paths.
+	*/
+	static void GetLevelLoadTracePath( const char* pszLevelName, char* pszPath, const size_t uiSizeInChars );
+
+	/**
+	*	Loads the trace of the given level, and prefetches or queues for preloading the files that aren't open or mapped already.
+	*/
+	void ReplayLevelLoadTrace( const char* pszLevelName );
+
+	void WriteLevelLoadTrace( const char* pszLevelName );
+
+	/**
+	*	Maps the contents of an open file, sharing an existing mapping of the same range of the same file if there is one.
+	*	Preloaded and cached files aren't mapped, the preloaded or cached contents are returned instead.
+	*	Every successful call must be matched by a call to ReleaseMapping.
+	*	@param file File to map. Must be open.
+	*	@param pszCaller Name of the calling function, for warnings.
+	*	@return Pointer to the file's contents, or null if the file could not be mapped.
+	*/
+	const uint8_t* AcquireMapping( CFileHandle& file, const char* pszCaller );
+
+	/**
+	*	Releases a reference to the mapping that contains the given pointer. The mapping is unmapped once nothing refers to it.
+	*	@return Whether the pointer was in a mapping.
+	*/
+	bool ReleaseMapping( const void* pData );
+
+	/**
+	*	Stops sharing mappings of the given file with new read buffers and MapFile calls. Must be called before the file is closed.
+	*	Existing read buffers and MapFile pointers remain valid until they are released.
+	*/
+	void DetachMappings( const FILE* pFile );
+
+	/**
+	*	Forgets cached directory listings that contain the given path after it has been created or removed.
+	*/
+	void InvalidatePath( const char* pszPath );
 
 private:
 	SearchPaths_t m_SearchPaths;
-	OpenedFiles_t m_OpenedFiles;
+	CFileHandleTable m_OpenedFiles;
 	FindFiles_t m_FindFiles;
+	Mappings_t m_Mappings;
+
+	CPathIndex m_PathIndex;
+	bool m_bUsePathIndex = true;
+
+	CResourcePreloader m_Preloader;
+
+	CBlockCache m_BlockCache;
+	bool m_bUseBlockCache = true;
+
+	bool m_bReplayLevelLoads = true;
+	bool m_bRecordingLevelLoad = false;
+
+	std::string m_szLevelLoadName;
+
+	CLevelLoadTrace m_LevelLoadTrace;
+
+	std::chrono::steady_clock::time_point m_LevelLoadStart;
+
+	LevelLoadInfo_t m_CurrentLevelLoad = {};
+	LevelLoadInfo_t m_LastLevelLoad = {};
+
+	FileSystemStats_t m_Stats = {};
 
 	FileSystemWarningFunc m_WarningFunc = nullptr;
 
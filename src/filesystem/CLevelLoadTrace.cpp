@@ -0,0 +1,226 @@
+#include <algorithm>
+#include <cstring>
+
+#include "ByteSwap.h"
+
+#include "CLevelLoadTrace.h"
+
+const uint32_t CLevelLoadTrace::IDENT;
+const uint32_t CLevelLoadTrace::VERSION;
+const size_t CLevelLoadTrace::MAX_FILES;
+const size_t CLevelLoadTrace::MAX_RANGES;
+
+namespace
+{
+/*
+*	Trace file layout:
+*	uint32_t ident, uint32_t version, uint32_t file count
+*	For each file: uint64_t length, uint8_t flags, uint16_t key length, key characters without null terminator, uint16_t range count,
+*	and for each range: uint64_t offset, uint64_t length.
+*/
+
+/**
+*	Flags of a file in a trace file.
+*/
+enum : uint8_t
+{
+	FILE_MAPPED = 1 << 0
+};
+
+template<typename T>
+void Write( std::vector<uint8_t>& data, const T value )
+{
+	const T littleValue = LittleValue( value );
+
+	const auto pBytes = reinterpret_cast<const uint8_t*>( &littleValue );
+
+	data.insert( data.end(), pBytes, pBytes + sizeof( T ) );
+}
+
+template<typename T>
+bool Read( const uint8_t*& pData, const uint8_t* pEnd, T& value )
+{
+	if( static_cast<size_t>( pEnd - pData ) < sizeof( T ) )
+		return false;
+
+	memcpy( &value, pData, sizeof( T ) );
+
+	value = LittleValue( value );
+
+	pData += sizeof( T );
+
+	return true;
+}
+}
+
+uint64_t CLevelLoadTrace::Entry_t::GetReadLength() const
+{
+	uint64_t uiTotal = 0;
+
+	for( const auto& range : ranges )
+		uiTotal += range.uiLength;
+
+	return uiTotal;
+}
+
+void CLevelLoadTrace::Clear()
+{
+	m_Entries.clear();
+	m_Indices.clear();
+}
+
+void CLevelLoadTrace::Add( const char* pszKey, const uint64_t uiLength )
+{
+	if( m_Entries.size() >= MAX_FILES )
+		return;
+
+	if( !m_Indices.emplace( pszKey, m_Entries.size() ).second )
+		return;
+
+	m_Entries.emplace_back( Entry_t{ pszKey, uiLength, {}, false } );
+}
+
+void CLevelLoadTrace::AddRange( const char* pszKey, const uint64_t uiOffset, const uint64_t uiLength )
+{
+	if( uiLength == 0 )
+		return;
+
+	auto index = m_Indices.find( pszKey );
+
+	if( index == m_Indices.end() )
+		return;
+
+	auto& ranges = m_Entries[ index->second ].ranges;
+
+	uint64_t uiStart = uiOffset;
+	uint64_t uiEnd = uiOffset + uiLength;
+
+	//Merge with every range that overlaps or touches the new one. Sequential reads keep extending the same range.
+	auto first = std::lower_bound( ranges.begin(), ranges.end(), uiStart, []( const Range_t& range, const uint64_t uiValue )
+	{
+		return range.uiOffset + range.uiLength < uiValue;
+	} );
+
+	auto last = first;
+
+	for( ; last != ranges.end() && last->uiOffset <= uiEnd; ++last )
+	{
+		uiStart = std::min( uiStart, last->uiOffset );
+		uiEnd = std::max( uiEnd, last->uiOffset + last->uiLength );
+	}
+
+	ranges.insert( ranges.erase( first, last ), Range_t{ uiStart, uiEnd - uiStart } );
+
+	if( ranges.size() > MAX_RANGES )
+	{
+		const Range_t span{ ranges.front().uiOffset, ranges.back().uiOffset + ranges.back().uiLength - ranges.front().uiOffset };
+
+		ranges.assign( 1, span );
+	}
+}
+
+void CLevelLoadTrace::SetMapped( const char* pszKey )
+{
+	auto index = m_Indices.find( pszKey );
+
+	if( index != m_Indices.end() )
+		m_Entries[ index->second ].bMapped = true;
+}
+
+uint64_t CLevelLoadTrace::GetTotalLength() const
+{
+	uint64_t uiTotal = 0;
+
+	for( const auto& entry : m_Entries )
+		uiTotal += entry.uiLength;
+
+	return uiTotal;
+}
+
+void CLevelLoadTrace::Serialize( std::vector<uint8_t>& data ) const
+{
+	data.clear();
+
+	Write( data, IDENT );
+	Write( data, VERSION );
+	Write( data, static_cast<uint32_t>( m_Entries.size() ) );
+
+	for( const auto& entry : m_Entries )
+	{
+		Write( data, entry.uiLength );
+		Write( data, static_cast<uint8_t>( entry.bMapped ? FILE_MAPPED : 0 ) );
+		Write( data, static_cast<uint16_t>( entry.szKey.size() ) );
+
+		data.insert( data.end(), entry.szKey.begin(), entry.szKey.end() );
+
+		Write( data, static_cast<uint16_t>( entry.ranges.size() ) );
+
+		for( const auto& range : entry.ranges )
+		{
+			Write( data, range.uiOffset );
+			Write( data, range.uiLength );
+		}
+	}
+}
+
+bool CLevelLoadTrace::Deserialize( const uint8_t* pData, const size_t uiSize )
+{
+	Clear();
+
+	const uint8_t* const pEnd = pData + uiSize;
+
+	uint32_t uiIdent, uiVersion, uiCount;
+
+	if( !Read( pData, pEnd, uiIdent ) || !Read( pData, pEnd, uiVersion ) || !Read( pData, pEnd, uiCount ) )
+		return false;
+
+	if( uiIdent != IDENT || uiVersion != VERSION || uiCount > MAX_FILES )
+		return false;
+
+	for( uint32_t uiIndex = 0; uiIndex < uiCount; ++uiIndex )
+	{
+		uint64_t uiLength;
+		uint8_t flags;
+		uint16_t uiKeyLength;
+
+		if( !Read( pData, pEnd, uiLength ) || !Read( pData, pEnd, flags ) || !Read( pData, pEnd, uiKeyLength ) ||
+			static_cast<size_t>( pEnd - pData ) < uiKeyLength || uiKeyLength == 0 )
+		{
+			Clear();
+			return false;
+		}
+
+		const std::string szKey( reinterpret_cast<const char*>( pData ), uiKeyLength );
+
+		pData += uiKeyLength;
+
+		uint16_t uiNumRanges;
+
+		if( !Read( pData, pEnd, uiNumRanges ) || uiNumRanges > MAX_RANGES )
+		{
+			Clear();
+			return false;
+		}
+
+		Add( szKey.c_str(), uiLength );
+
+		if( flags & FILE_MAPPED )
+			SetMapped( szKey.c_str() );
+
+		for( uint16_t uiRange = 0; uiRange < uiNumRanges; ++uiRange )
+		{
+			Range_t range;
+
+			if( !Read( pData, pEnd, range.uiOffset ) || !Read( pData, pEnd, range.uiLength ) ||
+				range.uiOffset > uiLength || range.uiLength > uiLength - range.uiOffset )
+			{
+				Clear();
+				return false;
+			}
+
+			AddRange( szKey.c_str(), range.uiOffset, range.uiLength );
+		}
+	}
+
+	return true;
+}
@@ -0,0 +1,129 @@
+#ifndef FILESYSTEM_CLEVELLOADTRACE_H
+#define FILESYSTEM_CLEVELLOADTRACE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/**
+*	The files that a level load opened, in the order they were first opened, along with the parts of them that were read and whether they were mapped.
+*	Traces are stored per level, and replayed on the next load of that level to read files ahead of the loader.
+*/
+class CLevelLoadTrace final
+{
+public:
+	/**
+	*	Identifies trace files.
+	*/
+	static const uint32_t IDENT = ( 'R' << 24 ) + ( 'T' << 16 ) + ( 'L' << 8 ) + 'L';
+
+	static const uint32_t VERSION = 2;
+
+	/**
+	*	Maximum number of files in a trace. Files opened after this are not recorded.
+	*/
+	static const size_t MAX_FILES = 4096;
+
+	/**
+	*	Maximum number of ranges per file. Files that are read in more places than this are recorded as a single range that covers all of them.
+	*/
+	static const size_t MAX_RANGES = 64;
+
+	/**
+	*	A range of bytes in a file, relative to the start of the file.
+	*/
+	struct Range_t
+	{
+		uint64_t uiOffset;
+		uint64_t uiLength;
+	};
+
+	/**
+	*	A file that was opened.
+	*/
+	struct Entry_t
+	{
+		/**
+		*	Normalized path of the file.
+		*/
+		std::string szKey;
+
+		/**
+		*	Number of bytes in the file when it was opened.
+		*/
+		uint64_t uiLength;
+
+		/**
+		*	Ranges that were read, sorted by offset. Overlapping and adjacent ranges are merged.
+		*/
+		std::vector<Range_t> ranges;
+
+		/**
+		*	Whether the file was mapped, or a read buffer was requested for it.
+		*/
+		bool bMapped;
+
+		/**
+		*	@return Number of bytes in all ranges.
+		*/
+		uint64_t GetReadLength() const;
+	};
+
+public:
+	CLevelLoadTrace() = default;
+	~CLevelLoadTrace() = default;
+
+	CLevelLoadTrace( CLevelLoadTrace&& other ) = default;
+	CLevelLoadTrace& operator=( CLevelLoadTrace&& other ) = default;
+
+	void Clear();
+
+	/**
+	*	Records that a file was opened. Files that are already in the trace are ignored.
+	*/
+	void Add( const char* pszKey, const uint64_t uiLength );
+
+	/**
+	*	Records that a range of a file in the trace was read. Ignored if the file isn't in the trace.
+	*/
+	void AddRange( const char* pszKey, const uint64_t uiOffset, const uint64_t uiLength );
+
+	/**
+	*	Records that a file in the trace was mapped. Ignored if the file isn't in the trace.
+	*/
+	void SetMapped( const char* pszKey );
+
+	const std::vector<Entry_t>& GetEntries() const { return m_Entries; }
+
+	/**
+	*	@return Total number of bytes in all files.
+	*/
+	uint64_t GetTotalLength() const;
+
+	/**
+	*	Writes the trace to a buffer, in little endian byte order.
+	*/
+	void Serialize( std::vector<uint8_t>& data ) const;
+
+	/**
+	*	Replaces the trace with the contents of a buffer written by Serialize.
+	*	@return Whether the buffer contained a valid trace. The trace is empty if not.
+	*/
+	bool Deserialize( const uint8_t* pData, const size_t uiSize );
+
+private:
+	std::vector<Entry_t> m_Entries;
+
+	/**
+	*	Index of each file in the entry list.
+	*/
+	std::unordered_map<std::string, size_t> m_Indices;
+
+private:
+	CLevelLoadTrace( const CLevelLoadTrace& ) = delete;
+	CLevelLoadTrace& operator=( const CLevelLoadTrace& ) = delete;
+};
+
+#endif //FILESYSTEM_CLEVELLOADTRACE_H
@@ -0,0 +1,154 @@
+#include <cassert>
+#include <cctype>
+#include <cstring>
+
+#include "Platform.h"
+
+#include "CPackDirectory.h"
+
+namespace
+{
+#ifdef WIN32
+const char PATH_SEPARATOR = '\\';
+#else
+const char PATH_SEPARATOR = '/';
+#endif
+
+inline char FoldCharacter( const char c )
+{
+	return c == '\\' ? '/' : static_cast<char>( tolower( static_cast<unsigned char>( c ) ) );
+}
+
+/**
+*	FNV-1a hash of the folded name.
+*/
+uint32_t HashFileName( const char* pszFileName )
+{
+	uint32_t uiHash = 2166136261U;
+
+	for( ; *pszFileName; ++pszFileName )
+	{
+		uiHash ^= static_cast<unsigned char>( FoldCharacter( *pszFileName ) );
+		uiHash *= 16777619U;
+	}
+
+	return uiHash;
+}
+
+bool FileNamesEqual( const char* pszLHS, const char* pszRHS )
+{
+	for( ; *pszLHS && *pszRHS; ++pszLHS, ++pszRHS )
+	{
+		if( FoldCharacter( *pszLHS ) != FoldCharacter( *pszRHS ) )
+			return false;
+	}
+
+	return *pszLHS == *pszRHS;
+}
+}
+
+void CPackDirectory::Clear()
+{
+	m_Entries.clear();
+	m_Entries.shrink_to_fit();
+
+	m_Names.reset();
+	m_uiNamesSize = 0;
+	m_uiNamesUsed = 0;
+
+	m_Slots.clear();
+	m_Slots.shrink_to_fit();
+}
+
+void CPackDirectory::Reserve( const size_t uiNumEntries, const size_t uiNameBytes )
+{
+	Clear();
+
+	m_Entries.reserve( uiNumEntries );
+
+	//Room for the null terminators.
+	m_uiNamesSize = uiNameBytes + uiNumEntries;
+	m_Names.reset( new char[ m_uiNamesSize ] );
+
+	size_t uiNumSlots = 16;
+
+	while( uiNumSlots < uiNumEntries * 2 )
+		uiNumSlots <<= 1;
+
+	m_Slots.resize( uiNumSlots, Slot_t{ 0, 0 } );
+}
+
+bool CPackDirectory::Add( const char* pszFileName, const size_t uiNameLength, const uint64_t uiStartOffset, const uint64_t uiLength )
+{
+	assert( pszFileName );
+
+	//Reserve decides the capacity, adding more would invalidate the names that entries point to.
+	if( m_Entries.size() == m_Entries.capacity() || m_uiNamesUsed + uiNameLength + 1 > m_uiNamesSize )
+	{
+		assert( !"CPackDirectory::Add: not enough room reserved" );
+		return false;
+	}
+
+	char* pszName = &m_Names[ m_uiNamesUsed ];
+
+	for( size_t uiIndex = 0; uiIndex < uiNameLength; ++uiIndex )
+	{
+		const char c = pszFileName[ uiIndex ];
+
+		pszName[ uiIndex ] = ( c == '/' || c == '\\' ) ? PATH_SEPARATOR : c;
+	}
+
+	pszName[ uiNameLength ] = '\0';
+
+	const uint32_t uiHash = HashFileName( pszName );
+
+	const size_t uiMask = m_Slots.size() - 1;
+
+	size_t uiSlot = uiHash & uiMask;
+
+	for( ; m_Slots[ uiSlot ].uiEntry; uiSlot = ( uiSlot + 1 ) & uiMask )
+	{
+		const auto& slot = m_Slots[ uiSlot ];
+
+		if( slot.uiHash == uiHash && FileNamesEqual( m_Entries[ slot.uiEntry - 1 ].GetFileName(), pszName ) )
+			return false;
+	}
+
+	m_uiNamesUsed += uiNameLength + 1;
+
+	m_Entries.emplace_back( pszName, uiStartOffset, uiLength );
+
+	m_Slots[ uiSlot ] = Slot_t{ uiHash, static_cast<uint32_t>( m_Entries.size() ) };
+
+	return true;
+}
+
+const CPackFileEntry* CPackDirectory::Find( const char* pszFileName ) const
+{
+	if( !pszFileName || m_Slots.empty() )
+		return nullptr;
+
+	const uint32_t uiHash = HashFileName( pszFileName );
+
+	const size_t uiMask = m_Slots.size() - 1;
+
+	for( size_t uiSlot = uiHash & uiMask; m_Slots[ uiSlot ].uiEntry; uiSlot = ( uiSlot + 1 ) & uiMask )
+	{
+		const auto& slot = m_Slots[ uiSlot ];
+
+		if( slot.uiHash == uiHash )
+		{
+			const auto& entry = m_Entries[ slot.uiEntry - 1 ];
+
+			if( FileNamesEqual( entry.GetFileName(), pszFileName ) )
+				return &entry;
+		}
+	}
+
+	return nullptr;
+}
+
+size_t CPackDirectory::GetMemoryUsage() const
+{
+	return m_Entries.capacity() * sizeof( CPackFileEntry ) + m_uiNamesSize + m_Slots.capacity() * sizeof( Slot_t );
+}
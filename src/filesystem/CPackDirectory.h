@@ -0,0 +1,98 @@
+#ifndef FILESYSTEM_CPACKDIRECTORY_H
+#define FILESYSTEM_CPACKDIRECTORY_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "CPackFileEntry.h"
+
+/**
+*	The list of files in a pack file.
+*	Entries are stored in one array in pack file order, their names in one buffer, and lookups go through an open addressing hash table.
+*	Lookups are case insensitive and treat forward and back slashes as the same character.
+*/
+class CPackDirectory final
+{
+public:
+	typedef std::vector<CPackFileEntry>::const_iterator const_iterator;
+
+public:
+	CPackDirectory() = default;
+	~CPackDirectory() = default;
+
+	CPackDirectory( CPackDirectory&& other ) = default;
+	CPackDirectory& operator=( CPackDirectory&& other ) = default;
+
+	/**
+	*	Frees all entries.
+	*/
+	void Clear();
+
+	/**
+	*	Frees all entries and allocates room for the given number of entries and name characters. Must be called before adding entries.
+	*	@param uiNumEntries Maximum number of entries.
+	*	@param uiNameBytes Total length of all names, excluding null terminators.
+	*/
+	void Reserve( const size_t uiNumEntries, const size_t uiNameBytes );
+
+	/**
+	*	Adds an entry. Slashes in the name are converted to the platform's separator.
+	*	@param pszFileName Name of the file. Need not be null terminated.
+	*	@param uiNameLength Length of the name.
+	*	@param uiStartOffset Offset of the file's contents in the pack file.
+	*	@param uiLength Length of the file's contents.
+	*	@return Whether the entry was added. Entries whose name is already in the directory are ignored; the first one wins.
+	*/
+	bool Add( const char* pszFileName, const size_t uiNameLength, const uint64_t uiStartOffset, const uint64_t uiLength );
+
+	/**
+	*	Finds an entry by name.
+	*	@return The entry, or null if there is no file with the given name.
+	*/
+	const CPackFileEntry* Find( const char* pszFileName ) const;
+
+	size_t size() const { return m_Entries.size(); }
+
+	bool empty() const { return m_Entries.empty(); }
+
+	const CPackFileEntry& operator[]( const size_t uiIndex ) const { return m_Entries[ uiIndex ]; }
+
+	const_iterator begin() const { return m_Entries.begin(); }
+
+	const_iterator end() const { return m_Entries.end(); }
+
+	/**
+	*	@return Number of bytes allocated for entries, names and the hash table.
+	*/
+	size_t GetMemoryUsage() const;
+
+private:
+	struct Slot_t
+	{
+		uint32_t uiHash;
+
+		/**
+		*	Index of the entry, plus one. 0 if the slot is empty.
+		*/
+		uint32_t uiEntry;
+	};
+
+	std::vector<CPackFileEntry> m_Entries;
+
+	std::unique_ptr<char[]> m_Names;
+	size_t m_uiNamesSize = 0;
+	size_t m_uiNamesUsed = 0;
+
+	/**
+	*	Power of 2 in size, and at most half full.
+	*/
+	std::vector<Slot_t> m_Slots;
+
+private:
+	CPackDirectory( const CPackDirectory& ) = delete;
+	CPackDirectory& operator=( const CPackDirectory& ) = delete;
+};
+
+#endif //FILESYSTEM_CPACKDIRECTORY_H
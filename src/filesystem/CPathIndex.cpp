@@ -0,0 +1,390 @@
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+
+#include <sys/stat.h>
+
+#include "CPathIndex.h"
+
+namespace fs = std::experimental::filesystem;
+
+const std::chrono::milliseconds CPathIndex::REVALIDATE_INTERVAL( 1000 );
+
+namespace
+{
+bool PathIDMatches( const char* pszPathID, const CSearchPath& searchPath )
+{
+	return !pszPathID || ( searchPath.pszPathID && strcmp( pszPathID, searchPath.pszPathID ) == 0 );
+}
+
+/**
+*	@return The directory that contains the given key. Empty for keys in the root directory.
+*/
+std::string GetParentDirectory( const char* pszKey )
+{
+	const char* pszSlash = strrchr( pszKey, '/' );
+
+	return pszSlash ? std::string( pszKey, pszSlash - pszKey ) : std::string();
+}
+
+std::string AppendPath( const std::string& szDirectory, const std::string& szName )
+{
+	return szDirectory.empty() ? szName : szDirectory + '/' + szName;
+}
+}
+
+bool CPathIndex::NormalizePath( const char* pszPath, char* pszKey, const size_t uiKeySize )
+{
+	if( !pszPath || !pszKey || !uiKeySize )
+		return false;
+
+	if( *pszPath == '/' || *pszPath == '\\' || strchr( pszPath, ':' ) )
+		return false;
+
+	size_t uiLength = 0;
+
+	const char* pszComponent = pszPath;
+
+	while( *pszComponent )
+	{
+		const char* pszEnd = pszComponent;
+
+		while( *pszEnd && *pszEnd != '/' && *pszEnd != '\\' )
+			++pszEnd;
+
+		const size_t uiComponentLength = pszEnd - pszComponent;
+
+		if( uiComponentLength > 0 )
+		{
+			if( pszComponent[ 0 ] == '.' && ( uiComponentLength == 1 || ( uiComponentLength == 2 && pszComponent[ 1 ] == '.' ) ) )
+				return false;
+
+			//Separator, component and null terminator.
+			if( uiLength + ( uiLength ? 1 : 0 ) + uiComponentLength + 1 > uiKeySize )
+				return false;
+
+			if( uiLength )
+				pszKey[ uiLength++ ] = '/';
+
+			for( size_t uiIndex = 0; uiIndex < uiComponentLength; ++uiIndex )
+			{
+				pszKey[ uiLength++ ] = static_cast<char>( tolower( static_cast<unsigned char>( pszComponent[ uiIndex ] ) ) );
+			}
+		}
+
+		pszComponent = *pszEnd ? pszEnd + 1 : pszEnd;
+	}
+
+	pszKey[ uiLength ] = '\0';
+
+	return uiLength > 0;
+}
+
+void CPathIndex::Invalidate( const SearchPaths_t& searchPaths )
+{
+	m_pSearchPaths = &searchPaths;
+
+	m_bBuilt = false;
+
+	m_Paths.clear();
+	m_Directories.clear();
+}
+
+void CPathIndex::InvalidatePath( const char* pszKey )
+{
+	std::string szDirectory( pszKey );
+
+	do
+	{
+		szDirectory = GetParentDirectory( szDirectory.c_str() );
+
+		InvalidateDirectory( szDirectory );
+	}
+	while( !szDirectory.empty() );
+}
+
+const CPathIndex::Location_t* CPathIndex::Find( const char* pszKey, const char* pszPathID, const FindFlags_t flags )
+{
+	if( !m_pSearchPaths )
+		return nullptr;
+
+	if( !m_bBuilt )
+		Build();
+
+	const auto szDirectory = GetParentDirectory( pszKey );
+
+	if( m_Directories.find( szDirectory ) == m_Directories.end() )
+		ListDirectory( szDirectory );
+
+	if( auto pLocation = FindLocation( pszKey, pszPathID, flags ) )
+		return pLocation;
+
+	//The file may have been created since the directory was listed.
+	if( Revalidate( szDirectory ) )
+	{
+		ListDirectory( szDirectory );
+
+		return FindLocation( pszKey, pszPathID, flags );
+	}
+
+	return nullptr;
+}
+
+bool CPathIndex::GetFileStatus( const Location_t& location, FileStatus_t& status )
+{
+	const auto now = std::chrono::steady_clock::now();
+
+	//Never checked before if the check time is still the default.
+	if( location.statusCheck == std::chrono::steady_clock::time_point() || now - location.statusCheck >= REVALIDATE_INTERVAL )
+	{
+		auto path = fs::path( location.pSearchPath->szPath ) / location.szActualPath;
+
+		path.make_preferred();
+
+		++m_uiNumDiskQueries;
+
+		struct stat buffer{};
+
+		if( stat( path.u8string().c_str(), &buffer ) == -1 )
+			return false;
+
+		location.status.uiLength = static_cast<uint64_t>( buffer.st_size );
+		location.status.iModTime = static_cast<int64_t>( buffer.st_mtime );
+		location.status.bIsRegularFile = ( buffer.st_mode & S_IFMT ) == S_IFREG;
+
+		location.statusCheck = now;
+	}
+
+	status = location.status;
+
+	return true;
+}
+
+const CPathIndex::Location_t* CPathIndex::FindLocation( const char* pszKey, const char* pszPathID, const FindFlags_t flags ) const
+{
+	auto it = m_Paths.find( pszKey );
+
+	if( it == m_Paths.end() )
+		return nullptr;
+
+	for( const auto& location : it->second )
+	{
+		if( !PathIDMatches( pszPathID, *location.pSearchPath ) )
+			continue;
+
+		if( ( flags & FindFlag::LOOSE_ONLY ) && location.pPackEntry )
+			continue;
+
+		if( ( flags & FindFlag::FILES_ONLY ) && location.bIsDirectory )
+			continue;
+
+		if( ( flags & FindFlag::DIRECTORIES_ONLY ) && !location.bIsDirectory )
+			continue;
+
+		return &location;
+	}
+
+	return nullptr;
+}
+
+void CPathIndex::Build()
+{
+	m_bBuilt = true;
+
+	char szKey[ MAX_PATH ];
+
+	for( size_t uiOrder = 0; uiOrder < m_pSearchPaths->size(); ++uiOrder )
+	{
+		auto& searchPath = *( *m_pSearchPaths )[ uiOrder ];
+
+		if( !searchPath.IsPackFile() )
+			continue;
+
+		for( const auto& entry : searchPath.packDirectory )
+		{
+			if( !NormalizePath( entry.GetFileName(), szKey, sizeof( szKey ) ) )
+				continue;
+
+			AddLocation( szKey, Location_t{ &searchPath, uiOrder, &entry, false, std::string(), {}, {} } );
+		}
+	}
+}
+
+void CPathIndex::ListDirectory( const std::string& szDirectory )
+{
+	//The parent listing provides the actual name of this directory in each search path.
+	if( !szDirectory.empty() )
+	{
+		auto szParent = GetParentDirectory( szDirectory.c_str() );
+
+		if( m_Directories.find( szParent ) == m_Directories.end() )
+			ListDirectory( szParent );
+	}
+
+	auto& directory = m_Directories[ szDirectory ];
+
+	directory.lastCheck = std::chrono::steady_clock::now();
+
+	char szKey[ MAX_PATH ];
+
+	for( size_t uiOrder = 0; uiOrder < m_pSearchPaths->size(); ++uiOrder )
+	{
+		auto& searchPath = *( *m_pSearchPaths )[ uiOrder ];
+
+		if( searchPath.IsPackFile() )
+			continue;
+
+		std::string szActualDirectory;
+
+		if( !szDirectory.empty() )
+		{
+			//Search paths that don't contain the directory don't need to be listed.
+			auto parent = m_Paths.find( szDirectory );
+
+			if( parent == m_Paths.end() )
+				break;
+
+			auto location = std::find_if( parent->second.begin(), parent->second.end(), [ & ]( const Location_t& location )
+			{
+				return location.pSearchPath == &searchPath && location.bIsDirectory;
+			} );
+
+			if( location == parent->second.end() )
+				continue;
+
+			szActualDirectory = location->szActualPath;
+		}
+
+		auto path = szActualDirectory.empty() ? fs::path( searchPath.szPath ) : fs::path( searchPath.szPath ) / szActualDirectory;
+
+		std::error_code error;
+
+		++m_uiNumDiskQueries;
+
+		const auto modified = fs::last_write_time( path, error );
+
+		if( error )
+			continue;
+
+		directory.listedPaths.emplace_back( ListedPath_t{ path.u8string(), modified } );
+
+		++m_uiNumDiskQueries;
+
+		for( fs::directory_iterator it( path, error ), end; !error && it != end; it.increment( error ) )
+		{
+			auto szName = it->path().filename().u8string();
+
+			if( !NormalizePath( AppendPath( szDirectory, szName ).c_str(), szKey, sizeof( szKey ) ) )
+				continue;
+
+			std::error_code statusError;
+
+			const bool bIsDirectory = fs::is_directory( it->status( statusError ) );
+
+			directory.keys.emplace_back( szKey );
+
+			AddLocation( szKey, Location_t{ &searchPath, uiOrder, nullptr, bIsDirectory, AppendPath( szActualDirectory, szName ), {}, {} } );
+		}
+	}
+}
+
+void CPathIndex::InvalidateDirectory( const std::string& szDirectory )
+{
+	auto it = m_Directories.find( szDirectory );
+
+	if( it == m_Directories.end() )
+		return;
+
+	//Remove the loose locations that the listing added, pack file entries don't change.
+	for( const auto& szKey : it->second.keys )
+	{
+		auto path = m_Paths.find( szKey );
+
+		if( path == m_Paths.end() )
+			continue;
+
+		auto& locations = path->second;
+
+		locations.erase( std::remove_if( locations.begin(), locations.end(), []( const Location_t& location )
+		{
+			return !location.pSearchPath->IsPackFile();
+		} ), locations.end() );
+
+		if( locations.empty() )
+			m_Paths.erase( path );
+	}
+
+	m_Directories.erase( it );
+}
+
+bool CPathIndex::Revalidate( const std::string& szDirectory )
+{
+	const auto now = std::chrono::steady_clock::now();
+
+	std::string szCurrent = szDirectory;
+
+	bool bChanged = false;
+
+	while( true )
+	{
+		auto it = m_Directories.find( szCurrent );
+
+		if( it != m_Directories.end() && now - it->second.lastCheck >= REVALIDATE_INTERVAL )
+		{
+			it->second.lastCheck = now;
+
+			std::error_code error;
+
+			for( const auto& listedPath : it->second.listedPaths )
+			{
+				++m_uiNumDiskQueries;
+
+				if( fs::last_write_time( listedPath.szPath, error ) != listedPath.modified || error )
+				{
+					bChanged = true;
+					break;
+				}
+			}
+		}
+
+		//A directory may also have been created in a search path that didn't have it when it was listed, which changes its parent.
+		if( bChanged || szCurrent.empty() )
+			break;
+
+		szCurrent = GetParentDirectory( szCurrent.c_str() );
+	}
+
+	if( !bChanged )
+		return false;
+
+	//Drop everything from the directory up to the one that changed so the listings are rebuilt from there.
+	for( std::string szInvalid = szDirectory; ; szInvalid = GetParentDirectory( szInvalid.c_str() ) )
+	{
+		InvalidateDirectory( szInvalid );
+
+		if( szInvalid == szCurrent )
+			break;
+	}
+
+	return true;
+}
+
+void CPathIndex::AddLocation( std::string&& szKey, Location_t&& location )
+{
+	auto& locations = m_Paths[ std::move( szKey ) ];
+
+	//Keep locations in search path order so the first match is the one that wins.
+	auto it = locations.begin();
+
+	while( it != locations.end() && it->uiOrder <= location.uiOrder )
+	{
+		//Already added. Happens when a pack file has duplicate entries, or a directory has names that only differ in case.
+		//The first one wins.
+		if( it->uiOrder == location.uiOrder )
+			return;
+
+		++it;
+	}
+
+	locations.insert( it, std::move( location ) );
+}
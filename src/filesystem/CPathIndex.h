@@ -0,0 +1,218 @@
+#ifndef FILESYSTEM_CPATHINDEX_H
+#define FILESYSTEM_CPATHINDEX_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <experimental/filesystem>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "CSearchPath.h"
+
+/**
+*	Maps relative paths to the search paths that contain them, so lookups don't have to probe every search path on disk.
+*	Pack file entries are indexed when the index is built. Loose directories are listed the first time a path inside of them is looked up,
+*	after which lookups of any file in that directory, including misses, are a single hash lookup.
+*	Keys are normalized: lowercase, forward slashes, no leading, trailing or duplicate slashes.
+*	Lookups are case insensitive on all platforms; loose files remember their actual name so they can be opened on case sensitive filesystems.
+*/
+class CPathIndex final
+{
+public:
+	typedef std::vector<std::unique_ptr<CSearchPath>> SearchPaths_t;
+
+	/**
+	*	Minimum time between checks for changes to a listed directory.
+	*	Directories are only checked when a lookup in them misses, and at most this often.
+	*/
+	static const std::chrono::milliseconds REVALIDATE_INTERVAL;
+
+	/**
+	*	Size and modification time of a loose file.
+	*/
+	struct FileStatus_t
+	{
+		uint64_t uiLength;
+		int64_t iModTime;
+
+		/**
+		*	Whether this is a regular file, as opposed to a device, pipe or similar.
+		*/
+		bool bIsRegularFile;
+	};
+
+	/**
+	*	A search path that contains a given path.
+	*/
+	struct Location_t
+	{
+		CSearchPath* pSearchPath;
+
+		/**
+		*	Index of the search path in the search path list. Locations are sorted by this.
+		*/
+		size_t uiOrder;
+
+		/**
+		*	If this is a file inside of a pack file, the pack entry. Null for loose files and directories.
+		*/
+		const CPackFileEntry* pPackEntry;
+
+		bool bIsDirectory;
+
+		/**
+		*	For loose files and directories, the path relative to the search path as it is spelled on disk.
+		*/
+		std::string szActualPath;
+
+		/**
+		*	For loose files, the status that was last read from disk, and when. Filled in by GetFileStatus.
+		*/
+		mutable FileStatus_t status;
+		mutable std::chrono::steady_clock::time_point statusCheck;
+	};
+
+	typedef uint32_t FindFlags_t;
+
+	struct FindFlag
+	{
+		enum : FindFlags_t
+		{
+			NONE			= 0,
+
+			/**
+			*	Skip files inside of pack files.
+			*/
+			LOOSE_ONLY		= 1 << 0,
+
+			/**
+			*	Skip directories.
+			*/
+			FILES_ONLY		= 1 << 1,
+
+			/**
+			*	Skip files.
+			*/
+			DIRECTORIES_ONLY	= 1 << 2,
+		};
+	};
+
+public:
+	CPathIndex() = default;
+	~CPathIndex() = default;
+
+	/**
+	*	Normalizes a relative path into an index key.
+	*	@param pszPath Path to normalize.
+	*	@param pszKey Destination buffer.
+	*	@param uiKeySize Size of the destination buffer, in characters.
+	*	@return Whether the path can be looked up in the index. Absolute paths, paths that refer to the current or parent directory
+	*		and paths that don't fit in the buffer can't be.
+	*/
+	static bool NormalizePath( const char* pszPath, char* pszKey, const size_t uiKeySize );
+
+	/**
+	*	Frees all entries. The index rebuilds itself from the given search paths on the next lookup.
+	*	Must be called whenever search paths are added or removed.
+	*/
+	void Invalidate( const SearchPaths_t& searchPaths );
+
+	/**
+	*	Forgets the listings of every directory that contains the given path, so files created or removed there are picked up.
+	*	@param pszKey Normalized path.
+	*/
+	void InvalidatePath( const char* pszKey );
+
+	/**
+	*	Finds the first search path that contains the given path.
+	*	@param pszKey Normalized path.
+	*	@param pszPathID If not null, only search paths with this path ID are considered.
+	*	@param flags Find flags.
+	*	@return The location, or null if no search path contains the path.
+	*/
+	const Location_t* Find( const char* pszKey, const char* pszPathID, const FindFlags_t flags = FindFlag::NONE );
+
+	/**
+	*	Gets the status of a loose file that was found with Find.
+	*	The status is remembered, and only read from disk again once REVALIDATE_INTERVAL has passed since it was last read.
+	*	@param location Location of a loose file.
+	*	@param[ out ] status The file's status.
+	*	@return Whether the file exists.
+	*/
+	bool GetFileStatus( const Location_t& location, FileStatus_t& status );
+
+	/**
+	*	@return Number of paths in the index.
+	*/
+	size_t GetNumPaths() const { return m_Paths.size(); }
+
+	/**
+	*	@return Number of directory listings and directory status checks made since the last call to ResetNumDiskQueries.
+	*/
+	uint64_t GetNumDiskQueries() const { return m_uiNumDiskQueries; }
+
+	void ResetNumDiskQueries() { m_uiNumDiskQueries = 0; }
+
+private:
+	/**
+	*	A loose directory that was listed, and its modification time at that point.
+	*/
+	struct ListedPath_t
+	{
+		std::string szPath;
+		std::experimental::filesystem::file_time_type modified;
+	};
+
+	struct Directory_t
+	{
+		/**
+		*	Keys that were added by listing this directory.
+		*/
+		std::vector<std::string> keys;
+
+		std::vector<ListedPath_t> listedPaths;
+
+		std::chrono::steady_clock::time_point lastCheck;
+	};
+
+	typedef std::unordered_map<std::string, Directory_t> Directories_t;
+
+	const Location_t* FindLocation( const char* pszKey, const char* pszPathID, const FindFlags_t flags ) const;
+
+	void Build();
+
+	void ListDirectory( const std::string& szDirectory );
+
+	void InvalidateDirectory( const std::string& szDirectory );
+
+	/**
+	*	Checks whether the given directory or any of its parents changed on disk, and drops their listings if so.
+	*	@return Whether anything changed.
+	*/
+	bool Revalidate( const std::string& szDirectory );
+
+	void AddLocation( std::string&& szKey, Location_t&& location );
+
+private:
+	const SearchPaths_t* m_pSearchPaths = nullptr;
+
+	bool m_bBuilt = false;
+
+	std::unordered_map<std::string, std::vector<Location_t>> m_Paths;
+
+	/**
+	*	Directories that have been listed.
+	*/
+	Directories_t m_Directories;
+
+	uint64_t m_uiNumDiskQueries = 0;
+
+private:
+	CPathIndex( const CPathIndex& ) = delete;
+	CPathIndex& operator=( const CPathIndex& ) = delete;
+};
+
+#endif //FILESYSTEM_CPATHINDEX_H
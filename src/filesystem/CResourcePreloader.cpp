@@ -0,0 +1,320 @@
+#include <algorithm>
+
+#include "Platform.h"
+
+#include "CResourcePreloader.h"
+
+const size_t CResourcePreloader::MAX_WORKERS;
+const uint64_t CResourcePreloader::MAX_CACHE_SIZE;
+
+CResourcePreloader::~CResourcePreloader()
+{
+	StopWorkers();
+}
+
+bool CResourcePreloader::Queue( Request_t&& request )
+{
+	std::lock_guard<std::mutex> lock( m_Mutex );
+
+	auto it = m_Entries.find( request.szKey );
+
+	if( it != m_Entries.end() )
+	{
+		auto& entry = *it->second;
+
+		//Already queued or loaded from the same place.
+		if( entry.request.pSearchPath == request.pSearchPath && entry.state != State::FAILED )
+			return true;
+
+		Cancel( entry );
+
+		m_Entries.erase( it );
+	}
+
+	if( m_uiCachedBytes + request.uiLength > MAX_CACHE_SIZE )
+		return false;
+
+	m_uiCachedBytes += request.uiLength;
+
+	auto entry = std::make_shared<Entry_t>();
+
+	entry->request = std::move( request );
+
+	m_Entries.emplace( entry->request.szKey, entry );
+
+	m_Queue.emplace_back( std::move( entry ) );
+
+	if( m_Workers.empty() )
+		StartWorkers();
+
+	m_WorkAvailable.notify_one();
+
+	return true;
+}
+
+void CResourcePreloader::Forget( const char* pszKey )
+{
+	std::lock_guard<std::mutex> lock( m_Mutex );
+
+	auto it = m_Entries.find( pszKey );
+
+	if( it == m_Entries.end() )
+		return;
+
+	Cancel( *it->second );
+
+	m_Entries.erase( it );
+}
+
+void CResourcePreloader::Clear()
+{
+	std::lock_guard<std::mutex> lock( m_Mutex );
+
+	for( auto& entry : m_Entries )
+		Cancel( *entry.second );
+
+	m_Entries.clear();
+	m_Queue.clear();
+	m_Waits.clear();
+}
+
+bool CResourcePreloader::SetPaused( const bool bPaused )
+{
+	std::lock_guard<std::mutex> lock( m_Mutex );
+
+	const bool bWasPaused = m_bPaused;
+
+	m_bPaused = bPaused;
+
+	if( !m_bPaused )
+		m_WorkAvailable.notify_all();
+
+	return bWasPaused;
+}
+
+CResourcePreloader::Data_t CResourcePreloader::Take( const char* pszKey, const CSearchPath* pSearchPath )
+{
+	std::unique_lock<std::mutex> lock( m_Mutex );
+
+	auto it = m_Entries.find( pszKey );
+
+	if( it == m_Entries.end() )
+		return nullptr;
+
+	//Keep the entry alive while waiting, the map can't change since only this thread modifies it.
+	auto entry = it->second;
+
+	if( entry->request.pSearchPath != pSearchPath )
+		return nullptr;
+
+	//Reading it again would only compete with the worker for the disk.
+	m_LoadFinished.wait( lock, [ & ]()
+	{
+		return entry->state != State::LOADING;
+	} );
+
+	Data_t data;
+
+	if( entry->state == State::DONE )
+	{
+		++m_uiHits;
+
+		data = std::move( entry->data );
+	}
+
+	//The caller's handle keeps the contents alive from here on.
+	Cancel( *entry );
+
+	m_Entries.erase( it );
+
+	return data;
+}
+
+bool CResourcePreloader::IsPending( const char* pszKey ) const
+{
+	std::lock_guard<std::mutex> lock( m_Mutex );
+
+	auto it = m_Entries.find( pszKey );
+
+	return it != m_Entries.end() && ( it->second->state == State::PENDING || it->second->state == State::LOADING );
+}
+
+int CResourcePreloader::CreateWait( const std::vector<std::string>& keys )
+{
+	std::lock_guard<std::mutex> lock( m_Mutex );
+
+	std::vector<std::shared_ptr<Entry_t>> entries;
+
+	for( const auto& szKey : keys )
+	{
+		auto it = m_Entries.find( szKey );
+
+		if( it != m_Entries.end() )
+			entries.emplace_back( it->second );
+	}
+
+	if( entries.empty() )
+		return 0;
+
+	const int iHandle = m_iNextWait++;
+
+	m_Waits.emplace( iHandle, std::move( entries ) );
+
+	return iHandle;
+}
+
+bool CResourcePreloader::GetWaitProgress( const int iHandle, float& flProgress, bool& bComplete )
+{
+	std::lock_guard<std::mutex> lock( m_Mutex );
+
+	auto it = m_Waits.find( iHandle );
+
+	if( it == m_Waits.end() )
+	{
+		flProgress = 0;
+		bComplete = true;
+		return false;
+	}
+
+	uint64_t uiTotal = 0;
+	uint64_t uiDone = 0;
+
+	for( const auto& entry : it->second )
+	{
+		uiTotal += entry->request.uiLength;
+
+		if( entry->state != State::PENDING && entry->state != State::LOADING )
+			uiDone += entry->request.uiLength;
+	}
+
+	bComplete = uiDone == uiTotal;
+	flProgress = uiTotal ? static_cast<float>( static_cast<double>( uiDone ) / uiTotal ) : 1.0f;
+
+	if( bComplete )
+		m_Waits.erase( it );
+
+	return true;
+}
+
+void CResourcePreloader::CancelWait( const int iHandle )
+{
+	std::lock_guard<std::mutex> lock( m_Mutex );
+
+	m_Waits.erase( iHandle );
+}
+
+void CResourcePreloader::GetStats( Stats_t& stats ) const
+{
+	std::lock_guard<std::mutex> lock( m_Mutex );
+
+	stats.uiHits = m_uiHits;
+	stats.uiCachedFiles = std::count_if( m_Entries.begin(), m_Entries.end(), []( const Entries_t::value_type& entry )
+	{
+		return entry.second->state == State::DONE;
+	} );
+	stats.uiCachedBytes = m_uiCachedBytes;
+}
+
+void CResourcePreloader::ResetStats()
+{
+	std::lock_guard<std::mutex> lock( m_Mutex );
+
+	m_uiHits = 0;
+}
+
+void CResourcePreloader::StartWorkers()
+{
+	const size_t uiNumWorkers = std::max( static_cast<size_t>( 1 ), std::min( static_cast<size_t>( std::thread::hardware_concurrency() ), MAX_WORKERS ) );
+
+	for( size_t uiIndex = 0; uiIndex < uiNumWorkers; ++uiIndex )
+		m_Workers.emplace_back( &CResourcePreloader::WorkerMain, this );
+}
+
+void CResourcePreloader::StopWorkers()
+{
+	{
+		std::lock_guard<std::mutex> lock( m_Mutex );
+
+		m_bShutdown = true;
+	}
+
+	m_WorkAvailable.notify_all();
+
+	for( auto& worker : m_Workers )
+		worker.join();
+
+	m_Workers.clear();
+}
+
+void CResourcePreloader::WorkerMain()
+{
+	std::unique_lock<std::mutex> lock( m_Mutex );
+
+	while( true )
+	{
+		m_WorkAvailable.wait( lock, [ this ]()
+		{
+			return m_bShutdown || ( !m_bPaused && !m_Queue.empty() );
+		} );
+
+		if( m_bShutdown )
+			return;
+
+		auto entry = std::move( m_Queue.front() );
+
+		m_Queue.pop_front();
+
+		if( entry->state != State::PENDING )
+			continue;
+
+		entry->state = State::LOADING;
+
+		//The request can't change while the entry is loading, so it can be read without holding the lock.
+		const auto& request = entry->request;
+
+		lock.unlock();
+
+		auto data = std::make_shared<std::vector<uint8_t>>( static_cast<size_t>( request.uiLength ) );
+
+		bool bSuccess = false;
+
+		if( FILE* pFile = fopen64( request.szDiskPath.c_str(), "rb" ) )
+		{
+			bSuccess = fseek64( pFile, static_cast<int64_t>( request.uiOffset ), SEEK_SET ) == 0 &&
+				( data->empty() || fread( data->data(), data->size(), 1, pFile ) == 1 );
+
+			fclose( pFile );
+		}
+
+		lock.lock();
+
+		if( entry->state != State::CANCELLED )
+		{
+			if( bSuccess )
+			{
+				entry->state = State::DONE;
+				entry->data = std::move( data );
+			}
+			else
+			{
+				entry->state = State::FAILED;
+				m_uiCachedBytes -= request.uiLength;
+			}
+		}
+
+		//An open of this file may be waiting on the read.
+		m_LoadFinished.notify_all();
+	}
+}
+
+void CResourcePreloader::Cancel( Entry_t& entry )
+{
+	if( entry.state == State::CANCELLED )
+		return;
+
+	if( entry.state != State::FAILED )
+		m_uiCachedBytes -= entry.request.uiLength;
+
+	entry.state = State::CANCELLED;
+	entry.data.reset();
+}
@@ -0,0 +1,206 @@
+#ifndef FILESYSTEM_CRESOURCEPRELOADER_H
+#define FILESYSTEM_CRESOURCEPRELOADER_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+struct CSearchPath;
+
+/**
+*	Reads files into memory on a small pool of worker threads, ahead of the time they are opened.
+*	Files are identified by their path index key and the search path they were found in, so a cached file is only used if the same search path would still provide it.
+*	Workers only read from disk; all filesystem state is resolved by the caller before a file is queued.
+*	Files are handed out once: opening a preloaded file takes its contents out of the cache, so the budget only covers files that haven't been opened yet.
+*	All methods must be called from the thread that owns the filesystem.
+*/
+class CResourcePreloader final
+{
+public:
+	/**
+	*	Maximum number of worker threads.
+	*/
+	static const size_t MAX_WORKERS = 4;
+
+	/**
+	*	Maximum number of bytes that queued and cached files may use together.
+	*/
+	static const uint64_t MAX_CACHE_SIZE = 64 * 1024 * 1024;
+
+	typedef std::shared_ptr<const std::vector<uint8_t>> Data_t;
+
+	/**
+	*	A file to preload.
+	*/
+	struct Request_t
+	{
+		/**
+		*	Normalized path of the file.
+		*/
+		std::string szKey;
+
+		/**
+		*	Search path that provides the file. Only used to check cache hits, never dereferenced.
+		*/
+		const CSearchPath* pSearchPath;
+
+		/**
+		*	File on disk to read from. For files in pack files, the pack file.
+		*/
+		std::string szDiskPath;
+
+		uint64_t uiOffset;
+		uint64_t uiLength;
+	};
+
+	struct Stats_t
+	{
+		/**
+		*	Number of opens that were served from the cache.
+		*/
+		uint64_t uiHits;
+
+		/**
+		*	Number of files that are cached.
+		*/
+		uint64_t uiCachedFiles;
+
+		/**
+		*	Number of bytes used by queued and cached files.
+		*/
+		uint64_t uiCachedBytes;
+	};
+
+public:
+	CResourcePreloader() = default;
+	~CResourcePreloader();
+
+	/**
+	*	Queues a file for preloading.
+	*	@return Whether the file is queued or cached. False if it doesn't fit in the cache.
+	*/
+	bool Queue( Request_t&& request );
+
+	/**
+	*	Drops a file from the cache. If it is being read, the result is discarded.
+	*/
+	void Forget( const char* pszKey );
+
+	/**
+	*	Drops all files from the cache, and cancels all waits.
+	*/
+	void Clear();
+
+	/**
+	*	Pauses or resumes preloading. Files that are being read when preloading is paused are finished.
+	*	@return Whether preloading was paused before this call.
+	*/
+	bool SetPaused( const bool bPaused );
+
+	/**
+	*	Removes the given file from the cache and returns its contents.
+	*	If the file is being read, waits for the read to finish. If it is still queued, it is dropped, since the caller will read it anyway.
+	*	@return The contents of the given file if it has been loaded from the given search path, otherwise null.
+	*/
+	Data_t Take( const char* pszKey, const CSearchPath* pSearchPath );
+
+	/**
+	*	@return Whether the given file is queued or being read.
+	*/
+	bool IsPending( const char* pszKey ) const;
+
+	/**
+	*	Starts tracking the progress of the given files, which must have been queued.
+	*	@return Handle to the wait, or 0 if there is nothing to wait on.
+	*/
+	int CreateWait( const std::vector<std::string>& keys );
+
+	/**
+	*	Gets the progress of a wait. Once a wait has been reported as complete, it is removed.
+	*	@return Whether the handle was valid.
+	*/
+	bool GetWaitProgress( const int iHandle, float& flProgress, bool& bComplete );
+
+	void CancelWait( const int iHandle );
+
+	void GetStats( Stats_t& stats ) const;
+
+	void ResetStats();
+
+private:
+	enum class State
+	{
+		PENDING,
+		LOADING,
+		DONE,
+		FAILED,
+
+		/**
+		*	Forgotten while it was queued or being read.
+		*/
+		CANCELLED
+	};
+
+	struct Entry_t
+	{
+		Request_t request;
+
+		State state = State::PENDING;
+
+		Data_t data;
+	};
+
+	typedef std::unordered_map<std::string, std::shared_ptr<Entry_t>> Entries_t;
+
+	void StartWorkers();
+
+	void StopWorkers();
+
+	void WorkerMain();
+
+	/**
+	*	Marks an entry as cancelled and releases its share of the cache. Must be called with the mutex held.
+	*/
+	void Cancel( Entry_t& entry );
+
+private:
+	mutable std::mutex m_Mutex;
+
+	std::condition_variable m_WorkAvailable;
+
+	/**
+	*	Signaled whenever a worker finishes reading a file.
+	*/
+	std::condition_variable m_LoadFinished;
+
+	std::vector<std::thread> m_Workers;
+
+	bool m_bShutdown = false;
+
+	bool m_bPaused = false;
+
+	Entries_t m_Entries;
+
+	std::deque<std::shared_ptr<Entry_t>> m_Queue;
+
+	uint64_t m_uiCachedBytes = 0;
+
+	std::unordered_map<int, std::vector<std::shared_ptr<Entry_t>>> m_Waits;
+
+	int m_iNextWait = 1;
+
+	uint64_t m_uiHits = 0;
+
+private:
+	CResourcePreloader( const CResourcePreloader& ) = delete;
+	CResourcePreloader& operator=( const CResourcePreloader& ) = delete;
+};
+
+#endif //FILESYSTEM_CRESOURCEPRELOADER_H
@@ -2,14 +2,12 @@
 #define FILESYSTEM_CSEARCHPATH_H
 
 #include <cstdint>
-#include <map>
 #include <memory>
 
 #include "Platform.h"
 
-#include "CPackFileEntry.h"
-
-#include "StringUtils.h"
+#include "CDirectoryTree.h"
+#include "CPackDirectory.h"
 
 class CFileHandle;
 
@@ -27,8 +25,6 @@ namespace SearchPathFlag
 
 struct CSearchPath
 {
-	typedef std::map<const char*, std::unique_ptr<CPackFileEntry>, Less_C_String<const char*>> Entries_t;
-
 	CSearchPath() = default;
 	CSearchPath( CSearchPath&& other ) = default;
 	CSearchPath& operator=( CSearchPath&& other ) = default;
@@ -43,7 +39,17 @@ struct CSearchPath
 
 	std::unique_ptr<CFileHandle> packFile;
 
-	Entries_t packEntries;
+	/**
+	*	Modification time of the pack file when it was mounted. Identifies its contents in the block cache.
+	*/
+	int64_t iPackModTime;
+
+	CPackDirectory packDirectory;
+
+	/**
+	*	Snapshot of the entries in this search path, used by FindFirst/FindNext.
+	*/
+	CDirectoryTree directoryTree;
 
 private:
 	CSearchPath( const CSearchPath& ) = delete;
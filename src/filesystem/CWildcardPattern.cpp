@@ -0,0 +1,93 @@
+#include <cstring>
+
+#include "CWildcardPattern.h"
+
+CWildcardPattern::CWildcardPattern( const char* pszPattern )
+{
+	const char* pszSegment = pszPattern;
+
+	while( true )
+	{
+		const char* pszStar = strchr( pszSegment, '*' );
+
+		if( !pszStar )
+		{
+			m_Segments.emplace_back( pszSegment );
+			break;
+		}
+
+		m_Segments.emplace_back( pszSegment, pszStar - pszSegment );
+
+		pszSegment = pszStar + 1;
+	}
+
+	//Split the literal prefix into directories and the name prefix of the last component.
+	const std::string& szLiteral = m_Segments.front();
+
+	size_t uiStart = 0;
+
+	for( size_t uiIndex = 0; uiIndex < szLiteral.length(); ++uiIndex )
+	{
+		if( szLiteral[ uiIndex ] == '/' || szLiteral[ uiIndex ] == '\\' )
+		{
+			if( uiIndex > uiStart )
+				m_Directories.emplace_back( szLiteral.substr( uiStart, uiIndex - uiStart ) );
+
+			uiStart = uiIndex + 1;
+		}
+	}
+
+	m_szNamePrefix = szLiteral.substr( uiStart );
+}
+
+bool CWildcardPattern::Matches( const char* pszString, const size_t uiLength ) const
+{
+	if( m_Segments.empty() )
+		return false;
+
+	const auto& first = m_Segments.front();
+
+	if( IsLiteral() )
+		return uiLength == first.length() && !memcmp( pszString, first.c_str(), uiLength );
+
+	const auto& last = m_Segments.back();
+
+	if( uiLength < first.length() + last.length() )
+		return false;
+
+	if( memcmp( pszString, first.c_str(), first.length() ) )
+		return false;
+
+	if( memcmp( pszString + uiLength - last.length(), last.c_str(), last.length() ) )
+		return false;
+
+	//Segments inbetween wildcards can be anywhere in the remaining range, the leftmost occurrence leaves the most room for the rest.
+	const char* pszPos = pszString + first.length();
+	const char* const pszEnd = pszString + uiLength - last.length();
+
+	for( size_t uiIndex = 1; uiIndex + 1 < m_Segments.size(); ++uiIndex )
+	{
+		const auto& segment = m_Segments[ uiIndex ];
+
+		if( segment.empty() )
+			continue;
+
+		const char* pszFound = nullptr;
+
+		for( const char* pszCandidate = pszPos; pszCandidate + segment.length() <= pszEnd; ++pszCandidate )
+		{
+			if( !memcmp( pszCandidate, segment.c_str(), segment.length() ) )
+			{
+				pszFound = pszCandidate;
+				break;
+			}
+		}
+
+		if( !pszFound )
+			return false;
+
+		pszPos = pszFound + segment.length();
+	}
+
+	return true;
+}
@@ -0,0 +1,63 @@
+#ifndef FILESYSTEM_CWILDCARDPATTERN_H
+#define FILESYSTEM_CWILDCARDPATTERN_H
+
+#include <string>
+#include <vector>
+
+/**
+*	A wildcard pattern used by FindFirst, compiled once so entries can be matched without reparsing it.
+*	'*' matches any number of characters, including path separators. All other characters match themselves, case sensitively.
+*	The literal part of the pattern before the first '*' is split into a directory and a name prefix,
+*	so searches only have to look at the entries inside of that directory whose names start with that prefix.
+*/
+class CWildcardPattern final
+{
+public:
+	CWildcardPattern() = default;
+	~CWildcardPattern() = default;
+
+	CWildcardPattern( CWildcardPattern&& other ) = default;
+	CWildcardPattern& operator=( CWildcardPattern&& other ) = default;
+
+	CWildcardPattern( const CWildcardPattern& other ) = default;
+	CWildcardPattern& operator=( const CWildcardPattern& other ) = default;
+
+	/**
+	*	Compiles the given pattern. Both '/' and '\\' are treated as path separators when splitting off the directory.
+	*/
+	explicit CWildcardPattern( const char* pszPattern );
+
+	/**
+	*	@return Whether the given path matches the pattern.
+	*/
+	bool Matches( const char* pszString, const size_t uiLength ) const;
+
+	bool Matches( const std::string& szString ) const { return Matches( szString.c_str(), szString.length() ); }
+
+	/**
+	*	@return Whether the pattern contains no wildcards, and only matches itself.
+	*/
+	bool IsLiteral() const { return m_Segments.size() == 1; }
+
+	/**
+	*	@return Directories that every match is inside of, outermost first.
+	*/
+	const std::vector<std::string>& GetDirectories() const { return m_Directories; }
+
+	/**
+	*	@return Prefix that the name of every match's entry inside of the pattern's directory starts with.
+	*/
+	const std::string& GetNamePrefix() const { return m_szNamePrefix; }
+
+private:
+	/**
+	*	Literal parts of the pattern between wildcards. Always contains at least one segment.
+	*/
+	std::vector<std::string> m_Segments;
+
+	std::vector<std::string> m_Directories;
+
+	std::string m_szNamePrefix;
+};
+
+#endif //FILESYSTEM_CWILDCARDPATTERN_H
@@ -0,0 +1,158 @@
+#include <cstdio>
+
+#include "common/ByteSwap.h"
+
+#include "Engine.h"
+#include "FileSystem2.h"
+#include "CFile.h"
+
+#include "WadIO.h"
+
+#include "CWadFile.h"
+
+CWadFile::~CWadFile()
+{
+	if( m_pMapped )
+		g_pFileSystem->UnmapFile( m_pMapped );
+}
+
+const void* CWadFile::GetLumpData( const lumpinfo_t* pLump ) const
+{
+	assert( pLump );
+
+	if( !pLump )
+		return nullptr;
+
+	//Check if the lump is actually from this wad.
+	if( pLump < GetLumps() || pLump >= GetLumps() + GetNumLumps() )
+		return nullptr;
+
+	//Compression isn't used, so the data is stored as is.
+	if( pLump->filepos < 0 || pLump->disksize < 0 || static_cast<uint64_t>( pLump->filepos ) + pLump->disksize > m_uiSize )
+		return nullptr;
+
+	if( m_pMapped )
+		return reinterpret_cast<const uint8_t*>( m_pMapped ) + pLump->filepos;
+
+	const int iLump = static_cast<int>( pLump - GetLumps() );
+
+	std::lock_guard<std::mutex> lock( m_Mutex );
+
+	auto it = m_LoadedLumps.find( iLump );
+
+	if( it != m_LoadedLumps.end() )
+		return it->second.get();
+
+	std::unique_ptr<uint8_t[]> data( new uint8_t[ pLump->disksize ] );
+
+	m_File->Seek( pLump->filepos, FILESYSTEM_SEEK_HEAD );
+
+	const int iRead = m_File->Read( data.get(), pLump->disksize );
+
+	if( iRead != pLump->disksize )
+	{
+		printf( "CWadFile::GetLumpData: Failed to read lump \"%.*s\" from WAD \"%s\" (expected %d, got %d)\n",
+				WAD_MAX_LUMP_NAME_SIZE, pLump->name, m_szFilename, pLump->disksize, iRead );
+		return nullptr;
+	}
+
+	return m_LoadedLumps.emplace( iLump, std::move( data ) ).first->second.get();
+}
+
+std::unique_ptr<CWadFile> OpenWadFile( const char* const pszFileName, const char* const pszName, const bool bAllowMapping )
+{
+	assert( pszFileName );
+	assert( pszName );
+
+	CFile file( pszFileName, "rb" );
+
+	if( !file.IsOpen() )
+	{
+		printf( "OpenWadFile: Couldn't open WAD \"%s\"\n", pszFileName );
+		return nullptr;
+	}
+
+	std::unique_ptr<CWadFile> wad( new CWadFile() );
+
+	strncpy( wad->m_szFilename, pszName, sizeof( wad->m_szFilename ) );
+
+	wad->m_szFilename[ sizeof( wad->m_szFilename ) - 1 ] = '\0';
+
+	if( bAllowMapping )
+		wad->m_pMapped = g_pFileSystem->MapFile( file.GetFileHandle(), wad->m_uiSize );
+
+	if( !wad->m_pMapped )
+		wad->m_uiSize = file.Size();
+
+	wadinfo_t header;
+
+	if( wad->m_uiSize < sizeof( header ) )
+	{
+		printf( "OpenWadFile: File \"%s\" is too small to be a WAD file\n", pszFileName );
+		return nullptr;
+	}
+
+	if( wad->m_pMapped )
+	{
+		memcpy( &header, wad->m_pMapped, sizeof( header ) );
+	}
+	else if( file.Read( &header, sizeof( header ) ) != sizeof( header ) )
+	{
+		printf( "OpenWadFile: Failed to read WAD header from \"%s\"\n", pszFileName );
+		return nullptr;
+	}
+
+	if( strncmp( WAD2_ID, header.identification, 4 ) && strncmp( WAD3_ID, header.identification, 4 ) )
+	{
+		printf( "OpenWadFile: File \"%s\" is not a WAD2 or WAD3 file\n", pszFileName );
+		return nullptr;
+	}
+
+	header.infotableofs = LittleValue( header.infotableofs );
+	header.numlumps = LittleValue( header.numlumps );
+
+	if( header.numlumps < 0 || header.infotableofs < 0 ||
+		static_cast<uint64_t>( header.infotableofs ) + static_cast<uint64_t>( header.numlumps ) * sizeof( lumpinfo_t ) > wad->m_uiSize )
+	{
+		printf( "OpenWadFile: WAD file \"%s\" has an invalid directory\n", pszFileName );
+		return nullptr;
+	}
+
+	wad->m_Lumps.resize( header.numlumps );
+
+	const int iDirectorySize = static_cast<int>( header.numlumps * sizeof( lumpinfo_t ) );
+
+	if( wad->m_pMapped )
+	{
+		memcpy( wad->m_Lumps.data(), reinterpret_cast<const uint8_t*>( wad->m_pMapped ) + header.infotableofs, iDirectorySize );
+	}
+	else
+	{
+		file.Seek( header.infotableofs, FILESYSTEM_SEEK_HEAD );
+
+		if( file.Read( wad->m_Lumps.data(), iDirectorySize ) != iDirectorySize )
+		{
+			printf( "OpenWadFile: Failed to read WAD directory from \"%s\"\n", pszFileName );
+			return nullptr;
+		}
+	}
+
+	//Swap all variables, clean up names.
+	for( auto& lump : wad->m_Lumps )
+	{
+		CleanupWadLumpName( lump.name, lump.name, sizeof( lump.name ) );
+
+		lump.filepos	= LittleValue( lump.filepos );
+		lump.disksize	= LittleValue( lump.disksize );
+		lump.size		= LittleValue( lump.size );
+	}
+
+	//Lumps are read on demand if the file isn't mapped, so keep it open.
+	if( !wad->m_pMapped )
+	{
+		wad->m_File = std::make_unique<CFile>();
+		*wad->m_File = std::move( file );
+	}
+
+	return wad;
+}
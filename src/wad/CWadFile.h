@@ -5,82 +5,55 @@
 #include <cstdint>
 #include <cstring>
 #include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
 
 #include "Platform.h"
 
 #include "WadFile.h"
 
+class CFile;
+
 /**
-*	Lightweight wrapper around a wad file.
+*	Read-only view of a wad file.
+*	Only the directory is read when the wad is opened. Lump data is accessed in place through a memory mapping of the file,
+*	or, if the file can't be mapped, read from the file the first time it's requested.
+*	@see OpenWadFile
 */
 class CWadFile final
 {
 public:
-	/**
-	*	Constructor.
-	*	@param pszFilename Name of the wad. Excluding path and extension.
-	*	@param pWad Wad to take ownership of. The wad will be freed unless ownership is released by calling Release.
-	*	@see Release
-	*/
-	CWadFile( const char* const pszFilename, wadinfo_t* pWad )
-		: m_pWad( pWad )
-	{
-		strncpy( m_szFilename, pszFilename, sizeof( m_szFilename ) );
-
-		m_szFilename[ sizeof( m_szFilename ) - 1 ] = '\0';
-	}
-
 	/**
 	*	Destructor.
 	*/
-	~CWadFile()
-	{
-		delete[] m_pWad;
-	}
+	~CWadFile();
 
 	/**
 	*	@return Whether this wad file is still valid.
 	*/
-	bool IsValid() const { return m_pWad != nullptr; }
+	bool IsValid() const { return m_pMapped != nullptr || m_File; }
 
 	/**
-	*	@return Filename of this wad.
+	*	@return Whether the file is memory mapped (true) or read on demand (false).
 	*/
-	const char* GetFilename() const { return m_szFilename; }
+	bool IsMapped() const { return m_pMapped != nullptr; }
 
 	/**
-	*	@return The wad file.
-	*/
-	const wadinfo_t* Get() const { return m_pWad; }
-
-	/**
-	*	Releases ownership of the wad file.
-	*	@return The wad file, or nullptr if ownership was already released.
+	*	@return Filename of this wad.
 	*/
-	wadinfo_t* Release()
-	{
-		memset( m_szFilename, 0, sizeof( m_szFilename ) );
-
-		wadinfo_t* pWad = m_pWad;
-
-		m_pWad = nullptr;
-
-		return pWad;
-	}
+	const char* GetFilename() const { return m_szFilename; }
 
 	/**
 	*	@return Number of lumps in this wad.
 	*/
-	int GetNumLumps() const { return m_pWad->numlumps; }
+	int GetNumLumps() const { return static_cast<int>( m_Lumps.size() ); }
 
 	/**
-	*	Gets the array of lumps.
+	*	Gets the array of lumps. Names are uppercased and values are in native byte order.
 	*	@return Lump array.
 	*/
-	const lumpinfo_t* GetLumps() const
-	{
-		return reinterpret_cast<const lumpinfo_t*>( reinterpret_cast<uint8_t*>( m_pWad ) + m_pWad->infotableofs );
-	}
+	const lumpinfo_t* GetLumps() const { return m_Lumps.data(); }
 
 	/**
 	*	Gets the requested lump by index.
@@ -89,10 +62,9 @@ public:
 	*/
 	const lumpinfo_t* GetLumpByIndex( const int iLump ) const
 	{
-		assert( m_pWad );
-		assert( iLump >= 0 && iLump < m_pWad->numlumps );
+		assert( iLump >= 0 && iLump < GetNumLumps() );
 
-		if( iLump < 0 || iLump >= m_pWad->numlumps )
+		if( iLump < 0 || iLump >= GetNumLumps() )
 			return nullptr;
 
 		return &GetLumps()[ iLump ];
@@ -106,14 +78,17 @@ public:
 	*/
 	const lumpinfo_t* GetLumpByName( const char* const pszName, const int iLumpType = TYP_NONE ) const
 	{
-		assert( m_pWad );
 		assert( pszName );
 
+		//Names that use the entire buffer aren't null terminated, so longer names can't match.
+		if( strlen( pszName ) > WAD_MAX_LUMP_NAME_SIZE )
+			return nullptr;
+
 		const lumpinfo_t* pLump = GetLumps();
 
-		for( int iLump = 0; iLump < m_pWad->numlumps; ++iLump, ++pLump )
+		for( int iLump = 0; iLump < GetNumLumps(); ++iLump, ++pLump )
 		{
-			if( stricmp( pszName, pLump->name ) == 0 )
+			if( strnicmp( pszName, pLump->name, WAD_MAX_LUMP_NAME_SIZE ) == 0 )
 			{
 				if( iLumpType != TYP_NONE )
 				{
@@ -130,30 +105,58 @@ public:
 
 	/**
 	*	Gets the data pointed to by the given lump.
-	*	@return Lump data, or null if the lump is invalid.
+	*	If the file isn't mapped, the lump is read the first time it's requested, and kept until the wad is closed.
+	*	@return Lump data, or null if the lump is invalid or lies outside of the file.
 	*/
-	const void* GetLumpData( const lumpinfo_t* pLump ) const
-	{
-		assert( m_pWad );
-		assert( pLump );
-
-		if( !pLump )
-			return nullptr;
+	const void* GetLumpData( const lumpinfo_t* pLump ) const;
 
-		//Check if the lump is actually from this wad.
-		if( pLump < GetLumps() || pLump >= GetLumps() + GetNumLumps() )
-			return nullptr;
+private:
+	friend std::unique_ptr<CWadFile> OpenWadFile( const char* const pszFileName, const char* const pszName, const bool bAllowMapping );
 
-		return reinterpret_cast<const uint8_t*>( m_pWad ) + pLump->filepos;
-	}
+	CWadFile() = default;
 
 private:
-	char m_szFilename[ MAX_PATH ];
-	wadinfo_t* m_pWad;
+	char m_szFilename[ MAX_PATH ] = {};
+
+	/**
+	*	Copy of the directory.
+	*/
+	std::vector<lumpinfo_t> m_Lumps;
+
+	/**
+	*	Size of the file, in bytes.
+	*/
+	uint64_t m_uiSize = 0;
+
+	/**
+	*	Mapping returned by the filesystem, if the file is mapped.
+	*/
+	const void* m_pMapped = nullptr;
+
+	/**
+	*	The open file, if the file is not mapped.
+	*/
+	std::unique_ptr<CFile> m_File;
+
+	/**
+	*	Lumps that have been read from the file, by lump index.
+	*/
+	mutable std::unordered_map<int, std::unique_ptr<uint8_t[]>> m_LoadedLumps;
+
+	mutable std::mutex m_Mutex;
 
 private:
 	CWadFile( const CWadFile& ) = delete;
 	CWadFile& operator=( const CWadFile& ) = delete;
 };
 
-#endif //WAD_CWADFILE_H
\ No newline at end of file
+/**
+*	Opens a wad file for read-only access. Only the header and directory are read.
+*	@param pszFileName Name of the file to open.
+*	@param pszName Name of the wad. Excluding path and extension.
+*	@param bAllowMapping Whether the file may be memory mapped. If false, or if mapping fails, lumps are read from the file when they're requested.
+*	@return The wad file, or null if the file couldn't be opened or is invalid.
+*/
+std::unique_ptr<CWadFile> OpenWadFile( const char* const pszFileName, const char* const pszName, const bool bAllowMapping = true );
+
+#endif //WAD_CWADFILE_H
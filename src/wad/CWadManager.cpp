@@ -1,6 +1,8 @@
 #include <algorithm>
 #include <cassert>
 #include <cstdio>
+#include <cstring>
+#include <unordered_set>
 
 #include "CWadFile.h"
 #include "WadIO.h"
@@ -11,7 +13,7 @@ CWadManager g_WadManager;
 
 CWadManager::~CWadManager()
 {
-	Clear();
+	Shutdown();
 }
 
 void CWadManager::SetBasePath( const char* const pszBasePath )
@@ -21,6 +23,10 @@ void CWadManager::SetBasePath( const char* const pszBasePath )
 	if( !pszBasePath )
 		return;
 
+	//Wads that are open were found in the old path.
+	if( strcmp( m_szBasePath, pszBasePath ) )
+		Shutdown();
+
 	strncpy( m_szBasePath, pszBasePath, sizeof( m_szBasePath ) );
 
 	m_szBasePath[ sizeof( m_szBasePath ) -1 ] = '\0';
@@ -40,7 +46,7 @@ const CWadFile* CWadManager::FindWadByName( const char* const pszWadName ) const
 	}
 	);
 
-	return it != m_WadFiles.end() ? it->get() : nullptr;
+	return it != m_WadFiles.end() ? *it : nullptr;
 }
 
 const miptex_t* CWadManager::FindTextureByName( const char* const pszTextureName ) const
@@ -50,16 +56,20 @@ const miptex_t* CWadManager::FindTextureByName( const char* const pszTextureName
 	if( !pszTextureName )
 		return nullptr;
 
-	for( const auto& wad : m_WadFiles )
-	{
-		if( auto pLump = wad->GetLumpByName( pszTextureName, TYP_LUMPY + TYP_LUMPY_MIPTEX ) )
-		{
-			if( auto pTexture = reinterpret_cast<const miptex_t*>( wad->GetLumpData( pLump ) ) )
-				return pTexture;
-		}
-	}
+	//Lump names are at most WAD_MAX_LUMP_NAME_SIZE characters, longer names can't match.
+	if( strlen( pszTextureName ) > WAD_MAX_LUMP_NAME_SIZE )
+		return nullptr;
+
+	char szName[ WAD_MAX_LUMP_NAME_SIZE + 1 ];
+
+	CleanupWadLumpName( pszTextureName, szName, sizeof( szName ) );
+
+	auto it = m_TextureIndex.find( szName );
+
+	if( it == m_TextureIndex.end() )
+		return nullptr;
 
-	return nullptr;
+	return reinterpret_cast<const miptex_t*>( it->second.pWad->GetLumpData( it->second.pLump ) );
 }
 
 CWadManager::AddResult CWadManager::AddWad( const char* const pszWadName )
@@ -79,13 +89,28 @@ CWadManager::AddResult CWadManager::AddWad( const char* const pszWadName )
 	if( iResult < 0 || static_cast<size_t>( iResult ) >= sizeof( szPath ) )
 		return AddResult::INVALID_NAME;
 
-	auto pWad = LoadWadFile( szPath );
+	auto itOpen = std::find_if( m_OpenWadFiles.begin(), m_OpenWadFiles.end(),
+	[ = ]( const auto& wad )
+	{
+		return stricmp( pszWadName, wad->GetFilename() ) == 0;
+	}
+	);
+
+	//Reuse the wad if an earlier map opened it.
+	if( itOpen == m_OpenWadFiles.end() )
+	{
+		auto wad = OpenWadFile( szPath, pszWadName, m_bMappingEnabled );
+
+		//TODO: could've been an I/O error - Solokiller
+		if( !wad )
+			return AddResult::FILE_NOT_FOUND;
+
+		itOpen = m_OpenWadFiles.emplace( m_OpenWadFiles.end(), std::move( wad ) );
+	}
 
-	//TODO: could've been an I/O error - Solokiller
-	if( !pWad )
-		return AddResult::FILE_NOT_FOUND;
+	m_WadFiles.emplace_back( itOpen->get() );
 
-	m_WadFiles.emplace_back( std::make_unique<CWadFile>( pszWadName, pWad ) );
+	IndexTextures( *m_WadFiles.back() );
 
 	printf( "Using wad file \"%s%s\"\n", pszWadName, WAD_FILE_EXT );
 
@@ -94,6 +119,41 @@ CWadManager::AddResult CWadManager::AddWad( const char* const pszWadName )
 
 void CWadManager::Clear()
 {
+	m_TextureIndex.clear();
+
 	m_WadFiles.clear();
-	m_WadFiles.shrink_to_fit();
-}
\ No newline at end of file
+}
+
+void CWadManager::Shutdown()
+{
+	Clear();
+
+	m_OpenWadFiles.clear();
+	m_OpenWadFiles.shrink_to_fit();
+}
+void CWadManager::IndexTextures( const CWadFile& wad )
+{
+	//Names seen in this wad, including lumps that aren't textures. Only the first lump with a given name can be found in a wad.
+	std::unordered_set<std::string> seenNames;
+
+	seenNames.reserve( wad.GetNumLumps() );
+
+	m_TextureIndex.reserve( m_TextureIndex.size() + wad.GetNumLumps() );
+
+	const lumpinfo_t* pLump = wad.GetLumps();
+
+	for( int iLump = 0; iLump < wad.GetNumLumps(); ++iLump, ++pLump )
+	{
+		//Names are uppercased on load, and aren't null terminated if they use the entire buffer.
+		std::string szName( pLump->name, strnlen( pLump->name, WAD_MAX_LUMP_NAME_SIZE ) );
+
+		if( !seenNames.insert( szName ).second )
+			continue;
+
+		if( pLump->type != TYP_LUMPY + TYP_LUMPY_MIPTEX )
+			continue;
+
+		//Wads that were added earlier take priority.
+		m_TextureIndex.emplace( std::move( szName ), TextureEntry_t{ &wad, pLump } );
+	}
+}
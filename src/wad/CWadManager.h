@@ -2,11 +2,14 @@
 #define WAD_CWADMANAGER_H
 
 #include <memory>
+#include <string>
+#include <unordered_map>
 #include <vector>
 
 #include "Platform.h"
 
 class CWadFile;
+struct lumpinfo_t;
 struct miptex_t;
 
 /**
@@ -39,7 +42,22 @@ public:
 	};
 
 private:
-	typedef std::vector<std::unique_ptr<CWadFile>> WadFiles_t;
+	typedef std::vector<std::unique_ptr<CWadFile>> OpenWadFiles_t;
+	typedef std::vector<const CWadFile*> WadFiles_t;
+
+	/**
+	*	Texture lump found in the index.
+	*/
+	struct TextureEntry_t
+	{
+		const CWadFile* pWad;
+		const lumpinfo_t* pLump;
+	};
+
+	/**
+	*	Maps uppercased texture names to the lump that FindTextureByName returns for them.
+	*/
+	typedef std::unordered_map<std::string, TextureEntry_t> TextureIndex_t;
 
 public:
 	/**
@@ -58,7 +76,27 @@ public:
 	const char* GetBasePath() const { return m_szBasePath; }
 
 	/**
-	*	Sets the base path.
+	*	@return Number of loaded wads.
+	*/
+	size_t GetNumWads() const { return m_WadFiles.size(); }
+
+	/**
+	*	@return The wad at the given index, in the order that they were added.
+	*/
+	const CWadFile* GetWad( const size_t uiIndex ) const { return m_WadFiles[ uiIndex ]; }
+
+	/**
+	*	@return Whether wads are memory mapped. If not, textures are read from the file when they're requested.
+	*/
+	bool IsMappingEnabled() const { return m_bMappingEnabled; }
+
+	/**
+	*	Sets whether wads are memory mapped. Only affects wads that are opened afterwards.
+	*/
+	void SetMappingEnabled( const bool bEnabled ) { m_bMappingEnabled = bEnabled; }
+
+	/**
+	*	Sets the base path. If it changes, open wads are closed.
 	*/
 	void SetBasePath( const char* const pszBasePath );
 
@@ -70,14 +108,15 @@ public:
 	const CWadFile* FindWadByName( const char* const pszWadName ) const;
 
 	/**
-	*	Finds a texture by name by searching all wads.
+	*	Finds a texture by name by searching all wads. If multiple wads contain the texture, the wad that was added first wins.
+	*	Names are looked up case insensitively in an index that is kept up to date by AddWad, so this does not depend on the number of wads.
 	*	@param pszTextureName Name to search for.
 	*	@return Texture, or null if the texture couldn't be found.
 	*/
 	const miptex_t* FindTextureByName( const char* const pszTextureName ) const;
 
 	/**
-	*	Adds a wad. This will load the wad and add it if it exists.
+	*	Adds a wad. This will open the wad and add it if it exists. Wads that are still open from earlier maps are reused.
 	*	@param pszWadName Name of the wad to load. This excludes the path and extension.
 	*	@return AddResult value.
 	*	@see AddResult
@@ -85,15 +124,38 @@ public:
 	AddResult AddWad( const char* const pszWadName );
 
 	/**
-	*	Removes all wads.
+	*	Removes all wads. The wad files stay open so later maps that use them don't have to open them again.
 	*/
 	void Clear();
 
+	/**
+	*	Removes all wads and closes the wad files.
+	*/
+	void Shutdown();
+
+private:
+	/**
+	*	Adds the textures of a newly added wad to the index.
+	*/
+	void IndexTextures( const CWadFile& wad );
+
 private:
 	char m_szBasePath[ MAX_PATH ] = {};
 
+	/**
+	*	Every wad that has been opened, in the order they were opened.
+	*/
+	OpenWadFiles_t m_OpenWadFiles;
+
+	/**
+	*	Wads that are in use, in the order they were added.
+	*/
 	WadFiles_t m_WadFiles;
 
+	bool m_bMappingEnabled = true;
+
+	TextureIndex_t m_TextureIndex;
+
 private:
 	CWadManager( const CWadManager& ) = delete;
 	CWadManager& operator=( const CWadManager& ) = delete;
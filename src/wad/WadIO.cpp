@@ -9,72 +9,12 @@
 ****/
 #include <cassert>
 #include <cctype>
-#include <cstdio>
 #include <cstdint>
-#include <memory>
 
-#include "common/ByteSwap.h"
 #include "Platform.h"
 
-#include "Engine.h"
-#include "FileSystem2.h"
-#include "CFile.h"
-
 #include "WadIO.h"
 
-wadinfo_t* LoadWadFile( const char* const pszFileName )
-{
-	assert( pszFileName );
-
-	CFile file( pszFileName, "rb" );
-
-	if( !file.IsOpen() )
-	{
-		printf( "LoadWadFile: Couldn't open WAD \"%s\"\n", pszFileName );
-		return nullptr;
-	}
-
-	const auto size = file.Size();
-
-	wadinfo_t* pWad = reinterpret_cast<wadinfo_t*>( new uint8_t[ size ] );
-
-	const auto read = file.Read( pWad, size );
-
-	file.Close();
-
-	if( read != size )
-	{
-		printf( "LoadWadFile: Failed to read WAD file \"%s\" (expected %u, got %u)\n", pszFileName, size, read );
-		delete[] pWad;
-
-		return nullptr;
-	}
-
-	if( strncmp( WAD2_ID, pWad->identification, 4 ) && strncmp( WAD3_ID, pWad->identification, 4 ) )
-	{
-		printf( "LoadWadFile: File \"%s\" is not a WAD2 or WAD3 file\n", pszFileName );
-		delete[] pWad;
-		return nullptr;
-	}
-
-	pWad->infotableofs = LittleValue( pWad->infotableofs );
-	pWad->numlumps = LittleValue( pWad->numlumps );
-
-	lumpinfo_t* pLump = reinterpret_cast<lumpinfo_t*>( reinterpret_cast<uint8_t*>( pWad ) + pWad->infotableofs );
-
-	//Swap all variables, clean up names.
-	for( int iLump = 0; iLump < pWad->numlumps; ++iLump, ++pLump )
-	{
-		CleanupWadLumpName( pLump->name, pLump->name, sizeof( pLump->name ) );
-
-		pLump->filepos		= LittleValue( pLump->filepos );
-		pLump->disksize		= LittleValue( pLump->disksize );
-		pLump->size			= LittleValue( pLump->size );
-	}
-
-	return pWad;
-}
-
 void CleanupWadLumpName( const char* in, char* out, const size_t uiBufferSize )
 {
 	//Must be large enough to fit at least an entire name.